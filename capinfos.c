@@ -172,6 +172,15 @@ static gchar file_md5[HASH_STR_SIZE];
 #define FILE_HASH_OPT ""
 #endif /* HAVE_LIBGCRYPT */
 
+#ifdef USE_THREADS
+#define THREADS_OPT "j:"
+#else
+#define THREADS_OPT ""
+#endif
+
+/* Number of record headers to fetch from wiretap at a time */
+#define CAPINFOS_SCAN_RECORDS 4096
+
 typedef struct _capture_info {
   const char    *filename;
   guint16       file_type;
@@ -315,7 +324,8 @@ print_stats(const gchar *filename, capture_info *cf_info)
   time_t                stop_time_t;
 
   /* Build printable strings for various stats */
-  file_type_string = wtap_file_type_string(cf_info->file_type);
+  file_type_string = (cf_info->file_type == WTAP_FILE_UNKNOWN) ?
+    "(more than one)" : wtap_file_type_string(cf_info->file_type);
   file_encap_string = wtap_encap_string(cf_info->file_encap);
   start_time_t = (time_t)cf_info->start_time;
   stop_time_t = (time_t)cf_info->stop_time;
@@ -424,7 +434,8 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
   time_t                stop_time_t;
 
   /* Build printable strings for various stats */
-  file_type_string = wtap_file_type_string(cf_info->file_type);
+  file_type_string = (cf_info->file_type == WTAP_FILE_UNKNOWN) ?
+    "(more than one)" : wtap_file_type_string(cf_info->file_type);
   file_encap_string = wtap_encap_string(cf_info->file_encap);
   start_time_t = (time_t)cf_info->start_time;
   stop_time_t = (time_t)cf_info->stop_time;
@@ -583,19 +594,68 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
   printf("\n");
 }
 
-static int
-process_cap_file(wtap *wth, const char *filename)
+/*
+ * Compute the summary statistics from the totals in a capture_info.
+ */
+static void
+compute_rates(capture_info *cf_info)
+{
+  cf_info->duration = cf_info->stop_time - cf_info->start_time;
+  cf_info->data_rate   = 0.0;
+  cf_info->packet_rate = 0.0;
+  cf_info->packet_size = 0.0;
+
+  if (cf_info->packet_count > 0) {
+    if (cf_info->duration > 0.0) {
+      cf_info->data_rate   = (double)cf_info->packet_bytes / cf_info->duration; /* Data rate per second */
+      cf_info->packet_rate = (double)cf_info->packet_count / cf_info->duration; /* packet rate per second */
+    }
+    cf_info->packet_size = (double)cf_info->packet_bytes / cf_info->packet_count; /* Avg packet size */
+  }
+}
+
+/*
+ * A file being looked at.  Its statistics may be gathered on a worker
+ * thread, but they're reported by the main thread, in the order in
+ * which the files were given.
+ */
+typedef struct _capinfos_file {
+  const char   *filename;
+  wtap         *wth;
+  gboolean      open_failed;
+  gboolean      done;                   /* statistics gathered */
+  gchar        *err_msg;                /* if we couldn't gather them */
+  /* An error reading the file; it's reported by the main thread, as
+     wtap_strerror() isn't thread-safe */
+  int           read_err;
+  gchar        *read_err_info;
+  guint32       read_err_packets;       /* packets read before it */
+  capture_info  cf_info;
+} capinfos_file;
+
+#ifdef USE_THREADS
+static GMutex *files_mtx;
+static GCond  *files_cond;
+#endif
+
+/*
+ * Gather the statistics for a file, and close it.
+ */
+static void
+process_cap_file(capinfos_file *cfile)
 {
+  wtap                  *wth = cfile->wth;
   int                   err;
   gchar                 *err_info;
   gint64                size;
-  gint64                data_offset;
+  wtap_header_scan_t    *scan;
+  gboolean              more;
+  guint                 i;
 
   guint32               packet = 0;
   gint64                bytes  = 0;
   guint32               snaplen_min_inferred = 0xffffffff;
   guint32               snaplen_max_inferred =          0;
-  const struct wtap_pkthdr *phdr;
   capture_info          cf_info;
   double                start_time = 0;
   double                stop_time  = 0;
@@ -605,77 +665,81 @@ process_cap_file(wtap *wth, const char *filename)
 
   cf_info.encap_counts = g_malloc0(WTAP_NUM_ENCAP_TYPES * sizeof(int));
 
-  /* Tally up data that we need to parse through the file to find */
-  while (wtap_read(wth, &err, &err_info, &data_offset))  {
-    phdr = wtap_phdr(wth);
-    prev_time = cur_time;
-    cur_time = secs_nsecs(&phdr->ts);
-    if(packet==0) {
-      start_time = cur_time;
-      stop_time = cur_time;
+  /* Tally up data that we need to parse through the file to find;
+     we only need the record headers, not the packet data. */
+  scan = wtap_header_scan_new(CAPINFOS_SCAN_RECORDS);
+  do {
+    more = wtap_scan_headers(wth, scan, &err, &err_info);
+    for (i = 0; i < scan->num_records; i++) {
       prev_time = cur_time;
-    }
-    if (cur_time < prev_time) {
-      in_order = FALSE;
-    }
-    if (cur_time < start_time) {
-      start_time = cur_time;
-    }
-    if (cur_time > stop_time) {
-      stop_time = cur_time;
-    }
+      cur_time = secs_nsecs(&scan->ts[i]);
+      if(packet==0) {
+        start_time = cur_time;
+        stop_time = cur_time;
+        prev_time = cur_time;
+      }
+      if (cur_time < prev_time) {
+        in_order = FALSE;
+      }
+      if (cur_time < start_time) {
+        start_time = cur_time;
+      }
+      if (cur_time > stop_time) {
+        stop_time = cur_time;
+      }
 
-    bytes+=phdr->len;
-    packet++;
-
-    /* If caplen < len for a rcd, then presumably           */
-    /* 'Limit packet capture length' was done for this rcd. */
-    /* Keep track as to the min/max actual snapshot lengths */
-    /*  seen for this file.                                 */
-    if (phdr->caplen < phdr->len) {
-      if (phdr->caplen < snaplen_min_inferred)
-        snaplen_min_inferred = phdr->caplen;
-      if (phdr->caplen > snaplen_max_inferred)
-        snaplen_max_inferred = phdr->caplen;
-    }
+      bytes+=scan->lens[i];
+      packet++;
+
+      /* If caplen < len for a rcd, then presumably           */
+      /* 'Limit packet capture length' was done for this rcd. */
+      /* Keep track as to the min/max actual snapshot lengths */
+      /*  seen for this file.                                 */
+      if (scan->caplens[i] < scan->lens[i]) {
+        if (scan->caplens[i] < snaplen_min_inferred)
+          snaplen_min_inferred = scan->caplens[i];
+        if (scan->caplens[i] > snaplen_max_inferred)
+          snaplen_max_inferred = scan->caplens[i];
+      }
 
-    /* Per-packet encapsulation */
-    if (wtap_file_encap(wth) == WTAP_ENCAP_PER_PACKET) {
-        if ((phdr->pkt_encap > 0) && (phdr->pkt_encap < WTAP_NUM_ENCAP_TYPES)) {
-            cf_info.encap_counts[phdr->pkt_encap] += 1;
-        } else {
-            fprintf(stderr, "capinfos: Unknown per-packet encapsulation: %d [frame number: %d]\n", phdr->pkt_encap, packet);
-        }
+      /* Per-packet encapsulation */
+      if (wtap_file_encap(wth) == WTAP_ENCAP_PER_PACKET) {
+          if ((scan->pkt_encaps[i] > 0) && (scan->pkt_encaps[i] < WTAP_NUM_ENCAP_TYPES)) {
+              cf_info.encap_counts[scan->pkt_encaps[i]] += 1;
+          } else {
+              fprintf(stderr, "capinfos: Unknown per-packet encapsulation: %d [frame number: %d]\n", scan->pkt_encaps[i], packet);
+          }
+      }
     }
-
-  } /* while */
+  } while (more);
+  wtap_header_scan_free(scan);
 
   if (err != 0) {
-    fprintf(stderr,
-            "capinfos: An error occurred after reading %u packets from \"%s\": %s.\n",
-            packet, filename, wtap_strerror(err));
+    cfile->read_err = err;
+    cfile->read_err_packets = packet;
     switch (err) {
 
     case WTAP_ERR_UNSUPPORTED:
     case WTAP_ERR_UNSUPPORTED_ENCAP:
     case WTAP_ERR_BAD_RECORD:
     case WTAP_ERR_DECOMPRESS:
-      fprintf(stderr, "(%s)\n", err_info);
-      g_free(err_info);
+      cfile->read_err_info = err_info;
       break;
     }
     g_free(cf_info.encap_counts);
-    return 1;
+    wtap_close(wth);
+    return;
   }
 
   /* File size */
   size = wtap_file_size(wth, &err);
   if (size == -1) {
-    fprintf(stderr,
+    cfile->err_msg = g_strdup_printf(
             "capinfos: Can't get size of \"%s\": %s.\n",
-            filename, g_strerror(err));
+            cfile->filename, g_strerror(err));
     g_free(cf_info.encap_counts);
-    return 1;
+    wtap_close(wth);
+    return;
   }
 
   cf_info.filesize = size;
@@ -702,35 +766,88 @@ process_cap_file(wtap *wth, const char *filename)
   /* File Times */
   cf_info.start_time = start_time;
   cf_info.stop_time = stop_time;
-  cf_info.duration = stop_time-start_time;
   cf_info.in_order = in_order;
 
   /* Number of packet bytes */
   cf_info.packet_bytes = bytes;
 
-  cf_info.data_rate   = 0.0;
-  cf_info.packet_rate = 0.0;
-  cf_info.packet_size = 0.0;
+  compute_rates(&cf_info);
 
-  if (packet > 0) {
-    if (cf_info.duration > 0.0) {
-      cf_info.data_rate   = (double)bytes  / (stop_time-start_time); /* Data rate per second */
-      cf_info.packet_rate = (double)packet / (stop_time-start_time); /* packet rate per second */
-    }
-    cf_info.packet_size = (double)bytes / packet;                  /* Avg packet size      */
-  }
+  cf_info.filename = cfile->filename;
+  cfile->cf_info = cf_info;
+  wtap_close(wth);
+}
+
+#ifdef USE_THREADS
+static void
+process_cap_file_worker(gpointer data, gpointer user_data _U_)
+{
+  capinfos_file *cfile = (capinfos_file *)data;
+
+  process_cap_file(cfile);
+
+  g_mutex_lock(files_mtx);
+  cfile->done = TRUE;
+  g_cond_broadcast(files_cond);
+  g_mutex_unlock(files_mtx);
+}
+#endif
+
+/*
+ * Add one file's statistics to the combined statistics for all the files.
+ * The files are treated as one capture, in the order in which they were
+ * given.
+ */
+static void
+add_to_totals(capture_info *totals, guint32 nfiles, const capture_info *cf_info)
+{
+  int i;
 
-  if(long_report) {
-    print_stats(filename, &cf_info);
+  if (nfiles == 0) {
+    *totals = *cf_info;
+    totals->encap_counts = g_malloc0(WTAP_NUM_ENCAP_TYPES * sizeof(int));
   } else {
-    print_stats_table(filename, &cf_info);
+    if (totals->file_type != cf_info->file_type)
+      totals->file_type = WTAP_FILE_UNKNOWN;
+    if (totals->file_encap != cf_info->file_encap)
+      totals->file_encap = WTAP_ENCAP_PER_PACKET;
+    totals->filesize += cf_info->filesize;
+    totals->packet_bytes += cf_info->packet_bytes;
+    if (cf_info->packet_count > 0) {
+      if (totals->packet_count == 0) {
+        totals->start_time = cf_info->start_time;
+        totals->stop_time = cf_info->stop_time;
+      } else {
+        if (cf_info->start_time < totals->stop_time)
+          totals->in_order = FALSE;
+        if (cf_info->start_time < totals->start_time)
+          totals->start_time = cf_info->start_time;
+        if (cf_info->stop_time > totals->stop_time)
+          totals->stop_time = cf_info->stop_time;
+      }
+    }
+    totals->packet_count += cf_info->packet_count;
+    totals->snap_set = totals->snap_set && cf_info->snap_set;
+    if (cf_info->snaplen > totals->snaplen)
+      totals->snaplen = cf_info->snaplen;
+    if (cf_info->snaplen_min_inferred < totals->snaplen_min_inferred)
+      totals->snaplen_min_inferred = cf_info->snaplen_min_inferred;
+    if (cf_info->snaplen_max_inferred > totals->snaplen_max_inferred)
+      totals->snaplen_max_inferred = cf_info->snaplen_max_inferred;
+    totals->in_order = totals->in_order && cf_info->in_order;
   }
 
-  g_free(cf_info.encap_counts);
-
-  return 0;
+  /* Per-packet encapsulation */
+  if (cf_info->file_encap == WTAP_ENCAP_PER_PACKET) {
+    for (i = 0; i < WTAP_NUM_ENCAP_TYPES; i++)
+      totals->encap_counts[i] += cf_info->encap_counts[i];
+  } else if (cf_info->file_encap > 0 && cf_info->file_encap < WTAP_NUM_ENCAP_TYPES) {
+    totals->encap_counts[cf_info->file_encap] += cf_info->packet_count;
+  }
+  compute_rates(totals);
 }
 
+
 static void
 usage(gboolean is_error)
 {
@@ -800,6 +917,10 @@ usage(gboolean is_error)
   fprintf(output, "  -h display this help and exit\n");
   fprintf(output, "  -C cancel processing if file open fails (default is to continue)\n");
   fprintf(output, "  -A generate all infos (default)\n");
+  fprintf(output, "  -M also report the totals for all the files, taken as one capture\n");
+#ifdef USE_THREADS
+  fprintf(output, "  -j <threads> look at that many files at once, on worker threads\n");
+#endif
   fprintf(output, "\n");
   fprintf(output, "Options are processed from left to right order with later options superceeding\n");
   fprintf(output, "or adding to earlier options.\n");
@@ -835,16 +956,83 @@ hash_to_str(const unsigned char *hash, size_t length, char *str) {
 }
 #endif /* HAVE_LIBGCRYPT */
 
-int
-main(int argc, char *argv[])
+#ifdef USE_THREADS
+static int
+get_positive_int(const char *string, const char *name)
+{
+  long number;
+  char *p;
+
+  number = strtol(string, &p, 10);
+  if (p == string || *p != '\0') {
+    fprintf(stderr, "capinfos: The specified %s \"%s\" isn't a decimal number\n",
+            name, string);
+    exit(1);
+  }
+  if (number <= 0 || number > G_MAXINT) {
+    fprintf(stderr, "capinfos: The specified %s is zero, negative or too large\n",
+            name);
+    exit(1);
+  }
+  return (int)number;
+}
+#endif
+
+/*
+ * Open a file and get its statistics gathered, on a worker thread if we
+ * have any.
+ */
+static void
+open_cap_file(capinfos_file *cfile, GThreadPool *pool _U_)
 {
-  wtap  *wth;
   int    err;
   gchar *err_info;
+
+  cfile->wth = wtap_open_offline(cfile->filename, &err, &err_info, FALSE);
+  if (!cfile->wth) {
+    switch (err) {
+
+    case WTAP_ERR_UNSUPPORTED:
+    case WTAP_ERR_UNSUPPORTED_ENCAP:
+    case WTAP_ERR_BAD_RECORD:
+      cfile->err_msg = g_strdup_printf("capinfos: Can't open %s: %s\n(%s)\n",
+        cfile->filename, wtap_strerror(err), err_info);
+      g_free(err_info);
+      break;
+
+    default:
+      cfile->err_msg = g_strdup_printf("capinfos: Can't open %s: %s\n",
+        cfile->filename, wtap_strerror(err));
+      break;
+    }
+    cfile->open_failed = TRUE;
+    cfile->done = TRUE;
+    return;
+  }
+
+#ifdef USE_THREADS
+  if (pool != NULL) {
+    g_thread_pool_push(pool, cfile, NULL);
+    return;
+  }
+#endif
+  process_cap_file(cfile);
+  cfile->done = TRUE;
+}
+
+int
+main(int argc, char *argv[])
+{
   int    opt;
   int    overall_error_status;
+  capinfos_file *files;
+  int    nfiles, next_open, i;
+  int    threads = 0;
+  GThreadPool *pool = NULL;
+  gboolean report_totals = FALSE;
+  capture_info totals;
+  guint32 totals_nfiles = 0;
 
-  int status = 0;
 #ifdef HAVE_PLUGINS
   char  *init_progfile_dir_error;
 #endif
@@ -878,7 +1066,7 @@ main(int argc, char *argv[])
 
   /* Process the options */
 
-  while ((opt = getopt(argc, argv, "tEcs" FILE_HASH_OPT "dluaeyizvhxoCALTRrSNqQBmb")) !=-1) {
+  while ((opt = getopt(argc, argv, "tEcs" FILE_HASH_OPT "dluaeyizvhxoCALTRrSNqQBmbM" THREADS_OPT)) !=-1) {
 
     switch (opt) {
 
@@ -967,6 +1155,16 @@ main(int argc, char *argv[])
       continue_after_wtap_open_offline_failure = FALSE;
       break;
 
+    case 'M':
+      report_totals = TRUE;
+      break;
+
+#ifdef USE_THREADS
+    case 'j':
+      threads = get_positive_int(optarg, "number of threads");
+      break;
+#endif
+
     case 'A':
       enable_all_infos();
       break;
@@ -1046,7 +1244,69 @@ main(int argc, char *argv[])
 
   overall_error_status = 0;
 
-  for (opt = optind; opt < argc; opt++) {
+#ifdef USE_THREADS
+  if (threads > 1) {
+    if (!g_thread_supported())
+      g_thread_init(NULL);
+    files_mtx = g_mutex_new();
+    files_cond = g_cond_new();
+    pool = g_thread_pool_new(process_cap_file_worker, NULL, threads, TRUE, NULL);
+  }
+#endif
+
+  /*
+   * Open the files a few at a time ahead of the one being reported on,
+   * so that the workers have something to do without our running out
+   * of file descriptors.
+   */
+  nfiles = argc - optind;
+  files = (capinfos_file *)g_malloc0(nfiles * sizeof(capinfos_file));
+  next_open = 0;
+
+  for (i = 0; i < nfiles; i++) {
+    capinfos_file *cfile = &files[i];
+
+    for (; next_open < nfiles && next_open <= i + 2 * threads; next_open++) {
+      files[next_open].filename = argv[optind + next_open];
+      open_cap_file(&files[next_open], pool);
+    }
+
+#ifdef USE_THREADS
+    if (pool != NULL) {
+      g_mutex_lock(files_mtx);
+      while (!cfile->done)
+        g_cond_wait(files_cond, files_mtx);
+      g_mutex_unlock(files_mtx);
+    }
+#endif
+
+    if (cfile->open_failed) {
+      fprintf(stderr, "%s", cfile->err_msg);
+      g_free(cfile->err_msg);
+      overall_error_status = 1; /* remember that an error has occurred */
+      if(!continue_after_wtap_open_offline_failure)
+        exit(1); /* error status */
+      continue;
+    }
+
+    if ((i > 0) && (long_report))
+      printf("\n");
+    if (cfile->read_err != 0) {
+      if (cfile->read_err_info != NULL)
+        fprintf(stderr,
+            "capinfos: An error occurred after reading %u packets from \"%s\": %s.\n(%s)\n",
+            cfile->read_err_packets, cfile->filename, wtap_strerror(cfile->read_err),
+            cfile->read_err_info);
+      else
+        fprintf(stderr,
+            "capinfos: An error occurred after reading %u packets from \"%s\": %s.\n",
+            cfile->read_err_packets, cfile->filename, wtap_strerror(cfile->read_err));
+      exit(1);
+    }
+    if (cfile->err_msg != NULL) {
+      fprintf(stderr, "%s", cfile->err_msg);
+      exit(1);
+    }
 
 #ifdef HAVE_LIBGCRYPT
     g_strlcpy(file_sha1, "<unknown>", HASH_STR_SIZE);
@@ -1054,7 +1314,7 @@ main(int argc, char *argv[])
     g_strlcpy(file_md5, "<unknown>", HASH_STR_SIZE);
 
     if (cap_file_hashes) {
-      fh = ws_fopen(argv[opt], "rb");
+      fh = ws_fopen(cfile->filename, "rb");
       if (fh && hd) {
         while((hash_bytes = fread(hash_buf, 1, HASH_BUF_SIZE, fh)) > 0) {
           gcry_md_write(hd, hash_buf, hash_bytes);
@@ -1069,34 +1329,38 @@ main(int argc, char *argv[])
     }
 #endif /* HAVE_LIBGCRYPT */
 
-    wth = wtap_open_offline(argv[opt], &err, &err_info, FALSE);
-
-    if (!wth) {
-      fprintf(stderr, "capinfos: Can't open %s: %s\n", argv[opt],
-        wtap_strerror(err));
-      switch (err) {
-
-      case WTAP_ERR_UNSUPPORTED:
-      case WTAP_ERR_UNSUPPORTED_ENCAP:
-      case WTAP_ERR_BAD_RECORD:
-        fprintf(stderr, "(%s)\n", err_info);
-        g_free(err_info);
-        break;
-      }
-      overall_error_status = 1; /* remember that an error has occurred */
-      if(!continue_after_wtap_open_offline_failure)
-        exit(1); /* error status */
+    if(long_report) {
+      print_stats(cfile->filename, &cfile->cf_info);
+    } else {
+      print_stats_table(cfile->filename, &cfile->cf_info);
     }
 
-    if(wth) {
-      if ((opt > optind) && (long_report))
-        printf("\n");
-      status = process_cap_file(wth, argv[opt]);
+    if (report_totals)
+      add_to_totals(&totals, totals_nfiles++, &cfile->cf_info);
+    g_free(cfile->cf_info.encap_counts);
+  }
+
+#ifdef USE_THREADS
+  if (pool != NULL)
+    g_thread_pool_free(pool, FALSE, TRUE);
+#endif
+  g_free(files);
 
-      wtap_close(wth);
-      if (status)
-        exit(status);
+  if (report_totals && totals_nfiles > 0) {
+#ifdef HAVE_LIBGCRYPT
+    g_strlcpy(file_sha1, "n/a", HASH_STR_SIZE);
+    g_strlcpy(file_rmd160, "n/a", HASH_STR_SIZE);
+    g_strlcpy(file_md5, "n/a", HASH_STR_SIZE);
+#endif
+    if(long_report) {
+      printf("\n");
+      print_stats("All files", &totals);
+      printf("Number of files:     %u\n", totals_nfiles);
+    } else {
+      print_stats_table("All files", &totals);
     }
+    g_free(totals.encap_counts);
   }
+
   return overall_error_status;
 }
@@ -223,12 +223,23 @@ capture_input_read_all(capture_options *capture_opts, gboolean is_tempfile, gboo
 guint32 drops)
 {
   int err;
+  guint32 writer_stalls, flow_truncated, sampled_out, rate_limited;
+
+  /* "cf_open()" clears what the capture child told us about the capture */
+  writer_stalls = cf_get_writer_stalls(capture_opts->cf);
+  flow_truncated = cf_get_flow_truncated(capture_opts->cf);
+  sampled_out = cf_get_sampled_out(capture_opts->cf);
+  rate_limited = cf_get_rate_limited(capture_opts->cf);
 
   /* Capture succeeded; attempt to open the capture file. */
   if (cf_open(capture_opts->cf, capture_opts->save_file, is_tempfile, &err) != CF_OK) {
     /* We're not doing a capture any more, so we don't have a save file. */
     return FALSE;
   }
+  cf_set_writer_stalls(capture_opts->cf, writer_stalls);
+  cf_set_flow_truncated(capture_opts->cf, flow_truncated);
+  cf_set_sampled_out(capture_opts->cf, sampled_out);
+  cf_set_rate_limited(capture_opts->cf, rate_limited);
   
   /* Set the read filter to NULL. */
   /* XXX - this is odd here; try to put it somewhere where it fits better */
@@ -434,6 +445,45 @@ capture_input_drops(capture_options *capture_opts, guint32 dropped)
 }
 
 
+/* Capture child told us how often it had to wait for the capture file
+   to be written.
+ */
+void
+capture_input_writer_stalls(capture_options *capture_opts, guint32 stalls, guint64 stall_usec)
+{
+  g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_INFO, "capture held up %u time%s, for %" G_GINT64_MODIFIER "u ms, waiting for the disk",
+        stalls, plurality(stalls, "", "s"), stall_usec / 1000);
+
+  cf_set_writer_stalls(capture_opts->cf, stalls);
+}
+
+
+/* Capture child told us how many packets per-flow truncation cut short.
+ */
+void
+capture_input_flow_truncation(capture_options *capture_opts, guint64 truncated, guint64 bytes_cut)
+{
+  g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_INFO, "flow truncation: %" G_GINT64_MODIFIER "u packet%s cut short, %" G_GINT64_MODIFIER "u bytes not saved",
+        truncated, plurality(truncated, "", "s"), bytes_cut);
+
+  cf_set_flow_truncated(capture_opts->cf, (guint32)truncated);
+}
+
+
+/* Capture child told us how many packets sampling and the rate limit
+   left out; they're kept apart from the drops.
+ */
+void
+capture_input_sampling(capture_options *capture_opts, guint64 sampled_out, guint64 rate_limited)
+{
+  g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_INFO, "sampling: %" G_GINT64_MODIFIER "u packet%s not sampled, %" G_GINT64_MODIFIER "u over the rate limit",
+        sampled_out, plurality(sampled_out, "", "s"), rate_limited);
+
+  cf_set_sampled_out(capture_opts->cf, (guint32)sampled_out);
+  cf_set_rate_limited(capture_opts->cf, (guint32)rate_limited);
+}
+
+
 /* Capture child told us that an error has occurred while starting/running
    the capture.
    The buffer we're handed has *two* null-terminated strings in it - a
@@ -85,6 +85,24 @@ extern void capture_input_new_packets(capture_options *capture_opts, int to_read
  */
 extern void capture_input_drops(capture_options *capture_opts, guint32 dropped);
 
+/**
+ * Capture child told us how often, and for how long in all, the capture
+ * had to wait for the capture file to be written.
+ */
+extern void capture_input_writer_stalls(capture_options *capture_opts, guint32 stalls, guint64 stall_usec);
+
+/**
+ * Capture child told us how many packets per-flow truncation cut short,
+ * and how many bytes it cut off them.
+ */
+extern void capture_input_flow_truncation(capture_options *capture_opts, guint64 truncated, guint64 bytes_cut);
+
+/**
+ * Capture child told us how many packets sampling and the rate limit
+ * left out.  They weren't dropped; the user asked for that.
+ */
+extern void capture_input_sampling(capture_options *capture_opts, guint64 sampled_out, guint64 rate_limited);
+
 /**
  * Capture child told us that an error has occurred while starting the capture.
  */
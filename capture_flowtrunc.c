@@ -0,0 +1,448 @@
+/* capture_flowtrunc.c
+ * Per-flow packet truncation, for dumpcap
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <pcap.h>
+
+#include "capture_flowtrunc.h"
+
+/* The table is split into sets of this many flows; a flow can only go
+   in the set its hash picks, so a lookup never looks at more than this. */
+#define FLOW_SET_SIZE       8
+
+#define FT_GET16(p)         ((guint16)(((p)[0] << 8) | (p)[1]))
+
+#define ETHERTYPE_IP        0x0800
+#define ETHERTYPE_IPv6      0x86dd
+#define ETHERTYPE_VLAN      0x8100
+#define ETHERTYPE_QINQ      0x88a8
+#define ETHERTYPE_QINQ_OLD  0x9100
+
+#define IP_PROTO_ICMP       1
+#define IP_PROTO_TCP        6
+#define IP_PROTO_UDP        17
+#define IP_PROTO_ICMPV6     58
+#define IP_PROTO_SCTP       132
+
+/* IPv6 extension headers we step over */
+#define IP6_HOPOPTS         0
+#define IP6_ROUTING         43
+#define IP6_FRAGMENT        44
+#define IP6_AH              51
+#define IP6_DSTOPTS         60
+
+/* what a flow is told apart by; the lower address/port pair comes first,
+   so both directions are the same flow */
+typedef struct {
+    guint8      addr[2][16];
+    guint16     port[2];
+    guint8      proto;
+    guint8      family;
+} flow_key_t;
+
+typedef struct {
+    flow_key_t  key;
+    guint32     hash;           /* 0 for a free slot */
+    guint32     last_seen;      /* packet time, in seconds */
+    guint32     bytes;          /* payload bytes seen */
+    guint32     packets;
+} flow_entry_t;
+
+struct flow_trunc_s {
+    flow_entry_t *flows;
+    guint32     set_mask;       /* number of sets - 1 */
+    guint32     max_bytes;
+    guint32     max_packets;
+    guint32     idle_timeout;
+    guint64     truncated;
+    guint64     bytes_cut;
+};
+
+/* what we found in a packet */
+typedef struct {
+    flow_key_t  key;
+    guint32     hdr_len;        /* link, network and transport headers */
+    guint32     payload_len;    /* what follows them, as far as we have it */
+} flow_pkt_t;
+
+flow_trunc_t *
+flow_trunc_new(guint32 max_bytes, guint32 max_packets, guint32 idle_timeout,
+               guint32 max_flows)
+{
+    flow_trunc_t *ft;
+    guint32 sets = 1;
+
+    while (sets * FLOW_SET_SIZE < max_flows && sets < (1U << 24))
+        sets <<= 1;
+
+    ft = g_malloc0(sizeof(flow_trunc_t));
+    ft->flows = g_malloc0(sets * FLOW_SET_SIZE * sizeof(flow_entry_t));
+    ft->set_mask = sets - 1;
+    ft->max_bytes = max_bytes;
+    ft->max_packets = max_packets;
+    ft->idle_timeout = idle_timeout;
+    return ft;
+}
+
+void
+flow_trunc_free(flow_trunc_t *ft)
+{
+    g_free(ft->flows);
+    g_free(ft);
+}
+
+void
+flow_trunc_get_stats(flow_trunc_t *ft, guint64 *truncated, guint64 *bytes_cut)
+{
+    *truncated = ft->truncated;
+    *bytes_cut = ft->bytes_cut;
+}
+
+/* Find the transport header after an IPv4 or IPv6 header, fill in the
+   key, and work out where the payload starts.  Returns FALSE if this
+   isn't a packet we can make sense of. */
+static gboolean
+flow_parse_ip(const u_char *ip, guint32 avail, guint32 offset, flow_pkt_t *pkt)
+{
+    const u_char *l4;
+    guint32 ip_len, hdr_len, l4_len;
+    guint8 proto;
+    gboolean first_frag = TRUE;
+    int i;
+
+    memset(&pkt->key, 0, sizeof(pkt->key));
+    if (avail < 1)
+        return FALSE;
+
+    switch (ip[0] >> 4) {
+
+    case 4:
+        if (avail < 20)
+            return FALSE;
+        hdr_len = (ip[0] & 0x0f) * 4;
+        ip_len = FT_GET16(ip + 2);
+        if (hdr_len < 20 || avail < hdr_len || ip_len < hdr_len)
+            return FALSE;
+        proto = ip[9];
+        if ((FT_GET16(ip + 6) & 0x1fff) != 0)
+            first_frag = FALSE;
+        pkt->key.family = 4;
+        memcpy(pkt->key.addr[0], ip + 12, 4);
+        memcpy(pkt->key.addr[1], ip + 16, 4);
+        break;
+
+    case 6:
+        if (avail < 40)
+            return FALSE;
+        hdr_len = 40;
+        ip_len = 40 + FT_GET16(ip + 4);
+        proto = ip[6];
+        pkt->key.family = 6;
+        memcpy(pkt->key.addr[0], ip + 8, 16);
+        memcpy(pkt->key.addr[1], ip + 24, 16);
+        /* step over the extension headers, up to a point */
+        for (i = 0; i < 8; i++) {
+            if (proto == IP6_FRAGMENT) {
+                if (avail < hdr_len + 8)
+                    return FALSE;
+                if ((FT_GET16(ip + hdr_len + 2) & 0xfff8) != 0)
+                    first_frag = FALSE;
+                proto = ip[hdr_len];
+                hdr_len += 8;
+            } else if (proto == IP6_HOPOPTS || proto == IP6_ROUTING ||
+                       proto == IP6_DSTOPTS) {
+                if (avail < hdr_len + 2)
+                    return FALSE;
+                proto = ip[hdr_len];
+                hdr_len += (ip[hdr_len + 1] + 1) * 8;
+            } else if (proto == IP6_AH) {
+                if (avail < hdr_len + 2)
+                    return FALSE;
+                proto = ip[hdr_len];
+                hdr_len += (ip[hdr_len + 1] + 2) * 4;
+            } else {
+                break;
+            }
+        }
+        if (avail < hdr_len || ip_len < hdr_len)
+            return FALSE;
+        break;
+
+    default:
+        return FALSE;
+    }
+    pkt->key.proto = proto;
+
+    /* don't count link-layer padding as payload */
+    if (avail > ip_len)
+        avail = ip_len;
+
+    /* the transport header; later fragments don't have one */
+    l4_len = 0;
+    l4 = ip + hdr_len;
+    if (first_frag) {
+        switch (proto) {
+
+        case IP_PROTO_TCP:
+            if (avail < hdr_len + 20)
+                return FALSE;
+            l4_len = (l4[12] >> 4) * 4;
+            if (l4_len < 20)
+                return FALSE;
+            break;
+
+        case IP_PROTO_UDP:
+            l4_len = 8;
+            break;
+
+        case IP_PROTO_SCTP:
+            l4_len = 12;
+            break;
+
+        case IP_PROTO_ICMP:
+        case IP_PROTO_ICMPV6:
+            l4_len = 8;
+            break;
+        }
+        if (avail < hdr_len + l4_len)
+            l4_len = avail - hdr_len;
+        if (proto == IP_PROTO_TCP || proto == IP_PROTO_UDP || proto == IP_PROTO_SCTP) {
+            if (l4_len >= 4) {
+                pkt->key.port[0] = FT_GET16(l4);
+                pkt->key.port[1] = FT_GET16(l4 + 2);
+            }
+        }
+    }
+
+    pkt->hdr_len = offset + hdr_len + l4_len;
+    pkt->payload_len = avail - hdr_len - l4_len;
+    return TRUE;
+}
+
+/* Find the network-layer header after the link-layer header. */
+static gboolean
+flow_parse(int linktype, const u_char *pd, guint32 caplen, flow_pkt_t *pkt)
+{
+    guint32 offset;
+    guint16 ethertype;
+    guint32 family;
+
+    switch (linktype) {
+
+    case DLT_EN10MB:
+        if (caplen < 14)
+            return FALSE;
+        ethertype = FT_GET16(pd + 12);
+        offset = 14;
+        while (ethertype == ETHERTYPE_VLAN || ethertype == ETHERTYPE_QINQ ||
+               ethertype == ETHERTYPE_QINQ_OLD) {
+            if (caplen < offset + 4)
+                return FALSE;
+            ethertype = FT_GET16(pd + offset + 2);
+            offset += 4;
+        }
+        if (ethertype != ETHERTYPE_IP && ethertype != ETHERTYPE_IPv6)
+            return FALSE;
+        break;
+
+#ifdef DLT_LINUX_SLL
+    case DLT_LINUX_SLL:
+        if (caplen < 16)
+            return FALSE;
+        ethertype = FT_GET16(pd + 14);
+        if (ethertype != ETHERTYPE_IP && ethertype != ETHERTYPE_IPv6)
+            return FALSE;
+        offset = 16;
+        break;
+#endif
+
+    case DLT_NULL:
+#ifdef DLT_LOOP
+    case DLT_LOOP:
+#endif
+        /* the address family, in whatever byte order; IPv6 has
+           different values on different systems */
+        if (caplen < 4)
+            return FALSE;
+        family = pd[0] | pd[1] << 8 | pd[2] << 16 | (guint32)pd[3] << 24;
+        if (family > 0xffff)
+            family = GUINT32_SWAP_LE_BE(family);
+        if (family != 2 && family != 24 && family != 28 && family != 30)
+            return FALSE;
+        offset = 4;
+        break;
+
+#ifdef DLT_RAW
+    case DLT_RAW:
+#endif
+#ifdef DLT_IPV4
+    case DLT_IPV4:
+#endif
+#ifdef DLT_IPV6
+    case DLT_IPV6:
+#endif
+        offset = 0;
+        break;
+
+    default:
+        return FALSE;
+    }
+
+    return flow_parse_ip(pd + offset, caplen - offset, offset, pkt);
+}
+
+/* Put the lower end of the flow first, so both directions look the same. */
+static void
+flow_key_order(flow_key_t *key)
+{
+    guint8 addr[16];
+    guint16 port;
+
+    if (memcmp(key->addr[0], key->addr[1], 16) < 0 ||
+        (memcmp(key->addr[0], key->addr[1], 16) == 0 &&
+         key->port[0] <= key->port[1]))
+        return;
+
+    memcpy(addr, key->addr[0], 16);
+    memcpy(key->addr[0], key->addr[1], 16);
+    memcpy(key->addr[1], addr, 16);
+    port = key->port[0];
+    key->port[0] = key->port[1];
+    key->port[1] = port;
+}
+
+static guint32
+flow_hash(const flow_key_t *key)
+{
+    const guint8 *p = (const guint8 *)key;
+    guint32 h = 2166136261U;
+    size_t i;
+
+    /* FNV-1a */
+    for (i = 0; i < sizeof(flow_key_t); i++) {
+        h ^= p[i];
+        h *= 16777619U;
+    }
+    return h != 0 ? h : 1;
+}
+
+/* Packets from different interfaces can be a little out of order, so a
+   time stamp before last_seen doesn't count as idle time. */
+#define FLOW_IDLE(ft, fe, now) \
+    ((now) > (fe)->last_seen && (now) - (fe)->last_seen > (ft)->idle_timeout)
+
+/* Find a flow, or make room for it: in a free slot, the slot of a flow
+   that has gone idle, or else that of the flow idle the longest. */
+static flow_entry_t *
+flow_lookup(flow_trunc_t *ft, const flow_key_t *key, guint32 now)
+{
+    guint32 hash = flow_hash(key);
+    flow_entry_t *set = &ft->flows[(hash & ft->set_mask) * FLOW_SET_SIZE];
+    flow_entry_t *victim = NULL;
+    gboolean victim_free = FALSE;
+    int i;
+
+    for (i = 0; i < FLOW_SET_SIZE; i++) {
+        flow_entry_t *fe = &set[i];
+
+        if (fe->hash == hash && memcmp(&fe->key, key, sizeof(flow_key_t)) == 0) {
+            if (!FLOW_IDLE(ft, fe, now))
+                return fe;
+            victim = fe;    /* went idle; start it over */
+            break;
+        }
+        if (fe->hash == 0 || FLOW_IDLE(ft, fe, now)) {
+            if (!victim_free) {
+                victim = fe;
+                victim_free = TRUE;
+            }
+        } else if (!victim_free &&
+                   (victim == NULL || fe->last_seen < victim->last_seen)) {
+            victim = fe;
+        }
+    }
+
+    victim->key = *key;
+    victim->hash = hash;
+    victim->bytes = 0;
+    victim->packets = 0;
+    return victim;
+}
+
+guint32
+flow_trunc_caplen(flow_trunc_t *ft, int linktype,
+                  const struct pcap_pkthdr *phdr, const u_char *pd)
+{
+    flow_pkt_t pkt;
+    flow_entry_t *fe;
+    guint32 keep, now;
+
+    if (!flow_parse(linktype, pd, phdr->caplen, &pkt))
+        return phdr->caplen;
+    flow_key_order(&pkt.key);
+
+    now = (guint32)phdr->ts.tv_sec;
+    fe = flow_lookup(ft, &pkt.key, now);
+    fe->last_seen = now;
+
+    if ((ft->max_packets != 0 && fe->packets >= ft->max_packets) ||
+        fe->bytes >= ft->max_bytes) {
+        /* headers only */
+        keep = pkt.hdr_len;
+    } else if (pkt.payload_len > ft->max_bytes - fe->bytes) {
+        /* the part of the payload that takes the flow to the limit */
+        keep = pkt.hdr_len + (ft->max_bytes - fe->bytes);
+    } else {
+        keep = phdr->caplen;
+    }
+    fe->packets++;
+    if (pkt.payload_len > G_MAXUINT32 - fe->bytes)
+        fe->bytes = G_MAXUINT32;
+    else
+        fe->bytes += pkt.payload_len;
+
+    if (keep >= phdr->caplen)
+        return phdr->caplen;
+    ft->truncated++;
+    ft->bytes_cut += phdr->caplen - keep;
+    return keep;
+}
+
+guint32
+flow_hash_packet(int linktype, const u_char *pd, guint32 caplen)
+{
+    flow_pkt_t pkt;
+
+    if (!flow_parse(linktype, pd, caplen, &pkt))
+        return 0;
+    flow_key_order(&pkt.key);
+    return flow_hash(&pkt.key);
+}
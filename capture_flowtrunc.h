@@ -0,0 +1,100 @@
+/* capture_flowtrunc.h
+ * Per-flow packet truncation, for dumpcap
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __CAPTURE_FLOWTRUNC_H__
+#define __CAPTURE_FLOWTRUNC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @file
+ *
+ * Keeps the start of every flow and only the headers of the rest.
+ *
+ * Flows are IPv4 or IPv6 conversations, keyed by addresses, protocol and
+ * (for TCP, UDP and SCTP) ports, in either direction.  Packets are kept
+ * whole until a flow has carried a given number of payload bytes or
+ * packets; after that, only the link, network and transport headers are
+ * kept.  Packets that aren't IP are left alone.
+ *
+ * The flow table has a fixed size.  Flows that have been idle for a
+ * while are forgotten, and if the table fills up anyway, the flow idle
+ * the longest makes room; a forgotten flow starts over if it is seen
+ * again.
+ */
+
+/** Default number of payload bytes kept per flow. */
+#define FLOW_TRUNC_DEFAULT_BYTES        4096
+/** Default number of seconds after which an idle flow is forgotten. */
+#define FLOW_TRUNC_DEFAULT_IDLE         120
+/** Default number of flows in the table. */
+#define FLOW_TRUNC_DEFAULT_FLOWS        65536
+
+typedef struct flow_trunc_s flow_trunc_t;
+
+/**
+ * Create a flow table.
+ *
+ * @param max_bytes payload bytes to keep per flow
+ * @param max_packets packets to keep whole per flow, or 0 for no limit
+ * @param idle_timeout seconds, by packet time stamps, after which an idle
+ *        flow is forgotten
+ * @param max_flows the number of flows to make room for; rounded up to a
+ *        power of 2
+ */
+extern flow_trunc_t *flow_trunc_new(guint32 max_bytes, guint32 max_packets,
+                                    guint32 idle_timeout, guint32 max_flows);
+
+/**
+ * Account for a packet, and work out how much of it to keep.
+ *
+ * @param linktype the DLT_ value of the link-layer header
+ * @return the number of bytes to keep; at most phdr->caplen
+ */
+extern guint32 flow_trunc_caplen(flow_trunc_t *ft, int linktype,
+                                 const struct pcap_pkthdr *phdr,
+                                 const u_char *pd);
+
+/** Get the number of packets cut short and bytes not kept so far. */
+extern void flow_trunc_get_stats(flow_trunc_t *ft, guint64 *truncated,
+                                 guint64 *bytes_cut);
+
+/** Free a flow table. */
+extern void flow_trunc_free(flow_trunc_t *ft);
+
+/**
+ * Hash the flow a packet belongs to; both directions of a flow get the
+ * same hash.
+ *
+ * @param linktype the DLT_ value of the link-layer header
+ * @return the hash, or 0 if the packet isn't IP
+ */
+extern guint32 flow_hash_packet(int linktype, const u_char *pd, guint32 caplen);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAPTURE_FLOWTRUNC_H__ */
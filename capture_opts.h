@@ -168,6 +168,9 @@ typedef struct capture_options_tag {
 
     gboolean has_file_duration;     /**< TRUE if ring duration specified */
     gint32 file_duration;           /**< Switch file after n seconds */
+    gboolean has_file_interval;     /**< TRUE if ring interval specified */
+    gint32 file_interval;           /**< Switch file every n seconds, on
+                                         the wall clock */
     gboolean has_ring_num_files;    /**< TRUE if ring num_files specified */
     guint32 ring_num_files;         /**< Number of multiple buffer files */
 
@@ -191,6 +194,9 @@ typedef struct capture_options_tag {
     int fork_child_status;          /**< Child exit status */
 #ifdef _WIN32
     int signal_pipe_write_fd;       /**< the pipe to signal the child */
+#endif
+#ifndef _WIN32
+    int ring_fd;                    /**< If not -1, shared packet ring to hand to the child */
 #endif
     capture_state state;            /**< current state of the capture engine */
     gboolean output_to_pipe;        /**< save_file is a pipe (named or stdout) */
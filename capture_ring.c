@@ -0,0 +1,382 @@
+/* capture_ring.c
+ * Shared-memory packet ring between dumpcap and its parent
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef HAVE_MEMFD_CREATE
+#define _GNU_SOURCE /* Otherwise memfd_create won't be declared on Linux */
+#endif
+
+#include <glib.h>
+
+#include "capture_ring.h"
+
+#ifdef HAVE_CAPTURE_RING
+
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <sys/mman.h>
+
+#include "tempfile.h"
+#include <wsutil/file_util.h>
+
+/*
+ * The shared area starts with a header, followed by the packet data
+ * area.  The producer only ever writes "head" and the consumer only
+ * ever writes "tail"; both are byte positions that run freely and are
+ * reduced modulo the (power of 2) size of the data area when used, so
+ * the ring is empty when they're equal.  They're kept on separate
+ * cache lines so that the two processes don't fight over one line.
+ */
+#define CAPTURE_RING_MAGIC      0x57535252  /* "WSRR" */
+#define CAPTURE_RING_VERSION    1
+#define CAPTURE_RING_LINE_SIZE  64
+
+#define CAPTURE_RING_OPEN       1
+#define CAPTURE_RING_CLOSED     0
+#define CAPTURE_RING_WANT_LIVE  2   /* open; the consumer asked for no file */
+#define CAPTURE_RING_LIVE       3   /* open, and there's no file */
+
+typedef struct {
+    guint32       magic;
+    guint32       version;
+    guint32       size;         /* size of the data area */
+    volatile gint linktype;
+    volatile gint state;
+    guint8        pad1[CAPTURE_RING_LINE_SIZE - 5*sizeof(guint32)];
+    volatile gint head;         /* written by the producer */
+    guint8        pad2[CAPTURE_RING_LINE_SIZE - sizeof(gint)];
+    volatile gint tail;         /* written by the consumer */
+    guint8        pad3[CAPTURE_RING_LINE_SIZE - sizeof(gint)];
+} capture_ring_hdr_t;
+
+/*
+ * Each record in the data area starts with this header and is padded
+ * to a multiple of 8 bytes.  A record never wraps around the end of
+ * the data area; if there isn't room for it there, the space left is
+ * filled with a pad record (of which only the first 8 bytes are ever
+ * looked at) and the record goes at the start of the data area.
+ */
+#define CAPTURE_RING_REC_PAD    0x00000001
+
+typedef struct {
+    guint32 rec_len;
+    guint32 flags;
+    guint32 caplen;
+    guint32 len;
+    guint32 ts_sec;
+    guint32 ts_usec;
+    gint64  file_offset;
+} capture_ring_rec_hdr_t;
+
+#define CAPTURE_RING_ALIGN(n)   (((n) + 7U) & ~7U)
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS   MAP_ANON
+#endif
+
+struct capture_ring_s {
+    int                 fd;
+    capture_ring_hdr_t *hdr;
+    guint8             *data;
+    guint32             mask;
+    size_t              map_size;
+    guint32             pending;    /* length of the record last peeked at */
+    gboolean            shared;     /* TRUE if shared with another process */
+};
+
+static capture_ring_t *
+capture_ring_map(int fd, guint32 size, gboolean create, int *err)
+{
+    capture_ring_t *ring;
+    size_t map_size = sizeof(capture_ring_hdr_t) + size;
+    void *map;
+
+    if (fd == -1)
+        map = mmap(NULL, map_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    else
+        map = mmap(NULL, map_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        *err = errno;
+        return NULL;
+    }
+
+    ring = g_malloc(sizeof(capture_ring_t));
+    ring->fd = fd;
+    ring->hdr = map;
+    ring->data = (guint8 *)map + sizeof(capture_ring_hdr_t);
+    ring->mask = size - 1;
+    ring->map_size = map_size;
+    ring->pending = 0;
+    ring->shared = (fd != -1);
+
+    if (create) {
+        ring->hdr->magic = CAPTURE_RING_MAGIC;
+        ring->hdr->version = CAPTURE_RING_VERSION;
+        ring->hdr->size = size;
+        g_atomic_int_set(&ring->hdr->linktype, -1);
+        g_atomic_int_set(&ring->hdr->head, 0);
+        g_atomic_int_set(&ring->hdr->tail, 0);
+        g_atomic_int_set(&ring->hdr->state, CAPTURE_RING_OPEN);
+    }
+    return ring;
+}
+
+capture_ring_t *
+capture_ring_create(guint32 size, int *err)
+{
+    capture_ring_t *ring;
+    int fd;
+
+    if (size < 4096 || (size & (size - 1)) != 0) {
+        *err = EINVAL;
+        return NULL;
+    }
+
+#ifdef HAVE_MEMFD_CREATE
+    fd = memfd_create("wireshark-capture-ring", 0);
+    if (fd == -1)
+#endif
+    {
+        char *tmpname;
+
+        /* No anonymous memory files; use an unlinked temporary file */
+        fd = create_tempfile(&tmpname, "wireshark_ring");
+        if (fd == -1) {
+            *err = errno;
+            return NULL;
+        }
+        ws_unlink(tmpname);
+    }
+
+    if (ftruncate(fd, (off_t)(sizeof(capture_ring_hdr_t) + size)) == -1) {
+        *err = errno;
+        ws_close(fd);
+        return NULL;
+    }
+
+    ring = capture_ring_map(fd, size, TRUE, err);
+    if (ring == NULL)
+        ws_close(fd);
+    return ring;
+}
+
+capture_ring_t *
+capture_ring_new(guint32 size, int *err)
+{
+    if (size < 4096 || (size & (size - 1)) != 0) {
+        *err = EINVAL;
+        return NULL;
+    }
+    return capture_ring_map(-1, size, TRUE, err);
+}
+
+capture_ring_t *
+capture_ring_attach(int fd, int *err)
+{
+    capture_ring_hdr_t hdr;
+    capture_ring_t *ring;
+
+    if (pread(fd, &hdr, sizeof hdr, 0) != (ssize_t)sizeof hdr) {
+        *err = errno != 0 ? errno : EINVAL;
+        return NULL;
+    }
+    if (hdr.magic != CAPTURE_RING_MAGIC ||
+        hdr.version != CAPTURE_RING_VERSION ||
+        hdr.size < 4096 || (hdr.size & (hdr.size - 1)) != 0) {
+        *err = EINVAL;
+        return NULL;
+    }
+
+    ring = capture_ring_map(fd, hdr.size, FALSE, err);
+    if (ring == NULL)
+        return NULL;
+
+    /* The mapping stays valid after the descriptor is closed. */
+    ws_close(fd);
+    ring->fd = -1;
+    ring->shared = TRUE;
+    return ring;
+}
+
+int
+capture_ring_fd(capture_ring_t *ring)
+{
+    return ring->fd;
+}
+
+void
+capture_ring_destroy(capture_ring_t *ring)
+{
+    munmap((void *)ring->hdr, ring->map_size);
+    if (ring->fd != -1)
+        ws_close(ring->fd);
+    g_free(ring);
+}
+
+void
+capture_ring_set_linktype(capture_ring_t *ring, int linktype)
+{
+    g_atomic_int_set(&ring->hdr->linktype, linktype);
+}
+
+int
+capture_ring_linktype(capture_ring_t *ring)
+{
+    return g_atomic_int_get(&ring->hdr->linktype);
+}
+
+void
+capture_ring_close(capture_ring_t *ring)
+{
+    g_atomic_int_set(&ring->hdr->state, CAPTURE_RING_CLOSED);
+}
+
+gboolean
+capture_ring_is_open(capture_ring_t *ring)
+{
+    return g_atomic_int_get(&ring->hdr->state) != CAPTURE_RING_CLOSED;
+}
+
+void
+capture_ring_want_live(capture_ring_t *ring)
+{
+    g_atomic_int_set(&ring->hdr->state, CAPTURE_RING_WANT_LIVE);
+}
+
+gboolean
+capture_ring_wants_live(capture_ring_t *ring)
+{
+    return g_atomic_int_get(&ring->hdr->state) == CAPTURE_RING_WANT_LIVE;
+}
+
+gboolean
+capture_ring_set_live(capture_ring_t *ring, gboolean live)
+{
+    return g_atomic_int_compare_and_exchange(&ring->hdr->state,
+                                             CAPTURE_RING_WANT_LIVE,
+                                             live ? CAPTURE_RING_LIVE : CAPTURE_RING_OPEN);
+}
+
+gboolean
+capture_ring_is_live(capture_ring_t *ring)
+{
+    return g_atomic_int_get(&ring->hdr->state) == CAPTURE_RING_LIVE;
+}
+
+gboolean
+capture_ring_put(capture_ring_t *ring, const capture_ring_rec_t *rec,
+                 const guint8 *pd)
+{
+    capture_ring_rec_hdr_t *rhdr;
+    guint32 size = ring->mask + 1;
+    guint32 head, tail, offset, to_end, need, total;
+
+    if (!capture_ring_is_open(ring))
+        return FALSE;
+
+    need = CAPTURE_RING_ALIGN((guint32)sizeof(capture_ring_rec_hdr_t) + rec->caplen);
+    head = (guint32)g_atomic_int_get(&ring->hdr->head);
+    tail = (guint32)g_atomic_int_get(&ring->hdr->tail);
+    offset = head & ring->mask;
+    to_end = size - offset;
+    total = (to_end < need) ? to_end + need : need;
+
+    if (need > size || total > size - (head - tail)) {
+        /* The consumer has fallen behind; it'll carry on from the file,
+           if there is one. */
+        if (ring->shared && !capture_ring_is_live(ring))
+            capture_ring_close(ring);
+        return FALSE;
+    }
+
+    if (to_end < need) {
+        rhdr = (capture_ring_rec_hdr_t *)(void *)(ring->data + offset);
+        rhdr->rec_len = to_end;
+        rhdr->flags = CAPTURE_RING_REC_PAD;
+        head += to_end;
+        offset = 0;
+    }
+
+    rhdr = (capture_ring_rec_hdr_t *)(void *)(ring->data + offset);
+    rhdr->rec_len = need;
+    rhdr->flags = 0;
+    rhdr->caplen = rec->caplen;
+    rhdr->len = rec->len;
+    rhdr->ts_sec = rec->ts_sec;
+    rhdr->ts_usec = rec->ts_usec;
+    rhdr->file_offset = rec->file_offset;
+    memcpy(rhdr + 1, pd, rec->caplen);
+
+    /* Publish the record; this is a memory barrier as well. */
+    g_atomic_int_set(&ring->hdr->head, (gint)(head + need));
+    return TRUE;
+}
+
+const guint8 *
+capture_ring_peek(capture_ring_t *ring, capture_ring_rec_t *rec)
+{
+    capture_ring_rec_hdr_t *rhdr;
+    guint32 head, tail;
+
+    tail = (guint32)g_atomic_int_get(&ring->hdr->tail);
+    for (;;) {
+        head = (guint32)g_atomic_int_get(&ring->hdr->head);
+        if (head == tail)
+            return NULL;
+
+        rhdr = (capture_ring_rec_hdr_t *)(void *)(ring->data + (tail & ring->mask));
+        if (!(rhdr->flags & CAPTURE_RING_REC_PAD))
+            break;
+        tail += rhdr->rec_len;
+        g_atomic_int_set(&ring->hdr->tail, (gint)tail);
+    }
+
+    rec->caplen = rhdr->caplen;
+    rec->len = rhdr->len;
+    rec->ts_sec = rhdr->ts_sec;
+    rec->ts_usec = rhdr->ts_usec;
+    rec->file_offset = rhdr->file_offset;
+    ring->pending = rhdr->rec_len;
+    return (const guint8 *)(rhdr + 1);
+}
+
+void
+capture_ring_release(capture_ring_t *ring)
+{
+    guint32 tail;
+
+    tail = (guint32)g_atomic_int_get(&ring->hdr->tail);
+    g_atomic_int_set(&ring->hdr->tail, (gint)(tail + ring->pending));
+    ring->pending = 0;
+}
+
+#endif /* HAVE_CAPTURE_RING */
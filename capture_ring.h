@@ -0,0 +1,169 @@
+/* capture_ring.h
+ * Shared-memory packet ring between dumpcap and its parent
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __CAPTURE_RING_H__
+#define __CAPTURE_RING_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @file
+ *
+ * A single-producer, single-consumer ring of captured packets in memory
+ * shared between dumpcap (the producer) and the program that started it
+ * (the consumer), so that the consumer can dissect packets without
+ * reading them back from the capture file.
+ *
+ * dumpcap still writes every packet to the capture file and still
+ * reports packet counts over the sync pipe; the ring only carries the
+ * packet data.  If the ring fills up, or the consumer can't use it,
+ * the ring is closed and the consumer carries on from the capture file.
+ *
+ * A consumer that doesn't want the capture file at all can ask for a
+ * "live" ring before starting dumpcap.  dumpcap then reports an empty
+ * file name once it knows the link-layer type, and waits for the
+ * consumer to settle it: if the consumer takes the ring live, dumpcap
+ * writes no file, and waits for room in the ring rather than closing it
+ * when it's full; otherwise everything goes on as above.
+ *
+ * A ring can also be used between two threads of one process, as a
+ * lock-free packet queue.
+ */
+
+#if defined(HAVE_MMAP) && !defined(_WIN32)
+#define HAVE_CAPTURE_RING
+#endif
+
+#ifdef HAVE_CAPTURE_RING
+
+/** Default size of the packet data area, in bytes; must be a power of 2. */
+#define CAPTURE_RING_DEFAULT_SIZE   (32*1024*1024)
+
+typedef struct capture_ring_s capture_ring_t;
+
+/** A packet record, as handed to capture_ring_put() or returned by
+ *  capture_ring_peek(). */
+typedef struct {
+    guint32 caplen;         /**< number of bytes of packet data */
+    guint32 len;            /**< length of the packet on the wire */
+    guint32 ts_sec;         /**< time stamp, seconds */
+    guint32 ts_usec;        /**< time stamp, microseconds */
+    gint64  file_offset;    /**< offset of the record in the capture file */
+} capture_ring_rec_t;
+
+/**
+ * Create a new ring, in the parent.
+ *
+ * @param size the size of the packet data area; a power of 2
+ * @param err receives an errno value on failure
+ * @return the new ring, or NULL on failure
+ */
+extern capture_ring_t *capture_ring_create(guint32 size, int *err);
+
+/**
+ * Create a new ring private to this process.  Such a ring isn't closed
+ * when it fills up; capture_ring_put() just returns FALSE, and the
+ * producer decides what to do with the packet.
+ *
+ * @param size the size of the packet data area; a power of 2
+ * @param err receives an errno value on failure
+ * @return the new ring, or NULL on failure
+ */
+extern capture_ring_t *capture_ring_new(guint32 size, int *err);
+
+/**
+ * Attach to a ring created by our parent, in dumpcap.  The descriptor
+ * is closed once the ring is mapped.
+ *
+ * @param fd the ring's file descriptor, as inherited from the parent
+ * @param err receives an errno value on failure
+ * @return the ring, or NULL on failure
+ */
+extern capture_ring_t *capture_ring_attach(int fd, int *err);
+
+/** The file descriptor to hand to the child, or -1 if already closed. */
+extern int capture_ring_fd(capture_ring_t *ring);
+
+/** Unmap the ring and close its descriptor, if still open. */
+extern void capture_ring_destroy(capture_ring_t *ring);
+
+/** Set/get the pcap link-layer type of the packets in the ring. */
+extern void capture_ring_set_linktype(capture_ring_t *ring, int linktype);
+extern int capture_ring_linktype(capture_ring_t *ring);
+
+/**
+ * Close the ring; either side may do this.  Once closed, the producer
+ * puts nothing more into it, and the consumer should read what's left
+ * and then carry on from the capture file.
+ */
+extern void capture_ring_close(capture_ring_t *ring);
+extern gboolean capture_ring_is_open(capture_ring_t *ring);
+
+/** Consumer: ask for a live ring, before starting the producer. */
+extern void capture_ring_want_live(capture_ring_t *ring);
+
+/** Producer: has the consumer asked for a live ring that isn't settled yet? */
+extern gboolean capture_ring_wants_live(capture_ring_t *ring);
+
+/**
+ * Settle whether the ring is live; either side may do this, and only the
+ * first one to do so counts.
+ *
+ * @return TRUE if this call settled it, FALSE if the other side already had
+ */
+extern gboolean capture_ring_set_live(capture_ring_t *ring, gboolean live);
+
+/** Is the ring open, and live? */
+extern gboolean capture_ring_is_live(capture_ring_t *ring);
+
+/**
+ * Producer: append a packet.  If there isn't room for it, FALSE is
+ * returned (and a shared ring is closed, unless it's live); the caller
+ * never blocks on the consumer.
+ */
+extern gboolean capture_ring_put(capture_ring_t *ring,
+                                 const capture_ring_rec_t *rec,
+                                 const guint8 *pd);
+
+/**
+ * Consumer: look at the oldest packet in the ring without removing it.
+ *
+ * @param rec filled in with the packet's record
+ * @return a pointer to the packet data, valid until capture_ring_release()
+ *         is called, or NULL if the ring is empty
+ */
+extern const guint8 *capture_ring_peek(capture_ring_t *ring,
+                                       capture_ring_rec_t *rec);
+
+/** Consumer: remove the packet returned by the last capture_ring_peek(). */
+extern void capture_ring_release(capture_ring_t *ring);
+
+#endif /* HAVE_CAPTURE_RING */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAPTURE_RING_H__ */
@@ -0,0 +1,223 @@
+/* capture_sampling.c
+ * Packet sampling and rate limiting, for dumpcap
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <glib.h>
+
+#include <pcap.h>
+
+#include "capture_flowtrunc.h"
+#include "capture_sampling.h"
+
+typedef struct {
+    guint64     seen;
+    guint64     kept;
+} sample_counts_t;
+
+struct sampler_s {
+    sample_mode_e mode;
+    guint32     rate;
+    guint32     count;          /* packets since the last one kept, SAMPLE_COUNT */
+    GRand      *rand;
+
+    guint32     limit_rate;     /* packets per second, 0 for none */
+    gdouble     limit_burst;
+    gdouble     tokens;
+    gdouble     last_time;      /* time stamp of the last packet, in seconds */
+    gboolean    have_time;
+
+    GArray     *counts;         /* sample_counts_t, by interface */
+    guint64     sampled_out;
+    guint64     limited;
+};
+
+sampler_t *
+sampler_new(sample_mode_e mode, guint32 rate, guint32 limit_rate, guint32 limit_burst)
+{
+    sampler_t *sp;
+
+    sp = g_new0(sampler_t, 1);
+    sp->mode = rate > 1 ? mode : SAMPLE_NONE;
+    sp->rate = rate;
+    if (sp->mode == SAMPLE_RANDOM)
+        sp->rand = g_rand_new();
+    sp->limit_rate = limit_rate;
+    sp->limit_burst = limit_burst != 0 ? limit_burst : limit_rate;
+    sp->tokens = sp->limit_burst;
+    sp->counts = g_array_new(FALSE, TRUE, sizeof(sample_counts_t));
+    return sp;
+}
+
+static gboolean
+sampler_count_keep(sampler_t *sp)
+{
+    gboolean keep = (sp->count == 0);
+
+    if (++sp->count == sp->rate)
+        sp->count = 0;
+    return keep;
+}
+
+static gboolean
+sampler_sample(sampler_t *sp, int linktype, const struct pcap_pkthdr *phdr,
+               const u_char *pd)
+{
+    guint32 hash;
+
+    switch (sp->mode) {
+
+    case SAMPLE_COUNT:
+        return sampler_count_keep(sp);
+
+    case SAMPLE_RANDOM:
+        return g_rand_int_range(sp->rand, 0, sp->rate) == 0;
+
+    case SAMPLE_FLOW:
+        hash = flow_hash_packet(linktype, pd, phdr->caplen);
+        if (hash == 0)
+            return sampler_count_keep(sp);
+        /* spread the hash over [0, rate) without the bias of a modulus */
+        return (((guint64)(hash * 0x9E3779B1U) * sp->rate) >> 32) == 0;
+
+    default:
+        return TRUE;
+    }
+}
+
+static gboolean
+sampler_limit(sampler_t *sp, const struct pcap_pkthdr *phdr)
+{
+    gdouble now;
+
+    if (sp->limit_rate == 0)
+        return TRUE;
+
+    now = phdr->ts.tv_sec + phdr->ts.tv_usec / 1000000.0;
+    /* a time stamp that goes backwards adds nothing to the bucket */
+    if (sp->have_time && now > sp->last_time) {
+        sp->tokens += (now - sp->last_time) * sp->limit_rate;
+        if (sp->tokens > sp->limit_burst)
+            sp->tokens = sp->limit_burst;
+    }
+    if (!sp->have_time || now > sp->last_time) {
+        sp->last_time = now;
+        sp->have_time = TRUE;
+    }
+
+    if (sp->tokens < 1.0)
+        return FALSE;
+    sp->tokens -= 1.0;
+    return TRUE;
+}
+
+gboolean
+sampler_keep(sampler_t *sp, guint32 interface_id, int linktype,
+             const struct pcap_pkthdr *phdr, const u_char *pd)
+{
+    sample_counts_t *counts;
+
+    if (interface_id >= sp->counts->len)
+        g_array_set_size(sp->counts, interface_id + 1);
+    counts = &g_array_index(sp->counts, sample_counts_t, interface_id);
+    counts->seen++;
+
+    if (!sampler_sample(sp, linktype, phdr, pd)) {
+        sp->sampled_out++;
+        return FALSE;
+    }
+    if (!sampler_limit(sp, phdr)) {
+        sp->limited++;
+        return FALSE;
+    }
+    counts->kept++;
+    return TRUE;
+}
+
+void
+sampler_get_stats(sampler_t *sp, guint32 interface_id, guint64 *seen, guint64 *kept)
+{
+    sample_counts_t *counts;
+
+    if (interface_id >= sp->counts->len) {
+        *seen = 0;
+        *kept = 0;
+        return;
+    }
+    counts = &g_array_index(sp->counts, sample_counts_t, interface_id);
+    *seen = counts->seen;
+    *kept = counts->kept;
+}
+
+void
+sampler_get_totals(sampler_t *sp, guint64 *sampled_out, guint64 *limited)
+{
+    *sampled_out = sp->sampled_out;
+    *limited = sp->limited;
+}
+
+gchar *
+sampler_describe(sampler_t *sp)
+{
+    GString *str;
+    const char *mode;
+
+    str = g_string_new("");
+    switch (sp->mode) {
+    case SAMPLE_COUNT:
+        mode = "1 in %u packets";
+        break;
+    case SAMPLE_RANDOM:
+        mode = "1 in %u packets, at random";
+        break;
+    case SAMPLE_FLOW:
+        mode = "1 in %u flows";
+        break;
+    default:
+        mode = NULL;
+        break;
+    }
+    if (mode != NULL) {
+        g_string_append(str, "Sampled: ");
+        g_string_append_printf(str, mode, sp->rate);
+    }
+    if (sp->limit_rate != 0) {
+        if (str->len != 0)
+            g_string_append(str, "; ");
+        g_string_append_printf(str, "Limited: %u packets/s, burst %.0f",
+                               sp->limit_rate, sp->limit_burst);
+    }
+    return g_string_free(str, FALSE);
+}
+
+void
+sampler_free(sampler_t *sp)
+{
+    if (sp->rand != NULL)
+        g_rand_free(sp->rand);
+    g_array_free(sp->counts, TRUE);
+    g_free(sp);
+}
@@ -0,0 +1,106 @@
+/* capture_sampling.h
+ * Packet sampling and rate limiting, for dumpcap
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __CAPTURE_SAMPLING_H__
+#define __CAPTURE_SAMPLING_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @file
+ *
+ * Decides which of the packets that got through the capture filter are
+ * kept, so that the amount of data saved stays predictable when there's
+ * too much traffic to save it all.
+ *
+ * Packets are first sampled, 1 in N:
+ *
+ * - systematically, every Nth packet;
+ * - at random, each packet with a chance of 1 in N;
+ * - by flow, keeping or leaving out whole IPv4/IPv6 conversations, picked
+ *   by a hash of their addresses, protocol and ports, so every packet of a
+ *   kept flow is kept.  Packets that aren't IP are sampled systematically.
+ *
+ * Then the packets sampled can be held to a rate, with a token bucket
+ * that fills up by packet time stamps (not by the clock), so the same
+ * packets give the same result however fast they are handled.
+ *
+ * A sampler isn't thread-safe; dumpcap uses it from the thread that
+ * writes packets.
+ */
+
+typedef enum {
+    SAMPLE_NONE,        /**< keep every packet */
+    SAMPLE_COUNT,       /**< keep every Nth packet */
+    SAMPLE_RANDOM,      /**< keep each packet with a chance of 1 in N */
+    SAMPLE_FLOW         /**< keep 1 in N flows */
+} sample_mode_e;
+
+typedef struct sampler_s sampler_t;
+
+/**
+ * Create a sampler.
+ *
+ * @param mode how to sample
+ * @param rate N, as in 1 in N; ignored for SAMPLE_NONE
+ * @param limit_rate packets per second to keep at most, or 0 for no limit
+ * @param limit_burst packets that may be kept in a burst above limit_rate;
+ *        0 means limit_rate
+ */
+extern sampler_t *sampler_new(sample_mode_e mode, guint32 rate,
+                              guint32 limit_rate, guint32 limit_burst);
+
+/**
+ * Decide whether to keep a packet.
+ *
+ * @param interface_id the interface the packet came from, for the counts
+ * @param linktype the DLT_ value of the link-layer header
+ */
+extern gboolean sampler_keep(sampler_t *sp, guint32 interface_id, int linktype,
+                             const struct pcap_pkthdr *phdr, const u_char *pd);
+
+/** Get the number of packets seen and kept on an interface so far. */
+extern void sampler_get_stats(sampler_t *sp, guint32 interface_id,
+                              guint64 *seen, guint64 *kept);
+
+/** Get the number of packets left out by sampling and by the rate limit. */
+extern void sampler_get_totals(sampler_t *sp, guint64 *sampled_out,
+                               guint64 *limited);
+
+/**
+ * Describe what the sampler does, e.g. for a capture file comment.
+ *
+ * @return a string to be freed with g_free()
+ */
+extern gchar *sampler_describe(sampler_t *sp);
+
+/** Free a sampler. */
+extern void sampler_free(sampler_t *sp);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAPTURE_SAMPLING_H__ */
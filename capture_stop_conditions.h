@@ -27,3 +27,4 @@ void cleanup_capture_stop_conditions(void);
 
 extern const char* CND_CLASS_TIMEOUT;
 extern const char* CND_CLASS_CAPTURESIZE;
+extern const char* CND_CLASS_INTERVAL;
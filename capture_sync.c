@@ -122,9 +122,14 @@ static const char *sync_pipe_signame(int);
 static gboolean sync_pipe_input_cb(gint source, gpointer user_data);
 static int sync_pipe_wait_for_child(int fork_child, gchar **msgp);
 static void pipe_convert_header(const guchar *header, int header_len, char *indicator, int *block_len);
+static gboolean sync_pipe_input_batch(gint source, capture_options *capture_opts,
+                                      const guchar *data, int len);
 static int pipe_read_block(int pipe_fd, char *indicator, int len, char *msg,
                            char **err_msg);
 
+/* Latest interface statistics reported by the child, indexed by interface */
+static GArray *sync_pipe_if_stats = NULL;
+
 
 
 /* Append an arg (realloc) to an argc/argv array */
@@ -331,6 +336,7 @@ sync_pipe_start(capture_options *capture_opts) {
     char scount[ARGV_NUMBER_LEN];
     char sfilesize[ARGV_NUMBER_LEN];
     char sfile_duration[ARGV_NUMBER_LEN];
+    char sfile_interval[ARGV_NUMBER_LEN];
     char sring_num_files[ARGV_NUMBER_LEN];
     char sautostop_files[ARGV_NUMBER_LEN];
     char sautostop_filesize[ARGV_NUMBER_LEN];
@@ -360,6 +366,7 @@ sync_pipe_start(capture_options *capture_opts) {
     char errmsg[1024+1];
     int sync_pipe[2];                       /* pipe used to send messages from child to parent */
     enum PIPES { PIPE_READ, PIPE_WRITE };   /* Constants 0 and 1 for PIPE_READ and PIPE_WRITE */
+    char sring_fd[ARGV_NUMBER_LEN];
 #endif
     int sync_pipe_read_fd;
     int argc;
@@ -371,6 +378,10 @@ sync_pipe_start(capture_options *capture_opts) {
 
     capture_opts->fork_child = -1;
 
+    /* forget the statistics of any previous capture */
+    if (sync_pipe_if_stats != NULL)
+        g_array_set_size(sync_pipe_if_stats, 0);
+
     argv = init_pipe_args(&argc);
     if (!argv) {
         /* We don't know where to find dumpcap. */
@@ -408,6 +419,12 @@ sync_pipe_start(capture_options *capture_opts) {
         argv = sync_pipe_add_arg(argv, &argc, sfile_duration);
       }
 
+      if (capture_opts->has_file_interval) {
+        argv = sync_pipe_add_arg(argv, &argc, "-b");
+        g_snprintf(sfile_interval, ARGV_NUMBER_LEN, "interval:%d",capture_opts->file_interval);
+        argv = sync_pipe_add_arg(argv, &argc, sfile_interval);
+      }
+
       if (capture_opts->has_ring_num_files) {
         argv = sync_pipe_add_arg(argv, &argc, "-b");
         g_snprintf(sring_num_files, ARGV_NUMBER_LEN, "files:%d",capture_opts->ring_num_files);
@@ -508,6 +525,15 @@ sync_pipe_start(capture_options *capture_opts) {
       argv = sync_pipe_add_arg(argv, &argc, capture_opts->save_file);
     }
 
+#ifndef _WIN32
+    /* hand the shared packet ring, if any, down to dumpcap (hidden option) */
+    if (capture_opts->ring_fd != -1) {
+      argv = sync_pipe_add_arg(argv, &argc, "-R");
+      g_snprintf(sring_fd, ARGV_NUMBER_LEN, "%d", capture_opts->ring_fd);
+      argv = sync_pipe_add_arg(argv, &argc, sring_fd);
+    }
+#endif
+
 #ifdef _WIN32
     /* init SECURITY_ATTRIBUTES */
     sa.nLength = sizeof(SECURITY_ATTRIBUTES);
@@ -1547,6 +1573,123 @@ pipe_read_block(int pipe_fd, char *indicator, int len, char *msg,
 }
 
 
+/* the child told us about a new capture file */
+static gboolean
+sync_pipe_input_new_file(gint source, capture_options *capture_opts, gchar *new_file)
+{
+  if(!capture_input_new_file(capture_opts, new_file)) {
+    g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_DEBUG, "sync_pipe_input_cb: file failed, closing capture");
+
+    /* We weren't able to open the new capture file; user has been
+       alerted. Close the sync pipe. */
+    ws_close(source);
+
+    /* the child has send us a filename which we couldn't open.
+       this probably means, the child is creating files faster than we can handle it.
+       this should only be the case for very fast file switches
+       we can't do much more than telling the child to stop
+       (this is the "emergency brake" if user e.g. wants to switch files every second) */
+    sync_pipe_stop(capture_opts);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+const sync_pipe_if_stats_t *
+sync_pipe_get_if_stats(guint iface)
+{
+  const sync_pipe_if_stats_t *stats;
+
+  if (sync_pipe_if_stats == NULL || iface >= sync_pipe_if_stats->len)
+    return NULL;
+  stats = &g_array_index(sync_pipe_if_stats, sync_pipe_if_stats_t, iface);
+  return (stats->ts_sec != 0 || stats->ts_usec != 0) ? stats : NULL;
+}
+
+/* The child sent us a batch of binary records (see sync_pipe.h); process
+   them in order.  Returns FALSE if we had to stop the capture. */
+static gboolean
+sync_pipe_input_batch(gint source, capture_options *capture_opts,
+                      const guchar *data, int len)
+{
+  sync_pipe_if_stats_t stats;
+  const guchar *value;
+  guint8 type;
+  int off, rec_len;
+  guint32 packets, stalls;
+
+  if (len < 1 || data[0] != SP_BATCH_VERSION) {
+    g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_WARNING,
+          "sync_pipe_input_batch: unsupported batch version %u", len < 1 ? 0 : data[0]);
+    return TRUE;
+  }
+
+  for (off = 1; off + SP_REC_HDR_LEN <= len; off += SP_REC_HDR_LEN + rec_len) {
+    type = data[off];
+    rec_len = pntohs(&data[off+1]);
+    value = &data[off+SP_REC_HDR_LEN];
+    if (off + SP_REC_HDR_LEN + rec_len > len) {
+      g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_WARNING,
+            "sync_pipe_input_batch: truncated record of type %u", type);
+      break;
+    }
+
+    switch (type) {
+    case SP_REC_PACKETS:
+      if (rec_len < 4)
+        break;
+      packets = pntohl(value);
+      g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_DEBUG, "sync_pipe_input_batch: new packets %u", packets);
+      capture_input_new_packets(capture_opts, (int) packets);
+      break;
+    case SP_REC_FILE:
+      if (rec_len < 1 || value[rec_len-1] != '\0')
+        break;
+      if (!sync_pipe_input_new_file(source, capture_opts, (gchar *) value))
+        return FALSE;
+      break;
+    case SP_REC_IF_STATS:
+      if (rec_len < SP_REC_IF_STATS_LEN)
+        break;
+      stats.iface = pntohl(&value[0]);
+      stats.ts_sec = pntohl(&value[4]);
+      stats.ts_usec = pntohl(&value[8]);
+      stats.received = pntohl(&value[12]);
+      stats.dropped = pntohl(&value[16]);
+      stats.if_dropped = pntohl(&value[20]);
+      g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_DEBUG,
+            "sync_pipe_input_batch: interface %u received %u dropped %u/%u",
+            stats.iface, stats.received, stats.dropped, stats.if_dropped);
+      if (sync_pipe_if_stats == NULL)
+        sync_pipe_if_stats = g_array_new(FALSE, TRUE, sizeof(sync_pipe_if_stats_t));
+      if (stats.iface >= sync_pipe_if_stats->len)
+        g_array_set_size(sync_pipe_if_stats, stats.iface + 1);
+      g_array_index(sync_pipe_if_stats, sync_pipe_if_stats_t, stats.iface) = stats;
+      break;
+    case SP_REC_WRITER_STALLS:
+      if (rec_len < SP_REC_WRITER_STALLS_LEN)
+        break;
+      stalls = pntohl(&value[0]);
+      capture_input_writer_stalls(capture_opts, stalls, pntoh64(&value[4]));
+      break;
+    case SP_REC_FLOW_TRUNC:
+      if (rec_len < SP_REC_FLOW_TRUNC_LEN)
+        break;
+      capture_input_flow_truncation(capture_opts, pntoh64(&value[0]), pntoh64(&value[8]));
+      break;
+    case SP_REC_SAMPLING:
+      if (rec_len < SP_REC_SAMPLING_LEN)
+        break;
+      capture_input_sampling(capture_opts, pntoh64(&value[0]), pntoh64(&value[8]));
+      break;
+    default:
+      /* from a newer child; skip it */
+      break;
+    }
+  }
+  return TRUE;
+}
+
 /* There's stuff to read from the sync pipe, meaning the child has sent
    us a message, or the sync pipe has closed, meaning the child has
    closed it (perhaps because it exited). */
@@ -1614,20 +1757,15 @@ sync_pipe_input_cb(gint source, gpointer user_data)
   /* we got a valid message block from the child, process it */
   switch(indicator) {
   case SP_FILE:
-    if(!capture_input_new_file(capture_opts, buffer)) {
-      g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_DEBUG, "sync_pipe_input_cb: file failed, closing capture");
-
-      /* We weren't able to open the new capture file; user has been
-         alerted. Close the sync pipe. */
-      ws_close(source);
-
-      /* the child has send us a filename which we couldn't open.
-         this probably means, the child is creating files faster than we can handle it.
-         this should only be the case for very fast file switches
-         we can't do much more than telling the child to stop
-         (this is the "emergency brake" if user e.g. wants to switch files every second) */
-      sync_pipe_stop(capture_opts);
-    }
+    /* as for a batch, below */
+    if (!sync_pipe_input_new_file(source, capture_opts, buffer))
+      return FALSE;
+    break;
+  case SP_BATCH:
+    /* a file switch in the batch failed, and the capture's been
+       stopped; don't read from the closed sync pipe again */
+    if (!sync_pipe_input_batch(source, capture_opts, (guchar *) buffer, nread - 4))
+      return FALSE;
     break;
   case SP_PACKET_COUNT:
     nread = atoi(buffer);
@@ -34,6 +34,8 @@
 #ifndef __CAPTURE_SYNC_H__
 #define __CAPTURE_SYNC_H__
 
+#include "sync_pipe.h"
+
 
 /**
  * Start a new capture session.
@@ -86,5 +88,10 @@ sync_interface_stats_close(int *read_fd, int *fork_child, gchar **msg);
 extern int
 sync_pipe_gets_nonblock(int pipe_fd, char *bytes, int max);
 
+/** Latest statistics the capture child reported for an interface, or
+ *  NULL if it hasn't reported any (yet). */
+extern const sync_pipe_if_stats_t *
+sync_pipe_get_if_stats(guint iface);
+
 
 #endif /* capture_sync.h */
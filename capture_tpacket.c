@@ -0,0 +1,365 @@
+/* capture_tpacket.c
+ * Linux TPACKET_V3 memory-mapped capture, for dumpcap
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <glib.h>
+
+#include <pcap.h>
+
+#include "capture_tpacket.h"
+
+#ifdef HAVE_TPACKET_V3
+
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+
+/* Older headers don't have these. */
+#ifndef TP_STATUS_VLAN_VALID
+#define TP_STATUS_VLAN_VALID        (1 << 4)
+#endif
+#ifndef TP_STATUS_VLAN_TPID_VALID
+#define TP_STATUS_VLAN_TPID_VALID   (1 << 6)
+#endif
+
+#define TPACKET_FRAME_SIZE  2048    /* only used to size the ring request */
+#define VLAN_TAG_LEN        4
+#define ETH_ADDRS_LEN       12      /* destination and source addresses */
+
+struct tpacket_ring_s {
+    int              fd;
+    int              ifindex;
+    int              snaplen;
+    guint8          *map;
+    size_t           map_size;
+    guint            block_size;
+    guint            block_count;
+    guint            next_block;    /* the next block we expect the kernel to hand over */
+    guint8          *pkt_buf;       /* used when a VLAN tag has to be put back */
+    struct pcap_stat stats;         /* accumulated; the kernel resets its counters on every read */
+};
+
+tpacket_ring_t *
+tpacket_ring_open(const char *ifname, int snaplen, gboolean promisc,
+                  guint block_size, guint ring_size, guint block_timeout,
+                  char *errmsg, size_t errmsg_len)
+{
+    tpacket_ring_t *ring;
+    struct tpacket_req3 req;
+    struct ifreq ifr;
+    int version = TPACKET_V3;
+    long page_size;
+    void *map;
+    int fd;
+
+    page_size = sysconf(_SC_PAGESIZE);
+    if (block_size < (guint)page_size || (block_size & (block_size - 1)) != 0) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "The ring block size %u isn't a power of 2 of at least %ld bytes.",
+                   block_size, page_size);
+        return NULL;
+    }
+    if (ring_size / block_size < 2)
+        ring_size = 2 * block_size;
+
+    if (strlen(ifname) >= sizeof ifr.ifr_name) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "The interface name \"%s\" is too long.", ifname);
+        return NULL;
+    }
+
+    /*
+     * Protocol 0 means no packets are queued until we bind, so nothing
+     * reaches the ring before the filter has been attached.
+     */
+    fd = socket(AF_PACKET, SOCK_RAW, 0);
+    if (fd == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't open a packet socket: %s.", g_strerror(errno));
+        return NULL;
+    }
+
+    memset(&ifr, 0, sizeof ifr);
+    g_strlcpy(ifr.ifr_name, ifname, sizeof ifr.ifr_name);
+    if (ioctl(fd, SIOCGIFINDEX, &ifr) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't get the index of interface \"%s\": %s.",
+                   ifname, g_strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof version) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "This kernel doesn't support TPACKET_V3: %s.", g_strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    memset(&req, 0, sizeof req);
+    req.tp_block_size = block_size;
+    req.tp_block_nr = ring_size / block_size;
+    req.tp_frame_size = TPACKET_FRAME_SIZE;
+    req.tp_frame_nr = (req.tp_block_size / req.tp_frame_size) * req.tp_block_nr;
+    req.tp_retire_blk_tov = block_timeout;
+    req.tp_feature_req_word = 0;
+    if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof req) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't set up a %u-block packet ring: %s.",
+                   req.tp_block_nr, g_strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    map = mmap(NULL, (size_t)req.tp_block_size * req.tp_block_nr,
+               PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't map the packet ring: %s.", g_strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    if (promisc) {
+        struct packet_mreq mreq;
+
+        memset(&mreq, 0, sizeof mreq);
+        mreq.mr_ifindex = ifr.ifr_ifindex;
+        mreq.mr_type = PACKET_MR_PROMISC;
+        if (setsockopt(fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof mreq) == -1) {
+            g_snprintf(errmsg, (gulong)errmsg_len,
+                       "Can't put interface \"%s\" into promiscuous mode: %s.",
+                       ifname, g_strerror(errno));
+            munmap(map, (size_t)req.tp_block_size * req.tp_block_nr);
+            close(fd);
+            return NULL;
+        }
+    }
+
+    ring = g_malloc0(sizeof(tpacket_ring_t));
+    ring->fd = fd;
+    ring->ifindex = ifr.ifr_ifindex;
+    ring->snaplen = snaplen;
+    ring->map = map;
+    ring->map_size = (size_t)req.tp_block_size * req.tp_block_nr;
+    ring->block_size = req.tp_block_size;
+    ring->block_count = req.tp_block_nr;
+    ring->next_block = 0;
+    ring->pkt_buf = g_malloc(snaplen + VLAN_TAG_LEN);
+    return ring;
+}
+
+gboolean
+tpacket_ring_set_filter(tpacket_ring_t *ring, const struct bpf_program *fcode,
+                        char *errmsg, size_t errmsg_len)
+{
+    struct sock_fprog prog;
+
+    /* struct bpf_insn and struct sock_filter have the same layout. */
+    prog.len = (unsigned short)fcode->bf_len;
+    prog.filter = (struct sock_filter *)(void *)fcode->bf_insns;
+    if (setsockopt(ring->fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof prog) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't attach the capture filter to the packet socket: %s.",
+                   g_strerror(errno));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+gboolean
+tpacket_ring_start(tpacket_ring_t *ring, char *errmsg, size_t errmsg_len)
+{
+    struct sockaddr_ll sll;
+
+    memset(&sll, 0, sizeof sll);
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = htons(ETH_P_ALL);
+    sll.sll_ifindex = ring->ifindex;
+    if (bind(ring->fd, (struct sockaddr *)&sll, sizeof sll) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't bind the packet socket to the interface: %s.",
+                   g_strerror(errno));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Hand every packet in a block to the callback. */
+static int
+tpacket_ring_walk_block(tpacket_ring_t *ring, struct tpacket_block_desc *pbd,
+                        pcap_handler callback, u_char *user)
+{
+    struct tpacket3_hdr *ppd;
+    struct pcap_pkthdr phdr;
+    guint32 num_pkts = pbd->hdr.bh1.num_pkts;
+    guint32 i;
+
+    ppd = (struct tpacket3_hdr *)(void *)((guint8 *)pbd + pbd->hdr.bh1.offset_to_first_pkt);
+    for (i = 0; i < num_pkts; i++) {
+        const guint8 *pd = (const guint8 *)ppd + ppd->tp_mac;
+        guint32 caplen = ppd->tp_snaplen;
+        guint32 len = ppd->tp_len;
+
+        /*
+         * The kernel strips an offloaded VLAN tag and reports it in the
+         * header instead; put it back, so that the packet is as it was
+         * on the wire.
+         */
+        if ((ppd->tp_status & TP_STATUS_VLAN_VALID) && caplen >= ETH_ADDRS_LEN) {
+#ifdef HAVE_STRUCT_TPACKET_HDR_VARIANT1_TP_VLAN_TPID
+            guint16 tpid = (ppd->tp_status & TP_STATUS_VLAN_TPID_VALID) ?
+                           ppd->hv1.tp_vlan_tpid : ETH_P_8021Q;
+#else
+            /* Headers before 3.14 don't have the TPID; assume 802.1Q */
+            guint16 tpid = ETH_P_8021Q;
+#endif
+            guint8 *p = ring->pkt_buf;
+            guint32 rest = MIN(caplen, (guint32)ring->snaplen) - ETH_ADDRS_LEN;
+
+            memcpy(p, pd, ETH_ADDRS_LEN);
+            p[ETH_ADDRS_LEN]     = tpid >> 8;
+            p[ETH_ADDRS_LEN + 1] = tpid & 0xff;
+            p[ETH_ADDRS_LEN + 2] = ppd->hv1.tp_vlan_tci >> 8;
+            p[ETH_ADDRS_LEN + 3] = ppd->hv1.tp_vlan_tci & 0xff;
+            memcpy(p + ETH_ADDRS_LEN + VLAN_TAG_LEN, pd + ETH_ADDRS_LEN, rest);
+            pd = p;
+            caplen += VLAN_TAG_LEN;
+            len += VLAN_TAG_LEN;
+        }
+
+        phdr.ts.tv_sec = ppd->tp_sec;
+        phdr.ts.tv_usec = ppd->tp_nsec / 1000;
+        phdr.caplen = MIN(caplen, (guint32)ring->snaplen);
+        phdr.len = len;
+        callback(user, &phdr, pd);
+
+        ppd = (struct tpacket3_hdr *)(void *)((guint8 *)ppd + ppd->tp_next_offset);
+    }
+    return (int)num_pkts;
+}
+
+int
+tpacket_ring_dispatch(tpacket_ring_t *ring, int timeout,
+                      pcap_handler callback, u_char *user,
+                      char *errmsg, size_t errmsg_len)
+{
+    struct tpacket_block_desc *pbd;
+    struct pollfd pfd;
+    guint blocks;
+    int count = 0;
+
+    pbd = (struct tpacket_block_desc *)(void *)(ring->map + (size_t)ring->next_block * ring->block_size);
+    if (!(pbd->hdr.bh1.block_status & TP_STATUS_USER)) {
+        pfd.fd = ring->fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, timeout) == -1) {
+            if (errno == EINTR)
+                return 0;
+            g_snprintf(errmsg, (gulong)errmsg_len,
+                       "Error while waiting for packets: %s.", g_strerror(errno));
+            return -1;
+        }
+        if (pfd.revents & (POLLERR|POLLHUP|POLLNVAL)) {
+            int sock_err = 0;
+            socklen_t sock_err_len = sizeof sock_err;
+
+            getsockopt(ring->fd, SOL_SOCKET, SO_ERROR, &sock_err, &sock_err_len);
+            if (sock_err == ENETDOWN)
+                g_snprintf(errmsg, (gulong)errmsg_len, "The interface went down.");
+            else
+                g_snprintf(errmsg, (gulong)errmsg_len,
+                           "Error on the packet socket: %s.",
+                           sock_err != 0 ? g_strerror(sock_err) : "unknown error");
+            return -1;
+        }
+    }
+
+    /*
+     * Take the blocks in order, at most one trip around the ring, so that
+     * the caller gets back in control regularly under a steady load.
+     */
+    for (blocks = 0; blocks < ring->block_count; blocks++) {
+        pbd = (struct tpacket_block_desc *)(void *)(ring->map + (size_t)ring->next_block * ring->block_size);
+        if (!(pbd->hdr.bh1.block_status & TP_STATUS_USER))
+            break;
+
+        count += tpacket_ring_walk_block(ring, pbd, callback, user);
+
+        /* We're done with the block's contents before the kernel gets it back. */
+        __sync_synchronize();
+        pbd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+        ring->next_block = (ring->next_block + 1) % ring->block_count;
+    }
+    return count;
+}
+
+gboolean
+tpacket_ring_stats(tpacket_ring_t *ring, struct pcap_stat *stats)
+{
+    struct tpacket_stats_v3 kstats;
+    socklen_t len = sizeof kstats;
+
+    if (getsockopt(ring->fd, SOL_PACKET, PACKET_STATISTICS, &kstats, &len) == -1)
+        return FALSE;
+
+    /* As with libpcap, the received count includes the packets dropped. */
+    ring->stats.ps_recv += kstats.tp_packets;
+    ring->stats.ps_drop += kstats.tp_drops;
+    *stats = ring->stats;
+    return TRUE;
+}
+
+guint
+tpacket_ring_block_size(tpacket_ring_t *ring)
+{
+    return ring->block_size;
+}
+
+void
+tpacket_ring_close(tpacket_ring_t *ring)
+{
+    munmap(ring->map, ring->map_size);
+    close(ring->fd);
+    g_free(ring->pkt_buf);
+    g_free(ring);
+}
+
+#endif /* HAVE_TPACKET_V3 */
@@ -0,0 +1,117 @@
+/* capture_tpacket.h
+ * Linux TPACKET_V3 memory-mapped capture, for dumpcap
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __CAPTURE_TPACKET_H__
+#define __CAPTURE_TPACKET_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @file
+ *
+ * A capture engine that reads packets from an AF_PACKET socket through
+ * a TPACKET_V3 ring of blocks shared with the kernel.  The kernel fills
+ * a whole block before handing it over (or hands it over when the block
+ * timeout expires), so packets are taken a block at a time, without a
+ * system call or a copy per packet.
+ *
+ * Only Ethernet interfaces are handled; everything else is left to
+ * libpcap.
+ */
+
+#if defined(HAVE_LINUX_IF_PACKET_H) && defined(HAVE_PCAP_OPEN_DEAD)
+#include <linux/if_packet.h>
+#ifdef TPACKET3_HDRLEN
+#define HAVE_TPACKET_V3
+#endif
+#endif
+
+#ifdef HAVE_TPACKET_V3
+
+/** Default size of a ring block, in bytes; a power of 2. */
+#define TPACKET_DEFAULT_BLOCK_SIZE      (1024*1024)
+/** Default block retire timeout, in milliseconds. */
+#define TPACKET_DEFAULT_BLOCK_TIMEOUT   100
+/** Default total size of the ring, in bytes, if no buffer size was given. */
+#define TPACKET_DEFAULT_RING_SIZE       (8*1024*1024)
+
+typedef struct tpacket_ring_s tpacket_ring_t;
+
+/**
+ * Set up a ring on an Ethernet interface.  The ring doesn't receive any
+ * packets until tpacket_ring_start() is called.
+ *
+ * @param ifname the interface name
+ * @param snaplen the maximum number of bytes to hand over per packet
+ * @param promisc TRUE to put the interface into promiscuous mode
+ * @param block_size the size of a block; a power of 2, at least a page
+ * @param ring_size the total size of the ring, rounded down to whole blocks
+ * @param block_timeout how long, in milliseconds, the kernel may keep a
+ *        partly filled block before handing it over
+ * @param errmsg receives an error message on failure
+ * @param errmsg_len size of the errmsg buffer
+ * @return the ring, or NULL on failure
+ */
+extern tpacket_ring_t *tpacket_ring_open(const char *ifname, int snaplen,
+                                         gboolean promisc, guint block_size,
+                                         guint ring_size, guint block_timeout,
+                                         char *errmsg, size_t errmsg_len);
+
+/** Attach a compiled BPF program to the ring's socket. */
+extern gboolean tpacket_ring_set_filter(tpacket_ring_t *ring,
+                                        const struct bpf_program *fcode,
+                                        char *errmsg, size_t errmsg_len);
+
+/** Start receiving packets. */
+extern gboolean tpacket_ring_start(tpacket_ring_t *ring,
+                                   char *errmsg, size_t errmsg_len);
+
+/**
+ * Wait up to timeout milliseconds for a block, then hand every packet in
+ * the blocks that are ready to the callback, as pcap_dispatch() would.
+ *
+ * @return the number of packets handed over, or -1 on error (with
+ *         errmsg filled in)
+ */
+extern int tpacket_ring_dispatch(tpacket_ring_t *ring, int timeout,
+                                 pcap_handler callback, u_char *user,
+                                 char *errmsg, size_t errmsg_len);
+
+/** Get the packet statistics since the ring was opened, as pcap_stats() would. */
+extern gboolean tpacket_ring_stats(tpacket_ring_t *ring, struct pcap_stat *stats);
+
+/** The block size, e.g. for sizing output buffers. */
+extern guint tpacket_ring_block_size(tpacket_ring_t *ring);
+
+/** Tear down the ring and close the socket. */
+extern void tpacket_ring_close(tpacket_ring_t *ring);
+
+#endif /* HAVE_TPACKET_V3 */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAPTURE_TPACKET_H__ */
@@ -84,6 +84,10 @@ typedef struct _capture_file {
   guint32      ref_time_count;  /* Number of time referenced frames */
   gboolean     drops_known;     /* TRUE if we know how many packets were dropped */
   guint32      drops;           /* Dropped packets */
+  guint32      writer_stalls;   /* Times the capture waited for the file to be written */
+  guint32      flow_truncated;  /* Packets cut short by per-flow truncation */
+  guint32      sampled_out;     /* Packets left out by sampling (not drops) */
+  guint32      rate_limited;    /* Packets left out by the rate limit (not drops) */
   nstime_t     elapsed_time;    /* Elapsed time */
   gboolean     has_snap;        /* TRUE if maximum capture packet length is known */
   int          snap;            /* Maximum captured packet length */
@@ -103,6 +103,10 @@
 #include "capture_opts.h"
 #include "capture_ifinfo.h"
 #include "capture_sync.h"
+#include "capture_ring.h"
+#include "capture_tpacket.h"
+#include "capture_flowtrunc.h"
+#include "capture_sampling.h"
 
 #include "conditions.h"
 #include "capture_stop_conditions.h"
@@ -133,6 +137,19 @@ static HANDLE sig_pipe_handle = NULL;
 static gboolean signal_pipe_check_running(void);
 #endif
 
+/*
+ * On UNIX, pipes are read in large chunks, and every complete record in
+ * a chunk is handled in place; Windows reads one record at a time in a
+ * thread of its own.
+ */
+#ifndef _WIN32
+#define CAP_PIPE_BUFFERED
+/* How much we read from the pipe at a time */
+#define CAP_PIPE_BUF_SIZE   (512*1024)
+/* The largest pcapng block we take */
+#define CAP_PIPE_MAX_BLOCK  (16*1024*1024)
+#endif
+
 #ifdef USE_THREADS
 static GAsyncQueue *cap_pipe_pending_q, *cap_pipe_done_q;
 static GMutex *cap_pipe_read_mtx;
@@ -205,6 +222,53 @@ typedef enum {
     INITFILTER_OTHER_ERROR
 } initfilter_status_t;
 
+#if defined(USE_THREADS) && defined(HAVE_CAPTURE_RING)
+/*
+ * We can capture from each interface in a thread of its own, handing the
+ * packets to the main thread through a lock-free queue; the main thread
+ * merges them into one pcapng file.
+ */
+#define USE_CAPTURE_THREADS
+
+/* Size of the queue between a capture thread and the writer. */
+#define CAPTURE_THREAD_QUEUE_SIZE   (16*1024*1024)
+
+/*
+ * How long, in milliseconds, the writer holds packets back waiting for
+ * older ones from another interface; packets that arrive later than that
+ * are written out of order.
+ */
+#define CAPTURE_THREAD_REORDER_WINDOW   250
+
+/* How long, in microseconds, the writer sleeps if it has nothing to write. */
+#define CAPTURE_THREAD_IDLE_SLEEP       2000
+
+/* Most packets the writer takes from the queues at a time. */
+#define CAPTURE_THREAD_BATCH            1024
+
+/* How often, in milliseconds, a capture thread fetches its statistics. */
+#define CAPTURE_THREAD_STATS_INTERVAL   500
+
+/* an interface we're capturing on in a thread of its own */
+typedef struct _pcap_options {
+    guint32          interface_id;        /* index of the interface in the pcapng file */
+    gchar           *name;
+    gchar           *cfilter;
+    pcap_t          *pcap_h;
+    int              pcap_fd;
+    int              linktype;
+    int              snaplen;
+    capture_ring_t  *queue;               /* packets from the capture thread to the writer */
+    volatile gint    queue_drops;         /* packets dropped because the queue was full */
+    GThread         *tid;
+    volatile gint    done;                /* set by the capture thread when it stops */
+    gboolean         pcap_err;            /* TRUE if error from pcap */
+    char             errmsg[PCAP_ERRBUF_SIZE];
+    GMutex          *stats_mtx;
+    struct pcap_stat stats;               /* as last fetched by the capture thread */
+} pcap_options;
+#endif /* USE_THREADS && HAVE_CAPTURE_RING */
+
 typedef struct _loop_data {
     /* common */
     gboolean       go;                    /* TRUE as long as we're supposed to keep capturing */
@@ -246,6 +310,15 @@ typedef struct _loop_data {
         STATE_READ_DATA
     } cap_pipe_state;
     enum { PIPOK, PIPEOF, PIPERR, PIPNEXIST } cap_pipe_err;
+#ifdef CAP_PIPE_BUFFERED
+    guchar        *cap_pipe_rbuf;         /* what we've read from the pipe */
+    guint          cap_pipe_rbuf_size;
+    guint          cap_pipe_rbuf_start;   /* first byte not yet handled */
+    guint          cap_pipe_rbuf_end;     /* end of what we've read */
+    guint          cap_pipe_rbuf_need;    /* size of the record at cap_pipe_rbuf_start, if known */
+    gboolean       cap_pipe_pcapng;       /* TRUE if the pipe carries pcapng rather than pcap */
+    GArray        *cap_pipe_ng_ifs;       /* cap_pipe_ng_if for each IDB in the current section */
+#endif
 
     /* output file(s) */
     FILE          *pdh;
@@ -254,6 +327,27 @@ typedef struct _loop_data {
     int            file_snaplen;
     long           bytes_written;
     guint32        autostop_files;
+
+#ifdef HAVE_CAPTURE_RING
+    /* shared packet ring to our parent, if it gave us one */
+    capture_ring_t *ring;
+#endif
+    gboolean       ring_only;             /* packets go only to the ring; no file */
+#ifdef HAVE_TPACKET_V3
+    /* memory-mapped packet socket ring, used instead of pcap_h for reading */
+    tpacket_ring_t *tpacket;
+#endif
+#ifdef USE_CAPTURE_THREADS
+    /* interfaces captured on in threads of their own, used instead of pcap_h */
+    pcap_options  *pcaps;
+    guint          n_pcaps;
+#endif
+
+    /* per-flow truncation, if asked for */
+    flow_trunc_t  *flow_trunc;
+
+    /* sampling and rate limiting, if asked for */
+    sampler_t     *sampler;
 } loop_data;
 
 /*
@@ -312,8 +406,48 @@ console_log_handler(const char *log_domain, GLogLevelFlags log_level,
 static capture_options global_capture_opts;
 static gboolean quiet = FALSE;
 
+/* messages to our parent that are sent as one batch (capture child only) */
+static sync_pipe_batch_t sync_batch;
+#ifdef HAVE_CAPTURE_RING
+static capture_ring_t *capture_ring = NULL;
+static pid_t capture_ring_parent;     /* the process that gave us the ring */
+#endif
+#ifdef HAVE_TPACKET_V3
+/* TPACKET_V3 ring block size (0 means don't use the ring) and timeout */
+static guint tpacket_block_size = TPACKET_DEFAULT_BLOCK_SIZE;
+static guint tpacket_block_timeout = TPACKET_DEFAULT_BLOCK_TIMEOUT;
+#endif
+/* TRUE if capture files are written by a thread of their own */
+static gboolean async_output = FALSE;
+
+/* Size of each of the buffers such a thread writes out. */
+#define DUMPCAP_WRITER_BUFFER_SIZE  (4*1024*1024)
+
+#ifdef USE_CAPTURE_THREADS
+/* capture from each interface in a thread of its own */
+static gboolean use_threads = FALSE;
+
+static void capture_loop_close_thread_inputs(loop_data *ld);
+#endif
+
+/* per-flow truncation: payload bytes and packets to keep whole per flow
+   (both 0 means don't truncate), and when to forget an idle flow */
+static guint32 flow_trunc_bytes = 0;
+static guint32 flow_trunc_packets = 0;
+static guint32 flow_trunc_idle = FLOW_TRUNC_DEFAULT_IDLE;
+
+/* sampling: how, and 1 in how many; and the most packets per second to
+   keep, with the burst allowed above that (a rate of 0 means no limit) */
+static sample_mode_e sample_mode = SAMPLE_NONE;
+static guint32 sample_rate = 0;
+static guint32 sample_limit_rate = 0;
+static guint32 sample_limit_burst = 0;
+
+static void capture_loop_write_packet(loop_data *ld, const struct pcap_pkthdr *phdr,
+                                      guint32 interface_id, const u_char *pd);
 static void capture_loop_packet_cb(u_char *user, const struct pcap_pkthdr *phdr,
                                    const u_char *pd);
+static gboolean parse_sampling(gchar *arg);
 static void capture_loop_get_errmsg(char *errmsg, int errmsglen, const char *fname,
                                     int err, gboolean is_close);
 
@@ -321,7 +455,13 @@ static void WS_MSVC_NORETURN exit_main(int err) G_GNUC_NORETURN;
 
 static void report_new_capture_file(const char *filename);
 static void report_packet_count(int packet_count);
+static void report_interface_stats(void);
+static void report_one_interface_stats(guint iface, const struct pcap_stat *stats);
+static void report_flush(void);
 static void report_packet_drops(guint32 received, guint32 drops, gchar *name);
+static void report_writer_stalls(void);
+static void report_flow_truncation(void);
+static void report_sampling(void);
 static void report_capture_error(const char *error_msg, const char *secondary_error_msg);
 static void report_cfilter_error(const char *cfilter, const char *errmsg);
 
@@ -354,6 +494,14 @@ print_usage(gboolean print_ver)
 #endif
 #if defined(_WIN32) || defined(HAVE_PCAP_CREATE)
     fprintf(output, "  -B <buffer size>         size of kernel buffer (def: 1MB)\n");
+#endif
+#ifdef HAVE_TPACKET_V3
+    fprintf(output, "  -K <block KB>[:<ms>]     memory-mapped ring block size and timeout;\n");
+    fprintf(output, "                           0 to use libpcap (def: %u:%u)\n",
+            TPACKET_DEFAULT_BLOCK_SIZE / 1024, TPACKET_DEFAULT_BLOCK_TIMEOUT);
+#endif
+#ifdef USE_CAPTURE_THREADS
+    fprintf(output, "  -t                       capture from each interface in a separate thread\n");
 #endif
     fprintf(output, "  -y <link type>           link layer type (def: first appropriate)\n");
     fprintf(output, "  -D                       print list of interfaces and exit\n");
@@ -385,9 +533,19 @@ print_usage(gboolean print_ver)
     fprintf(output, "  -w <filename>            name of file to save (def: tempfile)\n");
     fprintf(output, "  -g                       enable group read access on the output file(s)\n");
     fprintf(output, "  -b <ringbuffer opt.> ... duration:NUM - switch to next file after NUM secs\n");
+    fprintf(output, "                           interval:NUM - switch to next file every NUM secs,\n");
+    fprintf(output, "                                          on the clock\n");
     fprintf(output, "                           filesize:NUM - switch to next file after NUM KB\n");
     fprintf(output, "                              files:NUM - ringbuffer: replace after NUM files\n");
     fprintf(output, "  -n                       use pcapng format instead of pcap\n");
+    fprintf(output, "  -T <B>[:<P>[:<secs>]]    save only headers of a flow's packets after its first\n");
+    fprintf(output, "                           B payload bytes or P packets; forget flows idle\n");
+    fprintf(output, "                           for secs (def: %u)\n",
+            FLOW_TRUNC_DEFAULT_IDLE);
+    fprintf(output, "  -j <sampling opt.> ...   count:NUM - save one packet of every NUM\n");
+    fprintf(output, "                           random:NUM - save each packet with a chance of 1 in NUM\n");
+    fprintf(output, "                           flow:NUM - save every packet of one flow in NUM\n");
+    fprintf(output, "                           limit:PPS[:BURST] - save no more than PPS packets/s\n");
     /*fprintf(output, "\n");*/
     fprintf(output, "Miscellaneous:\n");
     fprintf(output, "  -q                       don't report packet capture counts\n");
@@ -1493,7 +1651,7 @@ cap_pipe_adjust_header(gboolean byte_swapped, struct pcap_hdr *hdr, struct pcapr
     }
 }
 
-#ifdef USE_THREADS
+#if defined(USE_THREADS) && !defined(CAP_PIPE_BUFFERED)
 /*
  * Thread function that reads from a pipe and pushes the data
  * to the main application thread.
@@ -1578,7 +1736,7 @@ static void *cap_pipe_read(void *ld_ptr)
     }
     return NULL;
 }
-#endif /* USE_THREADS */
+#endif /* USE_THREADS && !CAP_PIPE_BUFFERED */
 
 /* Provide select() functionality for a single file descriptor
  * on UNIX/POSIX. Windows uses cap_pipe_read via a thread.
@@ -1608,6 +1766,434 @@ cap_pipe_select(int pipe_fd)
 }
 
 
+#ifdef CAP_PIPE_BUFFERED
+/* pcapng block types and magic numbers we need */
+#define PCAPNG_BLOCK_SHB            0x0A0D0D0A
+#define PCAPNG_BLOCK_IDB            0x00000001
+#define PCAPNG_BLOCK_PB             0x00000002  /* obsolete */
+#define PCAPNG_BLOCK_SPB            0x00000003
+#define PCAPNG_BLOCK_EPB            0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC     0x1A2B3C4D
+#define PCAPNG_OPT_IF_TSRESOL       9
+
+/* what we need to know about an interface in a pcapng stream */
+typedef struct {
+    int            linktype;
+    guint64        ts_per_sec;
+} cap_pipe_ng_if;
+
+#define CAP_PIPE_GET16(ld, p) \
+    ((ld)->cap_pipe_byte_swapped ? BSWAP16(*(const guint16 *)(p)) : *(const guint16 *)(p))
+#define CAP_PIPE_GET32(ld, p) \
+    ((ld)->cap_pipe_byte_swapped ? BSWAP32(*(const guint32 *)(p)) : *(const guint32 *)(p))
+
+/* Make room in the read buffer for at least "need" bytes from the start
+   of the unhandled data. */
+static void
+cap_pipe_make_room(loop_data *ld, guint need)
+{
+    guint left = ld->cap_pipe_rbuf_end - ld->cap_pipe_rbuf_start;
+
+    if (need < CAP_PIPE_BUF_SIZE)
+        need = CAP_PIPE_BUF_SIZE;
+    if (ld->cap_pipe_rbuf_size < need) {
+        /* a record too big for the buffer; it's freed when the pipe is closed */
+        ld->cap_pipe_rbuf = g_realloc(ld->cap_pipe_rbuf, need);
+        ld->cap_pipe_rbuf_size = need;
+    }
+
+    /* Move what's left to the front, if there isn't much room after it;
+       there usually isn't much left, as we handle every complete record. */
+    if (left == 0) {
+        ld->cap_pipe_rbuf_start = ld->cap_pipe_rbuf_end = 0;
+    } else if (ld->cap_pipe_rbuf_start != 0 &&
+               (ld->cap_pipe_rbuf_size - ld->cap_pipe_rbuf_end < ld->cap_pipe_rbuf_size / 4 ||
+                ld->cap_pipe_rbuf_size - ld->cap_pipe_rbuf_start < need)) {
+        memmove(ld->cap_pipe_rbuf, ld->cap_pipe_rbuf + ld->cap_pipe_rbuf_start, left);
+        ld->cap_pipe_rbuf_start = 0;
+        ld->cap_pipe_rbuf_end = left;
+    }
+}
+
+/* Read from the pipe, waiting if need be, until there are at least "need"
+   bytes we haven't handled; only used while opening the pipe. */
+static gboolean
+cap_pipe_read_at_least(loop_data *ld, guint need, const char *what,
+                       char *errmsg, int errmsgl)
+{
+    int sel_ret;
+    ssize_t b;
+
+    if (ld->cap_pipe_rbuf == NULL) {
+        ld->cap_pipe_rbuf = g_malloc(CAP_PIPE_BUF_SIZE);
+        ld->cap_pipe_rbuf_size = CAP_PIPE_BUF_SIZE;
+        ld->cap_pipe_rbuf_start = ld->cap_pipe_rbuf_end = 0;
+    }
+    while (ld->cap_pipe_rbuf_end - ld->cap_pipe_rbuf_start < need) {
+        cap_pipe_make_room(ld, need);
+        sel_ret = cap_pipe_select(ld->cap_pipe_fd);
+        if (sel_ret < 0) {
+            if (errno == EINTR)
+                continue;
+            g_snprintf(errmsg, errmsgl,
+                       "Unexpected error from select: %s", g_strerror(errno));
+            return FALSE;
+        } else if (sel_ret > 0) {
+            b = read(ld->cap_pipe_fd, ld->cap_pipe_rbuf + ld->cap_pipe_rbuf_end,
+                     ld->cap_pipe_rbuf_size - ld->cap_pipe_rbuf_end);
+            if (b <= 0) {
+                if (b < 0 && errno == EINTR)
+                    continue;
+                if (b == 0)
+                    g_snprintf(errmsg, errmsgl, "End of file on pipe %s during open", what);
+                else
+                    g_snprintf(errmsg, errmsgl, "Error on pipe %s during open: %s",
+                               what, g_strerror(errno));
+                return FALSE;
+            }
+            ld->cap_pipe_rbuf_end += (guint)b;
+        }
+    }
+    return TRUE;
+}
+
+/* Get the length of a pcapng block, of which we have at least the first
+   12 bytes; returns 0 if it's bad.  A section header block brings its own
+   byte order, so that's picked up here. */
+static guint32
+cap_pipe_pcapng_block_len(loop_data *ld, const guchar *p, char *errmsg, int errmsgl)
+{
+    guint32 block_len;
+
+    if (*(const guint32 *)p == PCAPNG_BLOCK_SHB)
+        ld->cap_pipe_byte_swapped = (*(const guint32 *)(p + 8) != PCAPNG_BYTE_ORDER_MAGIC);
+    block_len = CAP_PIPE_GET32(ld, p + 4);
+
+    if (block_len < 12 || (block_len % 4) != 0 || block_len > CAP_PIPE_MAX_BLOCK) {
+        g_snprintf(errmsg, errmsgl, "Bad pcapng block length %u on pipe", block_len);
+        return 0;
+    }
+    return block_len;
+}
+
+/* Take in a section header block: a new byte order, and no interfaces. */
+static gboolean
+cap_pipe_pcapng_shb(loop_data *ld, const guchar *p, guint32 block_len,
+                    char *errmsg, int errmsgl)
+{
+    guint32 bom = *(const guint32 *)(p + 8);
+
+    if (bom != PCAPNG_BYTE_ORDER_MAGIC && bom != BSWAP32(PCAPNG_BYTE_ORDER_MAGIC)) {
+        g_snprintf(errmsg, errmsgl, "Unrecognized pcapng byte order on pipe");
+        return FALSE;
+    }
+    if (block_len < 28) {
+        g_snprintf(errmsg, errmsgl, "Section header block too short on pipe");
+        return FALSE;
+    }
+    g_array_set_size(ld->cap_pipe_ng_ifs, 0);
+    return TRUE;
+}
+
+/* Take in an interface description block. */
+static gboolean
+cap_pipe_pcapng_idb(loop_data *ld, const guchar *p, guint32 block_len,
+                    char *errmsg, int errmsgl)
+{
+    cap_pipe_ng_if ng_if;
+    const guchar *opt, *end;
+    guint16 opt_code, opt_len;
+    guint8 tsresol;
+    int i;
+
+    if (block_len < 20) {
+        g_snprintf(errmsg, errmsgl, "Interface description block too short on pipe");
+        return FALSE;
+    }
+    ng_if.linktype = CAP_PIPE_GET16(ld, p + 8);
+    ng_if.ts_per_sec = 1000000;
+    for (opt = p + 16, end = p + block_len - 4; opt + 4 <= end; ) {
+        opt_code = CAP_PIPE_GET16(ld, opt);
+        opt_len = CAP_PIPE_GET16(ld, opt + 2);
+        if (opt_code == 0 || opt + 4 + opt_len > end)
+            break;
+        if (opt_code == PCAPNG_OPT_IF_TSRESOL && opt_len >= 1) {
+            tsresol = opt[4];
+            ng_if.ts_per_sec = 1;
+            for (i = 0; i < (tsresol & 0x7f) && i < 63; i++)
+                ng_if.ts_per_sec *= (tsresol & 0x80) ? 2 : 10;
+        }
+        opt += 4 + ((opt_len + 3) & ~3);
+    }
+    if (ld->cap_pipe_ng_ifs->len != 0 &&
+        ng_if.linktype != g_array_index(ld->cap_pipe_ng_ifs, cap_pipe_ng_if, 0).linktype) {
+        /* XXX - we write only one link-layer type */
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_WARNING,
+              "Packets from interface %u on the pipe have link-layer type %d rather than %d, and will be dropped",
+              ld->cap_pipe_ng_ifs->len, ng_if.linktype,
+              g_array_index(ld->cap_pipe_ng_ifs, cap_pipe_ng_if, 0).linktype);
+    }
+    g_array_append_val(ld->cap_pipe_ng_ifs, ng_if);
+    return TRUE;
+}
+
+/* Read a pcapng stream's first section header block and interface
+   description block, so we know what we're getting. */
+static gboolean
+cap_pipe_pcapng_open(loop_data *ld, struct pcap_hdr *hdr, char *errmsg, int errmsgl)
+{
+    const guchar *p;
+    guint32 block_type, block_len;
+
+    ld->cap_pipe_pcapng = TRUE;
+    ld->cap_pipe_ng_ifs = g_array_new(FALSE, FALSE, sizeof(cap_pipe_ng_if));
+    while (ld->cap_pipe_ng_ifs->len == 0) {
+        if (!cap_pipe_read_at_least(ld, 12, "block header", errmsg, errmsgl))
+            return FALSE;
+        p = ld->cap_pipe_rbuf + ld->cap_pipe_rbuf_start;
+        if ((block_len = cap_pipe_pcapng_block_len(ld, p, errmsg, errmsgl)) == 0)
+            return FALSE;
+        block_type = CAP_PIPE_GET32(ld, p);
+        if (!cap_pipe_read_at_least(ld, block_len, "block", errmsg, errmsgl))
+            return FALSE;
+        p = ld->cap_pipe_rbuf + ld->cap_pipe_rbuf_start;
+
+        switch (block_type) {
+
+        case PCAPNG_BLOCK_SHB:
+            if (!cap_pipe_pcapng_shb(ld, p, block_len, errmsg, errmsgl))
+                return FALSE;
+            break;
+
+        case PCAPNG_BLOCK_IDB:
+            if (!cap_pipe_pcapng_idb(ld, p, block_len, errmsg, errmsgl))
+                return FALSE;
+            hdr->snaplen = CAP_PIPE_GET32(ld, p + 12);
+            if (hdr->snaplen == 0 || hdr->snaplen > WTAP_MAX_PACKET_SIZE)
+                hdr->snaplen = WTAP_MAX_PACKET_SIZE;
+            break;
+
+        case PCAPNG_BLOCK_PB:
+        case PCAPNG_BLOCK_SPB:
+        case PCAPNG_BLOCK_EPB:
+            g_snprintf(errmsg, errmsgl, "Packet before any interface description on pipe");
+            return FALSE;
+        }
+        ld->cap_pipe_rbuf_start += block_len;
+    }
+
+    hdr->version_major = 2;
+    hdr->version_minor = 4;
+    hdr->thiszone = 0;
+    hdr->sigfigs = 0;
+    hdr->network = g_array_index(ld->cap_pipe_ng_ifs, cap_pipe_ng_if, 0).linktype;
+    return TRUE;
+}
+
+/* Handle a pcapng block from the pipe.  Returns 1 if it was a packet we
+   handed on, 0 if it wasn't, -1 on error. */
+static int
+cap_pipe_pcapng_block(loop_data *ld, const guchar *p, guint32 block_len,
+                      char *errmsg, int errmsgl)
+{
+    struct pcap_pkthdr phdr;
+    guint32 block_type, interface_id, data_offset;
+    cap_pipe_ng_if *ng_if;
+    guint64 ts, frac;
+    GTimeVal now;
+
+    block_type = CAP_PIPE_GET32(ld, p);
+
+    switch (block_type) {
+
+    case PCAPNG_BLOCK_SHB:
+        return cap_pipe_pcapng_shb(ld, p, block_len, errmsg, errmsgl) ? 0 : -1;
+
+    case PCAPNG_BLOCK_IDB:
+        return cap_pipe_pcapng_idb(ld, p, block_len, errmsg, errmsgl) ? 0 : -1;
+
+    case PCAPNG_BLOCK_EPB:
+    case PCAPNG_BLOCK_PB:
+        if (block_len < 32)
+            goto too_short;
+        if (block_type == PCAPNG_BLOCK_EPB)
+            interface_id = CAP_PIPE_GET32(ld, p + 8);
+        else
+            interface_id = CAP_PIPE_GET16(ld, p + 8);
+        ts = ((guint64)CAP_PIPE_GET32(ld, p + 12) << 32) | CAP_PIPE_GET32(ld, p + 16);
+        phdr.caplen = CAP_PIPE_GET32(ld, p + 20);
+        phdr.len = CAP_PIPE_GET32(ld, p + 24);
+        data_offset = 28;
+        if (interface_id >= ld->cap_pipe_ng_ifs->len) {
+            g_snprintf(errmsg, errmsgl, "Packet for unknown interface %u on pipe", interface_id);
+            return -1;
+        }
+        ng_if = &g_array_index(ld->cap_pipe_ng_ifs, cap_pipe_ng_if, interface_id);
+        phdr.ts.tv_sec = (long)(ts / ng_if->ts_per_sec);
+        frac = ts % ng_if->ts_per_sec;
+        if (ng_if->ts_per_sec >= 1000000)
+            phdr.ts.tv_usec = (long)(frac / (ng_if->ts_per_sec / 1000000));
+        else
+            phdr.ts.tv_usec = (long)(frac * 1000000 / ng_if->ts_per_sec);
+        break;
+
+    case PCAPNG_BLOCK_SPB:
+        if (block_len < 16)
+            goto too_short;
+        interface_id = 0;
+        phdr.len = CAP_PIPE_GET32(ld, p + 8);
+        phdr.caplen = MIN(phdr.len, block_len - 16);
+        data_offset = 12;
+        if (ld->cap_pipe_ng_ifs->len == 0) {
+            g_snprintf(errmsg, errmsgl, "Packet before any interface description on pipe");
+            return -1;
+        }
+        /* no time stamp; use the time we got it */
+        g_get_current_time(&now);
+        phdr.ts.tv_sec = now.tv_sec;
+        phdr.ts.tv_usec = now.tv_usec;
+        break;
+
+    default:
+        /* statistics, name resolution and the like; not for us */
+        return 0;
+    }
+
+    if (phdr.caplen > WTAP_MAX_PACKET_SIZE) {
+        g_snprintf(errmsg, errmsgl, "Frame %u too long (%d bytes)",
+                   ld->packet_count+1, phdr.caplen);
+        return -1;
+    }
+    if (data_offset + phdr.caplen + 4 > block_len)
+        goto too_short;
+
+    /* XXX - we write only one link-layer type */
+    if (g_array_index(ld->cap_pipe_ng_ifs, cap_pipe_ng_if, interface_id).linktype != ld->linktype)
+        return 0;
+
+    capture_loop_packet_cb((u_char *)ld, &phdr, p + data_offset);
+    return 1;
+
+too_short:
+    g_snprintf(errmsg, errmsgl, "Packet block too short on pipe");
+    return -1;
+}
+
+/* Hand every complete record we've read from the pipe to the capture
+   loop, without copying it.  Returns the number of packets, or -1 on
+   error. */
+static int
+cap_pipe_handle_buffered(loop_data *ld, char *errmsg, int errmsgl)
+{
+    struct pcap_pkthdr phdr;
+    const guchar *p;
+    guint avail, hdr_len, rec_len;
+    int inpkts = 0, ret;
+
+    hdr_len = ld->cap_pipe_modified ?
+        sizeof(struct pcaprec_modified_hdr) : sizeof(struct pcaprec_hdr);
+
+    while (ld->go) {
+        p = ld->cap_pipe_rbuf + ld->cap_pipe_rbuf_start;
+        avail = ld->cap_pipe_rbuf_end - ld->cap_pipe_rbuf_start;
+        ld->cap_pipe_rbuf_need = 0;
+
+        if (ld->cap_pipe_pcapng) {
+            if (avail < 12)
+                break;
+            if ((rec_len = cap_pipe_pcapng_block_len(ld, p, errmsg, errmsgl)) == 0)
+                return -1;
+            if (avail < rec_len) {
+                ld->cap_pipe_rbuf_need = rec_len;
+                break;
+            }
+            ret = cap_pipe_pcapng_block(ld, p, rec_len, errmsg, errmsgl);
+            if (ret < 0)
+                return -1;
+            inpkts += ret;
+        } else {
+            if (avail < hdr_len)
+                break;
+            memcpy(&ld->cap_pipe_rechdr, p, hdr_len);
+            cap_pipe_adjust_header(ld->cap_pipe_byte_swapped, &ld->cap_pipe_hdr,
+                                   &ld->cap_pipe_rechdr.hdr);
+            if (ld->cap_pipe_rechdr.hdr.incl_len > WTAP_MAX_PACKET_SIZE) {
+                g_snprintf(errmsg, errmsgl, "Frame %u too long (%d bytes)",
+                           ld->packet_count+1, ld->cap_pipe_rechdr.hdr.incl_len);
+                return -1;
+            }
+            rec_len = hdr_len + ld->cap_pipe_rechdr.hdr.incl_len;
+            if (avail < rec_len) {
+                ld->cap_pipe_rbuf_need = rec_len;
+                break;
+            }
+            phdr.ts.tv_sec = ld->cap_pipe_rechdr.hdr.ts_sec;
+            phdr.ts.tv_usec = ld->cap_pipe_rechdr.hdr.ts_usec;
+            phdr.caplen = ld->cap_pipe_rechdr.hdr.incl_len;
+            phdr.len = ld->cap_pipe_rechdr.hdr.orig_len;
+            capture_loop_packet_cb((u_char *)ld, &phdr, p + hdr_len);
+            inpkts++;
+        }
+        ld->cap_pipe_rbuf_start += rec_len;
+    }
+    return inpkts;
+}
+
+/* Read what the pipe has for us, as much as fits in the buffer, and
+   handle every complete record in it.  The caller has made sure the read
+   won't block. */
+static int
+cap_pipe_dispatch_buffered(loop_data *ld, char *errmsg, int errmsgl)
+{
+    ssize_t b;
+
+    cap_pipe_make_room(ld, ld->cap_pipe_rbuf_need);
+    b = read(ld->cap_pipe_fd, ld->cap_pipe_rbuf + ld->cap_pipe_rbuf_end,
+             ld->cap_pipe_rbuf_size - ld->cap_pipe_rbuf_end);
+    if (b == 0) {
+        /* Hand on any complete records that are left first */
+        if (cap_pipe_handle_buffered(ld, errmsg, errmsgl) < 0) {
+            ld->cap_pipe_err = PIPERR;
+            return -1;
+        }
+        ld->cap_pipe_err = PIPEOF;
+        return -1;
+    }
+    if (b < 0) {
+        if (errno == EINTR || errno == EAGAIN)
+            return 0;
+        g_snprintf(errmsg, errmsgl, "Error reading from pipe: %s",
+                   g_strerror(errno));
+        ld->cap_pipe_err = PIPERR;
+        return -1;
+    }
+    ld->cap_pipe_rbuf_end += (guint)b;
+
+    b = cap_pipe_handle_buffered(ld, errmsg, errmsgl);
+    if (b < 0)
+        ld->cap_pipe_err = PIPERR;
+    return (int)b;
+}
+
+/* Hand on the complete records that are in the buffer already, without
+   reading from the pipe; opening the pipe usually reads in some records
+   along with the header, and those shouldn't have to wait for the pipe
+   to have more.  Returns the number of packets, or -1 on error. */
+static int
+cap_pipe_dispatch_unhandled(loop_data *ld, char *errmsg, int errmsgl)
+{
+    int inpkts;
+
+    if (ld->cap_pipe_rbuf_start == ld->cap_pipe_rbuf_end)
+        return 0;
+    inpkts = cap_pipe_handle_buffered(ld, errmsg, errmsgl);
+    if (inpkts < 0)
+        ld->cap_pipe_err = PIPERR;
+    return inpkts;
+}
+#endif /* CAP_PIPE_BUFFERED */
+
+
 /* Mimic pcap_open_live() for pipe captures
 
  * We check if "pipename" is "-" (stdin), a AF_UNIX socket, or a FIFO,
@@ -1622,9 +2208,7 @@ cap_pipe_open_live(char *pipename, struct pcap_hdr *hdr, loop_data *ld,
 #ifndef _WIN32
     ws_statb64   pipe_stat;
     struct sockaddr_un sa;
-    int          sel_ret;
     int          b;
-    unsigned int bytes_read;
     int          fd;
 #else /* _WIN32 */
 #if 1
@@ -1797,29 +2381,22 @@ cap_pipe_open_live(char *pipename, struct pcap_hdr *hdr, loop_data *ld,
 
     ld->from_cap_pipe = TRUE;
 
-#ifndef USE_THREADS
-    /* read the pcap header */
-    bytes_read = 0;
-    while (bytes_read < sizeof magic) {
-        sel_ret = cap_pipe_select(fd);
-        if (sel_ret < 0) {
-            g_snprintf(errmsg, errmsgl,
-                       "Unexpected error from select: %s", g_strerror(errno));
+#ifdef CAP_PIPE_BUFFERED
+    ld->cap_pipe_fd = fd;
+    ld->cap_pipe_pcapng = FALSE;
+    if (!cap_pipe_read_at_least(ld, sizeof magic, "magic", errmsg, errmsgl))
+        goto error;
+    memcpy(&magic, ld->cap_pipe_rbuf + ld->cap_pipe_rbuf_start, sizeof magic);
+    if (magic == PCAPNG_BLOCK_SHB) {
+        /* a pcapng stream; the blocks tell us what we need */
+        if (!cap_pipe_pcapng_open(ld, hdr, errmsg, errmsgl))
             goto error;
-        } else if (sel_ret > 0) {
-            b = read(fd, ((char *)&magic)+bytes_read, sizeof magic-bytes_read);
-            if (b <= 0) {
-                if (b == 0)
-                    g_snprintf(errmsg, errmsgl, "End of file on pipe magic during open");
-                else
-                    g_snprintf(errmsg, errmsgl, "Error on pipe magic during open: %s",
-                               g_strerror(errno));
-                goto error;
-            }
-            bytes_read += b;
-        }
+        ld->linktype = hdr->network;
+        ld->cap_pipe_err = PIPOK;
+        return;
     }
-#else /* USE_THREADS */
+    ld->cap_pipe_rbuf_start += sizeof magic;
+#else /* CAP_PIPE_BUFFERED */
     g_thread_create(&cap_pipe_read, ld, FALSE, NULL);
 
     ld->cap_pipe_buf = (char *) &magic;
@@ -1837,7 +2414,7 @@ cap_pipe_open_live(char *pipename, struct pcap_hdr *hdr, loop_data *ld,
         goto error;
     }
 
-#endif /* USE_THREADS */
+#endif /* CAP_PIPE_BUFFERED */
 
     switch (magic) {
     case PCAP_MAGIC:
@@ -1872,30 +2449,13 @@ cap_pipe_open_live(char *pipename, struct pcap_hdr *hdr, loop_data *ld,
         goto error;
     }
 
-#ifndef USE_THREADS
+#ifdef CAP_PIPE_BUFFERED
     /* Read the rest of the header */
-    bytes_read = 0;
-    while (bytes_read < sizeof(struct pcap_hdr)) {
-        sel_ret = cap_pipe_select(fd);
-        if (sel_ret < 0) {
-            g_snprintf(errmsg, errmsgl,
-                       "Unexpected error from select: %s", g_strerror(errno));
-            goto error;
-        } else if (sel_ret > 0) {
-            b = read(fd, ((char *)hdr)+bytes_read,
-                     sizeof(struct pcap_hdr) - bytes_read);
-            if (b <= 0) {
-                if (b == 0)
-                    g_snprintf(errmsg, errmsgl, "End of file on pipe header during open");
-                else
-                    g_snprintf(errmsg, errmsgl, "Error on pipe header during open: %s",
-                               g_strerror(errno));
-                goto error;
-            }
-            bytes_read += b;
-        }
-    }
-#else /* USE_THREADS */
+    if (!cap_pipe_read_at_least(ld, sizeof(struct pcap_hdr), "header", errmsg, errmsgl))
+        goto error;
+    memcpy(hdr, ld->cap_pipe_rbuf + ld->cap_pipe_rbuf_start, sizeof(struct pcap_hdr));
+    ld->cap_pipe_rbuf_start += sizeof(struct pcap_hdr);
+#else /* CAP_PIPE_BUFFERED */
     ld->cap_pipe_buf = (char *) hdr;
     ld->cap_pipe_bytes_read = 0;
     ld->cap_pipe_bytes_to_read = sizeof(struct pcap_hdr);
@@ -1909,7 +2469,7 @@ cap_pipe_open_live(char *pipename, struct pcap_hdr *hdr, loop_data *ld,
                        g_strerror(errno));
         goto error;
     }
-#endif /* USE_THREADS */
+#endif /* CAP_PIPE_BUFFERED */
 
     if (ld->cap_pipe_byte_swapped) {
         /* Byte-swap the header fields about which we care. */
@@ -1944,6 +2504,7 @@ error:
 }
 
 
+#ifndef CAP_PIPE_BUFFERED
 /* We read one record from the pipe, take care of byte order in the record
  * header, write the record to the capture file, and update capture statistics. */
 static int
@@ -2131,6 +2692,7 @@ cap_pipe_dispatch(loop_data *ld, guchar *data, char *errmsg, int errmsgl)
     /* Return here rather than inside the switch to prevent GCC warning */
     return -1;
 }
+#endif /* CAP_PIPE_BUFFERED */
 
 
 /** Open the capture input file (pcap or capture pipe).
@@ -2329,6 +2891,14 @@ static void capture_loop_close_input(loop_data *ld)
         ws_close(ld->cap_pipe_fd);
         ld->cap_pipe_fd = 0;
     }
+    if (ld->cap_pipe_rbuf != NULL) {
+        g_free(ld->cap_pipe_rbuf);
+        ld->cap_pipe_rbuf = NULL;
+    }
+    if (ld->cap_pipe_ng_ifs != NULL) {
+        g_array_free(ld->cap_pipe_ng_ifs, TRUE);
+        ld->cap_pipe_ng_ifs = NULL;
+    }
 #else
     if (ld->cap_pipe_h != INVALID_HANDLE_VALUE) {
         CloseHandle(ld->cap_pipe_h);
@@ -2336,6 +2906,20 @@ static void capture_loop_close_input(loop_data *ld)
     }
 #endif
 
+#ifdef USE_CAPTURE_THREADS
+    /* if open, stop the capture threads and close their interfaces */
+    if (ld->pcaps != NULL)
+        capture_loop_close_thread_inputs(ld);
+#endif
+
+#ifdef HAVE_TPACKET_V3
+    /* if open, close the packet ring */
+    if (ld->tpacket != NULL) {
+        tpacket_ring_close(ld->tpacket);
+        ld->tpacket = NULL;
+    }
+#endif
+
     /* if open, close the pcap "input file" */
     if(ld->pcap_h != NULL) {
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_close_input: closing %p", (void *)ld->pcap_h);
@@ -2362,8 +2946,9 @@ capture_loop_init_filter(pcap_t *pcap_h, gboolean from_cap_pipe,
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_init_filter: %s", cfilter);
 
-    /* capture filters only work on real interfaces */
-    if (cfilter && !from_cap_pipe) {
+    /* capture filters only work on real interfaces (capture threads
+       set up their own) */
+    if (cfilter && !from_cap_pipe && pcap_h != NULL) {
         /* A capture filter was specified; set it up. */
         if (!compile_capture_filter(name, pcap_h, &fcode, cfilter)) {
             /* Treat this specially - our caller might try to compile this
@@ -2386,55 +2971,553 @@ capture_loop_init_filter(pcap_t *pcap_h, gboolean from_cap_pipe,
 }
 
 
-/* set up to write to the already-opened capture output file/files */
+#ifdef USE_CAPTURE_THREADS
+/* open every interface, with its own filter, to be captured on in a thread */
 static gboolean
-capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *errmsg, int errmsg_len)
+capture_loop_open_thread_inputs(capture_options *capture_opts, loop_data *ld,
+                                char *errmsg, size_t errmsg_len,
+                                char *secondary_errmsg, size_t secondary_errmsg_len)
 {
+    gchar       open_err_str[PCAP_ERRBUF_SIZE];
+    interface_options interface_opts;
+    pcap_options *pcap_opts;
     int         err;
+    guint       i;
 
-    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_init_output");
-
-    /* get snaplen */
-    if (ld->from_cap_pipe) {
-        ld->file_snaplen = ld->cap_pipe_hdr.snaplen;
-    } else
-    {
-        ld->file_snaplen = pcap_snapshot(ld->pcap_h);
-    }
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_open_thread_inputs: %u interfaces",
+          capture_opts->number_of_ifaces);
 
-    /* Set up to write to the capture file. */
-    if (capture_opts->multi_files_on) {
-        ld->pdh = ringbuf_init_libpcap_fdopen(&err);
-    } else {
-        ld->pdh = libpcap_fdopen(ld->save_file_fd, &err);
+    ld->n_pcaps = capture_opts->number_of_ifaces;
+    ld->pcaps = g_new0(pcap_options, ld->n_pcaps);
+    for (i = 0; i < ld->n_pcaps; i++) {
+        pcap_opts = &ld->pcaps[i];
+        pcap_opts->pcap_fd = -1;
+        pcap_opts->stats_mtx = g_mutex_new();
     }
-    if (ld->pdh) {
-        gboolean successful;
 
-        ld->bytes_written = 0;
-        if (capture_opts->use_pcapng) {
-            char appname[100];
+    for (i = 0; i < ld->n_pcaps; i++) {
+        interface_opts = g_array_index(capture_opts->ifaces, interface_options, i);
+        pcap_opts = &ld->pcaps[i];
+        pcap_opts->interface_id = i;
+        pcap_opts->name = interface_opts.name;
+        pcap_opts->cfilter = interface_opts.cfilter;
 
-            g_snprintf(appname, sizeof(appname), "Dumpcap " VERSION "%s", wireshark_svnversion);
-            successful = libpcap_write_session_header_block(ld->pdh, appname, &ld->bytes_written, &err) &&
-                libpcap_write_interface_description_block(ld->pdh, capture_opts->iface, capture_opts->cfilter, ld->linktype, ld->file_snaplen, &ld->bytes_written, &err);
-        } else {
-            successful = libpcap_write_file_header(ld->pdh, ld->linktype, ld->file_snaplen,
-                                                   &ld->bytes_written, &err);
-        }
-        if (!successful) {
-            fclose(ld->pdh);
-            ld->pdh = NULL;
+        pcap_opts->pcap_h = open_capture_device(&interface_opts, capture_opts, &open_err_str);
+        if (pcap_opts->pcap_h == NULL) {
+            /* Pipes aren't supported here; they're read by the main thread. */
+            get_capture_device_open_failure_messages(open_err_str,
+                                                     interface_opts.name,
+                                                     errmsg, errmsg_len,
+                                                     secondary_errmsg,
+                                                     secondary_errmsg_len);
+            return FALSE;
         }
-    }
+        if (!set_pcap_linktype(pcap_opts->pcap_h, capture_opts, errmsg, errmsg_len,
+                               secondary_errmsg, secondary_errmsg_len))
+            return FALSE;
+        pcap_opts->linktype = get_pcap_linktype(pcap_opts->pcap_h, interface_opts.name);
+        pcap_opts->snaplen = pcap_snapshot(pcap_opts->pcap_h);
 
-    if (ld->pdh == NULL) {
-        /* We couldn't set up to write to the capture file. */
-        /* XXX - use cf_open_error_message from tshark instead? */
-        switch (err) {
+        switch (capture_loop_init_filter(pcap_opts->pcap_h, FALSE, interface_opts.name,
+                                         interface_opts.cfilter)) {
 
-        default:
-            if (err < 0) {
+        case INITFILTER_NO_ERROR:
+            break;
+
+        case INITFILTER_BAD_FILTER:
+            g_snprintf(errmsg, (gulong) errmsg_len,
+                       "Invalid capture filter \"%s\" for interface %s: %s",
+                       interface_opts.cfilter, interface_opts.name,
+                       pcap_geterr(pcap_opts->pcap_h));
+            return FALSE;
+
+        case INITFILTER_OTHER_ERROR:
+            g_snprintf(errmsg, (gulong) errmsg_len, "Can't install filter on %s (%s).",
+                       interface_opts.name, pcap_geterr(pcap_opts->pcap_h));
+            g_snprintf(secondary_errmsg, (gulong) secondary_errmsg_len, "%s", please_report);
+            return FALSE;
+        }
+
+#ifdef HAVE_PCAP_GET_SELECTABLE_FD
+        pcap_opts->pcap_fd = pcap_get_selectable_fd(pcap_opts->pcap_h);
+#else
+        pcap_opts->pcap_fd = pcap_fileno(pcap_opts->pcap_h);
+#endif
+
+        pcap_opts->queue = capture_ring_new(CAPTURE_THREAD_QUEUE_SIZE, &err);
+        if (pcap_opts->queue == NULL) {
+            g_snprintf(errmsg, (gulong) errmsg_len,
+                       "Couldn't set up a packet queue for %s: %s.",
+                       interface_opts.name, g_strerror(err));
+            return FALSE;
+        }
+    }
+
+    /* The first interface stands for the capture as a whole. */
+    ld->linktype = ld->pcaps[0].linktype;
+
+    /* Our parent expects packets of one link-layer type in the shared ring. */
+    if (ld->ring != NULL) {
+        capture_ring_close(ld->ring);
+        ld->ring = NULL;
+    }
+    return TRUE;
+}
+
+/* called by pcap_dispatch() in a capture thread */
+static void
+capture_thread_packet_cb(u_char *user, const struct pcap_pkthdr *phdr,
+                         const u_char *pd)
+{
+    pcap_options *pcap_opts = (pcap_options *) (void *) user;
+    capture_ring_rec_t rec;
+
+    rec.caplen = phdr->caplen;
+    rec.len = phdr->len;
+    rec.ts_sec = (guint32)phdr->ts.tv_sec;
+    rec.ts_usec = (guint32)phdr->ts.tv_usec;
+    rec.file_offset = 0;
+    if (!capture_ring_put(pcap_opts->queue, &rec, pd)) {
+        /* The writer has fallen behind; treat it like a kernel drop. */
+        g_atomic_int_inc(&pcap_opts->queue_drops);
+    }
+}
+
+/* fetch an interface's statistics for the writer; called in its capture thread */
+static void
+capture_thread_update_stats(pcap_options *pcap_opts)
+{
+    struct pcap_stat stats;
+
+    if (pcap_stats(pcap_opts->pcap_h, &stats) >= 0) {
+        g_mutex_lock(pcap_opts->stats_mtx);
+        pcap_opts->stats = stats;
+        g_mutex_unlock(pcap_opts->stats_mtx);
+    }
+}
+
+/* a capture thread: read packets from one interface and queue them */
+static void *
+capture_thread(void *arg)
+{
+    pcap_options *pcap_opts = (pcap_options *)arg;
+    GTimeVal upd_time, cur_time;
+    int inpkts;
+#ifdef MUST_DO_SELECT
+    fd_set rfds;
+    struct timeval timeout;
+    int sel_ret;
+#endif
+
+    g_get_current_time(&upd_time);
+    while (global_ld.go) {
+#ifdef MUST_DO_SELECT
+        if (pcap_opts->pcap_fd != -1) {
+            FD_ZERO(&rfds);
+            FD_SET(pcap_opts->pcap_fd, &rfds);
+            timeout.tv_sec = 0;
+            timeout.tv_usec = CAP_READ_TIMEOUT * 1000;
+            sel_ret = select(pcap_opts->pcap_fd + 1, &rfds, NULL, NULL, &timeout);
+            if (sel_ret < 0 && errno != EINTR) {
+                g_snprintf(pcap_opts->errmsg, sizeof(pcap_opts->errmsg),
+                           "Unexpected error from select: %s", g_strerror(errno));
+                pcap_opts->pcap_err = TRUE;
+                break;
+            }
+        } else
+            sel_ret = 1;
+        if (sel_ret > 0)
+#endif
+        {
+            inpkts = pcap_dispatch(pcap_opts->pcap_h, -1, capture_thread_packet_cb,
+                                   (u_char *) pcap_opts);
+            if (inpkts < 0) {
+                if (inpkts == -1) {
+                    /* Error, rather than pcap_breakloop(). */
+                    g_strlcpy(pcap_opts->errmsg, pcap_geterr(pcap_opts->pcap_h),
+                              sizeof(pcap_opts->errmsg));
+                    pcap_opts->pcap_err = TRUE;
+                }
+                break;
+            }
+        }
+
+        g_get_current_time(&cur_time);
+        if ((cur_time.tv_sec - upd_time.tv_sec) * 1000 +
+            (cur_time.tv_usec - upd_time.tv_usec) / 1000 > CAPTURE_THREAD_STATS_INTERVAL) {
+            capture_thread_update_stats(pcap_opts);
+            upd_time = cur_time;
+        }
+    }
+
+    /* Publish the error message, if any, along with the flag. */
+    g_atomic_int_set(&pcap_opts->done, TRUE);
+    return NULL;
+}
+
+/* start a capture thread per interface */
+static gboolean
+capture_loop_start_threads(loop_data *ld, char *errmsg, size_t errmsg_len)
+{
+    GError *error = NULL;
+    guint i;
+
+    for (i = 0; i < ld->n_pcaps; i++) {
+        ld->pcaps[i].tid = g_thread_create(capture_thread, &ld->pcaps[i], TRUE, &error);
+        if (ld->pcaps[i].tid == NULL) {
+            g_snprintf(errmsg, (gulong) errmsg_len,
+                       "Couldn't start the capture thread for %s: %s.",
+                       ld->pcaps[i].name, error->message);
+            g_error_free(error);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* stop the capture threads and wait for them */
+static void
+capture_loop_stop_threads(loop_data *ld)
+{
+    guint i;
+
+    ld->go = FALSE;
+    for (i = 0; i < ld->n_pcaps; i++) {
+        if (ld->pcaps[i].tid != NULL) {
+            g_thread_join(ld->pcaps[i].tid);
+            ld->pcaps[i].tid = NULL;
+            /* We have the handle to ourselves again. */
+            capture_thread_update_stats(&ld->pcaps[i]);
+        }
+    }
+}
+
+/* an interface's statistics, including the packets its queue dropped */
+static void
+capture_thread_get_stats(pcap_options *pcap_opts, struct pcap_stat *stats)
+{
+    g_mutex_lock(pcap_opts->stats_mtx);
+    *stats = pcap_opts->stats;
+    g_mutex_unlock(pcap_opts->stats_mtx);
+    stats->ps_drop += (u_int)g_atomic_int_get(&pcap_opts->queue_drops);
+}
+
+/* close the interfaces and free what capture_loop_open_thread_inputs() set up */
+static void
+capture_loop_close_thread_inputs(loop_data *ld)
+{
+    guint i;
+
+    capture_loop_stop_threads(ld);
+    for (i = 0; i < ld->n_pcaps; i++) {
+        if (ld->pcaps[i].pcap_h != NULL)
+            pcap_close(ld->pcaps[i].pcap_h);
+        if (ld->pcaps[i].queue != NULL)
+            capture_ring_destroy(ld->pcaps[i].queue);
+        g_mutex_free(ld->pcaps[i].stats_mtx);
+    }
+    g_free(ld->pcaps);
+    ld->pcaps = NULL;
+    ld->n_pcaps = 0;
+}
+
+/*
+ * Write out queued packets, oldest first.  Each queue is in time stamp
+ * order, so the oldest packet at the head of a queue can be written as
+ * soon as every other interface has a packet queued; if one hasn't, we
+ * give it CAPTURE_THREAD_REORDER_WINDOW to come up with an older one.
+ */
+static int
+capture_loop_dispatch_threads(loop_data *ld, char *errmsg, int errmsg_len)
+{
+    pcap_options *oldest;
+    capture_ring_rec_t rec, oldest_rec;
+    const guint8 *pd, *oldest_pd = NULL;
+    struct pcap_pkthdr phdr;
+    gint packet_count_before = ld->packet_count;
+    gboolean waiting, running;
+    GTimeVal now;
+    gint64 now_usec, oldest_usec = 0, rec_usec;
+    int written;
+    guint i;
+
+    g_get_current_time(&now);
+    now_usec = (gint64)now.tv_sec * 1000000 + now.tv_usec;
+
+    for (written = 0; ld->go && written < CAPTURE_THREAD_BATCH; written++) {
+        oldest = NULL;
+        waiting = FALSE;
+        for (i = 0; i < ld->n_pcaps; i++) {
+            pd = capture_ring_peek(ld->pcaps[i].queue, &rec);
+            if (pd == NULL) {
+                if (!g_atomic_int_get(&ld->pcaps[i].done))
+                    waiting = TRUE;
+                continue;
+            }
+            rec_usec = (gint64)rec.ts_sec * 1000000 + rec.ts_usec;
+            if (oldest == NULL || rec_usec < oldest_usec) {
+                oldest = &ld->pcaps[i];
+                oldest_rec = rec;
+                oldest_pd = pd;
+                oldest_usec = rec_usec;
+            }
+        }
+        if (oldest == NULL)
+            break;
+        if (waiting && oldest_usec + CAPTURE_THREAD_REORDER_WINDOW * 1000 > now_usec)
+            break;
+
+        phdr.ts.tv_sec = oldest_rec.ts_sec;
+        phdr.ts.tv_usec = oldest_rec.ts_usec;
+        phdr.caplen = oldest_rec.caplen;
+        phdr.len = oldest_rec.len;
+        capture_loop_write_packet(ld, &phdr, oldest->interface_id, oldest_pd);
+        capture_ring_release(oldest->queue);
+    }
+
+    running = FALSE;
+    for (i = 0; i < ld->n_pcaps; i++) {
+        if (!g_atomic_int_get(&ld->pcaps[i].done)) {
+            running = TRUE;
+        } else if (ld->pcaps[i].pcap_err) {
+            /* a capture thread failed; stop the capture */
+            g_snprintf(errmsg, errmsg_len, "Error while capturing packets on %s: %s",
+                       ld->pcaps[i].name, ld->pcaps[i].errmsg);
+            report_capture_error(errmsg, "");
+            ld->pcaps[i].pcap_err = FALSE;
+            ld->go = FALSE;
+        }
+    }
+    if (written == 0) {
+        if (!running)
+            ld->go = FALSE;     /* every thread has stopped and we've written it all */
+        else if (ld->go)
+            g_usleep(CAPTURE_THREAD_IDLE_SLEEP);
+    }
+
+    return ld->packet_count - packet_count_before;
+}
+#endif /* USE_CAPTURE_THREADS */
+
+#ifdef HAVE_TPACKET_V3
+/*
+ * Switch an Ethernet capture over to a TPACKET_V3 ring, once libpcap has
+ * opened the device and accepted the filter.  The filter is compiled by
+ * libpcap on the live handle (so that it's compiled for the right link
+ * type, with the kernel's VLAN extensions if any) and attached to the
+ * ring's socket; the live handle is then replaced by a dead one, which is
+ * only used for its snapshot length and link type.
+ *
+ * If anything goes wrong, we just keep capturing with libpcap.
+ */
+static void
+capture_loop_start_tpacket(capture_options *capture_opts, loop_data *ld)
+{
+    interface_options interface_opts;
+    struct bpf_program fcode;
+    tpacket_ring_t *tpacket;
+    pcap_t *dead_h;
+    guint ring_size;
+    int snaplen;
+    char errmsg[MSG_MAX_LENGTH+1];
+
+    if (tpacket_block_size == 0 || ld->from_cap_pipe || ld->pcap_h == NULL ||
+        ld->linktype != DLT_EN10MB)
+        return;
+
+    interface_opts = g_array_index(capture_opts->ifaces, interface_options, 0);
+    if (strncmp(interface_opts.name, "rpcap://", 8) == 0)
+        return;
+
+    snaplen = pcap_snapshot(ld->pcap_h);
+#ifdef HAVE_PCAP_CREATE
+    if (interface_opts.buffer_size > 1)
+        ring_size = interface_opts.buffer_size * 1024 * 1024;
+    else
+#endif
+        ring_size = TPACKET_DEFAULT_RING_SIZE;
+
+    tpacket = tpacket_ring_open(interface_opts.name, snaplen,
+                                interface_opts.promisc_mode,
+                                tpacket_block_size, ring_size,
+                                tpacket_block_timeout,
+                                errmsg, sizeof(errmsg));
+    if (tpacket == NULL) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+              "Packet ring: %s Using libpcap.", errmsg);
+        return;
+    }
+
+    if (capture_opts->cfilter != NULL) {
+        if (!compile_capture_filter(interface_opts.name, ld->pcap_h, &fcode,
+                                    capture_opts->cfilter)) {
+            tpacket_ring_close(tpacket);
+            return;
+        }
+        if (!tpacket_ring_set_filter(tpacket, &fcode, errmsg, sizeof(errmsg))) {
+#ifdef HAVE_PCAP_FREECODE
+            pcap_freecode(&fcode);
+#endif
+            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+                  "Packet ring: %s Using libpcap.", errmsg);
+            tpacket_ring_close(tpacket);
+            return;
+        }
+#ifdef HAVE_PCAP_FREECODE
+        pcap_freecode(&fcode);
+#endif
+    }
+
+    dead_h = pcap_open_dead(ld->linktype, snaplen);
+    if (dead_h == NULL || !tpacket_ring_start(tpacket, errmsg, sizeof(errmsg))) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+              "Packet ring: %s Using libpcap.",
+              dead_h == NULL ? "can't create a placeholder handle." : errmsg);
+        if (dead_h != NULL)
+            pcap_close(dead_h);
+        tpacket_ring_close(tpacket);
+        return;
+    }
+
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+          "Packet ring: capturing with %u KB blocks", tpacket_ring_block_size(tpacket) / 1024);
+    pcap_close(ld->pcap_h);
+    ld->pcap_h = dead_h;
+#ifdef MUST_DO_SELECT
+    ld->pcap_fd = -1;
+#endif
+    ld->tpacket = tpacket;
+}
+#endif /* HAVE_TPACKET_V3 */
+
+/* get the capture statistics of the input */
+static gboolean
+capture_loop_get_stats(loop_data *ld, struct pcap_stat *stats)
+{
+#ifdef HAVE_TPACKET_V3
+    if (ld->tpacket != NULL)
+        return tpacket_ring_stats(ld->tpacket, stats);
+#endif
+    return pcap_stats(ld->pcap_h, stats) >= 0;
+}
+
+/*
+ * Packets from a packet ring come a block at a time, so write them out
+ * a block at a time as well.
+ */
+static void
+capture_loop_set_output_buffer(loop_data *ld _U_)
+{
+#ifdef HAVE_TPACKET_V3
+    /* (asynchronous output does its own buffering) */
+    if (ld->tpacket != NULL && ld->pdh != NULL && !async_output)
+        setvbuf(ld->pdh, NULL, _IOFBF, tpacket_ring_block_size(ld->tpacket));
+#endif
+}
+
+/*
+ * Write out what's been captured so far.  If our parent is going to read
+ * it, wait until it's all in the file; otherwise, the writer thread can
+ * take its time.
+ */
+static void
+capture_loop_flush_output(loop_data *ld)
+{
+    if (ld->pdh == NULL)
+        return;
+    if (capture_child)
+        libpcap_dump_sync(ld->pdh, NULL);
+    else
+        libpcap_dump_flush(ld->pdh, NULL);
+}
+
+/* write the file header, or the section header and interface description blocks */
+static gboolean
+capture_loop_write_file_header(capture_options *capture_opts, loop_data *ld, int *err)
+{
+    if (capture_opts->use_pcapng) {
+        char appname[100];
+        gchar *comment = NULL;
+        gboolean successful;
+
+        g_snprintf(appname, sizeof(appname), "Dumpcap " VERSION "%s", wireshark_svnversion);
+        if (!libpcap_write_session_header_block(ld->pdh, appname, &ld->bytes_written, err))
+            return FALSE;
+        /* pcapng has no option for sampling, so say how it was done in
+           each interface's comment */
+        if (ld->sampler != NULL)
+            comment = sampler_describe(ld->sampler);
+#ifdef USE_CAPTURE_THREADS
+        if (ld->pcaps != NULL) {
+            guint i;
+
+            successful = TRUE;
+            for (i = 0; successful && i < ld->n_pcaps; i++) {
+                successful = libpcap_write_interface_description_block(ld->pdh, ld->pcaps[i].name, ld->pcaps[i].cfilter,
+                                                                       comment, ld->pcaps[i].linktype, ld->pcaps[i].snaplen,
+                                                                       &ld->bytes_written, err);
+            }
+            g_free(comment);
+            return successful;
+        }
+#endif
+        successful = libpcap_write_interface_description_block(ld->pdh, capture_opts->iface, capture_opts->cfilter, comment, ld->linktype, ld->file_snaplen, &ld->bytes_written, err);
+        g_free(comment);
+        return successful;
+    } else {
+        return libpcap_write_file_header(ld->pdh, ld->linktype, ld->file_snaplen,
+                                         &ld->bytes_written, err);
+    }
+}
+
+/* set up to write to the already-opened capture output file/files */
+static gboolean
+capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *errmsg, int errmsg_len)
+{
+    int         err;
+
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_init_output");
+
+    /* get snaplen */
+    if (ld->from_cap_pipe) {
+        ld->file_snaplen = ld->cap_pipe_hdr.snaplen;
+    }
+#ifdef USE_CAPTURE_THREADS
+    else if (ld->pcaps != NULL) {
+        /* each interface has its own in the interface description blocks */
+        ld->file_snaplen = ld->pcaps[0].snaplen;
+    }
+#endif
+    else
+    {
+        ld->file_snaplen = pcap_snapshot(ld->pcap_h);
+    }
+
+    /* Set up to write to the capture file. */
+    if (capture_opts->multi_files_on) {
+        ld->pdh = ringbuf_init_libpcap_fdopen(&err);
+    } else {
+        ld->pdh = libpcap_fdopen(ld->save_file_fd, &err);
+    }
+    if (ld->pdh) {
+        gboolean successful;
+
+        capture_loop_set_output_buffer(ld);
+        ld->bytes_written = 0;
+        successful = capture_loop_write_file_header(capture_opts, ld, &err);
+        if (!successful) {
+            fclose(ld->pdh);
+            ld->pdh = NULL;
+        }
+    }
+
+    if (ld->pdh == NULL) {
+        /* We couldn't set up to write to the capture file. */
+        /* XXX - use cf_open_error_message from tshark instead? */
+        switch (err) {
+
+        default:
+            if (err < 0) {
                 g_snprintf(errmsg, errmsg_len,
                            "The file to which the capture would be"
                            " saved (\"%s\") could not be opened: Error %d.",
@@ -2454,6 +3537,19 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
     return TRUE;
 }
 
+/* write the statistics of one interface, with how many of its packets
+   sampling kept, if it's on */
+static void
+capture_loop_write_stats_block(loop_data *ld, guint32 interface_id, pcap_t *pcap_h, int *err_close)
+{
+    guint64 seen = 0, kept = 0;
+
+    if (ld->sampler != NULL)
+        sampler_get_stats(ld->sampler, interface_id, &seen, &kept);
+    libpcap_write_interface_statistics_block(ld->pdh, interface_id, pcap_h, seen, kept,
+                                             &ld->bytes_written, err_close);
+}
+
 static gboolean
 capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err_close)
 {
@@ -2464,7 +3560,15 @@ capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err
         return ringbuf_libpcap_dump_close(&capture_opts->save_file, err_close);
     } else {
         if (capture_opts->use_pcapng) {
-            libpcap_write_interface_statistics_block(ld->pdh, 0, ld->pcap_h, &ld->bytes_written, err_close);
+#ifdef USE_CAPTURE_THREADS
+            if (ld->pcaps != NULL) {
+                guint i;
+
+                for (i = 0; i < ld->n_pcaps; i++)
+                    capture_loop_write_stats_block(ld, i, ld->pcaps[i].pcap_h, err_close);
+            } else
+#endif
+            capture_loop_write_stats_block(ld, 0, ld->pcap_h, err_close);
         }
         return libpcap_dump_close(ld->pdh, err_close);
     }
@@ -2487,18 +3591,34 @@ capture_loop_dispatch(capture_options *capture_opts _U_, loop_data *ld,
 {
     int       inpkts;
     gint      packet_count_before;
+#ifndef CAP_PIPE_BUFFERED
     guchar    pcap_data[WTAP_MAX_PACKET_SIZE];
-#if !defined(USE_THREADS) || defined(MUST_DO_SELECT)
+#endif
+#if !defined(USE_THREADS) || defined(MUST_DO_SELECT) || defined(CAP_PIPE_BUFFERED)
     int       sel_ret;
 #endif
 
+#ifdef USE_CAPTURE_THREADS
+    if (ld->pcaps != NULL)
+        return capture_loop_dispatch_threads(ld, errmsg, errmsg_len);
+#endif
+
     packet_count_before = ld->packet_count;
     if (ld->from_cap_pipe) {
         /* dispatch from capture pipe */
 #ifdef LOG_CAPTURE_VERBOSE
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_dispatch: from capture pipe");
 #endif
-#ifndef USE_THREADS
+#ifdef CAP_PIPE_BUFFERED
+        inpkts = cap_pipe_dispatch_unhandled(ld, errmsg, errmsg_len);
+        if (inpkts != 0) {
+            /* don't wait for the pipe this time round */
+            if (inpkts < 0)
+                ld->go = FALSE;
+            sel_ret = 0;
+        } else
+#endif
+#if !defined(USE_THREADS) || defined(CAP_PIPE_BUFFERED)
         sel_ret = cap_pipe_select(ld->cap_pipe_fd);
         if (sel_ret <= 0) {
             if (sel_ret < 0 && errno != EINTR) {
@@ -2512,14 +3632,33 @@ capture_loop_dispatch(capture_options *capture_opts _U_, loop_data *ld,
              * "select()" says we can read from the pipe without blocking
              */
 #endif /* USE_THREADS */
+#ifdef CAP_PIPE_BUFFERED
+            inpkts = cap_pipe_dispatch_buffered(ld, errmsg, errmsg_len);
+#else
             inpkts = cap_pipe_dispatch(ld, pcap_data, errmsg, errmsg_len);
+#endif
             if (inpkts < 0) {
                 ld->go = FALSE;
             }
-#ifndef USE_THREADS
+#if !defined(USE_THREADS) || defined(CAP_PIPE_BUFFERED)
         }
 #endif
     }
+#ifdef HAVE_TPACKET_V3
+    else if (ld->tpacket != NULL) {
+        /* dispatch from the packet ring */
+#ifdef LOG_CAPTURE_VERBOSE
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_dispatch: from packet ring");
+#endif
+        inpkts = tpacket_ring_dispatch(ld->tpacket, CAP_READ_TIMEOUT,
+                                       capture_loop_packet_cb, (u_char *)ld,
+                                       errmsg, errmsg_len);
+        if (inpkts < 0) {
+            report_capture_error(errmsg, "");
+            ld->go = FALSE;
+        }
+    }
+#endif
     else
     {
         /* dispatch from pcap */
@@ -2707,7 +3846,8 @@ capture_loop_open_output(capture_options *capture_opts, int *save_file_fd,
                 /* ringbuffer is enabled */
                 *save_file_fd = ringbuf_init(capfile_name,
                                              (capture_opts->has_ring_num_files) ? capture_opts->ring_num_files : 0,
-                                             capture_opts->group_read_access);
+                                             capture_opts->group_read_access,
+                                             (capture_opts->has_autostop_filesize) ? (gint64)capture_opts->autostop_filesize * 1024 : 0);
 
                 /* we need the ringbuf name */
                 if(*save_file_fd != -1) {
@@ -2775,7 +3915,8 @@ static gboolean
 do_file_switch_or_stop(capture_options *capture_opts,
                        condition *cnd_autostop_files,
                        condition *cnd_autostop_size,
-                       condition *cnd_file_duration)
+                       condition *cnd_file_duration,
+                       condition *cnd_file_interval)
 {
     if (capture_opts->multi_files_on) {
         if (cnd_autostop_files != NULL &&
@@ -2785,23 +3926,20 @@ do_file_switch_or_stop(capture_options *capture_opts,
             return FALSE;
         }
 
+        /* The old file is closed in the background; make sure our parent
+           can read all of it before it's told about the new one. */
+        if (capture_child)
+            libpcap_dump_sync(global_ld.pdh, NULL);
+
         /* Switch to the next ringbuffer file */
         if (ringbuf_switch_file(&global_ld.pdh, &capture_opts->save_file,
                                 &global_ld.save_file_fd, &global_ld.err)) {
             gboolean successful;
 
             /* File switch succeeded: reset the conditions */
+            capture_loop_set_output_buffer(&global_ld);
             global_ld.bytes_written = 0;
-            if (capture_opts->use_pcapng) {
-                char appname[100];
-
-                g_snprintf(appname, sizeof(appname), "Dumpcap " VERSION "%s", wireshark_svnversion);
-                successful = libpcap_write_session_header_block(global_ld.pdh, appname, &global_ld.bytes_written, &global_ld.err) &&
-                    libpcap_write_interface_description_block(global_ld.pdh, capture_opts->iface, capture_opts->cfilter, global_ld.linktype, global_ld.file_snaplen, &global_ld.bytes_written, &global_ld.err);
-            } else {
-                successful = libpcap_write_file_header(global_ld.pdh, global_ld.linktype, global_ld.file_snaplen,
-                                                       &global_ld.bytes_written, &global_ld.err);
-            }
+            successful = capture_loop_write_file_header(capture_opts, &global_ld, &global_ld.err);
             if (!successful) {
                 fclose(global_ld.pdh);
                 global_ld.pdh = NULL;
@@ -2812,7 +3950,9 @@ do_file_switch_or_stop(capture_options *capture_opts,
                 cnd_reset(cnd_autostop_size);
             if(cnd_file_duration)
                 cnd_reset(cnd_file_duration);
-            libpcap_dump_flush(global_ld.pdh, NULL);
+            if(cnd_file_interval)
+                cnd_reset(cnd_file_interval);
+            capture_loop_flush_output(&global_ld);
             if (!quiet)
                 report_packet_count(global_ld.inpkts_to_sync_pipe);
             global_ld.inpkts_to_sync_pipe = 0;
@@ -2830,6 +3970,70 @@ do_file_switch_or_stop(capture_options *capture_opts,
     return TRUE;
 }
 
+#ifdef HAVE_CAPTURE_RING
+/* how long to wait for our parent to settle whether the ring is live, in ms */
+#define CAPTURE_RING_LIVE_TIMEOUT   5000
+
+/* Our parent would rather take every packet from the ring than have us
+   write a capture file.  Unless a file was asked for in its own right,
+   tell our parent (with an empty file name) that the ring's link-layer
+   type is known, and wait for it to settle whether it can do without the
+   file.  Returns TRUE if we're to write no file. */
+static gboolean
+capture_loop_ask_ring_only(capture_options *capture_opts, loop_data *ld)
+{
+    int waited;
+
+    if (capture_opts->save_file != NULL || capture_opts->multi_files_on ||
+        capture_opts->has_autostop_filesize) {
+        capture_ring_set_live(ld->ring, FALSE);
+        return FALSE;
+    }
+
+    report_new_capture_file("");
+    for (waited = 0; capture_ring_wants_live(ld->ring); waited++) {
+        if (waited == CAPTURE_RING_LIVE_TIMEOUT || !ld->go) {
+            capture_ring_set_live(ld->ring, FALSE);
+            break;
+        }
+        g_usleep(1000);
+    }
+    if (!capture_ring_is_live(ld->ring))
+        return FALSE;
+
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+          "Packet ring: live, not writing a capture file");
+    return TRUE;
+}
+
+/* Put a packet into a live ring.  There's no file to fall back on, so if
+   the ring is full, wait for our parent to make room.  Returns FALSE if
+   our parent has closed the ring or gone away, or we're stopping. */
+static gboolean
+capture_loop_put_ring_only(loop_data *ld, const struct pcap_pkthdr *phdr,
+                           const u_char *pd)
+{
+    capture_ring_rec_t rec;
+
+    rec.caplen = phdr->caplen;
+    rec.len = phdr->len;
+    rec.ts_sec = (guint32)phdr->ts.tv_sec;
+    rec.ts_usec = (guint32)phdr->ts.tv_usec;
+    rec.file_offset = 0;
+    while (!capture_ring_put(ld->ring, &rec, pd)) {
+        if (!ld->go)
+            return FALSE;
+        if (!capture_ring_is_live(ld->ring) || getppid() != capture_ring_parent) {
+            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_WARNING,
+                  "Packet ring: our parent has stopped taking packets");
+            return FALSE;
+        }
+        g_usleep(100);
+    }
+    return TRUE;
+}
+#endif
+
 /* Do the low-level work of a capture.
    Returns TRUE if it succeeds, FALSE otherwise. */
 static gboolean
@@ -2843,6 +4047,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     int         err_close;
     int         inpkts;
     condition  *cnd_file_duration = NULL;
+    condition  *cnd_file_interval = NULL;
     condition  *cnd_autostop_files = NULL;
     condition  *cnd_autostop_size = NULL;
     condition  *cnd_autostop_duration = NULL;
@@ -2872,6 +4077,9 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     global_ld.pdh                 = NULL;
 #ifndef _WIN32
     global_ld.cap_pipe_fd         = -1;
+    global_ld.cap_pipe_rbuf       = NULL;
+    global_ld.cap_pipe_rbuf_need  = 0;
+    global_ld.cap_pipe_ng_ifs     = NULL;
 #else
     global_ld.cap_pipe_h          = INVALID_HANDLE_VALUE;
 #endif
@@ -2880,6 +4088,27 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
 #endif
     global_ld.autostop_files      = 0;
     global_ld.save_file_fd        = -1;
+    sync_pipe_batch_init(&sync_batch, 2);
+#ifdef HAVE_CAPTURE_RING
+    global_ld.ring                = capture_ring;
+#endif
+    global_ld.ring_only           = FALSE;
+#ifdef HAVE_TPACKET_V3
+    global_ld.tpacket             = NULL;
+#endif
+#ifdef USE_CAPTURE_THREADS
+    global_ld.pcaps               = NULL;
+    global_ld.n_pcaps             = 0;
+#endif
+    global_ld.flow_trunc          = NULL;
+    if (flow_trunc_bytes != 0 || flow_trunc_packets != 0)
+        global_ld.flow_trunc      = flow_trunc_new(flow_trunc_bytes != 0 ? flow_trunc_bytes : G_MAXUINT32,
+                                                   flow_trunc_packets, flow_trunc_idle,
+                                                   FLOW_TRUNC_DEFAULT_FLOWS);
+    global_ld.sampler             = NULL;
+    if (sample_mode != SAMPLE_NONE || sample_limit_rate != 0)
+        global_ld.sampler         = sampler_new(sample_mode, sample_rate,
+                                                sample_limit_rate, sample_limit_burst);
 
     /* We haven't yet gotten the capture statistics. */
     *stats_known      = FALSE;
@@ -2888,11 +4117,27 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     capture_opts_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, capture_opts);
 
     /* open the "input file" from network interface or capture pipe */
+#ifdef USE_CAPTURE_THREADS
+    if (use_threads) {
+        if (!capture_loop_open_thread_inputs(capture_opts, &global_ld, errmsg, sizeof(errmsg),
+                                             secondary_errmsg, sizeof(secondary_errmsg))) {
+            goto error;
+        }
+    } else
+#endif
     if (!capture_loop_open_input(capture_opts, &global_ld, errmsg, sizeof(errmsg),
                                  secondary_errmsg, sizeof(secondary_errmsg))) {
         goto error;
     }
 
+#ifdef HAVE_CAPTURE_RING
+    if (global_ld.ring != NULL) {
+        capture_ring_set_linktype(global_ld.ring, global_ld.linktype);
+        if (capture_ring_wants_live(global_ld.ring))
+            global_ld.ring_only = capture_loop_ask_ring_only(capture_opts, &global_ld);
+    }
+#endif
+
     /* init the input filter from the network interface (capture pipe will do nothing) */
     switch (capture_loop_init_filter(global_ld.pcap_h, global_ld.from_cap_pipe,
                                      capture_opts->iface,
@@ -2913,14 +4158,33 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
         goto error;
     }
 
+#ifdef HAVE_TPACKET_V3
+    /* read Ethernet captures from a packet ring, if we can */
+    capture_loop_start_tpacket(capture_opts, &global_ld);
+#endif
+
+#ifdef USE_CAPTURE_THREADS
+    /* start capturing; the packets wait in the queues until we write them */
+    if (global_ld.pcaps != NULL &&
+        !capture_loop_start_threads(&global_ld, errmsg, sizeof(errmsg))) {
+        goto error;
+    }
+#endif
+
     /* If we're supposed to write to a capture file, open it for output
        (temporary/specified name/ringbuffer) */
-    if (capture_opts->saving_to_file) {
+    if (capture_opts->saving_to_file && !global_ld.ring_only) {
         if (!capture_loop_open_output(capture_opts, &global_ld.save_file_fd,
                                       errmsg, sizeof(errmsg))) {
             goto error;
         }
 
+        /* Write capture files from a thread of their own, so that the
+           capture doesn't stall while the disk does.  Pipes are flushed
+           after every batch of packets anyway, so don't bother there. */
+        if (!capture_opts->output_to_pipe)
+            async_output = libpcap_set_async_output(DUMPCAP_WRITER_BUFFER_SIZE);
+
         /* set up to write to the already-opened capture output file/files */
         if (!capture_loop_init_output(capture_opts, &global_ld, errmsg,
                                       sizeof(errmsg))) {
@@ -2940,7 +4204,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
            message to our parent so that they'll open the capture file and
            update its windows to indicate that we have a live capture in
            progress. */
-        libpcap_dump_flush(global_ld.pdh, NULL);
+        capture_loop_flush_output(&global_ld);
         report_new_capture_file(capture_opts->save_file);
     }
 
@@ -2959,6 +4223,10 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             cnd_file_duration =
                 cnd_new(CND_CLASS_TIMEOUT, capture_opts->file_duration);
 
+        if (capture_opts->has_file_interval)
+            cnd_file_interval =
+                cnd_new(CND_CLASS_INTERVAL, capture_opts->file_interval);
+
         if (capture_opts->has_autostop_files)
             cnd_autostop_files =
                 cnd_new(CND_CLASS_CAPTURESIZE, capture_opts->autostop_files);
@@ -3004,7 +4272,8 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
                 cnd_eval(cnd_autostop_size, (guint32)global_ld.bytes_written)) {
                 /* Capture size limit reached, do we have another file? */
                 if (!do_file_switch_or_stop(capture_opts, cnd_autostop_files,
-                                            cnd_autostop_size, cnd_file_duration))
+                                            cnd_autostop_size, cnd_file_duration,
+                                            cnd_file_interval))
                     continue;
             } /* cnd_autostop_size */
             if (capture_opts->output_to_pipe) {
@@ -3012,6 +4281,15 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             }
         } /* inpkts */
 
+        /* check the wall clock interval condition here, rather than on the
+           update timer, so files start on the second */
+        if (cnd_file_interval != NULL && cnd_eval(cnd_file_interval)) {
+            if (!do_file_switch_or_stop(capture_opts, cnd_autostop_files,
+                                        cnd_autostop_size, cnd_file_duration,
+                                        cnd_file_interval))
+                continue;
+        } /* cnd_file_interval */
+
         /* Only update once every 500ms so as not to overload slow displays.
          * This also prevents too much context-switching between the dumpcap
          * and wireshark processes.
@@ -3037,7 +4315,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             /* Let the parent process know. */
             if (global_ld.inpkts_to_sync_pipe) {
                 /* do sync here */
-                libpcap_dump_flush(global_ld.pdh, NULL);
+                capture_loop_flush_output(&global_ld);
 
                 /* Send our parent a message saying we've written out
                    "global_ld.inpkts_to_sync_pipe" packets to the capture file. */
@@ -3046,6 +4324,8 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
 
                 global_ld.inpkts_to_sync_pipe = 0;
             }
+            report_interface_stats();
+            report_flush();
 
             /* check capture duration condition */
             if (cnd_autostop_duration != NULL && cnd_eval(cnd_autostop_duration)) {
@@ -3058,7 +4338,8 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             if (cnd_file_duration != NULL && cnd_eval(cnd_file_duration)) {
                 /* duration limit reached, do we have another file? */
                 if (!do_file_switch_or_stop(capture_opts, cnd_autostop_files,
-                                            cnd_autostop_size, cnd_file_duration))
+                                            cnd_autostop_size, cnd_file_duration,
+                                            cnd_file_interval))
                     continue;
             } /* cnd_file_duration */
         }
@@ -3067,9 +4348,17 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Capture loop stopping ...");
 
+#ifdef USE_CAPTURE_THREADS
+    /* stop the capture threads, so that we have their handles to ourselves */
+    if (global_ld.pcaps != NULL)
+        capture_loop_stop_threads(&global_ld);
+#endif
+
     /* delete stop conditions */
     if (cnd_file_duration != NULL)
         cnd_delete(cnd_file_duration);
+    if (cnd_file_interval != NULL)
+        cnd_delete(cnd_file_interval);
     if (cnd_autostop_files != NULL)
         cnd_delete(cnd_autostop_files);
     if (cnd_autostop_size != NULL)
@@ -3122,7 +4411,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
         write_ok = FALSE;
     }
 
-    if (capture_opts->saving_to_file) {
+    if (capture_opts->saving_to_file && !global_ld.ring_only) {
         /* close the output file */
         close_ok = capture_loop_close_output(capture_opts, &global_ld, &err_close);
     } else
@@ -3135,6 +4424,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             report_packet_count(global_ld.inpkts_to_sync_pipe);
         global_ld.inpkts_to_sync_pipe = 0;
     }
+    report_flush();
 
     /* If we've displayed a message about a write error, there's no point
        in displaying another message about an error on close. */
@@ -3154,13 +4444,46 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
      */
 
     report_capture_count(TRUE);
+    if (async_output)
+        report_writer_stalls();
+    if (global_ld.flow_trunc != NULL) {
+        report_flow_truncation();
+        flow_trunc_free(global_ld.flow_trunc);
+        global_ld.flow_trunc = NULL;
+    }
+    if (global_ld.sampler != NULL) {
+        report_sampling();
+        sampler_free(global_ld.sampler);
+        global_ld.sampler = NULL;
+    }
+
+#ifdef USE_CAPTURE_THREADS
+    /* get packet drop statistics from the capture threads */
+    if (global_ld.pcaps != NULL) {
+        struct pcap_stat if_stats;
+        guint i;
+
+        memset(stats, 0, sizeof(*stats));
+        for (i = 0; i < global_ld.n_pcaps; i++) {
+            capture_thread_get_stats(&global_ld.pcaps[i], &if_stats);
+            /* Our parent only takes one drop count (see report_packet_drops()). */
+            if (!capture_child)
+                report_packet_drops(if_stats.ps_recv, if_stats.ps_drop, global_ld.pcaps[i].name);
+            stats->ps_recv += if_stats.ps_recv;
+            stats->ps_drop += if_stats.ps_drop;
+        }
+        *stats_known = TRUE;
+        if (capture_child)
+            report_packet_drops(stats->ps_recv, stats->ps_drop, capture_opts->iface);
+    }
+#endif
 
     /* get packet drop statistics from pcap */
     if(global_ld.pcap_h != NULL) {
         g_assert(!global_ld.from_cap_pipe);
         /* Get the capture statistics, so we know how many packets were
            dropped. */
-        if (pcap_stats(global_ld.pcap_h, stats) >= 0) {
+        if (capture_loop_get_stats(&global_ld, stats)) {
             *stats_known = TRUE;
             /* Let the parent process know. */
             report_packet_drops(stats->ps_recv, stats->ps_drop, capture_opts->iface);
@@ -3207,6 +4530,15 @@ error:
     /* close the input file (pcap or cap_pipe) */
     capture_loop_close_input(&global_ld);
 
+    if (global_ld.flow_trunc != NULL) {
+        flow_trunc_free(global_ld.flow_trunc);
+        global_ld.flow_trunc = NULL;
+    }
+    if (global_ld.sampler != NULL) {
+        sampler_free(global_ld.sampler);
+        global_ld.sampler = NULL;
+    }
+
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Capture loop stopped with error");
 
     return FALSE;
@@ -3218,6 +4550,16 @@ static void capture_loop_stop(void)
 #ifdef HAVE_PCAP_BREAKLOOP
     if(global_ld.pcap_h != NULL)
         pcap_breakloop(global_ld.pcap_h);
+#ifdef USE_CAPTURE_THREADS
+    if (global_ld.pcaps != NULL) {
+        guint i;
+
+        for (i = 0; i < global_ld.n_pcaps; i++) {
+            if (global_ld.pcaps[i].pcap_h != NULL)
+                pcap_breakloop(global_ld.pcaps[i].pcap_h);
+        }
+    }
+#endif
 #endif
     global_ld.go = FALSE;
 }
@@ -3273,8 +4615,17 @@ static void
 capture_loop_packet_cb(u_char *user, const struct pcap_pkthdr *phdr,
                        const u_char *pd)
 {
-    loop_data *ld = (loop_data *) (void *) user;
+    capture_loop_write_packet((loop_data *) (void *) user, phdr, 0, pd);
+}
+
+/* write one packet, from the given interface, to the capture file */
+static void
+capture_loop_write_packet(loop_data *ld, const struct pcap_pkthdr *phdr,
+                          guint32 interface_id, const u_char *pd)
+{
     int err;
+    int linktype = ld->linktype;
+    struct pcap_pkthdr trunc_hdr;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -3282,13 +4633,32 @@ capture_loop_packet_cb(u_char *user, const struct pcap_pkthdr *phdr,
     if (!ld->go)
         return;
 
+#ifdef USE_CAPTURE_THREADS
+    if (ld->pcaps != NULL)
+        linktype = ld->pcaps[interface_id].linktype;
+#endif
+
+    /* leave out the packets sampling or the rate limit don't want */
+    if (ld->sampler != NULL && !sampler_keep(ld->sampler, interface_id, linktype, phdr, pd))
+        return;
+
+    /* keep only the headers, if the flow has had its share */
+    if (ld->flow_trunc != NULL) {
+        trunc_hdr = *phdr;
+        trunc_hdr.caplen = flow_trunc_caplen(ld->flow_trunc, linktype, phdr, pd);
+        phdr = &trunc_hdr;
+    }
+
     if (ld->pdh) {
         gboolean successful;
+#ifdef HAVE_CAPTURE_RING
+        gint64 file_offset = ld->bytes_written;
+#endif
         /* We're supposed to write the packet to a file; do so.
            If this fails, set "ld->go" to FALSE, to stop the capture, and set
            "ld->err" to the error. */
         if (global_capture_opts.use_pcapng) {
-            successful = libpcap_write_enhanced_packet_block(ld->pdh, phdr, 0, pd, &ld->bytes_written, &err);
+            successful = libpcap_write_enhanced_packet_block(ld->pdh, phdr, interface_id, pd, &ld->bytes_written, &err);
         } else {
             successful = libpcap_write_packet(ld->pdh, phdr, pd, &ld->bytes_written, &err);
         }
@@ -3296,6 +4666,22 @@ capture_loop_packet_cb(u_char *user, const struct pcap_pkthdr *phdr,
             ld->go = FALSE;
             ld->err = err;
         } else {
+#ifdef HAVE_CAPTURE_RING
+            /* Hand the packet to our parent through the shared ring as
+               well, so it needn't read it back from the file.  If the
+               ring is full, our parent carries on from the file. */
+            if (ld->ring != NULL) {
+                capture_ring_rec_t rec;
+
+                rec.caplen = phdr->caplen;
+                rec.len = phdr->len;
+                rec.ts_sec = (guint32)phdr->ts.tv_sec;
+                rec.ts_usec = (guint32)phdr->ts.tv_usec;
+                rec.file_offset = file_offset;
+                if (!capture_ring_put(ld->ring, &rec, pd))
+                    ld->ring = NULL;
+            }
+#endif
             ld->packet_count++;
             /* if the user told us to stop after x packets, do we already have enough? */
             if ((ld->packet_max > 0) && (ld->packet_count >= ld->packet_max))
@@ -3303,10 +4689,57 @@ capture_loop_packet_cb(u_char *user, const struct pcap_pkthdr *phdr,
                 ld->go = FALSE;
             }
         }
+#ifdef HAVE_CAPTURE_RING
+    } else if (ld->ring_only) {
+        /* No file; the packet goes only to our parent, through the ring. */
+        if (!capture_loop_put_ring_only(ld, phdr, pd)) {
+            ld->go = FALSE;
+        } else {
+            ld->packet_count++;
+            if ((ld->packet_max > 0) && (ld->packet_count >= ld->packet_max))
+            {
+                ld->go = FALSE;
+            }
+        }
+#endif
     }
 }
 
 
+/* parse a -j argument: "count:NUM", "random:NUM", "flow:NUM" or
+   "limit:PPS[:BURST]" */
+static gboolean
+parse_sampling(gchar *arg)
+{
+    gchar *colonp, *burstp;
+
+    colonp = strchr(arg, ':');
+    if (colonp == NULL)
+        return FALSE;
+    *colonp++ = '\0';
+
+    if (strcmp(arg, "limit") == 0) {
+        burstp = strchr(colonp, ':');
+        if (burstp != NULL) {
+            *burstp++ = '\0';
+            sample_limit_burst = get_positive_int(burstp, "sampling burst");
+        }
+        sample_limit_rate = get_positive_int(colonp, "sampling rate limit");
+        return TRUE;
+    }
+
+    if (strcmp(arg, "count") == 0)
+        sample_mode = SAMPLE_COUNT;
+    else if (strcmp(arg, "random") == 0)
+        sample_mode = SAMPLE_RANDOM;
+    else if (strcmp(arg, "flow") == 0)
+        sample_mode = SAMPLE_FLOW;
+    else
+        return FALSE;
+    sample_rate = get_positive_int(colonp, "sampling rate");
+    return TRUE;
+}
+
 /* And now our feature presentation... [ fade to music ] */
 int
 main(int argc, char *argv[])
@@ -3383,7 +4816,25 @@ main(int argc, char *argv[])
 #define OPTSTRING_d ""
 #endif
 
-#define OPTSTRING "a:" OPTSTRING_A "b:" OPTSTRING_B "c:" OPTSTRING_d "Df:ghi:" OPTSTRING_I "L" OPTSTRING_m "Mnpq" OPTSTRING_r "Ss:" OPTSTRING_u "vw:y:Z:"
+#ifdef HAVE_CAPTURE_RING
+#define OPTSTRING_R "R:"
+#else
+#define OPTSTRING_R ""
+#endif
+
+#ifdef HAVE_TPACKET_V3
+#define OPTSTRING_K "K:"
+#else
+#define OPTSTRING_K ""
+#endif
+
+#ifdef USE_CAPTURE_THREADS
+#define OPTSTRING_t "t"
+#else
+#define OPTSTRING_t ""
+#endif
+
+#define OPTSTRING "a:" OPTSTRING_A "b:" OPTSTRING_B "c:" OPTSTRING_d "Df:ghi:" OPTSTRING_I "j:" OPTSTRING_K "L" OPTSTRING_m "Mnpq" OPTSTRING_r OPTSTRING_R "Ss:" OPTSTRING_t "T:" OPTSTRING_u "vw:y:Z:"
 
 #ifdef DEBUG_CHILD_DUMPCAP
     if ((debug_log = ws_fopen("dumpcap_debug_log.tmp","w")) == NULL) {
@@ -3703,6 +5154,77 @@ main(int argc, char *argv[])
             }
 #endif
             break;
+#ifdef HAVE_CAPTURE_RING
+            /*** hidden option: shared packet ring set up by our parent ***/
+        case 'R':
+        {
+            int ring_err;
+
+            capture_ring = capture_ring_attach(get_natural_int(optarg, "packet ring descriptor"), &ring_err);
+            capture_ring_parent = getppid();
+            if (capture_ring == NULL) {
+                /* Not fatal; our parent reads the packets from the file. */
+                g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_WARNING,
+                      "Packet ring: unable to attach: %s", g_strerror(ring_err));
+            }
+            break;
+        }
+#endif
+
+#ifdef HAVE_TPACKET_V3
+        case 'K':        /* TPACKET_V3 ring block size and timeout */
+        {
+            gchar *colonp;
+
+            colonp = strchr(optarg, ':');
+            if (colonp != NULL) {
+                *colonp = '\0';
+                tpacket_block_timeout = get_natural_int(colonp + 1, "ring block timeout");
+            }
+            tpacket_block_size = get_natural_int(optarg, "ring block size") * 1024;
+            if (tpacket_block_size != 0 &&
+                (tpacket_block_size & (tpacket_block_size - 1)) != 0) {
+                cmdarg_err("The ring block size must be a power of 2 KB.");
+                exit_main(1);
+            }
+            break;
+        }
+#endif
+
+#ifdef USE_CAPTURE_THREADS
+        case 't':        /* Capture from each interface in a thread of its own */
+            use_threads = TRUE;
+            break;
+#endif
+
+        case 'T':        /* Per-flow truncation */
+        {
+            gchar *colonp, *pkts;
+
+            pkts = strchr(optarg, ':');
+            if (pkts != NULL) {
+                *pkts++ = '\0';
+                colonp = strchr(pkts, ':');
+                if (colonp != NULL) {
+                    *colonp = '\0';
+                    flow_trunc_idle = get_positive_int(colonp + 1, "flow idle timeout");
+                }
+                flow_trunc_packets = get_natural_int(pkts, "packets per flow");
+            }
+            flow_trunc_bytes = get_natural_int(optarg, "bytes per flow");
+            if (flow_trunc_bytes == 0 && flow_trunc_packets == 0) {
+                cmdarg_err("A number of bytes or packets per flow must be given.");
+                exit_main(1);
+            }
+            break;
+        }
+
+        case 'j':        /* Sampling and rate limiting */
+            if (!parse_sampling(optarg)) {
+                cmdarg_err("Invalid sampling option: %s", optarg);
+                exit_main(1);
+            }
+            break;
 
         case 'q':        /* Quiet */
             quiet = TRUE;
@@ -3782,7 +5304,8 @@ main(int argc, char *argv[])
                 cmdarg_err("Ring buffer requested, but capture isn't being saved to a permanent file.");
                 global_capture_opts.multi_files_on = FALSE;
             }
-            if (!global_capture_opts.has_autostop_filesize && !global_capture_opts.has_file_duration) {
+            if (!global_capture_opts.has_autostop_filesize && !global_capture_opts.has_file_duration &&
+                !global_capture_opts.has_file_interval) {
                 cmdarg_err("Ring buffer requested, but no maximum capture file size or duration were specified.");
 #if 0
                 /* XXX - this must be redesigned as the conditions changed */
@@ -3910,6 +5433,12 @@ main(int argc, char *argv[])
     /* We're supposed to do a capture.  Process the ring buffer arguments. */
     capture_opts_trim_ring_num_files(&global_capture_opts);
 
+#ifdef USE_CAPTURE_THREADS
+    /* Only pcapng can tell the packets of different interfaces apart. */
+    if (use_threads)
+        global_capture_opts.use_pcapng = TRUE;
+#endif
+
     /* Now start the capture. */
 
     if(capture_loop_start(&global_capture_opts, &stats_known, &stats) == TRUE) {
@@ -4021,7 +5550,8 @@ report_packet_count(int packet_count)
     if(capture_child) {
         g_snprintf(tmp, sizeof(tmp), "%d", packet_count);
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "Packets: %s", tmp);
-        pipe_write_block(2, SP_PACKET_COUNT, tmp);
+        /* sent with the next batch */
+        sync_pipe_batch_add_packets(&sync_batch, packet_count);
     } else {
         count += packet_count;
         fprintf(stderr, "\rPackets: %u ", count);
@@ -4030,12 +5560,62 @@ report_packet_count(int packet_count)
     }
 }
 
+/* tell our parent how the interface(s) are doing; sent with the next batch */
+static void
+report_interface_stats(void)
+{
+    struct pcap_stat stats;
+
+    if (!capture_child)
+        return;
+
+#ifdef USE_CAPTURE_THREADS
+    if (global_ld.pcaps != NULL) {
+        guint i;
+
+        for (i = 0; i < global_ld.n_pcaps; i++) {
+            capture_thread_get_stats(&global_ld.pcaps[i], &stats);
+            report_one_interface_stats(i, &stats);
+        }
+        return;
+    }
+#endif
+    if (global_ld.pcap_h != NULL && capture_loop_get_stats(&global_ld, &stats))
+        report_one_interface_stats(0, &stats);
+}
+
+static void
+report_one_interface_stats(guint iface, const struct pcap_stat *stats)
+{
+    sync_pipe_if_stats_t if_stats;
+    GTimeVal now;
+
+    g_get_current_time(&now);
+    if_stats.iface = iface;
+    if_stats.ts_sec = (guint32)now.tv_sec;
+    if_stats.ts_usec = (guint32)now.tv_usec;
+    if_stats.received = stats->ps_recv;
+    if_stats.dropped = stats->ps_drop;
+    if_stats.if_dropped = stats->ps_ifdrop;
+    sync_pipe_batch_add_if_stats(&sync_batch, &if_stats);
+}
+
+/* send what we've batched up for our parent */
+static void
+report_flush(void)
+{
+    if (capture_child)
+        sync_pipe_batch_flush(&sync_batch);
+}
+
 static void
 report_new_capture_file(const char *filename)
 {
     if(capture_child) {
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "File: %s", filename);
-        pipe_write_block(2, SP_FILE, filename);
+        /* our parent wants to know about this one right away */
+        sync_pipe_batch_add_file(&sync_batch, filename);
+        sync_pipe_batch_flush(&sync_batch);
     } else {
 #ifdef SIGINFO
         /*
@@ -4116,6 +5696,78 @@ report_packet_drops(guint32 received, guint32 drops, gchar *name)
     }
 }
 
+/* tell how often the capture had to wait for the capture file to be written */
+static void
+report_writer_stalls(void)
+{
+    guint32 stalls;
+    guint64 stall_usec;
+
+    libpcap_get_async_stalls(&stalls, &stall_usec);
+    if (stalls == 0)
+        return;
+
+    if(capture_child) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+              "Capture held up %u time%s, for %" G_GINT64_MODIFIER "u ms, waiting for the disk",
+              stalls, plurality(stalls, "", "s"), stall_usec / 1000);
+        sync_pipe_batch_add_writer_stalls(&sync_batch, stalls, stall_usec);
+        report_flush();
+    } else {
+        fprintf(stderr, "Capture held up %u time%s, for %" G_GINT64_MODIFIER "u ms, waiting for the disk\n",
+                stalls, plurality(stalls, "", "s"), stall_usec / 1000);
+        /* stderr could be line buffered */
+        fflush(stderr);
+    }
+}
+
+
+/* tell how many packets sampling and the rate limit left out */
+static void
+report_sampling(void)
+{
+    guint64 sampled_out, limited;
+
+    sampler_get_totals(global_ld.sampler, &sampled_out, &limited);
+
+    if(capture_child) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+              "Sampling: %" G_GINT64_MODIFIER "u packet%s not sampled, %" G_GINT64_MODIFIER "u over the rate limit",
+              sampled_out, plurality(sampled_out, "", "s"), limited);
+        /* separate from the drops, which report_packet_drops() sends */
+        sync_pipe_batch_add_sampling(&sync_batch, sampled_out, limited);
+        report_flush();
+    } else if (!quiet) {
+        fprintf(stderr, "Sampling: %" G_GINT64_MODIFIER "u packet%s not sampled, %" G_GINT64_MODIFIER "u over the rate limit\n",
+                sampled_out, plurality(sampled_out, "", "s"), limited);
+        /* stderr could be line buffered */
+        fflush(stderr);
+    }
+}
+
+
+/* tell how much per-flow truncation has saved */
+static void
+report_flow_truncation(void)
+{
+    guint64 truncated, bytes_cut;
+
+    flow_trunc_get_stats(global_ld.flow_trunc, &truncated, &bytes_cut);
+
+    if(capture_child) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+              "Flow truncation: %" G_GINT64_MODIFIER "u packet%s cut short, %" G_GINT64_MODIFIER "u bytes not saved",
+              truncated, plurality(truncated, "", "s"), bytes_cut);
+        sync_pipe_batch_add_flow_trunc(&sync_batch, truncated, bytes_cut);
+        report_flush();
+    } else if (!quiet) {
+        fprintf(stderr, "Flow truncation: %" G_GINT64_MODIFIER "u packet%s cut short, %" G_GINT64_MODIFIER "u bytes not saved\n",
+                truncated, plurality(truncated, "", "s"), bytes_cut);
+        /* stderr could be line buffered */
+        fflush(stderr);
+    }
+}
+
 
 /****************************************************************************************************************/
 /* signal_pipe handling */
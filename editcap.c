@@ -130,6 +130,7 @@ static double err_prob = 0.0;
 static time_t starttime = 0;
 static time_t stoptime = 0;
 static gboolean check_startstop = FALSE;
+static gboolean time_ordered = FALSE;
 static gboolean dup_detect = FALSE;
 static gboolean dup_detect_by_time = FALSE;
 
@@ -677,6 +678,8 @@ usage(gboolean is_error)
   fprintf(output, "                         to) the given time (format as YYYY-MM-DD hh:mm:ss).\n");
   fprintf(output, "  -B <stop time>         only output packets whose timestamp is before the\n");
   fprintf(output, "                         given time (format as YYYY-MM-DD hh:mm:ss).\n");
+  fprintf(output, "  -o                     the input file is in timestamp order; search it\n");
+  fprintf(output, "                         for the -A time and stop reading at the -B time.\n");
   fprintf(output, "\n");
   fprintf(output, "Duplicate packet removal:\n");
   fprintf(output, "  -d                     remove packet if duplicate (window == %d).\n", DEFAULT_DUP_DEPTH);
@@ -861,7 +864,7 @@ main(int argc, char *argv[])
 #endif
 
   /* Process the options */
-  while ((opt = getopt(argc, argv, "A:B:c:C:dD:E:F:hrs:i:t:S:T:vw:")) !=-1) {
+  while ((opt = getopt(argc, argv, "A:B:c:C:dD:E:F:hors:i:t:S:T:vw:")) !=-1) {
 
     switch (opt) {
 
@@ -956,6 +959,10 @@ main(int argc, char *argv[])
       exit(1);
       break;
 
+    case 'o':
+      time_ordered = TRUE;
+      break;
+
     case 'r':
       keep_em = !keep_em;  /* Just invert */
       break;
@@ -1117,6 +1124,58 @@ main(int argc, char *argv[])
       }
     }
 
+    /*
+     * Tell wiretap which packets we're after, so that it can skip the
+     * ones in front of them (using the file's index or, with -o, by
+     * searching a time-ordered file) and stop at the last one.  Don't
+     * do this when splitting, as the split points are relative to the
+     * first packet in the file.
+     */
+    if (split_packet_count == 0 && secs_per_block == 0) {
+      wtap_read_window_t window;
+      guint32 first_frame;
+
+      memset(&window, 0, sizeof window);
+      window.time_ordered = time_ordered;
+      if (check_startstop) {
+        window.has_start_time = (starttime != 0);
+        window.start_time.secs = starttime;
+        window.has_stop_time = TRUE;
+        window.stop_time.secs = stoptime;
+      }
+      if (keep_em && max_selected >= 0) {
+        window.first_frame = G_MAXUINT32;
+        for (i = 0; i <= max_selected; i++) {
+          window.first_frame = MIN(window.first_frame, (guint32)selectfrm[i].first);
+          window.last_frame = MAX(window.last_frame, (guint32)selectfrm[i].first);
+          if (selectfrm[i].inclusive)
+            window.last_frame = MAX(window.last_frame, (guint32)selectfrm[i].second);
+        }
+      }
+      /* A search by time loses track of packet numbers */
+      if (time_ordered && (max_selected >= 0 || verbose))
+        window.has_start_time = FALSE;
+
+      if (!wtap_set_read_window(wth, &window, &first_frame, &err, &err_info)) {
+        fprintf(stderr, "editcap: Can't seek in \"%s\": %s\n",
+                argv[optind], wtap_strerror(err));
+        switch (err) {
+
+        case WTAP_ERR_BAD_RECORD:
+          fprintf(stderr, "(%s)\n", err_info);
+          g_free(err_info);
+          break;
+        }
+        exit(2);
+      }
+      if (first_frame > 1) {
+        if (verbose)
+          fprintf(stderr, "Skipped to packet %u using the file's index.\n",
+                  first_frame);
+        count = first_frame;
+      }
+    }
+
     while (wtap_read(wth, &err, &err_info, &data_offset)) {
       phdr = wtap_phdr(wth);
       buf = wtap_buf_ptr(wth);
@@ -40,6 +40,7 @@ struct _dfilter_t {
 	int		*interesting_fields;
 	int		num_interesting_fields;
 	GPtrArray	*deprecated;
+	gchar		*plan;		/* the filter as it is run */
 };
 
 typedef struct {
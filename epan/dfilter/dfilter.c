@@ -31,6 +31,7 @@
 #include "syntax-tree.h"
 #include "gencode.h"
 #include "semcheck.h"
+#include "optimize.h"
 #include "dfvm.h"
 #include <epan/epan_dissect.h>
 #include "dfilter.h"
@@ -167,6 +168,7 @@ dfilter_free(dfilter_t *df)
 		g_ptr_array_free(df->deprecated, TRUE);
 	}
 
+	g_free(df->plan);
 	g_free(df->registers);
 	g_free(df->attempted_load);
 	g_free(df);
@@ -218,6 +220,7 @@ dfilter_compile(const gchar *text, dfilter_t **dfp)
 	dfwork_t	*dfw;
 	gboolean failure = FALSE;
 	const char	*depr_test;
+	gchar		*plan;
 	guint		i;
 	GPtrArray	*deprecated;
 
@@ -325,6 +328,10 @@ dfilter_compile(const gchar *text, dfilter_t **dfp)
 			goto FAILURE;
 		}
 
+		/* Reorder and simplify the tests */
+		dfw_optimize(dfw);
+		plan = dfw_plan(dfw->st_root);
+
 		/* Create bytecode */
 		dfw_gencode(dfw);
 
@@ -348,6 +355,7 @@ dfilter_compile(const gchar *text, dfilter_t **dfp)
 
 		/* Add any deprecated items */
 		dfilter->deprecated = deprecated;
+		dfilter->plan = plan;
 
 		/* And give it to the user. */
 		*dfp = dfilter;
@@ -409,6 +417,16 @@ dfilter_dump(dfilter_t *df)
 	guint i;
 	const gchar *sep = "";
 
+	if (df->plan) {
+		printf("Filter: %s\n\n", df->plan);
+	}
+
+	if (df->consts && df->consts->len) {
+		printf("Constants:\n");
+		dfvm_dump(stdout, df->consts);
+		printf("\nInstructions:\n");
+	}
+
 	dfvm_dump(stdout, df->insns);
 
 	if (df->deprecated && df->deprecated->len) {
@@ -0,0 +1,460 @@
+/*
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "dfset.h"
+
+/* How the values of a set are compared.  Values of one kind all map to
+ * a key with the same ordering and equality as their ftype's own
+ * comparisons; a set whose values aren't all of one kind, or of a kind
+ * that isn't listed here, is searched value by value. */
+typedef enum {
+	SET_EMPTY,
+	SET_GENERIC,
+	SET_UNSIGNED,	/* 32-bit unsigned integers */
+	SET_SIGNED,	/* 32-bit signed integers */
+	SET_UINT64,
+	SET_INT64,
+	SET_IPV4,	/* host-order address, the netmask applied */
+	SET_BYTES,	/* ordered by length, then by contents */
+	SET_STRING
+} set_kind_t;
+
+typedef struct {
+	guint64		num;
+	const guint8	*data;
+	guint		len;
+} set_key_t;
+
+typedef struct {
+	set_key_t	low;
+	set_key_t	high;
+} set_interval_t;
+
+struct _df_set_t {
+	set_kind_t	kind;
+	GPtrArray	*values;	/* fvalue_t's */
+	GPtrArray	*lows;		/* the ends of the ranges, */
+	GPtrArray	*highs;		/* in the same order */
+
+	/* Lookup tables, built by df_set_finish() */
+	GHashTable	*singles;	/* set_key_t's, pointing into keys */
+	set_key_t	*keys;
+	set_interval_t	*intervals;	/* sorted, not overlapping */
+	guint		num_intervals;
+};
+
+/* Flips the sign bit, so that signed integers sort as unsigned ones */
+#define SIGN_BIT_64	(((guint64)1) << 63)
+
+static set_kind_t
+ftype_kind(ftenum_t ftype)
+{
+	switch (ftype) {
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_FRAMENUM:
+		case FT_IPXNET:
+			return SET_UNSIGNED;
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			return SET_SIGNED;
+		case FT_UINT64:
+		case FT_EUI64:
+			return SET_UINT64;
+		case FT_INT64:
+			return SET_INT64;
+		case FT_IPv4:
+			return SET_IPV4;
+		case FT_ETHER:
+		case FT_IPv6:
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_OID:
+			return SET_BYTES;
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_EBCDIC:
+			return SET_STRING;
+		default:
+			return SET_GENERIC;
+	}
+}
+
+static set_kind_t
+fvalue_kind(fvalue_t *fv)
+{
+	return ftype_kind(fvalue_ftype(fv)->ftype);
+}
+
+/* Make the key of a value; for an IPv4 address, that of the lowest
+ * address its netmask covers. */
+static void
+make_key(set_kind_t kind, fvalue_t *fv, set_key_t *key)
+{
+	key->num = 0;
+	key->data = NULL;
+	key->len = 0;
+
+	switch (kind) {
+		case SET_UNSIGNED:
+			key->num = fvalue_get_uinteger(fv);
+			break;
+		case SET_SIGNED:
+			key->num = (guint64)(gint64)fvalue_get_sinteger(fv) ^ SIGN_BIT_64;
+			break;
+		case SET_UINT64:
+			key->num = fvalue_get_integer64(fv);
+			break;
+		case SET_INT64:
+			key->num = fvalue_get_integer64(fv) ^ SIGN_BIT_64;
+			break;
+		case SET_IPV4:
+			key->num = ipv4_get_host_order_addr(&fv->value.ipv4) &
+				fv->value.ipv4.nmask;
+			break;
+		case SET_BYTES:
+			key->data = fvalue_get(fv);
+			key->len = fvalue_length(fv);
+			break;
+		case SET_STRING:
+			key->data = fvalue_get(fv);
+			break;
+		default:
+			g_assert_not_reached();
+	}
+}
+
+static int
+key_cmp(set_kind_t kind, const set_key_t *a, const set_key_t *b)
+{
+	switch (kind) {
+		case SET_BYTES:
+			if (a->len != b->len)
+				return a->len < b->len ? -1 : 1;
+			return memcmp(a->data, b->data, a->len);
+		case SET_STRING:
+			return strcmp((const char *)a->data, (const char *)b->data);
+		default:
+			if (a->num != b->num)
+				return a->num < b->num ? -1 : 1;
+			return 0;
+	}
+}
+
+static guint
+num_key_hash(gconstpointer k)
+{
+	const set_key_t	*key = k;
+
+	return (guint)(key->num ^ (key->num >> 32));
+}
+
+static gboolean
+num_key_equal(gconstpointer a, gconstpointer b)
+{
+	return ((const set_key_t *)a)->num == ((const set_key_t *)b)->num;
+}
+
+static guint
+bytes_key_hash(gconstpointer k)
+{
+	const set_key_t	*key = k;
+	guint		h = key->len;
+	guint		i;
+
+	for (i = 0; i < key->len; i++)
+		h = (h << 5) - h + key->data[i];
+	return h;
+}
+
+static gboolean
+bytes_key_equal(gconstpointer a, gconstpointer b)
+{
+	const set_key_t	*key_a = a;
+	const set_key_t	*key_b = b;
+
+	return key_a->len == key_b->len &&
+		memcmp(key_a->data, key_b->data, key_a->len) == 0;
+}
+
+static guint
+string_key_hash(gconstpointer k)
+{
+	return g_str_hash(((const set_key_t *)k)->data);
+}
+
+static gboolean
+string_key_equal(gconstpointer a, gconstpointer b)
+{
+	return strcmp((const char *)((const set_key_t *)a)->data,
+		(const char *)((const set_key_t *)b)->data) == 0;
+}
+
+df_set_t*
+df_set_new(void)
+{
+	df_set_t	*set;
+
+	set = g_new0(df_set_t, 1);
+	set->kind = SET_EMPTY;
+	set->values = g_ptr_array_new();
+	set->lows = g_ptr_array_new();
+	set->highs = g_ptr_array_new();
+	return set;
+}
+
+static void
+note_kind(df_set_t *set, fvalue_t *fv)
+{
+	set_kind_t	kind = fvalue_kind(fv);
+
+	if (set->kind == SET_EMPTY)
+		set->kind = kind;
+	else if (set->kind != kind)
+		set->kind = SET_GENERIC;
+}
+
+void
+df_set_add(df_set_t *set, fvalue_t *fv)
+{
+	g_assert(set->singles == NULL);
+	note_kind(set, fv);
+	g_ptr_array_add(set->values, fv);
+}
+
+void
+df_set_add_range(df_set_t *set, fvalue_t *low, fvalue_t *high)
+{
+	g_assert(set->singles == NULL);
+	note_kind(set, low);
+	note_kind(set, high);
+	g_ptr_array_add(set->lows, low);
+	g_ptr_array_add(set->highs, high);
+}
+
+static gint
+interval_cmp(gconstpointer a, gconstpointer b, gpointer kind)
+{
+	return key_cmp(GPOINTER_TO_INT(kind), &((const set_interval_t *)a)->low,
+		&((const set_interval_t *)b)->low);
+}
+
+void
+df_set_finish(df_set_t *set)
+{
+	GHashFunc	hash_func;
+	GEqualFunc	equal_func;
+	fvalue_t	*fv;
+	set_interval_t	*iv;
+	guint32		nmask;
+	guint		i, n;
+
+	switch (set->kind) {
+		case SET_EMPTY:
+		case SET_GENERIC:
+			return;
+		case SET_BYTES:
+			hash_func = bytes_key_hash;
+			equal_func = bytes_key_equal;
+			break;
+		case SET_STRING:
+			hash_func = string_key_hash;
+			equal_func = string_key_equal;
+			break;
+		default:
+			hash_func = num_key_hash;
+			equal_func = num_key_equal;
+			break;
+	}
+
+	set->singles = g_hash_table_new(hash_func, equal_func);
+	set->keys = g_new(set_key_t, set->values->len);
+	set->intervals = g_new(set_interval_t, set->values->len + set->lows->len);
+
+	/* An IPv4 address with a netmask is a range of addresses */
+	n = 0;
+	for (i = 0; i < set->values->len; i++) {
+		fv = g_ptr_array_index(set->values, i);
+		if (set->kind == SET_IPV4 && fv->value.ipv4.nmask != 0xffffffff) {
+			iv = &set->intervals[n++];
+			make_key(set->kind, fv, &iv->low);
+			iv->high = iv->low;
+			iv->high.num |= ~fv->value.ipv4.nmask & 0xffffffff;
+			continue;
+		}
+		make_key(set->kind, fv, &set->keys[i]);
+		g_hash_table_insert(set->singles, &set->keys[i], &set->keys[i]);
+	}
+
+	for (i = 0; i < set->lows->len; i++) {
+		iv = &set->intervals[n];
+		make_key(set->kind, g_ptr_array_index(set->lows, i), &iv->low);
+		fv = g_ptr_array_index(set->highs, i);
+		make_key(set->kind, fv, &iv->high);
+		if (set->kind == SET_IPV4) {
+			nmask = fv->value.ipv4.nmask;
+			iv->high.num |= ~nmask & 0xffffffff;
+		}
+		/* An empty range matches nothing */
+		if (key_cmp(set->kind, &iv->low, &iv->high) <= 0)
+			n++;
+	}
+
+	/* Sort the ranges, and merge those that overlap */
+	g_qsort_with_data(set->intervals, n, sizeof (set_interval_t),
+		interval_cmp, GINT_TO_POINTER(set->kind));
+	set->num_intervals = 0;
+	iv = NULL;
+	for (i = 0; i < n; i++) {
+		if (iv && key_cmp(set->kind, &set->intervals[i].low, &iv->high) <= 0) {
+			if (key_cmp(set->kind, &set->intervals[i].high, &iv->high) > 0)
+				iv->high = set->intervals[i].high;
+		}
+		else {
+			iv = &set->intervals[set->num_intervals++];
+			*iv = set->intervals[i];
+		}
+	}
+}
+
+/* Compare a value against every value and range of the set, as the
+ * relational operators would. */
+static gboolean
+contains_generic(df_set_t *set, fvalue_t *fv)
+{
+	guint		i;
+
+	for (i = 0; i < set->values->len; i++) {
+		if (fvalue_eq(fv, g_ptr_array_index(set->values, i)))
+			return TRUE;
+	}
+	for (i = 0; i < set->lows->len; i++) {
+		if (fvalue_ge(fv, g_ptr_array_index(set->lows, i)) &&
+		    fvalue_le(fv, g_ptr_array_index(set->highs, i)))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+gboolean
+df_set_contains(df_set_t *set, fvalue_t *fv)
+{
+	set_key_t	key;
+	guint		low, high, mid;
+
+	/* A value from a packet that isn't of the kind of the set, or an
+	 * IPv4 address with a netmask, takes the slow way. */
+	if (set->singles == NULL || fvalue_kind(fv) != set->kind ||
+	    (set->kind == SET_IPV4 && fv->value.ipv4.nmask != 0xffffffff))
+		return contains_generic(set, fv);
+
+	make_key(set->kind, fv, &key);
+	if (g_hash_table_lookup(set->singles, &key))
+		return TRUE;
+
+	/* Find the last range that starts at or below the value */
+	low = 0;
+	high = set->num_intervals;
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (key_cmp(set->kind, &set->intervals[mid].low, &key) <= 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return low > 0 &&
+		key_cmp(set->kind, &key, &set->intervals[low - 1].high) <= 0;
+}
+
+static void
+dump_fvalue(FILE *f, fvalue_t *fv)
+{
+	char	*value_str = NULL;
+
+	if (fvalue_ftype(fv)->val_to_string_repr)
+		value_str = fvalue_to_string_repr(fv, FTREPR_DFILTER, NULL);
+	if (value_str) {
+		fputs(value_str, f);
+		g_free(value_str);
+	}
+	else {
+		fprintf(f, "<%s>", fvalue_type_name(fv));
+	}
+}
+
+void
+df_set_dump(FILE *f, df_set_t *set)
+{
+	guint		i;
+
+	fputc('{', f);
+	for (i = 0; i < set->values->len; i++) {
+		if (i > 0)
+			fputc(' ', f);
+		dump_fvalue(f, g_ptr_array_index(set->values, i));
+	}
+	for (i = 0; i < set->lows->len; i++) {
+		if (i > 0 || set->values->len > 0)
+			fputc(' ', f);
+		dump_fvalue(f, g_ptr_array_index(set->lows, i));
+		fputs("..", f);
+		dump_fvalue(f, g_ptr_array_index(set->highs, i));
+	}
+	fputc('}', f);
+}
+
+static void
+free_fvalues(GPtrArray *fvalues)
+{
+	guint		i;
+	fvalue_t	*fv;
+
+	for (i = 0; i < fvalues->len; i++) {
+		fv = g_ptr_array_index(fvalues, i);
+		FVALUE_FREE(fv);
+	}
+	g_ptr_array_free(fvalues, TRUE);
+}
+
+void
+df_set_free(df_set_t *set)
+{
+	free_fvalues(set->values);
+	free_fvalues(set->lows);
+	free_fvalues(set->highs);
+	if (set->singles)
+		g_hash_table_destroy(set->singles);
+	g_free(set->keys);
+	g_free(set->intervals);
+	g_free(set);
+}
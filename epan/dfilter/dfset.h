@@ -0,0 +1,65 @@
+/*
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef DFSET_H
+#define DFSET_H
+
+#include <stdio.h>
+#include <glib.h>
+#include "ftypes/ftypes.h"
+
+/* The set of values, and ranges of values, that the "in" operator tests
+ * a field against.  For integers, IPv4 addresses (with their netmasks),
+ * strings and byte strings such as Ethernet and IPv6 addresses, the
+ * single values are kept in a hash table and the ranges in a sorted
+ * array, so testing a value doesn't depend on the size of the set.
+ * Anything else is compared against every value in turn. */
+typedef struct _df_set_t df_set_t;
+
+df_set_t*
+df_set_new(void);
+
+/* Add a value; the set takes ownership of the fvalue. */
+void
+df_set_add(df_set_t *set, fvalue_t *fv);
+
+/* Add the range of values from low to high, inclusive; the set takes
+ * ownership of both fvalues. */
+void
+df_set_add_range(df_set_t *set, fvalue_t *low, fvalue_t *high);
+
+/* Build the lookup tables, once all the values have been added. */
+void
+df_set_finish(df_set_t *set);
+
+/* Is a value in the set? */
+gboolean
+df_set_contains(df_set_t *set, fvalue_t *fv);
+
+/* Print the set, as in a filter, for dfvm_dump(). */
+void
+df_set_dump(FILE *f, df_set_t *set);
+
+void
+df_set_free(df_set_t *set);
+
+#endif
@@ -50,6 +50,12 @@ dfvm_value_free(dfvm_value_t *v)
 		case DRANGE:
 			drange_free(v->value.drange);
 			break;
+		case FVALUE_SET:
+			df_set_free(v->value.set);
+			break;
+		case FVALUE_SEARCH:
+			fvalue_search_free(v->value.search);
+			break;
 		default:
 			/* nothing */
 			;
@@ -228,6 +234,13 @@ dfvm_dump(FILE *f, GPtrArray *insns)
 					id, arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_IN:
+				fprintf(f, "%05d ANY_IN\t\treg#%u in ",
+					id, arg1->value.numeric);
+				df_set_dump(f, arg2->value.set);
+				fprintf(f, "\n");
+				break;
+
 			case NOT:
 				fprintf(f, "%05d NOT\n", id);
 				break;
@@ -337,6 +350,34 @@ any_test(dfilter_t *df, FvalueCmpFunc cmp, int reg1, int reg2)
 	return FALSE;
 }
 
+/* Does any of the values in a register contain the prepared needle? */
+static gboolean
+any_search(dfilter_t *df, int reg, fvalue_search_t *search)
+{
+	GList	*list;
+
+	for (list = df->registers[reg]; list; list = g_list_next(list)) {
+		if (fvalue_search(list->data, search)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/* Is any of the values in a register in a set? */
+static gboolean
+any_in(dfilter_t *df, int reg, df_set_t *set)
+{
+	GList	*list;
+
+	for (list = df->registers[reg]; list; list = g_list_next(list)) {
+		if (df_set_contains(set, list->data)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 
 /* Free the list nodes w/o freeing the memory that each
  * list node points to. */
@@ -486,8 +527,16 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 				break;
 
 			case ANY_CONTAINS:
-				accum = any_test(df, fvalue_contains,
-						arg1->value.numeric, arg2->value.numeric);
+				arg3 = insn->arg3;
+				if (arg3) {
+					/* The needle was prepared by gencode */
+					accum = any_search(df, arg1->value.numeric,
+							arg3->value.search);
+				}
+				else {
+					accum = any_test(df, fvalue_contains,
+							arg1->value.numeric, arg2->value.numeric);
+				}
 				break;
 
 			case ANY_MATCHES:
@@ -495,6 +544,10 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_IN:
+				accum = any_in(df, arg1->value.numeric, arg2->value.set);
+				break;
+
 			case NOT:
 				accum = !accum;
 				break;
@@ -568,6 +621,7 @@ dfvm_init_const(dfilter_t *df)
 			case ANY_BITWISE_AND:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
+			case ANY_IN:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
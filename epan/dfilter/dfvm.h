@@ -29,6 +29,7 @@
 #include "syntax-tree.h"
 #include "drange.h"
 #include "dfunctions.h"
+#include "dfset.h"
 
 typedef enum {
 	EMPTY,
@@ -38,7 +39,9 @@ typedef enum {
 	REGISTER,
 	INTEGER,
 	DRANGE,
-	FUNCTION_DEF
+	FUNCTION_DEF,
+	FVALUE_SET,
+	FVALUE_SEARCH
 } dfvm_value_type_t;
 
 typedef struct {
@@ -50,6 +53,8 @@ typedef struct {
 		drange			*drange;
 		header_field_info	*hfinfo;
         df_func_def_t   *funcdef;
+		df_set_t		*set;
+		fvalue_search_t		*search;
 	} value;
 
 } dfvm_value_t;
@@ -73,6 +78,7 @@ typedef enum {
 	ANY_BITWISE_AND,
 	ANY_CONTAINS,
 	ANY_MATCHES,
+	ANY_IN,
 	MK_RANGE,
     CALL_FUNCTION
 
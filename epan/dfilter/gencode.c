@@ -31,6 +31,8 @@
 #include "sttype-range.h"
 #include "sttype-test.h"
 #include "sttype-function.h"
+#include "sttype-set.h"
+#include "dfset.h"
 #include "ftypes/ftypes.h"
 
 static void
@@ -246,8 +248,10 @@ dfw_append_function(dfwork_t *dfw, stnode_t *node, dfvm_value_t **p_jmp)
 }
 
 
+/* arg3, if not NULL, is handed to the instruction */
 static void
-gen_relation(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_arg2)
+gen_relation_arg3(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_arg2,
+		dfvm_value_t *arg3)
 {
 	dfvm_insn_t	*insn;
 	dfvm_value_t	*val1, *val2;
@@ -266,6 +270,7 @@ gen_relation(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_ar
 	val2->value.numeric = reg2;
 	insn->arg1 = val1;
 	insn->arg2 = val2;
+	insn->arg3 = arg3;
 	dfw_append_insn(dfw, insn);
 
     /* If either of the relation argumnents need an "exit" instruction
@@ -279,6 +284,30 @@ gen_relation(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_ar
 	}
 }
 
+static void
+gen_relation(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	gen_relation_arg3(dfw, op, st_arg1, st_arg2, NULL);
+}
+
+/* "contains" a constant searches for it with a pattern prepared once,
+ * rather than starting afresh for every value. */
+static void
+gen_contains(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	fvalue_search_t	*search = NULL;
+	dfvm_value_t	*val3 = NULL;
+
+	if (stnode_type_id(st_arg2) == STTYPE_FVALUE) {
+		search = fvalue_search_new(stnode_data(st_arg2));
+	}
+	if (search) {
+		val3 = dfvm_value_new(FVALUE_SEARCH);
+		val3->value.search = search;
+	}
+	gen_relation_arg3(dfw, ANY_CONTAINS, st_arg1, st_arg2, val3);
+}
+
 /* Parse an entity, returning the reg that it gets put into.
  * p_jmp will be set if it has to be set by the calling code; it should
  * be set to the place to jump to, to return to the calling code,
@@ -319,6 +348,46 @@ gen_entity(dfwork_t *dfw, stnode_t *st_arg, dfvm_value_t **p_jmp)
 }
 
 
+/* Tests a field against the values of a set, which are handed over to
+ * the df_set_t of the instruction. */
+static void
+gen_set_membership(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1, *val2;
+	dfvm_value_t	*jmp1 = NULL;
+	df_set_t	*set;
+	set_range_t	*range;
+	GSList		*l;
+	int		reg1;
+
+	reg1 = gen_entity(dfw, st_arg1, &jmp1);
+
+	set = df_set_new();
+	for (l = sttype_set_members(st_arg2); l; l = l->next) {
+		df_set_add(set, stnode_data(l->data));
+	}
+	for (l = sttype_set_ranges(st_arg2); l; l = l->next) {
+		range = l->data;
+		df_set_add_range(set, stnode_data(range->low),
+				stnode_data(range->high));
+	}
+	df_set_finish(set);
+
+	insn = dfvm_insn_new(ANY_IN);
+	val1 = dfvm_value_new(REGISTER);
+	val1->value.numeric = reg1;
+	val2 = dfvm_value_new(FVALUE_SET);
+	val2->value.set = set;
+	insn->arg1 = val1;
+	insn->arg2 = val2;
+	dfw_append_insn(dfw, insn);
+
+	if (jmp1) {
+		jmp1->value.numeric = dfw->next_insn_id;
+	}
+}
+
 static void
 gen_test(dfwork_t *dfw, stnode_t *st_node)
 {
@@ -418,12 +487,16 @@ gen_test(dfwork_t *dfw, stnode_t *st_node)
 			break;
 
 		case TEST_OP_CONTAINS:
-			gen_relation(dfw, ANY_CONTAINS, st_arg1, st_arg2);
+			gen_contains(dfw, st_arg1, st_arg2);
 			break;
 
 		case TEST_OP_MATCHES:
 			gen_relation(dfw, ANY_MATCHES, st_arg1, st_arg2);
 			break;
+
+		case TEST_OP_IN:
+			gen_set_membership(dfw, st_arg1, st_arg2);
+			break;
 	}
 }
 
@@ -0,0 +1,712 @@
+/*
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "dfilter-int.h"
+#include "optimize.h"
+#include "syntax-tree.h"
+#include "sttype-range.h"
+#include "sttype-test.h"
+#include "sttype-function.h"
+#include "sttype-set.h"
+#include "ftypes/ftypes.h"
+
+/*
+ * A filter is run with short-circuit evaluation, left to right, so the
+ * order of the operands of "and" and "or" matters for speed, but not for
+ * the result: tests have no side effects, and a field stays loaded in its
+ * register for the rest of the run once it has been read.  So:
+ *
+ *  - chains of "and", and of "or", are flattened and their operands
+ *    sorted so that the ones that are cheap and likely to decide the
+ *    chain come first;
+ *  - operands repeated in a chain, and double negations, are dropped;
+ *  - "f == a || f == b || ..." becomes "f in {a b ...}", which looks
+ *    the values of f up in a hash table instead of comparing each of
+ *    them against every constant; tests of the same field against sets
+ *    are merged too.
+ *
+ * Comparisons between two constants are already refused by semcheck,
+ * so there is nothing else to fold.
+ */
+
+/* Guesses of what the parts of a test cost, in no particular unit */
+#define COST_FIELD		1.0	/* read once per run, then cached */
+#define COST_COMPARE		2.0
+#define COST_COMPARE_BYTES	4.0	/* strings, byte arrays and the like */
+#define COST_CONTAINS		10.0
+#define COST_MATCHES		30.0
+#define COST_RANGE		3.0
+#define COST_FUNCTION		5.0
+
+/* Guesses of how likely a test is to be true */
+#define PROB_EXISTS		0.5
+#define PROB_EQ			0.1
+#define PROB_NE			0.9
+#define PROB_ORDER		0.5
+#define PROB_SEARCH		0.2
+
+/* Keeps a rank finite for tests that are (nearly) always true or false */
+#define PROB_MIN		0.01
+
+typedef struct {
+	stnode_t	*node;
+	double		rank;		/* the operand with the lowest runs first */
+} operand_t;
+
+static stnode_t*
+optimize(stnode_t *st_node);
+
+static void
+plan_node(GString *str, stnode_t *st_node);
+
+static gboolean
+is_test(stnode_t *st_node, test_op_t op)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+
+	if (stnode_type_id(st_node) != STTYPE_TEST)
+		return FALSE;
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+	return st_op == op;
+}
+
+static gboolean
+is_text_or_bytes(ftenum_t ftype)
+{
+	switch (ftype) {
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_EBCDIC:
+		case FT_UINT_STRING:
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_PROTOCOL:
+		case FT_OID:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+/* Free a syntax tree that is being dropped, with the constants in it;
+ * those would otherwise be handed to, and freed with, the bytecode. */
+static void
+free_subtree(stnode_t *st_node)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+	GSList		*l;
+
+	switch (stnode_type_id(st_node)) {
+		case STTYPE_TEST:
+			sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+			if (st_arg1)
+				free_subtree(st_arg1);
+			if (st_arg2)
+				free_subtree(st_arg2);
+			sttype_test_set2_args(st_node, NULL, NULL);
+			break;
+		case STTYPE_FVALUE:
+			FVALUE_FREE((fvalue_t *)stnode_data(st_node));
+			break;
+		case STTYPE_SET:
+			for (l = sttype_set_members(st_node); l; l = l->next)
+				FVALUE_FREE((fvalue_t *)stnode_data(l->data));
+			for (l = sttype_set_ranges(st_node); l; l = l->next) {
+				set_range_t *range = l->data;
+
+				FVALUE_FREE((fvalue_t *)stnode_data(range->low));
+				FVALUE_FREE((fvalue_t *)stnode_data(range->high));
+			}
+			break;
+		case STTYPE_FUNCTION:
+			for (l = sttype_function_params(st_node); l; l = l->next) {
+				if (stnode_type_id(l->data) == STTYPE_FVALUE)
+					FVALUE_FREE((fvalue_t *)stnode_data(l->data));
+			}
+			break;
+		default:
+			break;
+	}
+	stnode_free(st_node);
+}
+
+/* Free an "and"/"or"/"not" node whose operands have been taken away */
+static void
+free_shell(stnode_t *st_node)
+{
+	sttype_test_set2_args(st_node, NULL, NULL);
+	stnode_free(st_node);
+}
+
+static double
+entity_cost(stnode_t *st_node, gboolean *text_or_bytes)
+{
+	header_field_info	*hfinfo;
+	df_func_def_t		*funcdef;
+	GSList			*params;
+	double			cost;
+
+	switch (stnode_type_id(st_node)) {
+		case STTYPE_FIELD:
+			hfinfo = stnode_data(st_node);
+			if (is_text_or_bytes(hfinfo->type))
+				*text_or_bytes = TRUE;
+			return COST_FIELD;
+
+		case STTYPE_RANGE:
+			*text_or_bytes = TRUE;
+			return COST_FIELD + COST_RANGE;
+
+		case STTYPE_FUNCTION:
+			funcdef = sttype_function_funcdef(st_node);
+			if (is_text_or_bytes(funcdef->retval_ftype))
+				*text_or_bytes = TRUE;
+			cost = COST_FUNCTION;
+			for (params = sttype_function_params(st_node); params; params = params->next)
+				cost += entity_cost(params->data, text_or_bytes);
+			return cost;
+
+		default:
+			return 0.0;
+	}
+}
+
+/* Estimate the cost of running a test, and the chance that it's true */
+static void
+estimate(stnode_t *st_node, double *cost, double *prob)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+	double		cost1, prob1, cost2, prob2;
+	gboolean	text_or_bytes = FALSE;
+	double		compare;
+	guint		n_values = 1;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+
+	switch (st_op) {
+		case TEST_OP_EXISTS:
+			*cost = COST_FIELD;
+			*prob = PROB_EXISTS;
+			return;
+
+		case TEST_OP_NOT:
+			estimate(st_arg1, cost, prob);
+			*prob = 1.0 - *prob;
+			return;
+
+		case TEST_OP_AND:
+			estimate(st_arg1, &cost1, &prob1);
+			estimate(st_arg2, &cost2, &prob2);
+			*cost = cost1 + prob1 * cost2;
+			*prob = prob1 * prob2;
+			return;
+
+		case TEST_OP_OR:
+			estimate(st_arg1, &cost1, &prob1);
+			estimate(st_arg2, &cost2, &prob2);
+			*cost = cost1 + (1.0 - prob1) * cost2;
+			*prob = 1.0 - (1.0 - prob1) * (1.0 - prob2);
+			return;
+
+		default:
+			break;
+	}
+
+	*cost = entity_cost(st_arg1, &text_or_bytes) +
+		entity_cost(st_arg2, &text_or_bytes);
+	compare = text_or_bytes ? COST_COMPARE_BYTES : COST_COMPARE;
+	if (stnode_type_id(st_arg2) == STTYPE_SET)
+		n_values = g_slist_length(sttype_set_members(st_arg2)) +
+			g_slist_length(sttype_set_ranges(st_arg2));
+
+	switch (st_op) {
+		case TEST_OP_EQ:
+			*cost += compare;
+			*prob = PROB_EQ;
+			break;
+		case TEST_OP_IN:
+			/* One lookup, however many values */
+			*cost += compare;
+			*prob = MIN(PROB_EQ * n_values, 1.0 - PROB_MIN);
+			break;
+		case TEST_OP_NE:
+			*cost += compare;
+			*prob = PROB_NE;
+			break;
+		case TEST_OP_CONTAINS:
+			*cost += COST_CONTAINS;
+			*prob = PROB_SEARCH;
+			break;
+		case TEST_OP_MATCHES:
+			*cost += COST_MATCHES;
+			*prob = PROB_SEARCH;
+			break;
+		default:
+			*cost += compare;
+			*prob = PROB_ORDER;
+			break;
+	}
+}
+
+/* If a test is "field == value" or "field in {...}", with the field put
+ * on the left, return the field, else NULL. */
+static header_field_info*
+set_test_field(stnode_t *st_node)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+	header_field_info	*hfinfo;
+
+	if (is_test(st_node, TEST_OP_EQ)) {
+		sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+		if (stnode_type_id(st_arg1) == STTYPE_FVALUE &&
+		    stnode_type_id(st_arg2) == STTYPE_FIELD) {
+			sttype_test_set2_args(st_node, st_arg2, st_arg1);
+			sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+		}
+		if (stnode_type_id(st_arg2) != STTYPE_FVALUE)
+			return NULL;
+	}
+	else if (is_test(st_node, TEST_OP_IN)) {
+		sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+	}
+	else {
+		return NULL;
+	}
+	if (stnode_type_id(st_arg1) != STTYPE_FIELD)
+		return NULL;
+
+	hfinfo = stnode_data(st_arg1);
+	while (hfinfo->same_name_prev)
+		hfinfo = hfinfo->same_name_prev;
+	return hfinfo;
+}
+
+/* The type of the values a "field == value" or "field in {...}" test
+ * compares against */
+static ftype_t*
+set_test_ftype(stnode_t *st_node)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+	if (stnode_type_id(st_arg2) == STTYPE_SET) {
+		if (sttype_set_members(st_arg2))
+			st_arg2 = sttype_set_members(st_arg2)->data;
+		else
+			st_arg2 = ((set_range_t *)sttype_set_ranges(st_arg2)->data)->low;
+	}
+	return fvalue_ftype(stnode_data(st_arg2));
+}
+
+/* Take the values out of a "field == value" or "field in {...}" test,
+ * as a set. */
+static stnode_t*
+set_test_take_set(stnode_t *st_node)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2, *set;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+	if (st_op == TEST_OP_IN) {
+		set = st_arg2;
+	}
+	else {
+		set = stnode_new(STTYPE_SET, NULL);
+		sttype_set_add(set, st_arg2);
+	}
+	sttype_test_set2_args(st_node, st_arg1, NULL);
+	return set;
+}
+
+/* Merge the "field == value" and "field in {...}" operands of an "or"
+ * chain that test the same field into one "in" test. */
+static void
+merge_eq_tests(GPtrArray *operands)
+{
+	guint			i, j;
+	header_field_info	*hfinfo;
+	ftype_t			*ftype;
+	test_op_t		st_op;
+	stnode_t		*st_node, *other, *st_arg1, *st_arg2, *set, *other_set;
+
+	for (i = 0; i < operands->len; i++) {
+		st_node = g_ptr_array_index(operands, i);
+		hfinfo = set_test_field(st_node);
+		if (!hfinfo)
+			continue;
+		ftype = set_test_ftype(st_node);
+
+		set = NULL;
+		for (j = i + 1; j < operands->len; ) {
+			other = g_ptr_array_index(operands, j);
+			if (set_test_field(other) != hfinfo ||
+			    set_test_ftype(other) != ftype) {
+				j++;
+				continue;
+			}
+			if (!set)
+				set = set_test_take_set(st_node);
+			other_set = set_test_take_set(other);
+			sttype_set_merge(set, other_set);
+			stnode_free(other_set);
+			stnode_free(other);
+			g_ptr_array_remove_index(operands, j);
+		}
+		if (!set)
+			continue;
+
+		sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+		sttype_test_set2(st_node, TEST_OP_IN, st_arg1, set);
+	}
+}
+
+/* Drop the operands of a chain that are the same as an earlier one */
+static void
+drop_repeated(GPtrArray *operands)
+{
+	GHashTable	*seen;
+	GString		*str;
+	guint		i;
+	stnode_t	*st_node;
+
+	seen = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	for (i = 0; i < operands->len; ) {
+		st_node = g_ptr_array_index(operands, i);
+		str = g_string_new("");
+		plan_node(str, st_node);
+		if (g_hash_table_lookup(seen, str->str)) {
+			g_string_free(str, TRUE);
+			free_subtree(st_node);
+			g_ptr_array_remove_index(operands, i);
+		}
+		else {
+			g_hash_table_insert(seen, g_string_free(str, FALSE),
+				GINT_TO_POINTER(TRUE));
+			i++;
+		}
+	}
+	g_hash_table_destroy(seen);
+}
+
+/* Collect the operands of a chain of the given "and" or "or", optimizing
+ * each of them. */
+static void
+flatten(stnode_t *st_node, test_op_t op, GPtrArray *operands)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+
+	if (!is_test(st_node, op)) {
+		st_node = optimize(st_node);
+		if (!is_test(st_node, op)) {
+			g_ptr_array_add(operands, st_node);
+			return;
+		}
+	}
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+	free_shell(st_node);
+	flatten(st_arg1, op, operands);
+	flatten(st_arg2, op, operands);
+}
+
+static stnode_t*
+optimize_chain(stnode_t *st_node, test_op_t op)
+{
+	GPtrArray	*operands;
+	operand_t	*ranked, tmp;
+	double		cost, prob;
+	guint		i, j;
+
+	operands = g_ptr_array_new();
+	flatten(st_node, op, operands);
+
+	if (op == TEST_OP_OR)
+		merge_eq_tests(operands);
+	drop_repeated(operands);
+
+	/* An "and" chain is done as soon as a test is false, an "or" chain
+	 * as soon as one is true; for independent tests, running them by
+	 * increasing cost per chance of ending the chain is the cheapest. */
+	ranked = g_new(operand_t, operands->len);
+	for (i = 0; i < operands->len; i++) {
+		ranked[i].node = g_ptr_array_index(operands, i);
+		estimate(ranked[i].node, &cost, &prob);
+		if (op == TEST_OP_AND)
+			prob = 1.0 - prob;
+		ranked[i].rank = cost / MAX(prob, PROB_MIN);
+	}
+
+	/* Insertion sort, which keeps the order of operands of equal rank */
+	for (i = 1; i < operands->len; i++) {
+		tmp = ranked[i];
+		for (j = i; j > 0 && ranked[j - 1].rank > tmp.rank; j--)
+			ranked[j] = ranked[j - 1];
+		ranked[j] = tmp;
+	}
+
+	/* Rebuild the chain, grouping to the left as the grammar does */
+	st_node = ranked[0].node;
+	for (i = 1; i < operands->len; i++) {
+		stnode_t *new_st = stnode_new(STTYPE_TEST, NULL);
+
+		sttype_test_set2(new_st, op, st_node, ranked[i].node);
+		st_node = new_st;
+	}
+
+	g_free(ranked);
+	g_ptr_array_free(operands, TRUE);
+	return st_node;
+}
+
+/* Optimize a test, returning the test that replaces it */
+static stnode_t*
+optimize(stnode_t *st_node)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2, *inner;
+
+	if (stnode_type_id(st_node) != STTYPE_TEST)
+		return st_node;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+
+	switch (st_op) {
+		case TEST_OP_NOT:
+			st_arg1 = optimize(st_arg1);
+			if (is_test(st_arg1, TEST_OP_NOT)) {
+				/* !!x is x */
+				sttype_test_get(st_arg1, &st_op, &inner, &st_arg2);
+				free_shell(st_arg1);
+				free_shell(st_node);
+				return inner;
+			}
+			sttype_test_set2_args(st_node, st_arg1, NULL);
+			return st_node;
+
+		case TEST_OP_AND:
+		case TEST_OP_OR:
+			return optimize_chain(st_node, st_op);
+
+		default:
+			return st_node;
+	}
+}
+
+void
+dfw_optimize(dfwork_t *dfw)
+{
+	dfw->st_root = optimize(dfw->st_root);
+}
+
+
+static const char*
+relation_string(test_op_t op)
+{
+	switch (op) {
+		case TEST_OP_EQ:		return "==";
+		case TEST_OP_NE:		return "!=";
+		case TEST_OP_GT:		return ">";
+		case TEST_OP_GE:		return ">=";
+		case TEST_OP_LT:		return "<";
+		case TEST_OP_LE:		return "<=";
+		case TEST_OP_BITWISE_AND:	return "&";
+		case TEST_OP_CONTAINS:		return "contains";
+		case TEST_OP_MATCHES:		return "matches";
+		case TEST_OP_IN:		return "in";
+		default:
+			g_assert_not_reached();
+			return NULL;
+	}
+}
+
+static void
+plan_operand(GString *str, stnode_t *st_node, test_op_t op)
+{
+	if (is_test(st_node, TEST_OP_AND) || is_test(st_node, TEST_OP_OR)) {
+		if (!is_test(st_node, op)) {
+			g_string_append_c(str, '(');
+			plan_node(str, st_node);
+			g_string_append_c(str, ')');
+			return;
+		}
+	}
+	plan_node(str, st_node);
+}
+
+static void
+plan_drange(GString *str, drange *dr)
+{
+	GSList		*range_list;
+	drange_node	*range_item;
+
+	for (range_list = dr->range_list; range_list != NULL;
+	     range_list = range_list->next) {
+		range_item = range_list->data;
+		switch (range_item->ending) {
+			case DRANGE_NODE_END_T_UNINITIALIZED:
+				g_string_append_c(str, '?');
+				break;
+			case DRANGE_NODE_END_T_LENGTH:
+				g_string_append_printf(str, "%d:%d",
+					range_item->start_offset, range_item->length);
+				break;
+			case DRANGE_NODE_END_T_OFFSET:
+				g_string_append_printf(str, "%d-%d",
+					range_item->start_offset, range_item->end_offset);
+				break;
+			case DRANGE_NODE_END_T_TO_THE_END:
+				g_string_append_printf(str, "%d:",
+					range_item->start_offset);
+				break;
+		}
+		if (range_list->next != NULL)
+			g_string_append_c(str, ',');
+	}
+}
+
+static void
+plan_node(GString *str, stnode_t *st_node)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+	header_field_info	*hfinfo;
+	fvalue_t	*fv;
+	char		*value_str;
+	GSList		*l;
+
+	switch (stnode_type_id(st_node)) {
+		case STTYPE_TEST:
+			sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+			switch (st_op) {
+				case TEST_OP_EXISTS:
+					plan_node(str, st_arg1);
+					break;
+				case TEST_OP_NOT:
+					g_string_append_c(str, '!');
+					if (stnode_type_id(st_arg1) == STTYPE_TEST &&
+					    !is_test(st_arg1, TEST_OP_EXISTS)) {
+						g_string_append_c(str, '(');
+						plan_node(str, st_arg1);
+						g_string_append_c(str, ')');
+					}
+					else {
+						plan_node(str, st_arg1);
+					}
+					break;
+				case TEST_OP_AND:
+				case TEST_OP_OR:
+					plan_operand(str, st_arg1, st_op);
+					g_string_append(str, st_op == TEST_OP_AND ? " && " : " || ");
+					plan_operand(str, st_arg2, st_op);
+					break;
+				default:
+					plan_node(str, st_arg1);
+					g_string_append_printf(str, " %s ",
+						relation_string(st_op));
+					plan_node(str, st_arg2);
+					break;
+			}
+			break;
+
+		case STTYPE_FIELD:
+			hfinfo = stnode_data(st_node);
+			g_string_append(str, hfinfo->abbrev);
+			break;
+
+		case STTYPE_FVALUE:
+			fv = stnode_data(st_node);
+			value_str = NULL;
+			if (fvalue_ftype(fv)->val_to_string_repr)
+				value_str = fvalue_to_string_repr(fv, FTREPR_DFILTER, NULL);
+			if (value_str) {
+				g_string_append(str, value_str);
+				g_free(value_str);
+			}
+			else {
+				/* Can't be shown; make sure it never looks
+				 * like any other value. */
+				g_string_append_printf(str, "<%s %p>",
+					fvalue_type_name(fv), (void *)fv);
+			}
+			break;
+
+		case STTYPE_RANGE:
+			hfinfo = sttype_range_hfinfo(st_node);
+			g_string_append_printf(str, "%s[", hfinfo->abbrev);
+			plan_drange(str, sttype_range_drange(st_node));
+			g_string_append_c(str, ']');
+			break;
+
+		case STTYPE_FUNCTION:
+			g_string_append_printf(str, "%s(",
+				sttype_function_funcdef(st_node)->name);
+			for (l = sttype_function_params(st_node); l; l = l->next) {
+				plan_node(str, l->data);
+				if (l->next)
+					g_string_append(str, ", ");
+			}
+			g_string_append_c(str, ')');
+			break;
+
+		case STTYPE_SET:
+			g_string_append_c(str, '{');
+			for (l = sttype_set_members(st_node); l; l = l->next) {
+				plan_node(str, l->data);
+				if (l->next || sttype_set_ranges(st_node))
+					g_string_append_c(str, ' ');
+			}
+			for (l = sttype_set_ranges(st_node); l; l = l->next) {
+				set_range_t *range = l->data;
+
+				plan_node(str, range->low);
+				g_string_append(str, "..");
+				plan_node(str, range->high);
+				if (l->next)
+					g_string_append_c(str, ' ');
+			}
+			g_string_append_c(str, '}');
+			break;
+
+		default:
+			g_string_append(str, stnode_type_name(st_node));
+			break;
+	}
+}
+
+gchar*
+dfw_plan(stnode_t *st_node)
+{
+	GString		*str;
+
+	str = g_string_new("");
+	plan_node(str, st_node);
+	return g_string_free(str, FALSE);
+}
@@ -0,0 +1,36 @@
+/*
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+/* Rewrite a semantically-checked syntax tree into one that gives the same
+ * result but is cheaper to run. */
+void
+dfw_optimize(dfwork_t *dfw);
+
+/* Describe a syntax tree as a filter string, as it will be run.
+ * Free the result with g_free(). */
+gchar*
+dfw_plan(stnode_t *st_node);
+
+#endif
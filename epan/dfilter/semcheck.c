@@ -24,6 +24,7 @@
 #include "config.h"
 #endif
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "dfilter-int.h"
@@ -32,6 +33,7 @@
 #include "sttype-range.h"
 #include "sttype-test.h"
 #include "sttype-function.h"
+#include "sttype-set.h"
 
 #include <epan/exceptions.h>
 #include <epan/packet.h>
@@ -351,6 +353,7 @@ check_exists(stnode_t *st_arg1)
 		case STTYPE_TEST:
 		case STTYPE_INTEGER:
 		case STTYPE_FVALUE:
+		case STTYPE_SET:
 		case STTYPE_NUM_TYPES:
 			g_assert_not_reached();
 	}
@@ -1129,6 +1132,200 @@ header_field_info   *hfinfo;
 	}
 }
 
+/* Make the lowest, or highest, address of an IPv6 prefix written as
+ * "address/length". */
+static fvalue_t*
+mk_ipv6_prefix_bound(char *s, gboolean high_end)
+{
+	char		*slash, *addr_s, *end;
+	unsigned long	bits;
+	fvalue_t	*fv;
+	guint8		addr[16];
+	guint8		mask;
+	int		i, n;
+
+	slash = strchr(s, '/');
+	bits = strtoul(slash + 1, &end, 10);
+	if (end == slash + 1 || *end != '\0' || bits > 128) {
+		dfilter_fail("\"%s\" is not a valid IPv6 prefix length.", slash + 1);
+		return NULL;
+	}
+
+	addr_s = g_strndup(s, slash - s);
+	fv = fvalue_from_unparsed(FT_IPv6, addr_s, FALSE, dfilter_fail);
+	g_free(addr_s);
+	if (!fv) {
+		return NULL;
+	}
+
+	memcpy(addr, fvalue_get(fv), sizeof addr);
+	for (i = 0; i < 16; i++) {
+		/* The number of bits of this byte in the prefix */
+		n = (int)bits - 8 * i;
+		if (n >= 8)
+			continue;
+		mask = n <= 0 ? 0 : (guint8)(0xff << (8 - n));
+		if (high_end)
+			addr[i] |= (guint8)~mask;
+		else
+			addr[i] &= mask;
+	}
+	fvalue_set(fv, addr, FALSE);
+	return fv;
+}
+
+/* Convert a value of a set, or an end of one of its ranges, to a value
+ * of the type of the field the set is tested against. */
+static stnode_t*
+mk_set_value(header_field_info *hfinfo, stnode_t *st_value, gboolean high_end)
+{
+	header_field_info	*hfinfo2;
+	fvalue_t		*fvalue = NULL;
+	char			*s;
+
+	switch (stnode_type_id(st_value)) {
+		case STTYPE_STRING:
+			s = stnode_data(st_value);
+			fvalue = fvalue_from_string(hfinfo->type, s, dfilter_fail);
+			if (!fvalue) {
+				/* check value_string */
+				fvalue = mk_fvalue_from_val_string(hfinfo, s);
+			}
+			break;
+
+		case STTYPE_UNPARSED:
+			s = stnode_data(st_value);
+			if (hfinfo->type == FT_IPv6 && strchr(s, '/')) {
+				fvalue = mk_ipv6_prefix_bound(s, high_end);
+				break;
+			}
+			fvalue = fvalue_from_unparsed(hfinfo->type, s, FALSE, dfilter_fail);
+			if (!fvalue) {
+				/* check value_string */
+				fvalue = mk_fvalue_from_val_string(hfinfo, s);
+			}
+			break;
+
+		case STTYPE_FIELD:
+			hfinfo2 = stnode_data(st_value);
+			dfilter_fail("%s is a field; a set can only hold values.",
+					hfinfo2->abbrev);
+			break;
+
+		default:
+			dfilter_fail("A set can only hold values.");
+			break;
+	}
+	if (!fvalue) {
+		THROW(TypeError);
+	}
+	return stnode_new(STTYPE_FVALUE, fvalue);
+}
+
+/* Check the semantics of "field in {...}", converting the values of the
+ * set to values of the type of the field. */
+static void
+check_set_membership(stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	header_field_info	*hfinfo;
+	stnode_t		*st_value;
+	set_range_t		*range;
+	GSList			*l, *members, *v;
+	GSList			*volatile values;
+	fvalue_t		*fvalue;
+	char			*s, *dots, *low_s;
+
+	DebugLog(("   4 check_set_membership()\n"));
+
+	if (stnode_type_id(st_arg1) != STTYPE_FIELD) {
+		dfilter_fail("Only a field can be tested for being in a set.");
+		THROW(TypeError);
+	}
+	hfinfo = stnode_data(st_arg1);
+	if (!ftype_can_eq(hfinfo->type)) {
+		dfilter_fail("%s (type=%s) cannot participate in 'in' comparison.",
+				hfinfo->abbrev, ftype_pretty_name(hfinfo->type));
+		THROW(TypeError);
+	}
+
+	/* Ranges written without spaces, "a..b", are scanned as one value;
+	 * so is an IPv6 prefix, which is a range too. */
+	members = NULL;
+	for (l = sttype_set_members(st_arg2); l; l = l->next) {
+		st_value = l->data;
+		if (stnode_type_id(st_value) == STTYPE_UNPARSED) {
+			s = stnode_data(st_value);
+			dots = strstr(s, "..");
+			if (dots && dots != s && dots[2] != '\0') {
+				low_s = g_strndup(s, dots - s);
+				sttype_set_add_range(st_arg2,
+					stnode_new(STTYPE_UNPARSED, low_s),
+					stnode_new(STTYPE_UNPARSED, dots + 2));
+				g_free(low_s);
+				stnode_free(st_value);
+				continue;
+			}
+			if (hfinfo->type == FT_IPv6 && strchr(s, '/')) {
+				sttype_set_add_range(st_arg2, st_value,
+					stnode_new(STTYPE_UNPARSED, s));
+				continue;
+			}
+		}
+		members = g_slist_append(members, st_value);
+	}
+	sttype_set_replace_members(st_arg2, members);
+
+	/* Convert all the values before putting any of them in the set;
+	 * freeing the set doesn't free the fvalues, so if one of them
+	 * can't be converted, those converted before it are freed here. */
+	values = NULL;
+	TRY {
+		for (l = sttype_set_members(st_arg2); l; l = l->next) {
+			values = g_slist_prepend(values,
+					mk_set_value(hfinfo, l->data, FALSE));
+		}
+		for (l = sttype_set_ranges(st_arg2); l; l = l->next) {
+			range = l->data;
+			if (!ftype_can_gt(hfinfo->type)) {
+				dfilter_fail("%s (type=%s) cannot be given a range of values.",
+						hfinfo->abbrev, ftype_pretty_name(hfinfo->type));
+				THROW(TypeError);
+			}
+			values = g_slist_prepend(values,
+					mk_set_value(hfinfo, range->low, FALSE));
+			values = g_slist_prepend(values,
+					mk_set_value(hfinfo, range->high, TRUE));
+		}
+	}
+	CATCH(TypeError) {
+		for (l = values; l; l = l->next) {
+			fvalue = stnode_data(l->data);
+			FVALUE_FREE(fvalue);
+			stnode_free(l->data);
+		}
+		g_slist_free(values);
+		RETHROW;
+	}
+	ENDTRY;
+
+	values = g_slist_reverse(values);
+	v = values;
+	for (l = sttype_set_members(st_arg2); l; l = l->next) {
+		stnode_free(l->data);
+		l->data = v->data;
+		v = v->next;
+	}
+	for (l = sttype_set_ranges(st_arg2); l; l = l->next) {
+		range = l->data;
+		stnode_free(range->low);
+		range->low = v->data;
+		stnode_free(range->high);
+		range->high = v->next->data;
+		v = v->next->next;
+	}
+	g_slist_free(values);
+}
+
 /* Check the semantics of any type of TEST */
 static void
 check_test(stnode_t *st_node)
@@ -1194,6 +1391,9 @@ check_test(stnode_t *st_node)
 			THROW(TypeError);
 #endif
 			break;
+		case TEST_OP_IN:
+			check_set_membership(st_arg1, st_arg2);
+			break;
 
 		default:
 			g_assert_not_reached();
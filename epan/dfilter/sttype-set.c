@@ -0,0 +1,171 @@
+/*
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "syntax-tree.h"
+#include "sttype-set.h"
+
+typedef struct {
+	guint32		magic;
+	GSList		*members;
+	GSList		*ranges;
+} set_t;
+
+#define SET_MAGIC	0x5e75e75e
+
+static gpointer
+set_new(gpointer junk)
+{
+	set_t		*set;
+
+	g_assert(junk == NULL);
+
+	set = g_new(set_t, 1);
+
+	set->magic = SET_MAGIC;
+	set->members = NULL;
+	set->ranges = NULL;
+
+	return (gpointer) set;
+}
+
+static void
+slist_stnode_free(gpointer data, gpointer user_data _U_)
+{
+	stnode_free(data);
+}
+
+static void
+slist_range_free(gpointer data, gpointer user_data _U_)
+{
+	set_range_t	*range = data;
+
+	stnode_free(range->low);
+	stnode_free(range->high);
+	g_free(range);
+}
+
+static void
+set_free(gpointer value)
+{
+	set_t	*set = value;
+	assert_magic(set, SET_MAGIC);
+
+	g_slist_foreach(set->members, slist_stnode_free, NULL);
+	g_slist_free(set->members);
+	g_slist_foreach(set->ranges, slist_range_free, NULL);
+	g_slist_free(set->ranges);
+	g_free(set);
+}
+
+void
+sttype_set_add(stnode_t *node, stnode_t *member)
+{
+	set_t	*set;
+
+	set = stnode_data(node);
+	assert_magic(set, SET_MAGIC);
+
+	set->members = g_slist_append(set->members, member);
+}
+
+GSList*
+sttype_set_members(stnode_t *node)
+{
+	set_t	*set;
+
+	set = stnode_data(node);
+	assert_magic(set, SET_MAGIC);
+
+	return set->members;
+}
+
+void
+sttype_set_replace_members(stnode_t *node, GSList *members)
+{
+	set_t	*set;
+
+	set = stnode_data(node);
+	assert_magic(set, SET_MAGIC);
+
+	g_slist_free(set->members);
+	set->members = members;
+}
+
+void
+sttype_set_add_range(stnode_t *node, stnode_t *low, stnode_t *high)
+{
+	set_t		*set;
+	set_range_t	*range;
+
+	set = stnode_data(node);
+	assert_magic(set, SET_MAGIC);
+
+	range = g_new(set_range_t, 1);
+	range->low = low;
+	range->high = high;
+	set->ranges = g_slist_append(set->ranges, range);
+}
+
+GSList*
+sttype_set_ranges(stnode_t *node)
+{
+	set_t	*set;
+
+	set = stnode_data(node);
+	assert_magic(set, SET_MAGIC);
+
+	return set->ranges;
+}
+
+void
+sttype_set_merge(stnode_t *node, stnode_t *other)
+{
+	set_t	*set, *other_set;
+
+	set = stnode_data(node);
+	assert_magic(set, SET_MAGIC);
+	other_set = stnode_data(other);
+	assert_magic(other_set, SET_MAGIC);
+
+	set->members = g_slist_concat(set->members, other_set->members);
+	set->ranges = g_slist_concat(set->ranges, other_set->ranges);
+	other_set->members = NULL;
+	other_set->ranges = NULL;
+}
+
+void
+sttype_register_set(void)
+{
+	static sttype_t set_type = {
+		STTYPE_SET,
+		"SET",
+		set_new,
+		set_free,
+	};
+
+	sttype_register(&set_type);
+}
@@ -0,0 +1,64 @@
+/*
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef STTYPE_SET_H
+#define STTYPE_SET_H
+
+#include "syntax-tree.h"
+
+/* A set stnode_t is a list of values, and of ranges of values, any of
+ * which a field may be equal to, or in.  It is made with
+ * stnode_new(STTYPE_SET, NULL). */
+
+/* A range of values, from low to high inclusive */
+typedef struct {
+	stnode_t	*low;
+	stnode_t	*high;
+} set_range_t;
+
+/* Add a value, an stnode_t, to the end of a set. */
+void
+sttype_set_add(stnode_t *node, stnode_t *member);
+
+/* Get the values of a set, as a list of stnode_t's. */
+GSList*
+sttype_set_members(stnode_t *node);
+
+/* Replace the values of a set; the old list is freed, not its members. */
+void
+sttype_set_replace_members(stnode_t *node, GSList *members);
+
+/* Add a range of values, two stnode_t's, to the end of a set. */
+void
+sttype_set_add_range(stnode_t *node, stnode_t *low, stnode_t *high);
+
+/* Get the ranges of a set, as a list of set_range_t's. */
+GSList*
+sttype_set_ranges(stnode_t *node);
+
+/* Move the values and ranges of another set to the end of a set,
+ * leaving the other one empty. */
+void
+sttype_set_merge(stnode_t *node, stnode_t *other);
+
+#endif
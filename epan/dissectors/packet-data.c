@@ -135,6 +135,7 @@ proto_register_data(void)
 
 	proto_register_field_array(proto_data, hf, array_length(hf));
 	proto_register_subtree_array(ett, array_length(ett));
+	proto_set_skippable(proto_data);
 	
 	module_data = prefs_register_protocol( proto_data, proto_reg_handoff_data);
 	prefs_register_bool_preference(module_data,
@@ -82,6 +82,7 @@ proto_register_daytime(void)
   proto_daytime = proto_register_protocol("Daytime Protocol", "DAYTIME", "daytime");
   proto_register_field_array(proto_daytime, hf, array_length(hf));
   proto_register_subtree_array(ett, array_length(ett));
+  proto_set_skippable(proto_daytime);
 }
 
 void
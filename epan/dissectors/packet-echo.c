@@ -106,6 +106,7 @@ void proto_register_echo(void)
   proto_echo = proto_register_protocol("Echo", "ECHO", "echo");
   proto_register_field_array(proto_echo, hf, array_length(hf));
   proto_register_subtree_array(ett, array_length(ett));
+  proto_set_skippable(proto_echo);
 
 }
 
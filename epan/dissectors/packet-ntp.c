@@ -1434,6 +1434,7 @@ proto_register_ntp(void)
 	    "ntp");
 	proto_register_field_array(proto_ntp, hf, array_length(hf));
 	proto_register_subtree_array(ett, array_length(ett));
+	proto_set_skippable(proto_ntp);
 
 	init_parser();
 }
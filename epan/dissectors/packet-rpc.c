@@ -1412,7 +1412,7 @@ dissect_rpc_indir_call(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
 			 * it to the list of information structures.
 			 */
 			rpc_conv_info = se_alloc(sizeof(rpc_conv_info_t));
-			rpc_conv_info->xids=se_tree_create_non_persistent(EMEM_TREE_TYPE_RED_BLACK, "rpc_xids");
+			rpc_conv_info->xids=se_tree_create_non_persistent(EMEM_TREE_TYPE_RADIX, "rpc_xids");
 
 			conversation_add_proto_data(conversation, proto_rpc, rpc_conv_info);
 		}
@@ -1544,7 +1544,7 @@ dissect_rpc_indir_reply(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
 		 * it to the list of information structures.
 		 */
 		rpc_conv_info = se_alloc(sizeof(rpc_conv_info_t));
-		rpc_conv_info->xids=se_tree_create_non_persistent(EMEM_TREE_TYPE_RED_BLACK, "rpc_xids");
+		rpc_conv_info->xids=se_tree_create_non_persistent(EMEM_TREE_TYPE_RADIX, "rpc_xids");
 		conversation_add_proto_data(conversation, proto_rpc, rpc_conv_info);
 	}
 
@@ -1850,7 +1850,7 @@ dissect_rpc_message(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
 			 * it to the list of information structures.
 			 */
 			rpc_conv_info = se_alloc(sizeof(rpc_conv_info_t));
-			rpc_conv_info->xids=se_tree_create_non_persistent(EMEM_TREE_TYPE_RED_BLACK, "rpc_xids");
+			rpc_conv_info->xids=se_tree_create_non_persistent(EMEM_TREE_TYPE_RADIX, "rpc_xids");
 
 			conversation_add_proto_data(conversation, proto_rpc, rpc_conv_info);
 		}
@@ -2130,7 +2130,7 @@ dissect_rpc_message(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
 			 * it to the list of information structures.
 			 */
 			rpc_conv_info = se_alloc(sizeof(rpc_conv_info_t));
-			rpc_conv_info->xids=se_tree_create_non_persistent(EMEM_TREE_TYPE_RED_BLACK, "rpc_xids");
+			rpc_conv_info->xids=se_tree_create_non_persistent(EMEM_TREE_TYPE_RADIX, "rpc_xids");
 
 			conversation_add_proto_data(conversation, proto_rpc, rpc_conv_info);
 		}
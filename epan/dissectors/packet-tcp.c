@@ -373,19 +373,19 @@ init_tcp_conversation_data(packet_info *pinfo)
     tcpd=se_alloc0(sizeof(struct tcp_analysis));
     tcpd->flow1.win_scale=-1;
     tcpd->flow1.window = G_MAXUINT32;
-    tcpd->flow1.multisegment_pdus=se_tree_create_non_persistent(EMEM_TREE_TYPE_RED_BLACK, "tcp_multisegment_pdus");
+    tcpd->flow1.multisegment_pdus=se_tree_create_non_persistent(EMEM_TREE_TYPE_RADIX, "tcp_multisegment_pdus");
     /*
     tcpd->flow1.username = NULL;
     tcpd->flow1.command = NULL;
     */
     tcpd->flow2.window = G_MAXUINT32;
     tcpd->flow2.win_scale=-1;
-    tcpd->flow2.multisegment_pdus=se_tree_create_non_persistent(EMEM_TREE_TYPE_RED_BLACK, "tcp_multisegment_pdus");
+    tcpd->flow2.multisegment_pdus=se_tree_create_non_persistent(EMEM_TREE_TYPE_RADIX, "tcp_multisegment_pdus");
     /*
     tcpd->flow2.username = NULL;
     tcpd->flow2.command = NULL;
     */
-    tcpd->acked_table=se_tree_create_non_persistent(EMEM_TREE_TYPE_RED_BLACK, "tcp_analyze_acked_table");
+    tcpd->acked_table=se_tree_create_non_persistent(EMEM_TREE_TYPE_RADIX, "tcp_analyze_acked_table");
     tcpd->ts_first.secs=pinfo->fd->abs_ts.secs;
     tcpd->ts_first.nsecs=pinfo->fd->abs_ts.nsecs;
     tcpd->ts_prev.secs=pinfo->fd->abs_ts.secs;
@@ -87,6 +87,7 @@ proto_register_time(void)
   proto_time = proto_register_protocol("Time Protocol", "TIME", "time");
   proto_register_field_array(proto_time, hf, array_length(hf));
   proto_register_subtree_array(ett, array_length(ett));
+  proto_set_skippable(proto_time);
 }
 
 void
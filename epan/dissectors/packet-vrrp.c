@@ -300,6 +300,7 @@ void proto_register_vrrp(void)
 	    "VRRP", "vrrp");
 	proto_register_field_array(proto_vrrp, hf, array_length(hf));
 	proto_register_subtree_array(ett, array_length(ett));
+	proto_set_skippable(proto_vrrp);
 
 	return;
 }
@@ -152,10 +152,45 @@ typedef struct _emem_header_t {
 	 */
 	gboolean debug_verify_pointers;
 
+	/* Allocation accounting, shared by the pools of a context; NULL
+	 * unless it has been turned on with emem_stats_enable().
+	 */
+	struct _emem_stats_state_t *stats;
+
 } emem_header_t;
 
-static emem_header_t ep_packet_mem;
-static emem_header_t se_packet_mem;
+/* A packet-lifetime pool and a capture-lifetime pool */
+struct _emem_context_t {
+	emem_header_t ep;
+	emem_header_t se;
+};
+
+/* The context of threads that haven't been given one of their own */
+static emem_context_t default_context;
+
+/* The context each thread has been given, if any */
+static GStaticPrivate current_context = G_STATIC_PRIVATE_INIT;
+
+/* Has any thread been given a context?  Until one has, there is no need
+ * to look for it.
+ */
+static gboolean have_contexts = FALSE;
+
+static emem_context_t *
+emem_current_context(void)
+{
+	emem_context_t *context;
+
+	if (!have_contexts)
+		return &default_context;
+
+	context = g_static_private_get(&current_context);
+	return context ? context : &default_context;
+}
+
+/* The pools of the calling thread */
+#define ep_packet_mem	(emem_current_context()->ep)
+#define se_packet_mem	(emem_current_context()->se)
 
 /*
  *  Memory scrubbing is expensive but can be useful to ensure we don't:
@@ -290,44 +325,44 @@ emem_init_chunk(emem_header_t *mem)
 }
 
 
-/* Initialize the packet-lifetime memory allocation pool.
- * This function should be called only once when Wireshark or TShark starts
- * up.
+/* Initialize a packet-lifetime memory allocation pool.
+ * This function should be called only once for each pool.
  */
 static void
-ep_init_chunk(void)
+ep_init_chunk(emem_header_t *mem)
 {
-	ep_packet_mem.free_list=NULL;
-	ep_packet_mem.used_list=NULL;
-	ep_packet_mem.trees=NULL;	/* not used by this allocator */
+	mem->free_list=NULL;
+	mem->used_list=NULL;
+	mem->trees=NULL;	/* not used by this allocator */
+	mem->stats=NULL;
 
-	ep_packet_mem.debug_use_chunks = (getenv("WIRESHARK_DEBUG_EP_NO_CHUNKS") == NULL);
-	ep_packet_mem.debug_use_canary = ep_packet_mem.debug_use_chunks && (getenv("WIRESHARK_DEBUG_EP_NO_CANARY") == NULL);
-	ep_packet_mem.debug_verify_pointers = (getenv("WIRESHARK_EP_VERIFY_POINTERS") != NULL);
+	mem->debug_use_chunks = (getenv("WIRESHARK_DEBUG_EP_NO_CHUNKS") == NULL);
+	mem->debug_use_canary = mem->debug_use_chunks && (getenv("WIRESHARK_DEBUG_EP_NO_CANARY") == NULL);
+	mem->debug_verify_pointers = (getenv("WIRESHARK_EP_VERIFY_POINTERS") != NULL);
 
 #ifdef DEBUG_INTENSE_CANARY_CHECKS
 	intense_canary_checking = (getenv("WIRESHARK_DEBUG_EP_INTENSE_CANARY") != NULL);
 #endif
 
-	emem_init_chunk(&ep_packet_mem);
+	emem_init_chunk(mem);
 }
 
-/* Initialize the capture-lifetime memory allocation pool.
- * This function should be called only once when Wireshark or TShark starts
- * up.
+/* Initialize a capture-lifetime memory allocation pool.
+ * This function should be called only once for each pool.
  */
 static void
-se_init_chunk(void)
+se_init_chunk(emem_header_t *mem)
 {
-	se_packet_mem.free_list = NULL;
-	se_packet_mem.used_list = NULL;
-	se_packet_mem.trees = NULL;
+	mem->free_list = NULL;
+	mem->used_list = NULL;
+	mem->trees = NULL;
+	mem->stats = NULL;
 
-	se_packet_mem.debug_use_chunks = (getenv("WIRESHARK_DEBUG_SE_NO_CHUNKS") == NULL);
-	se_packet_mem.debug_use_canary = se_packet_mem.debug_use_chunks && (getenv("WIRESHARK_DEBUG_SE_USE_CANARY") != NULL);
-	se_packet_mem.debug_verify_pointers = (getenv("WIRESHARK_SE_VERIFY_POINTERS") != NULL);
+	mem->debug_use_chunks = (getenv("WIRESHARK_DEBUG_SE_NO_CHUNKS") == NULL);
+	mem->debug_use_canary = mem->debug_use_chunks && (getenv("WIRESHARK_DEBUG_SE_USE_CANARY") != NULL);
+	mem->debug_verify_pointers = (getenv("WIRESHARK_SE_VERIFY_POINTERS") != NULL);
 
-	emem_init_chunk(&se_packet_mem);
+	emem_init_chunk(mem);
 }
 
 /*  Initialize all the allocators here.
@@ -337,8 +372,8 @@ se_init_chunk(void)
 void
 emem_init(void)
 {
-	ep_init_chunk();
-	se_init_chunk();
+	ep_init_chunk(&default_context.ep);
+	se_init_chunk(&default_context.se);
 
 	if (getenv("WIRESHARK_DEBUG_SCRUB_MEMORY"))
 		debug_use_memory_scrubber  = TRUE;
@@ -368,6 +403,39 @@ emem_init(void)
 #endif /* _WIN32 / USE_GUARD_PAGES */
 }
 
+emem_context_t *
+emem_context_new(void)
+{
+	emem_context_t *context;
+
+	context = g_new(emem_context_t, 1);
+	ep_init_chunk(&context->ep);
+	se_init_chunk(&context->se);
+
+	return context;
+}
+
+emem_context_t *
+emem_context_set_current(emem_context_t *context)
+{
+	emem_context_t *previous;
+
+	have_contexts = TRUE;
+	previous = g_static_private_get(&current_context);
+	g_static_private_set(&current_context, context, NULL);
+
+	return previous;
+}
+
+emem_context_t *
+emem_context_get_current(void)
+{
+	if (!have_contexts)
+		return NULL;
+
+	return g_static_private_get(&current_context);
+}
+
 #ifdef SHOW_EMEM_STATS
 #define NUM_ALLOC_DIST 10
 static guint allocations[NUM_ALLOC_DIST] = { 0 };
@@ -843,12 +911,109 @@ emem_alloc_glib(size_t size, emem_header_t *mem)
 	return npc->buf;
 }
 
+/* What has been allocated for one owner */
+typedef struct _emem_owner_t {
+	int id;
+	emem_stats_t stats;
+	guint64 packet_bytes;	/* allocated for it in the current packet */
+	gboolean in_packet;	/* on the packet_owners list */
+} emem_owner_t;
+
+typedef struct _emem_stats_state_t {
+	emem_header_t *se;		/* to tell se_ from ep_ allocations */
+	GHashTable *owners;		/* emem_owner_t, by id */
+	emem_owner_t *owner;		/* the one being allocated for now */
+	GPtrArray *packet_owners;	/* those that allocated in this packet */
+	guint64 packet_allocs;
+	guint64 packet_bytes;
+	guint64 packets[EMEM_STATS_PACKET_BUCKETS];
+} emem_stats_state_t;
+
+static emem_owner_t *
+emem_stats_owner(emem_stats_state_t *stats, int id)
+{
+	emem_owner_t *owner;
+
+	owner = g_hash_table_lookup(stats->owners, GINT_TO_POINTER(id));
+	if (!owner) {
+		owner = g_new0(emem_owner_t, 1);
+		owner->id = id;
+		g_hash_table_insert(stats->owners, GINT_TO_POINTER(id), owner);
+	}
+	return owner;
+}
+
+/* Charge an allocation to the current owner */
+static void
+emem_stats_count(emem_header_t *mem, size_t size)
+{
+	emem_stats_state_t *stats = mem->stats;
+	emem_owner_t *owner = stats->owner;
+
+	if (mem == stats->se) {
+		owner->stats.se_allocs++;
+		owner->stats.se_bytes += size;
+	} else {
+		owner->stats.ep_allocs++;
+		owner->stats.ep_bytes += size;
+	}
+
+	if (!owner->in_packet) {
+		owner->in_packet = TRUE;
+		g_ptr_array_add(stats->packet_owners, owner);
+	}
+	owner->packet_bytes += size;
+	stats->packet_allocs++;
+	stats->packet_bytes += size;
+}
+
+/* The histogram bucket for a packet: bucket i is for up to 2^i bytes */
+static int
+emem_stats_bucket(guint64 bytes)
+{
+	int i;
+
+	for (i = 0; i < EMEM_STATS_PACKET_BUCKETS - 1 && bytes > ((guint64)1 << i); i++)
+		;
+	return i;
+}
+
+/* Called between packets, when the ep_ memory is freed: add what the
+ * last packet allocated to the histogram, and to the owners' maximums.
+ */
+static void
+emem_stats_end_packet(emem_stats_state_t *stats)
+{
+	emem_owner_t *owner;
+	guint i;
+
+	for (i = 0; i < stats->packet_owners->len; i++) {
+		owner = g_ptr_array_index(stats->packet_owners, i);
+		if (owner->packet_bytes > owner->stats.packet_max)
+			owner->stats.packet_max = owner->packet_bytes;
+		owner->packet_bytes = 0;
+		owner->in_packet = FALSE;
+	}
+	g_ptr_array_set_size(stats->packet_owners, 0);
+
+	if (stats->packet_allocs == 0)
+		return;
+
+	stats->packets[emem_stats_bucket(stats->packet_bytes)]++;
+
+	stats->packet_allocs = 0;
+	stats->packet_bytes = 0;
+}
+
 /* allocate 'size' amount of memory. */
 static void *
 emem_alloc(size_t size, emem_header_t *mem)
 {
 	void *buf = mem->memory_alloc(size, mem);
 
+	if (mem->stats)
+		emem_stats_count(mem, size);
+
 	/*  XXX - this is a waste of time if the allocator function is going to
 	 *  memset this straight back to 0.
 	 */
@@ -1233,6 +1398,7 @@ emem_free_all(emem_header_t *mem)
 	/* release/reset all allocated trees */
 	for(tree_list=mem->trees;tree_list;tree_list=tree_list->next){
 		tree_list->tree=NULL;
+		tree_list->radix=NULL;
 	}
 }
 
@@ -1240,7 +1406,12 @@ emem_free_all(emem_header_t *mem)
 void
 ep_free_all(void)
 {
-	emem_free_all(&ep_packet_mem);
+	emem_header_t *mem = &ep_packet_mem;
+
+	if (mem->stats)
+		emem_stats_end_packet(mem->stats);
+
+	emem_free_all(mem);
 }
 
 /* release all allocated memory back to the pool. */
@@ -1254,6 +1425,185 @@ se_free_all(void)
 	emem_free_all(&se_packet_mem);
 }
 
+/* Allocation accounting */
+
+static void
+emem_stats_free(emem_context_t *context)
+{
+	emem_stats_state_t *stats = context->ep.stats;
+
+	context->ep.stats = NULL;
+	context->se.stats = NULL;
+
+	g_hash_table_destroy(stats->owners);
+	g_ptr_array_free(stats->packet_owners, TRUE);
+	g_free(stats);
+}
+
+void
+emem_stats_enable(gboolean enable)
+{
+	emem_context_t *context = emem_current_context();
+	emem_stats_state_t *stats = context->ep.stats;
+
+	if (enable && !stats) {
+		stats = g_new0(emem_stats_state_t, 1);
+		stats->se = &context->se;
+		stats->owners = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		    NULL, g_free);
+		stats->packet_owners = g_ptr_array_new();
+		stats->owner = emem_stats_owner(stats, EMEM_STATS_NO_OWNER);
+
+		context->ep.stats = stats;
+		context->se.stats = stats;
+	} else if (!enable && stats) {
+		emem_stats_free(context);
+	}
+}
+
+gboolean
+emem_stats_enabled(void)
+{
+	return emem_current_context()->ep.stats != NULL;
+}
+
+int
+emem_stats_set_owner(int id)
+{
+	emem_stats_state_t *stats = emem_current_context()->ep.stats;
+	int previous;
+
+	if (!stats)
+		return EMEM_STATS_NO_OWNER;
+
+	previous = stats->owner->id;
+	if (id != previous)
+		stats->owner = emem_stats_owner(stats, id);
+
+	return previous;
+}
+
+static gboolean
+emem_stats_remove_owner(gpointer key _U_, gpointer value _U_, gpointer user_data _U_)
+{
+	return TRUE;
+}
+
+void
+emem_stats_reset(void)
+{
+	emem_stats_state_t *stats = emem_current_context()->ep.stats;
+	int id;
+
+	if (!stats)
+		return;
+
+	id = stats->owner->id;
+	g_ptr_array_set_size(stats->packet_owners, 0);
+	g_hash_table_foreach_remove(stats->owners, emem_stats_remove_owner, NULL);
+	stats->owner = emem_stats_owner(stats, id);
+	stats->packet_allocs = 0;
+	stats->packet_bytes = 0;
+	memset(stats->packets, 0, sizeof stats->packets);
+}
+
+typedef struct {
+	emem_stats_func func;
+	void *user_data;
+} emem_stats_foreach_t;
+
+static void
+emem_stats_foreach_owner(gpointer key _U_, gpointer value, gpointer user_data)
+{
+	emem_owner_t *owner = value;
+	emem_stats_foreach_t *foreach = user_data;
+	emem_stats_t stats;
+
+	if (owner->stats.ep_allocs == 0 && owner->stats.se_allocs == 0)
+		return;
+
+	/* Include the packet that hasn't ended yet */
+	stats = owner->stats;
+	if (owner->packet_bytes > stats.packet_max)
+		stats.packet_max = owner->packet_bytes;
+	foreach->func(owner->id, &stats, foreach->user_data);
+}
+
+void
+emem_stats_foreach(emem_stats_func func, void *user_data)
+{
+	emem_stats_state_t *stats = emem_current_context()->ep.stats;
+	emem_stats_foreach_t foreach;
+
+	if (!stats)
+		return;
+
+	foreach.func = func;
+	foreach.user_data = user_data;
+	g_hash_table_foreach(stats->owners, emem_stats_foreach_owner, &foreach);
+}
+
+guint64
+emem_stats_get_packets(guint64 packets[EMEM_STATS_PACKET_BUCKETS])
+{
+	emem_stats_state_t *stats = emem_current_context()->ep.stats;
+	guint64 total = 0;
+	int i;
+
+	if (!stats) {
+		memset(packets, 0, EMEM_STATS_PACKET_BUCKETS * sizeof(guint64));
+		return 0;
+	}
+
+	memcpy(packets, stats->packets, sizeof stats->packets);
+	if (stats->packet_allocs != 0) {
+		/* Include the packet that hasn't ended yet */
+		packets[emem_stats_bucket(stats->packet_bytes)]++;
+	}
+	for (i = 0; i < EMEM_STATS_PACKET_BUCKETS; i++)
+		total += packets[i];
+	return total;
+}
+
+/* Give all the memory of a pool back to the system */
+static void
+emem_destroy_pool(emem_header_t *mem)
+{
+	emem_chunk_t *npc;
+	emem_tree_t *tree_list;
+
+	/* Check the canaries, and free what wasn't allocated in chunks */
+	emem_free_all(mem);
+
+	while (mem->free_list) {
+		npc = mem->free_list;
+		mem->free_list = npc->next;
+
+		/* The chunk was made by emem_create_chunk_gp(); unmap its
+		 * guard pages along with it. */
+		npc->amount_free_init = EMEM_PACKET_CHUNK_SIZE;
+		emem_destroy_chunk(npc);
+	}
+
+	while (mem->trees) {
+		tree_list = mem->trees;
+		mem->trees = tree_list->next;
+		g_free(tree_list);
+	}
+}
+
+void
+emem_context_free(emem_context_t *context)
+{
+	g_assert(context != emem_context_get_current());
+
+	if (context->ep.stats)
+		emem_stats_free(context);
+	emem_destroy_pool(&context->ep);
+	emem_destroy_pool(&context->se);
+	g_free(context);
+}
+
 void
 sl_free_all(struct ws_memory_slab *mem_chunk)
 {
@@ -1313,6 +1663,407 @@ ep_stack_pop(ep_stack_t stack)
 	}
 }
 
+/*
+ * Radix trees
+ *
+ * EMEM_TREE_TYPE_RADIX trees branch on the bytes of the key, most
+ * significant first, so they are never more than four nodes deep and need
+ * no rebalancing.  Inner nodes only exist where keys differ: a node that
+ * would have a single child is left out, and the node below it records
+ * which byte it branches on and the bytes above that all its keys share.
+ * Inner nodes start with room for 4 children and grow to 16 and then
+ * 256; the smaller ones keep their key bytes sorted in an array of their
+ * own, so a search looks at one or two cache lines per node.  The keys
+ * and data are kept in leaves.
+ *
+ * A node that grows is replaced; the memory of the old one is only given
+ * back when the tree's memory is, except for pe trees.
+ */
+typedef struct _emem_radix_t emem_radix_t;
+
+#define EMEM_RADIX_LEAF		0
+#define EMEM_RADIX_NODE4	1
+#define EMEM_RADIX_NODE16	2
+#define EMEM_RADIX_NODE256	3
+
+struct _emem_radix_t {
+	guint8 type;
+};
+
+typedef struct _emem_radix_leaf_t {
+	guint8 type;
+	guint8 is_subtree;
+	guint32 key32;
+	void *data;
+} emem_radix_leaf_t;
+
+typedef struct _emem_radix_inner_t {
+	guint8 type;
+	guint8 depth;		/* byte of the key this node branches on, 0-3 */
+	guint16 count;		/* number of children */
+	guint32 prefix;		/* bytes of the keys above depth */
+} emem_radix_inner_t;
+
+typedef struct _emem_radix_node4_t {
+	emem_radix_inner_t inner;
+	guint8 keys[4];
+	emem_radix_t *children[4];
+} emem_radix_node4_t;
+
+typedef struct _emem_radix_node16_t {
+	emem_radix_inner_t inner;
+	guint8 keys[16];
+	emem_radix_t *children[16];
+} emem_radix_node16_t;
+
+typedef struct _emem_radix_node256_t {
+	emem_radix_inner_t inner;
+	emem_radix_t *children[256];
+} emem_radix_node256_t;
+
+/* The bits of the bytes of a key above a depth */
+#define RADIX_PREFIX(key, depth) \
+	((depth) == 0 ? 0 : (key) & (0xffffffffU << (32 - 8 * (depth))))
+/* The byte of a key at a depth */
+#define RADIX_BYTE(key, depth) \
+	((guint8) ((key) >> (24 - 8 * (depth))))
+
+/* The sorted keys and the children of a node with at most 16 children */
+static void
+emem_radix_small(emem_radix_inner_t *inner, guint8 **keys, emem_radix_t ***children)
+{
+	if (inner->type == EMEM_RADIX_NODE4) {
+		*keys = ((emem_radix_node4_t *)inner)->keys;
+		*children = ((emem_radix_node4_t *)inner)->children;
+	} else {
+		*keys = ((emem_radix_node16_t *)inner)->keys;
+		*children = ((emem_radix_node16_t *)inner)->children;
+	}
+}
+
+/* Find the slot of the child of a node for a key byte, or NULL */
+static emem_radix_t **
+emem_radix_find_child(emem_radix_inner_t *inner, guint8 byte)
+{
+	guint8 *keys;
+	emem_radix_t **children;
+	int i;
+
+	if (inner->type == EMEM_RADIX_NODE256) {
+		emem_radix_node256_t *node = (emem_radix_node256_t *)inner;
+
+		return node->children[byte] ? &node->children[byte] : NULL;
+	}
+
+	emem_radix_small(inner, &keys, &children);
+	for (i = 0; i < inner->count && keys[i] <= byte; i++) {
+		if (keys[i] == byte)
+			return &children[i];
+	}
+	return NULL;
+}
+
+/* The leaf with the largest key below a node */
+static emem_radix_leaf_t *
+emem_radix_max_leaf(emem_radix_t *node)
+{
+	guint8 *keys;
+	emem_radix_t **children;
+	int i;
+
+	while (node->type != EMEM_RADIX_LEAF) {
+		emem_radix_inner_t *inner = (emem_radix_inner_t *)node;
+
+		if (inner->type == EMEM_RADIX_NODE256) {
+			emem_radix_node256_t *node256 = (emem_radix_node256_t *)inner;
+
+			for (i = 255; node256->children[i] == NULL; i--)
+				;
+			node = node256->children[i];
+		} else {
+			emem_radix_small(inner, &keys, &children);
+			node = children[inner->count - 1];
+		}
+	}
+	return (emem_radix_leaf_t *)node;
+}
+
+static emem_radix_leaf_t *
+emem_radix_new_leaf(emem_tree_t *se_tree, guint32 key, void *data, int is_subtree)
+{
+	emem_radix_leaf_t *leaf;
+
+	leaf = se_tree->malloc(sizeof(emem_radix_leaf_t));
+	leaf->type = EMEM_RADIX_LEAF;
+	leaf->is_subtree = is_subtree;
+	leaf->key32 = key;
+	leaf->data = data;
+
+	return leaf;
+}
+
+/* Put a new node in place of *slot, which holds something whose keys begin
+ * with prefix, that branches between it and a new leaf at the first byte
+ * where the new leaf's key differs from prefix. */
+static void
+emem_radix_split(emem_tree_t *se_tree, emem_radix_t **slot, guint32 prefix,
+		 emem_radix_leaf_t *leaf)
+{
+	emem_radix_node4_t *node;
+	guint8 depth = 0;
+
+	while (RADIX_BYTE(prefix, depth) == RADIX_BYTE(leaf->key32, depth))
+		depth++;
+
+	node = se_tree->malloc(sizeof(emem_radix_node4_t));
+	node->inner.type = EMEM_RADIX_NODE4;
+	node->inner.depth = depth;
+	node->inner.count = 2;
+	node->inner.prefix = RADIX_PREFIX(leaf->key32, depth);
+	if (RADIX_BYTE(prefix, depth) < RADIX_BYTE(leaf->key32, depth)) {
+		node->keys[0] = RADIX_BYTE(prefix, depth);
+		node->children[0] = *slot;
+		node->keys[1] = RADIX_BYTE(leaf->key32, depth);
+		node->children[1] = (emem_radix_t *)leaf;
+	} else {
+		node->keys[0] = RADIX_BYTE(leaf->key32, depth);
+		node->children[0] = (emem_radix_t *)leaf;
+		node->keys[1] = RADIX_BYTE(prefix, depth);
+		node->children[1] = *slot;
+	}
+	*slot = (emem_radix_t *)node;
+}
+
+/* Replace a full node, held in *slot, with a bigger one */
+static emem_radix_inner_t *
+emem_radix_grow(emem_tree_t *se_tree, emem_radix_t **slot)
+{
+	emem_radix_inner_t *inner = (emem_radix_inner_t *)*slot;
+	emem_radix_inner_t *bigger;
+	guint8 *keys;
+	emem_radix_t **children;
+	int i;
+
+	emem_radix_small(inner, &keys, &children);
+	if (inner->type == EMEM_RADIX_NODE4) {
+		emem_radix_node16_t *node = se_tree->malloc(sizeof(emem_radix_node16_t));
+
+		memcpy(node->keys, keys, inner->count);
+		memcpy(node->children, children, inner->count * sizeof(emem_radix_t *));
+		bigger = &node->inner;
+		bigger->type = EMEM_RADIX_NODE16;
+	} else {
+		emem_radix_node256_t *node = se_tree->malloc(sizeof(emem_radix_node256_t));
+
+		memset(node->children, 0, sizeof(node->children));
+		for (i = 0; i < inner->count; i++)
+			node->children[keys[i]] = children[i];
+		bigger = &node->inner;
+		bigger->type = EMEM_RADIX_NODE256;
+	}
+	bigger->depth = inner->depth;
+	bigger->count = inner->count;
+	bigger->prefix = inner->prefix;
+
+	if (se_tree->malloc == (void *(*)(size_t)) g_malloc)
+		g_free(inner);
+	*slot = (emem_radix_t *)bigger;
+
+	return bigger;
+}
+
+/* Add a child to the node in *slot, which has none for its key byte */
+static void
+emem_radix_add_child(emem_tree_t *se_tree, emem_radix_t **slot, emem_radix_leaf_t *leaf)
+{
+	emem_radix_inner_t *inner = (emem_radix_inner_t *)*slot;
+	guint8 byte = RADIX_BYTE(leaf->key32, inner->depth);
+	guint8 *keys;
+	emem_radix_t **children;
+	int i;
+
+	if ((inner->type == EMEM_RADIX_NODE4 && inner->count == 4) ||
+	    (inner->type == EMEM_RADIX_NODE16 && inner->count == 16))
+		inner = emem_radix_grow(se_tree, slot);
+
+	inner->count++;
+	if (inner->type == EMEM_RADIX_NODE256) {
+		((emem_radix_node256_t *)inner)->children[byte] = (emem_radix_t *)leaf;
+		return;
+	}
+
+	/* Keep the keys in order */
+	emem_radix_small(inner, &keys, &children);
+	for (i = inner->count - 1; i > 0 && keys[i - 1] > byte; i--) {
+		keys[i] = keys[i - 1];
+		children[i] = children[i - 1];
+	}
+	keys[i] = byte;
+	children[i] = (emem_radix_t *)leaf;
+}
+
+/* Find the leaf of a key, adding one made by func(ud) if there is none */
+static emem_radix_leaf_t *
+emem_radix_lookup_or_insert(emem_tree_t *se_tree, guint32 key,
+			    void *(*func)(void *), void *ud, int is_subtree)
+{
+	emem_radix_t **slot = &se_tree->radix;
+	emem_radix_t **child;
+	emem_radix_inner_t *inner;
+	emem_radix_leaf_t *leaf;
+
+	while (*slot) {
+		if ((*slot)->type == EMEM_RADIX_LEAF) {
+			leaf = (emem_radix_leaf_t *)*slot;
+			if (leaf->key32 == key)
+				return leaf;
+
+			leaf = emem_radix_new_leaf(se_tree, key, func(ud), is_subtree);
+			emem_radix_split(se_tree, slot, ((emem_radix_leaf_t *)*slot)->key32, leaf);
+			return leaf;
+		}
+
+		inner = (emem_radix_inner_t *)*slot;
+		if (RADIX_PREFIX(key, inner->depth) != inner->prefix) {
+			/* The key parts company with the keys below
+			 * this node above the byte it branches on */
+			leaf = emem_radix_new_leaf(se_tree, key, func(ud), is_subtree);
+			emem_radix_split(se_tree, slot, inner->prefix, leaf);
+			return leaf;
+		}
+
+		child = emem_radix_find_child(inner, RADIX_BYTE(key, inner->depth));
+		if (!child) {
+			leaf = emem_radix_new_leaf(se_tree, key, func(ud), is_subtree);
+			emem_radix_add_child(se_tree, slot, leaf);
+			return leaf;
+		}
+		slot = child;
+	}
+
+	leaf = emem_radix_new_leaf(se_tree, key, func(ud), is_subtree);
+	*slot = (emem_radix_t *)leaf;
+	return leaf;
+}
+
+static void *
+emem_radix_lookup(emem_tree_t *se_tree, guint32 key)
+{
+	emem_radix_t *node = se_tree->radix;
+	emem_radix_t **child;
+	emem_radix_leaf_t *leaf;
+
+	/* The bytes skipped by each node are only checked at the leaf */
+	while (node && node->type != EMEM_RADIX_LEAF) {
+		emem_radix_inner_t *inner = (emem_radix_inner_t *)node;
+
+		child = emem_radix_find_child(inner, RADIX_BYTE(key, inner->depth));
+		node = child ? *child : NULL;
+	}
+
+	leaf = (emem_radix_leaf_t *)node;
+	return (leaf && leaf->key32 == key) ? leaf->data : NULL;
+}
+
+/* The leaf below a node with the largest key less than or equal to key */
+static emem_radix_leaf_t *
+emem_radix_lookup_le(emem_radix_t *node, guint32 key)
+{
+	emem_radix_inner_t *inner;
+	emem_radix_leaf_t *leaf;
+	emem_radix_t **child;
+	guint8 byte;
+	guint8 *keys;
+	emem_radix_t **children;
+	int i;
+
+	if (!node)
+		return NULL;
+
+	if (node->type == EMEM_RADIX_LEAF) {
+		leaf = (emem_radix_leaf_t *)node;
+		return leaf->key32 <= key ? leaf : NULL;
+	}
+
+	inner = (emem_radix_inner_t *)node;
+	if (RADIX_PREFIX(key, inner->depth) != inner->prefix) {
+		/* All the keys below this node are either smaller or
+		 * larger than the key */
+		if (inner->prefix < RADIX_PREFIX(key, inner->depth))
+			return emem_radix_max_leaf(node);
+		return NULL;
+	}
+
+	byte = RADIX_BYTE(key, inner->depth);
+	child = emem_radix_find_child(inner, byte);
+	if (child) {
+		leaf = emem_radix_lookup_le(*child, key);
+		if (leaf)
+			return leaf;
+	}
+
+	/* Nothing small enough below the key's own byte; take the
+	 * largest key below the next smaller byte */
+	if (inner->type == EMEM_RADIX_NODE256) {
+		emem_radix_node256_t *node256 = (emem_radix_node256_t *)inner;
+
+		for (i = byte - 1; i >= 0; i--) {
+			if (node256->children[i])
+				return emem_radix_max_leaf(node256->children[i]);
+		}
+		return NULL;
+	}
+
+	emem_radix_small(inner, &keys, &children);
+	for (i = inner->count - 1; i >= 0; i--) {
+		if (keys[i] < byte)
+			return emem_radix_max_leaf(children[i]);
+	}
+	return NULL;
+}
+
+static gboolean
+emem_radix_foreach(emem_radix_t *node, tree_foreach_func callback, void *user_data)
+{
+	emem_radix_inner_t *inner;
+	emem_radix_leaf_t *leaf;
+	guint8 *keys;
+	emem_radix_t **children;
+	int i;
+
+	if (node->type == EMEM_RADIX_LEAF) {
+		leaf = (emem_radix_leaf_t *)node;
+		if (leaf->is_subtree == EMEM_TREE_NODE_IS_SUBTREE)
+			return emem_tree_foreach(leaf->data, callback, user_data);
+		return callback(leaf->data, user_data);
+	}
+
+	inner = (emem_radix_inner_t *)node;
+	if (inner->type == EMEM_RADIX_NODE256) {
+		emem_radix_node256_t *node256 = (emem_radix_node256_t *)inner;
+
+		for (i = 0; i < 256; i++) {
+			if (node256->children[i] &&
+			    emem_radix_foreach(node256->children[i], callback, user_data))
+				return TRUE;
+		}
+		return FALSE;
+	}
+
+	emem_radix_small(inner, &keys, &children);
+	for (i = 0; i < inner->count; i++) {
+		if (emem_radix_foreach(children[i], callback, user_data))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void *
+emem_radix_return_data(void *data)
+{
+	return data;
+}
+
 emem_tree_t *
 se_tree_create(int type, const char *name)
 {
@@ -1322,6 +2073,7 @@ se_tree_create(int type, const char *name)
 	tree_list->next=se_packet_mem.trees;
 	tree_list->type=type;
 	tree_list->tree=NULL;
+	tree_list->radix=NULL;
 	tree_list->name=name;
 	tree_list->malloc=se_alloc;
 	se_packet_mem.trees=tree_list;
@@ -1334,6 +2086,10 @@ emem_tree_lookup32(emem_tree_t *se_tree, guint32 key)
 {
 	emem_tree_node_t *node;
 
+	if(se_tree->type==EMEM_TREE_TYPE_RADIX){
+		return emem_radix_lookup(se_tree, key);
+	}
+
 	node=se_tree->tree;
 
 	while(node){
@@ -1357,6 +2113,13 @@ emem_tree_lookup32_le(emem_tree_t *se_tree, guint32 key)
 {
 	emem_tree_node_t *node;
 
+	if(se_tree->type==EMEM_TREE_TYPE_RADIX){
+		emem_radix_leaf_t *leaf;
+
+		leaf=emem_radix_lookup_le(se_tree->radix, key);
+		return leaf ? leaf->data : NULL;
+	}
+
 	node=se_tree->tree;
 
 	if(!node){
@@ -1618,6 +2381,14 @@ emem_tree_insert32(emem_tree_t *se_tree, guint32 key, void *data)
 {
 	emem_tree_node_t *node;
 
+	if(se_tree->type==EMEM_TREE_TYPE_RADIX){
+		emem_radix_leaf_t *leaf;
+
+		leaf=emem_radix_lookup_or_insert(se_tree, key, emem_radix_return_data, data, EMEM_TREE_NODE_IS_DATA);
+		leaf->data=data;
+		return;
+	}
+
 	node=se_tree->tree;
 
 	/* is this the first node ?*/
@@ -1699,6 +2470,10 @@ lookup_or_insert32(emem_tree_t *se_tree, guint32 key, void*(*func)(void*),void*
 {
 	emem_tree_node_t *node;
 
+	if(se_tree->type==EMEM_TREE_TYPE_RADIX){
+		return emem_radix_lookup_or_insert(se_tree, key, func, ud, is_subtree)->data;
+	}
+
 	node=se_tree->tree;
 
 	/* is this the first node ?*/
@@ -1788,6 +2563,7 @@ se_tree_create_non_persistent(int type, const char *name)
 	tree_list->next=NULL;
 	tree_list->type=type;
 	tree_list->tree=NULL;
+	tree_list->radix=NULL;
 	tree_list->name=name;
 	tree_list->malloc=se_alloc;
 
@@ -1805,6 +2581,7 @@ pe_tree_create(int type, const char *name)
 	tree_list->next=NULL;
 	tree_list->type=type;
 	tree_list->tree=NULL;
+	tree_list->radix=NULL;
 	tree_list->name=name;
 	tree_list->malloc=(void *(*)(size_t)) g_malloc;
 
@@ -1823,6 +2600,7 @@ emem_tree_create_subtree(emem_tree_t *parent_tree, const char *name)
 	tree_list->next=NULL;
 	tree_list->type=parent_tree->type;
 	tree_list->tree=NULL;
+	tree_list->radix=NULL;
 	tree_list->name=name;
 	tree_list->malloc=parent_tree->malloc;
 
@@ -2072,6 +2850,12 @@ emem_tree_foreach(emem_tree_t* emem_tree, tree_foreach_func callback, void *user
 	if (!emem_tree)
 		return FALSE;
 
+	if(emem_tree->type==EMEM_TREE_TYPE_RADIX){
+		if(!emem_tree->radix)
+			return FALSE;
+		return emem_radix_foreach(emem_tree->radix, callback, user_data);
+	}
+
 	if(!emem_tree->tree)
 		return FALSE;
 
@@ -36,6 +36,86 @@
  */
 void emem_init(void);
 
+/** A context is a pair of the pools described below: one with a packet
+ *  lifetime scope, for the ep_ functions, and one with a capture lifetime
+ *  scope, for the se_ functions.  Each thread allocates from its current
+ *  context, so threads with contexts of their own can dissect packets at
+ *  the same time; threads that haven't been given one share the default
+ *  context that emem_init() sets up.  ep_free_all() and se_free_all()
+ *  only release the memory of the calling thread's context.
+ *
+ *  A context must be current in only one thread at a time.  An se_tree
+ *  belongs to the context that was current when it was created, and
+ *  must only be used while that context is current.
+ */
+typedef struct _emem_context_t emem_context_t;
+
+/** Create a context; emem_init() must have been called first. */
+emem_context_t *emem_context_new(void);
+
+/** Make a context the calling thread's current context; NULL makes it
+ *  use the default context again.  Returns the context that was current,
+ *  or NULL if it was the default one.
+ */
+emem_context_t *emem_context_set_current(emem_context_t *context);
+
+/** Get the calling thread's current context, or NULL if it is the default
+ *  one.
+ */
+emem_context_t *emem_context_get_current(void);
+
+/** Release all the memory of a context, including its se_trees, and the
+ *  context itself.  It must not be current in any thread.
+ */
+void emem_context_free(emem_context_t *context);
+
+/** Allocation accounting.  Once it has been turned on for a context, every
+ *  ep_ and se_ allocation made in it is charged to the "owner" set with
+ *  emem_stats_set_owner(); the dissector code makes that the protocol
+ *  being dissected, and EMEM_STATS_NO_OWNER outside dissectors.  Each
+ *  ep_free_all() ends a packet, for the maximum and histogram of what
+ *  was allocated in one packet.  All these functions apply to the calling
+ *  thread's current context.
+ */
+typedef struct _emem_stats_t {
+	guint64 ep_allocs;	/**< number of ep_ allocations */
+	guint64 ep_bytes;	/**< bytes asked for in them */
+	guint64 se_allocs;	/**< number of se_ allocations */
+	guint64 se_bytes;	/**< bytes asked for in them */
+	guint64 packet_max;	/**< most bytes allocated in one packet */
+} emem_stats_t;
+
+#define EMEM_STATS_NO_OWNER		-1
+#define EMEM_STATS_PACKET_BUCKETS	32
+
+/** Turn accounting on, starting from zero, or off. */
+void emem_stats_enable(gboolean enable);
+
+/** Is accounting turned on? */
+gboolean emem_stats_enabled(void);
+
+/** Charge allocations to an owner from now on; returns the previous one,
+ *  so that it can be restored.  Does nothing unless accounting is on.
+ */
+int emem_stats_set_owner(int id);
+
+/** Forget what has been counted so far. */
+void emem_stats_reset(void);
+
+/** Call a function with what has been counted for each owner, in no
+ *  particular order.
+ */
+typedef void (*emem_stats_func)(int id, const emem_stats_t *stats, void *user_data);
+void emem_stats_foreach(emem_stats_func func, void *user_data);
+
+/** Fill in the histogram of bytes allocated per packet: packets[0] is
+ *  the number of packets that allocated at most 1 byte, and packets[i]
+ *  the number that allocated more than 2^(i-1) and at most 2^i bytes;
+ *  the last bucket also has the packets that allocated more than that.
+ *  Returns the number of packets.
+ */
+guint64 emem_stats_get_packets(guint64 packets[EMEM_STATS_PACKET_BUCKETS]);
+
 /* Functions for handling memory allocation and garbage collection with
  * a packet lifetime scope.
  * These functions are used to allocate memory that will only remain persistent
@@ -205,18 +285,24 @@ typedef struct _emem_tree_node_t {
 	void *data;
 } emem_tree_node_t;
 
-/** Right now we only do basic red/black trees   but in the future we might want
- * to try something different, such as a tree where each node keeps track
- * of how many times it has been looked up, and letting often looked up
- * nodes bubble upwards in the tree using rotate_right/left.
+/** Basic red/black trees, or radix trees that branch on the bytes of the
+ * key.  Radix trees take less memory for each key and fewer cache misses to
+ * search, which suits large trees of frame or sequence numbers; they have
+ * the same API, including the _le lookups.
+ * In the future we might want to try something different again, such as
+ * a tree where each node keeps track of how many times it has been looked
+ * up, and letting often looked up nodes bubble upwards in the tree using
+ * rotate_right/left.
  * That would probably be good for things like nfs filehandles
  */
 #define EMEM_TREE_TYPE_RED_BLACK	1
+#define EMEM_TREE_TYPE_RADIX		2
 typedef struct _emem_tree_t {
 	struct _emem_tree_t *next;
 	int type;
 	const char *name;    /**< just a string to make debugging easier */
 	emem_tree_node_t *tree;
+	struct _emem_radix_t *radix;	/**< root of an EMEM_TREE_TYPE_RADIX tree */
 	void *(*malloc)(size_t);
 } emem_tree_t;
 
@@ -227,7 +313,8 @@ typedef struct _emem_tree_t {
  * When the SE heap is released back to the system the pointer to the
  * tree is automatically reset to NULL.
  *
- * type is : EMEM_TREE_TYPE_RED_BLACK for a standard red/black tree.
+ * type is : EMEM_TREE_TYPE_RED_BLACK for a standard red/black tree, or
+ *           EMEM_TREE_TYPE_RADIX for a radix tree.
  */
 emem_tree_t *se_tree_create(int type, const char *name) G_GNUC_MALLOC;
 
@@ -0,0 +1,284 @@
+/* Standalone program to check the radix emem trees against the red/black
+ * ones, and to compare how fast they are.
+ *
+ * emem_tree_test : emem_tree_test.o emem.o except.o
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include "emem.h"
+
+#define NUM_KEYS	1000000
+#define NUM_LOOKUPS	4000000
+
+static gboolean failed = FALSE;
+
+/* The keys, and the keys to look up; some of the latter aren't in the tree */
+static guint32 keys[NUM_KEYS];
+static guint32 probes[NUM_LOOKUPS];
+
+/* Data pointers that say which key they were stored under */
+#define KEY_DATA(i)	GUINT_TO_POINTER((i) + 1)
+
+static void
+make_keys(const char *pattern, GRand *rand)
+{
+	guint32 i;
+
+	for (i = 0; i < NUM_KEYS; i++) {
+		if (pattern[0] == 'f') {
+			/* Frame numbers */
+			keys[i] = i + 1;
+		} else {
+			/* Sequence numbers, all over the place */
+			keys[i] = g_rand_int(rand);
+		}
+	}
+	for (i = 0; i < NUM_LOOKUPS; i++) {
+		if (i % 4 == 3)
+			probes[i] = g_rand_int(rand);
+		else
+			probes[i] = keys[g_rand_int_range(rand, 0, NUM_KEYS)];
+	}
+}
+
+static gdouble
+time_inserts(emem_tree_t *tree)
+{
+	GTimer *timer = g_timer_new();
+	guint32 i;
+	gdouble elapsed;
+
+	for (i = 0; i < NUM_KEYS; i++)
+		se_tree_insert32(tree, keys[i], KEY_DATA(i));
+
+	elapsed = g_timer_elapsed(timer, NULL);
+	g_timer_destroy(timer);
+	return elapsed;
+}
+
+static gdouble
+time_lookups(emem_tree_t *tree, void *(*lookup)(emem_tree_t *, guint32))
+{
+	GTimer *timer = g_timer_new();
+	guint32 i;
+	gulong found = 0;
+	gdouble elapsed;
+
+	for (i = 0; i < NUM_LOOKUPS; i++) {
+		if (lookup(tree, probes[i]))
+			found++;
+	}
+
+	elapsed = g_timer_elapsed(timer, NULL);
+	g_timer_destroy(timer);
+	/* Keep the compiler from dropping the loop */
+	if (found > NUM_LOOKUPS)
+		printf("?\n");
+	return elapsed;
+}
+
+static void
+check_lookups(emem_tree_t *rb_tree, emem_tree_t *radix_tree)
+{
+	guint32 i;
+
+	for (i = 0; i < NUM_LOOKUPS; i++) {
+		if (se_tree_lookup32(rb_tree, probes[i]) !=
+		    se_tree_lookup32(radix_tree, probes[i])) {
+			printf("Failed: lookup32 of %u\n", probes[i]);
+			failed = TRUE;
+			return;
+		}
+		if (se_tree_lookup32_le(rb_tree, probes[i]) !=
+		    se_tree_lookup32_le(radix_tree, probes[i])) {
+			printf("Failed: lookup32_le of %u\n", probes[i]);
+			failed = TRUE;
+			return;
+		}
+	}
+}
+
+typedef struct {
+	GPtrArray *data;
+} collect_t;
+
+static gboolean
+collect(void *value, void *userdata)
+{
+	collect_t *collected = userdata;
+
+	g_ptr_array_add(collected->data, value);
+	return FALSE;
+}
+
+static void
+check_foreach(emem_tree_t *rb_tree, emem_tree_t *radix_tree)
+{
+	collect_t rb, radix;
+	guint i;
+
+	rb.data = g_ptr_array_new();
+	radix.data = g_ptr_array_new();
+	se_tree_foreach(rb_tree, collect, &rb);
+	se_tree_foreach(radix_tree, collect, &radix);
+
+	if (rb.data->len != radix.data->len) {
+		printf("Failed: foreach found %u and %u values\n",
+		       rb.data->len, radix.data->len);
+		failed = TRUE;
+	} else {
+		for (i = 0; i < rb.data->len; i++) {
+			if (g_ptr_array_index(rb.data, i) != g_ptr_array_index(radix.data, i)) {
+				printf("Failed: foreach order differs at %u\n", i);
+				failed = TRUE;
+				break;
+			}
+		}
+	}
+
+	g_ptr_array_free(rb.data, TRUE);
+	g_ptr_array_free(radix.data, TRUE);
+}
+
+/* The ..._array functions consume the key they are given, so it has to be
+ * set up again for each call */
+static emem_tree_key_t *
+array_key(emem_tree_key_t *key, guint32 *conv, guint32 *seq)
+{
+	key[0].length = 1;
+	key[0].key = conv;
+	key[1].length = 2;
+	key[1].key = seq;
+	key[2].length = 0;
+	key[2].key = NULL;
+	return key;
+}
+
+static void
+check_arrays(GRand *rand)
+{
+	emem_tree_t *rb_tree = se_tree_create(EMEM_TREE_TYPE_RED_BLACK, "rb array");
+	emem_tree_t *radix_tree = se_tree_create(EMEM_TREE_TYPE_RADIX, "radix array");
+	emem_tree_key_t key[3];
+	guint32 conv, seq[2];
+	guint32 i, n;
+
+	for (i = 0; i < 100000; i++) {
+		keys[i] = g_rand_int_range(rand, 0, 50);
+		probes[i] = g_rand_int_range(rand, 0, 1000);
+		conv = keys[i];
+		seq[0] = probes[i];
+		seq[1] = g_rand_int(rand);
+		se_tree_insert32_array(rb_tree, array_key(key, &conv, seq), KEY_DATA(i));
+		se_tree_insert32_array(radix_tree, array_key(key, &conv, seq), KEY_DATA(i));
+	}
+	/* Only look for the last part of the key; when an earlier part
+	 * isn't there the ..._le lookup hands back a subtree, and those
+	 * differ between the two trees. */
+	for (i = 0; i < 100000; i++) {
+		void *rb_data, *radix_data;
+
+		n = g_rand_int_range(rand, 0, 100000);
+		conv = keys[n];
+		seq[0] = probes[n];
+		seq[1] = g_rand_int(rand);
+		rb_data = se_tree_lookup32_array_le(rb_tree, array_key(key, &conv, seq));
+		radix_data = se_tree_lookup32_array_le(radix_tree, array_key(key, &conv, seq));
+		if (rb_data != radix_data) {
+			printf("Failed: lookup32_array_le\n");
+			failed = TRUE;
+			break;
+		}
+	}
+	check_foreach(rb_tree, radix_tree);
+
+	se_tree_insert_string(rb_tree, "Hello", KEY_DATA(1), 0);
+	se_tree_insert_string(radix_tree, "Hello", KEY_DATA(1), 0);
+	if (se_tree_lookup_string(radix_tree, "Hello", 0) != KEY_DATA(1) ||
+	    se_tree_lookup_string(radix_tree, "Hell", 0) !=
+	    se_tree_lookup_string(rb_tree, "Hell", 0)) {
+		printf("Failed: string keys\n");
+		failed = TRUE;
+	}
+}
+
+static void
+time_tree(const char *name, emem_tree_t *tree)
+{
+	gdouble insert, lookup, lookup_le;
+
+	/* One at a time, so that the lookups are done after the inserts */
+	insert = time_inserts(tree);
+	lookup = time_lookups(tree, emem_tree_lookup32);
+	lookup_le = time_lookups(tree, emem_tree_lookup32_le);
+
+	printf("%-18s insert %7.3fs  lookup32 %7.3fs  lookup32_le %7.3fs\n",
+	       name, insert, lookup, lookup_le);
+}
+
+static void
+run(const char *pattern, GRand *rand)
+{
+	emem_tree_t *rb_tree = se_tree_create(EMEM_TREE_TYPE_RED_BLACK, "rb");
+	emem_tree_t *radix_tree = se_tree_create(EMEM_TREE_TYPE_RADIX, "radix");
+
+	make_keys(pattern, rand);
+
+	time_tree("red/black", rb_tree);
+	time_tree("radix", radix_tree);
+
+	check_lookups(rb_tree, radix_tree);
+	check_foreach(rb_tree, radix_tree);
+
+	se_free_all();
+}
+
+int
+main(void)
+{
+	GRand *rand = g_rand_new_with_seed(20111019);
+
+	emem_init();
+
+	printf("%u frame numbers, %u lookups:\n", NUM_KEYS, NUM_LOOKUPS);
+	run("frames", rand);
+	printf("%u random sequence numbers, %u lookups:\n", NUM_KEYS, NUM_LOOKUPS);
+	run("sequence numbers", rand);
+	check_arrays(rand);
+
+	g_rand_free(rand);
+
+	if (failed)
+		exit(1);
+
+	printf("The radix trees agree with the red/black ones.\n");
+	exit(0);
+}
@@ -191,6 +191,13 @@ epan_dissect_fake_protocols(epan_dissect_t *edt, const gboolean fake_protocols)
 		proto_tree_set_fake_protocols(edt->tree, fake_protocols);
 }
 
+void
+epan_dissect_fields_only(epan_dissect_t *edt, const gboolean fields_only)
+{
+	if (edt && edt->tree)
+		proto_tree_set_fields_only(edt->tree, fields_only);
+}
+
 void
 epan_dissect_run(epan_dissect_t *edt, void* pseudo_header,
         const guint8* data, frame_data *fd, column_info *cinfo)
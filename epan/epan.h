@@ -101,6 +101,11 @@ epan_dissect_new(const gboolean create_proto_tree, const gboolean proto_tree_vis
 void
 epan_dissect_fake_protocols(epan_dissect_t *edt, const gboolean fake_protocols);
 
+/** Indicate whether only the primed fields are wanted from the dissection,
+ so that item text and skippable protocols can be left out */
+void
+epan_dissect_fields_only(epan_dissect_t *edt, const gboolean fields_only);
+
 /** run a single packet dissection */
 void
 epan_dissect_run(epan_dissect_t *edt, void* pseudo_header,
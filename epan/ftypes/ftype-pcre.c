@@ -39,6 +39,15 @@
 
 #include <pcre.h>
 
+/* Have the RE compiled to machine code, where this libpcre (8.20 and
+ * later, built with JIT support) can; pcre_exec() then uses it by itself.
+ * A libpcre that can't do it leaves the RE interpreted. */
+#ifdef PCRE_STUDY_JIT_COMPILE
+#define STUDY_OPTIONS	PCRE_STUDY_JIT_COMPILE
+#else
+#define STUDY_OPTIONS	0
+#endif
+
 /* Create a pcre_tuple_t object based on the given string pattern */ 
 static pcre_tuple_t *
 pcre_tuple_new(const char *value)
@@ -67,7 +76,7 @@ pcre_tuple_new(const char *value)
 		tuple->error = NULL;
 	}
 	/* Study the RE */
-	tuple->ex = pcre_study(tuple->re, 0, &pcre_error_text);
+	tuple->ex = pcre_study(tuple->re, STUDY_OPTIONS, &pcre_error_text);
 	if (pcre_error_text) {
 		if (tuple->error) {
 			tuple->error = g_strdup_printf("In regular expression \"%s\":\n"
@@ -88,7 +97,13 @@ pcre_tuple_free(pcre_tuple_t *tuple)
 	if (tuple) {
 		g_free(tuple->string);
 		g_free(tuple->re);
+#ifdef PCRE_STUDY_JIT_COMPILE
+		/* Also frees the machine code */
+		if (tuple->ex)
+			pcre_free_study(tuple->ex);
+#else
 		g_free(tuple->ex);
+#endif
 		g_free(tuple->error);
 		g_free(tuple);
 	}
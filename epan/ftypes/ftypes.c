@@ -24,9 +24,13 @@
 #include "config.h"
 #endif
 
+#include <string.h>
+
 #include <ftypes-int.h>
 #include <glib.h>
 #include "../slab.h"
+#include <epan/exceptions.h>
+#include <epan/strutil.h>
 
 #include "ftypes.h"
 
@@ -560,3 +564,134 @@ fvalue_matches(fvalue_t *a, fvalue_t *b)
 	g_assert(a->ftype->cmp_matches);
 	return a->ftype->cmp_matches(a, b);
 }
+
+/* How the "contains" of a type gets at the bytes of its values */
+typedef enum {
+	SEARCH_NONE,
+	SEARCH_BYTES,		/* GByteArray */
+	SEARCH_STRING,		/* NUL-terminated string */
+	SEARCH_TVB		/* the captured data of a tvbuff */
+} search_kind_t;
+
+struct _fvalue_search_t {
+	fvalue_t		*needle;
+	search_kind_t		kind;
+	epan_memmem_pattern_t	*pattern;
+};
+
+static search_kind_t
+search_kind(fvalue_t *fv)
+{
+	switch (fv->ftype->ftype) {
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_ETHER:
+		case FT_IPv6:
+		case FT_OID:
+			return SEARCH_BYTES;
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_EBCDIC:
+		case FT_UINT_STRING:
+			return SEARCH_STRING;
+		case FT_PROTOCOL:
+			return SEARCH_TVB;
+		default:
+			return SEARCH_NONE;
+	}
+}
+
+fvalue_search_t*
+fvalue_search_new(fvalue_t *needle)
+{
+	fvalue_search_t		*search;
+	search_kind_t		kind;
+	const guint8		*data = NULL;
+	guint			len = 0;
+	volatile gboolean	ok = TRUE;
+
+	kind = search_kind(needle);
+	switch (kind) {
+		case SEARCH_BYTES:
+			data = needle->value.bytes->data;
+			len = needle->value.bytes->len;
+			break;
+		case SEARCH_STRING:
+			data = (const guint8 *)needle->value.string;
+			len = (guint)strlen(needle->value.string);
+			break;
+		case SEARCH_TVB:
+			TRY {
+				len = tvb_length(needle->value.tvb);
+				if (len > 0)
+					data = tvb_get_ptr(needle->value.tvb, 0, len);
+			}
+			CATCH_ALL {
+				ok = FALSE;
+			}
+			ENDTRY;
+			break;
+		default:
+			ok = FALSE;
+			break;
+	}
+	if (!ok) {
+		return NULL;
+	}
+
+	search = g_malloc(sizeof (fvalue_search_t));
+	search->needle = needle;
+	search->kind = kind;
+	search->pattern = epan_memmem_pattern_new(data, len);
+	return search;
+}
+
+gboolean
+fvalue_search(fvalue_t *haystack, fvalue_search_t *search)
+{
+	volatile gboolean	found = FALSE;
+	const guint8		*data;
+	guint			len;
+
+	/* A value of another type may see the needle differently */
+	if (search_kind(haystack) != search->kind) {
+		return fvalue_contains(haystack, search->needle);
+	}
+
+	switch (search->kind) {
+		case SEARCH_BYTES:
+			found = epan_memmem_find(search->pattern,
+				haystack->value.bytes->data,
+				haystack->value.bytes->len) != NULL;
+			break;
+		case SEARCH_STRING:
+			found = epan_memmem_find(search->pattern,
+				(const guint8 *)haystack->value.string,
+				(guint)strlen(haystack->value.string)) != NULL;
+			break;
+		case SEARCH_TVB:
+			TRY {
+				len = tvb_length(haystack->value.tvb);
+				if (len > 0) {
+					data = tvb_get_ptr(haystack->value.tvb, 0, len);
+					found = epan_memmem_find(search->pattern,
+						data, len) != NULL;
+				}
+			}
+			CATCH_ALL {
+				/* nothing */
+			}
+			ENDTRY;
+			break;
+		default:
+			g_assert_not_reached();
+	}
+	return found;
+}
+
+void
+fvalue_search_free(fvalue_search_t *search)
+{
+	epan_memmem_pattern_free(search->pattern);
+	g_free(search);
+}
@@ -368,6 +368,23 @@ fvalue_contains(fvalue_t *a, fvalue_t *b);
 gboolean
 fvalue_matches(fvalue_t *a, fvalue_t *b);
 
+/* The value on the right of a "contains" test, prepared once for being
+ * searched for in many values. */
+typedef struct _fvalue_search_t fvalue_search_t;
+
+/* Returns NULL if values of the needle's type aren't searched for as
+ * strings of bytes; fvalue_contains() is then the way. The needle must
+ * outlive the search. */
+fvalue_search_t*
+fvalue_search_new(fvalue_t *needle);
+
+/* Same result as fvalue_contains(haystack, needle) */
+gboolean
+fvalue_search(fvalue_t *haystack, fvalue_search_t *search);
+
+void
+fvalue_search_free(fvalue_search_t *search);
+
 guint
 fvalue_length(fvalue_t *fv);
 
@@ -416,19 +416,11 @@ struct dissector_handle {
  * and if the dissector rejected the packet.
  */
 static int
-call_dissector_through_handle(dissector_handle_t handle, tvbuff_t *tvb,
-			      packet_info *pinfo, proto_tree *tree)
+call_dissector_through_handle_work(dissector_handle_t handle, tvbuff_t *tvb,
+				   packet_info *pinfo, proto_tree *tree)
 {
-	const char *saved_proto;
 	int ret;
 
-	saved_proto = pinfo->current_proto;
-
-	if (handle->protocol != NULL) {
-		pinfo->current_proto =
-			proto_get_protocol_short_name(handle->protocol);
-	}
-
 	if (handle->is_new) {
 		EP_CHECK_CANARY(("before calling handle->dissector.new for %s",handle->name));
 		ret = (*handle->dissector.new)(tvb, pinfo, tree);
@@ -448,6 +440,38 @@ call_dissector_through_handle(dissector_handle_t handle, tvbuff_t *tvb,
 		}
 	}
 
+	return ret;
+}
+
+static int
+call_dissector_through_handle(dissector_handle_t handle, tvbuff_t *tvb,
+			      packet_info *pinfo, proto_tree *tree)
+{
+	const char *saved_proto;
+	int saved_owner;
+	volatile int ret = 0;
+
+	saved_proto = pinfo->current_proto;
+
+	if (handle->protocol != NULL) {
+		pinfo->current_proto =
+			proto_get_protocol_short_name(handle->protocol);
+	}
+
+	if (handle->protocol != NULL && emem_stats_enabled()) {
+		/* Charge what it allocates to it, and put the caller's
+		 * owner back even if it throws an exception */
+		saved_owner = emem_stats_set_owner(proto_get_id(handle->protocol));
+		TRY {
+			ret = call_dissector_through_handle_work(handle, tvb, pinfo, tree);
+		}
+		FINALLY {
+			emem_stats_set_owner(saved_owner);
+		}
+		ENDTRY;
+	} else
+		ret = call_dissector_through_handle_work(handle, tvb, pinfo, tree);
+
 	pinfo->current_proto = saved_proto;
 
 	return ret;
@@ -520,7 +544,18 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb,
 		}
 	}
 
-	if (pinfo->in_error_pkt) {
+	if (handle->protocol != NULL &&
+	    proto_can_skip_protocol(tree, handle->protocol)) {
+		/*
+		 * The tree is only being built for fields that
+		 * this protocol doesn't have, and its dissector
+		 * has nothing else to do; take the packet as
+		 * dissected without calling it.
+		 */
+		ret = tvb_length(tvb);
+		if (ret == 0)
+			ret = 1;
+	} else if (pinfo->in_error_pkt) {
 		ret = call_dissector_work_error(handle, tvb, pinfo, tree);
 	} else {
 		/*
@@ -1617,7 +1652,9 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors,
 			tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree)
 {
 	gboolean status;
+	volatile gboolean accepted = FALSE;
 	const char *saved_proto;
+	int saved_owner;
 	GSList *entry;
 	heur_dtbl_entry_t *dtbl_entry;
 	guint16 saved_can_desegment;
@@ -1672,7 +1709,20 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors,
 		}
 		EP_CHECK_CANARY(("before calling heuristic dissector for protocol: %s",
 				 proto_get_protocol_filter_name(proto_get_id(dtbl_entry->protocol))));
-		if ((*dtbl_entry->dissector)(tvb, pinfo, tree)) {
+		if (dtbl_entry->protocol != NULL && emem_stats_enabled()) {
+			/* Charge what it allocates to it, and put the
+			 * caller's owner back even if it throws an exception */
+			saved_owner = emem_stats_set_owner(proto_get_id(dtbl_entry->protocol));
+			TRY {
+				accepted = (*dtbl_entry->dissector)(tvb, pinfo, tree);
+			}
+			FINALLY {
+				emem_stats_set_owner(saved_owner);
+			}
+			ENDTRY;
+		} else
+			accepted = (*dtbl_entry->dissector)(tvb, pinfo, tree);
+		if (accepted) {
 			EP_CHECK_CANARY(("after heuristic dissector for protocol: %s has accepted and dissected packet",
 					 proto_get_protocol_filter_name(proto_get_id(dtbl_entry->protocol))));
 			status = TRUE;
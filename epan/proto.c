@@ -257,6 +257,7 @@ struct _protocol {
 	gboolean is_enabled;		/* TRUE if protocol is enabled */
 	gboolean can_toggle;		/* TRUE if is_enabled can be changed */
 	gboolean is_private;		/* TRUE is protocol is private */
+	gboolean is_skippable;		/* TRUE if fields-only trees can do without it */
 };
 
 /* List of all protocols */
@@ -316,14 +317,28 @@ typedef struct _gpa_hfinfo_t {
 } gpa_hfinfo_t;
 gpa_hfinfo_t gpa_hfinfo;
 
-/* Balanced tree of abbreviations and IDs */
-static GTree *gpa_name_tree = NULL;
-static header_field_info *same_name_hfinfo;
-
-static void save_same_name_hfinfo(gpointer data)
-{
-  same_name_hfinfo = (header_field_info*)data;
-}
+/* Fields a filter or a tap is interested in are given a dense slot number
+   when they are primed, so each proto_tree can keep the field_infos of
+   those fields in a plain array, indexed by slot. */
+static guint *interesting_slots = NULL;		/* by hfid: slot + 1, or 0 */
+static guint interesting_slots_len = 0;
+static GArray *interesting_slot_hfids = NULL;	/* by slot: hfid */
+
+/* The field_infos of the interesting fields of one proto_tree.  These
+   tables, and the GPtrArrays in them, are reused from tree to tree, so
+   once they've grown to fit no allocation is done per packet. */
+typedef struct _interesting_fields {
+	GPtrArray **ptrs;	/* by slot; NULL until the slot is first used */
+	guint *used;		/* slots with field_infos in this tree */
+	guint n_used;
+	guint len;		/* of ptrs and used */
+	struct _interesting_fields *next;	/* in the free list */
+} interesting_fields_t;
+
+static interesting_fields_t *interesting_fields_free_list = NULL;
+
+/* Hash table of abbreviations and IDs */
+static GHashTable *gpa_name_map = NULL;
 
 /* Points to the first element of an array of Booleans, indexed by
    a subtree item type; that array element is TRUE if subtrees of
@@ -378,7 +393,7 @@ proto_init(void (register_all_protocols_func)(register_cb cb, gpointer client_da
 	gpa_hfinfo.len=0;
 	gpa_hfinfo.allocated_len=0;
 	gpa_hfinfo.hfi=NULL;
-	gpa_name_tree = g_tree_new_full(wrs_strcmp_with_data, NULL, NULL, save_same_name_hfinfo);
+	gpa_name_map = g_hash_table_new(wrs_str_hash, g_str_equal);
 
 	/* Initialize the ftype subsystem */
 	ftypes_initialize();
@@ -440,10 +455,10 @@ proto_init(void (register_all_protocols_func)(register_cb cb, gpointer client_da
 void
 proto_cleanup(void)
 {
-	/* Free the abbrev/ID GTree */
-	if (gpa_name_tree) {
-		g_tree_destroy(gpa_name_tree);
-		gpa_name_tree = NULL;
+	/* Free the abbrev/ID hash table */
+	if (gpa_name_map) {
+		g_hash_table_destroy(gpa_name_map);
+		gpa_name_map = NULL;
 	}
 
 	while (protocols) {
@@ -486,6 +501,27 @@ proto_cleanup(void)
 	}
 #endif
 
+	while (interesting_fields_free_list) {
+		interesting_fields_t *fields = interesting_fields_free_list;
+		guint i;
+
+		interesting_fields_free_list = fields->next;
+		for (i = 0; i < fields->len; i++) {
+			if (fields->ptrs[i])
+				g_ptr_array_free(fields->ptrs[i], TRUE);
+		}
+		g_free(fields->ptrs);
+		g_free(fields->used);
+		g_free(fields);
+	}
+	g_free(interesting_slots);
+	interesting_slots = NULL;
+	interesting_slots_len = 0;
+	if (interesting_slot_hfids) {
+		g_array_free(interesting_slot_hfids, TRUE);
+		interesting_slot_hfids = NULL;
+	}
+
 	if(gpa_hfinfo.allocated_len){
 		gpa_hfinfo.len=0;
 		gpa_hfinfo.allocated_len=0;
@@ -574,10 +610,8 @@ proto_tree_free(proto_tree *tree)
 }
 
 static void
-free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
+unref_interesting_hfid(gint hfid)
 {
-	GPtrArray	*ptrs = value;
-	gint hfid = (gint)(long)key;
 	header_field_info *hfinfo;
 
 	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
@@ -593,20 +627,26 @@ free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
 		}
 		hfinfo->ref_type = HF_REF_TYPE_NONE;
 	}
-
-	g_ptr_array_free(ptrs, TRUE);
 }
 
 static void
 free_node_tree_data(tree_data_t *tree_data)
 {
-	if (tree_data->interesting_hfids) {
-		/* Free all the GPtrArray's in the interesting_hfids hash. */
-		g_hash_table_foreach(tree_data->interesting_hfids,
-			free_GPtrArray_value, NULL);
+	interesting_fields_t *fields = tree_data->interesting_fields;
 
-		/* And then destroy the hash. */
-		g_hash_table_destroy(tree_data->interesting_hfids);
+	if (fields) {
+		guint i, slot;
+
+		/* Empty the GPtrArrays that were used, and put the table
+		 * back on the free list for the next tree. */
+		for (i = 0; i < fields->n_used; i++) {
+			slot = fields->used[i];
+			unref_interesting_hfid(g_array_index(interesting_slot_hfids, gint, slot));
+			g_ptr_array_set_size(fields->ptrs[slot], 0);
+		}
+		fields->n_used = 0;
+		fields->next = interesting_fields_free_list;
+		interesting_fields_free_list = fields;
 	}
 
 	/* And finally the tree_data_t itself. */
@@ -692,6 +732,17 @@ proto_tree_set_fake_protocols(proto_tree *tree, gboolean fake_protocols)
 	PTREE_DATA(tree)->fake_protocols = fake_protocols;
 }
 
+/* Is the tree only being built for the fields that have been primed?
+ * If so, no item text is formatted, and the dissectors of protocols that
+ * have said they can be skipped aren't called when none of their fields
+ * are primed.
+ */
+void
+proto_tree_set_fields_only(proto_tree *tree, gboolean fields_only)
+{
+	PTREE_DATA(tree)->fields_only = fields_only;
+}
+
 /* Assume dissector set only its protocol fields.
    This function is called by dissectors and allows the speeding up of filtering
    in wireshark; if this function returns FALSE it is safe to reset tree to NULL
@@ -819,7 +870,7 @@ proto_registrar_get_byname(const char *field_name)
 	if (!field_name)
 		return NULL;
 
-	hfinfo = g_tree_lookup(gpa_name_tree, field_name);
+	hfinfo = g_hash_table_lookup(gpa_name_map, field_name);
 
 	if (hfinfo) return hfinfo;
 
@@ -832,7 +883,7 @@ proto_registrar_get_byname(const char *field_name)
 		return NULL;
 	}
 
-	return g_tree_lookup(gpa_name_tree, field_name);
+	return g_hash_table_lookup(gpa_name_map, field_name);
 }
 
 
@@ -1189,30 +1240,75 @@ get_int_value(tvbuff_t *tvb, gint offset, gint length, const guint encoding)
 	return value;
 }
 
+/* Returns the slot of an interesting field, giving it one if it has none */
+static guint
+proto_interesting_slot(const gint hfid)
+{
+	if ((guint)hfid >= interesting_slots_len) {
+		guint len = gpa_hfinfo.len;
+
+		interesting_slots = g_renew(guint, interesting_slots, len);
+		memset(interesting_slots + interesting_slots_len, 0,
+		       (len - interesting_slots_len) * sizeof(guint));
+		interesting_slots_len = len;
+	}
+	if (interesting_slots[hfid] == 0) {
+		if (!interesting_slot_hfids)
+			interesting_slot_hfids = g_array_new(FALSE, FALSE, sizeof(gint));
+		g_array_append_val(interesting_slot_hfids, hfid);
+		interesting_slots[hfid] = interesting_slot_hfids->len;
+	}
+	return interesting_slots[hfid] - 1;
+}
+
+/* Makes room in a table for every slot handed out so far */
+static void
+interesting_fields_grow(interesting_fields_t *fields)
+{
+	guint len = interesting_slot_hfids->len;
+
+	fields->ptrs = g_renew(GPtrArray *, fields->ptrs, len);
+	memset(fields->ptrs + fields->len, 0,
+	       (len - fields->len) * sizeof(GPtrArray *));
+	fields->used = g_renew(guint, fields->used, len);
+	fields->len = len;
+}
+
 static GPtrArray *
 proto_lookup_or_create_interesting_hfids(proto_tree *tree,
 					 header_field_info *hfinfo)
 {
+	interesting_fields_t *fields;
 	GPtrArray *ptrs = NULL;
+	guint slot;
 
 	DISSECTOR_ASSERT(tree);
 	DISSECTOR_ASSERT(hfinfo);
 
 	if (hfinfo->ref_type == HF_REF_TYPE_DIRECT) {
-		if (PTREE_DATA(tree)->interesting_hfids == NULL) {
-			/* Initialize the hash because we now know that it is needed */
-			PTREE_DATA(tree)->interesting_hfids =
-				g_hash_table_new(g_direct_hash, NULL /* g_direct_equal */);
+		slot = proto_interesting_slot(hfinfo->id);
+
+		fields = PTREE_DATA(tree)->interesting_fields;
+		if (fields == NULL) {
+			/* Take a table because we now know that it is needed */
+			fields = interesting_fields_free_list;
+			if (fields)
+				interesting_fields_free_list = fields->next;
+			else
+				fields = g_new0(interesting_fields_t, 1);
+			PTREE_DATA(tree)->interesting_fields = fields;
 		}
+		if (slot >= fields->len)
+			interesting_fields_grow(fields);
 
-		ptrs = g_hash_table_lookup(PTREE_DATA(tree)->interesting_hfids,
-					   GINT_TO_POINTER(hfinfo->id));
+		ptrs = fields->ptrs[slot];
 		if (!ptrs) {
-			/* First element triggers the creation of pointer array */
+			/* First element ever triggers the creation of pointer array */
 			ptrs = g_ptr_array_new();
-			g_hash_table_insert(PTREE_DATA(tree)->interesting_hfids,
-					    GINT_TO_POINTER(hfinfo->id), ptrs);
+			fields->ptrs[slot] = ptrs;
 		}
+		if (ptrs->len == 0)
+			fields->used[fields->n_used++] = slot;
 	}
 
 	return ptrs;
@@ -4028,6 +4124,10 @@ proto_item_set_text(proto_item *pi, const char *format, ...)
 	if (fi==NULL)
 		return;
 
+	/* Nobody is going to look at the text */
+	if (PTREE_DATA(pi)->fields_only)
+		return;
+
 	if(fi->rep){
 		ITEM_LABEL_FREE(fi->rep);
 	}
@@ -4054,6 +4154,9 @@ proto_item_append_text(proto_item *pi, const char *format, ...)
 		return;
 	}
 
+	if (PTREE_DATA(pi)->fields_only)
+		return;
+
 	if (!PROTO_ITEM_IS_HIDDEN(pi)) {
 		/*
 		 * If we don't already have a representation,
@@ -4091,6 +4194,9 @@ proto_item_prepend_text(proto_item *pi, const char *format, ...)
 		return;
 	}
 
+	if (PTREE_DATA(pi)->fields_only)
+		return;
+
 	if (!PROTO_ITEM_IS_HIDDEN(pi)) {
 		/*
 		 * If we don't already have a representation,
@@ -4201,7 +4307,7 @@ proto_tree_create_root(void)
 	pnode->tree_data = g_new(tree_data_t, 1);
 
 	/* Don't initialize the tree_data_t. Wait until we know we need it */
-	pnode->tree_data->interesting_hfids = NULL;
+	pnode->tree_data->interesting_fields = NULL;
 
 	/* Set the default to FALSE so it's easier to
 	 * find errors; if we expect to see the protocol tree
@@ -4212,6 +4318,8 @@ proto_tree_create_root(void)
 	/* Make sure that we fake protocols (if possible) */
 	pnode->tree_data->fake_protocols = TRUE;
 
+	pnode->tree_data->fields_only = FALSE;
+
 	/* Keep track of the number of children */
 	pnode->tree_data->count = 0;
 
@@ -4227,6 +4335,8 @@ proto_tree_prime_hfid(proto_tree *tree _U_, const gint hfid)
 	header_field_info *hfinfo;
 
 	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
+	/* give the field its slot now, rather than while dissecting */
+	proto_interesting_slot(hfid);
 	/* this field is referenced by a filter so increase the refcount.
 	   also increase the refcount for the parent, i.e the protocol.
 	*/
@@ -4461,6 +4571,7 @@ proto_register_protocol(const char *name, const char *short_name,
 	protocol->is_enabled = TRUE; /* protocol is enabled by default */
 	protocol->can_toggle = TRUE;
 	protocol->is_private = FALSE;
+	protocol->is_skippable = FALSE;
 	/* list will be sorted later by name, when all protocols completed registering */
 	protocols = g_list_prepend(protocols, protocol);
 
@@ -4698,6 +4809,30 @@ proto_set_cant_toggle(const int proto_id)
 	protocol->can_toggle = FALSE;
 }
 
+void
+proto_set_skippable(const int proto_id)
+{
+	protocol_t *protocol;
+
+	protocol = find_protocol_by_id(proto_id);
+	protocol->is_skippable = TRUE;
+}
+
+/* A protocol can be left out of a fields-only tree if it has said that
+ * it may be, and neither it nor any of its fields has been primed; priming
+ * a field marks its protocol as indirectly referenced. */
+gboolean
+proto_can_skip_protocol(proto_tree *tree, const protocol_t *protocol)
+{
+	header_field_info *hfinfo;
+
+	if (!tree || !PTREE_DATA(tree)->fields_only || !protocol->is_skippable)
+		return FALSE;
+
+	PROTO_REGISTRAR_GET_NTH(protocol->proto_id, hfinfo);
+	return hfinfo->ref_type == HF_REF_TYPE_NONE;
+}
+
 /* for use with static arrays only, since we don't allocate our own copies
 of the header_field_info struct contained within the hf_register_info struct */
 void
@@ -4758,7 +4893,7 @@ proto_unregister_field (const int parent, gint hf_id)
 		hf = field->data;
 		if (*hf->p_id == hf_id) {
 			/* Found the hf_id in this protocol */
-			g_tree_steal (gpa_name_tree, hf->hfinfo.abbrev);
+			g_hash_table_remove (gpa_name_map, hf->hfinfo.abbrev);
 			proto->fields = g_list_remove_link (proto->fields, field);
 			proto->last_field = g_list_last (proto->fields);
 			break;
@@ -4978,6 +5113,41 @@ static void tmp_fld_check_assert(header_field_info *hfinfo) {
 	}
 }
 
+/* Enter a field in the map of abbreviations */
+static void
+proto_name_map_insert(header_field_info *hfinfo)
+{
+	header_field_info *same_name_hfinfo, *same_name_next_hfinfo;
+
+	/* We allow multiple hfinfo's to be registered under the same
+	 * abbreviation. This was done for X.25, as, depending
+	 * on whether it's modulo-8 or modulo-128 operation,
+	 * some bitfield fields may be in different bits of
+	 * a byte, and we want to be able to refer to that field
+	 * with one name regardless of whether the packets
+	 * are modulo-8 or modulo-128 packets. */
+	same_name_hfinfo = g_hash_table_lookup(gpa_name_map, hfinfo->abbrev);
+	if (same_name_hfinfo) {
+		/* There's already a field with this name.
+		 * Put it after that field in the list of
+		 * fields with this name, then replace the old
+		 * hfinfo with the new hfinfo in the map. Thus,
+		 * we end up with a linked-list of same-named hfinfo's,
+		 * with the root of the list being the hfinfo in the map */
+		same_name_next_hfinfo =
+			same_name_hfinfo->same_name_next;
+
+		hfinfo->same_name_next = same_name_next_hfinfo;
+		if (same_name_next_hfinfo)
+			same_name_next_hfinfo->same_name_prev = hfinfo;
+
+		same_name_hfinfo->same_name_next = hfinfo;
+		hfinfo->same_name_prev = same_name_hfinfo;
+	}
+
+	g_hash_table_insert(gpa_name_map, (gpointer) (hfinfo->abbrev), hfinfo);
+}
+
 static int
 proto_register_field_init(header_field_info *hfinfo, const int parent)
 {
@@ -5007,10 +5177,8 @@ proto_register_field_init(header_field_info *hfinfo, const int parent)
 	gpa_hfinfo.len++;
 	hfinfo->id = gpa_hfinfo.len - 1;
 
-	/* if we have real names, enter this field in the name tree */
+	/* if we have real names, enter this field in the name map */
 	if ((hfinfo->name[0] != 0) && (hfinfo->abbrev[0] != 0 )) {
-
-		header_field_info *same_name_next_hfinfo;
 		guchar c;
 
 		/* Check that the filter name (abbreviation) is legal;
@@ -5021,38 +5189,7 @@ proto_register_field_init(header_field_info *hfinfo, const int parent)
 			DISSECTOR_ASSERT(!c);
 		}
 
-		/* We allow multiple hfinfo's to be registered under the same
-		 * abbreviation. This was done for X.25, as, depending
-		 * on whether it's modulo-8 or modulo-128 operation,
-		 * some bitfield fields may be in different bits of
-		 * a byte, and we want to be able to refer to that field
-		 * with one name regardless of whether the packets
-		 * are modulo-8 or modulo-128 packets. */
-
-		same_name_hfinfo = NULL;
-
-		g_tree_insert(gpa_name_tree, (gpointer) (hfinfo->abbrev), hfinfo);
-		/* GLIB 2.x - if it is already present
-		 * the previous hfinfo with the same name is saved
-		 * to same_name_hfinfo by value destroy callback */
-		if (same_name_hfinfo) {
-			/* There's already a field with this name.
-			 * Put it after that field in the list of
-			 * fields with this name, then allow the code
-			 * after this if{} block to replace the old
-			 * hfinfo with the new hfinfo in the GTree. Thus,
-			 * we end up with a linked-list of same-named hfinfo's,
-			 * with the root of the list being the hfinfo in the GTree */
-			same_name_next_hfinfo =
-				same_name_hfinfo->same_name_next;
-
-			hfinfo->same_name_next = same_name_next_hfinfo;
-			if (same_name_next_hfinfo)
-				same_name_next_hfinfo->same_name_prev = hfinfo;
-
-			same_name_hfinfo->same_name_next = hfinfo;
-			hfinfo->same_name_prev = same_name_hfinfo;
-		}
+		proto_name_map_insert(hfinfo);
 	}
 
 	return hfinfo->id;
@@ -6131,14 +6268,25 @@ proto_check_for_protocol_or_field(const proto_tree* tree, const int id)
 GPtrArray *
 proto_get_finfo_ptr_array(const proto_tree *tree, const int id)
 {
+	interesting_fields_t *fields;
+	GPtrArray *ptrs;
+	guint slot;
+
 	if (!tree)
 		return NULL;
 
-	if (PTREE_DATA(tree)->interesting_hfids != NULL)
-		return g_hash_table_lookup(PTREE_DATA(tree)->interesting_hfids,
-					   GINT_TO_POINTER(id));
-	else
+	fields = PTREE_DATA(tree)->interesting_fields;
+	if (fields == NULL || (guint)id >= interesting_slots_len ||
+	    interesting_slots[id] == 0)
 		return NULL;
+
+	slot = interesting_slots[id] - 1;
+	if (slot >= fields->len)
+		return NULL;
+	ptrs = fields->ptrs[slot];
+	if (ptrs == NULL || ptrs->len == 0)
+		return NULL;
+	return ptrs;
 }
 
 gboolean
@@ -6147,7 +6295,8 @@ proto_tracking_interesting_fields(const proto_tree *tree)
 	if (!tree)
 		return FALSE;
 
-	return (PTREE_DATA(tree)->interesting_hfids != NULL);
+	return (PTREE_DATA(tree)->interesting_fields != NULL &&
+		PTREE_DATA(tree)->interesting_fields->n_used > 0);
 }
 
 /* Helper struct for proto_find_info() and	proto_all_finfos() */
@@ -396,9 +396,10 @@ typedef struct field_info {
 /** One of these exists for the entire protocol tree. Each proto_node
  * in the protocol tree points to the same copy. */
 typedef struct {
-    GHashTable  *interesting_hfids;
+    struct _interesting_fields *interesting_fields; /**< primed fields seen, by slot */
     gboolean    visible;
     gboolean    fake_protocols;
+    gboolean    fields_only;
     gint        count;
 } tree_data_t;
 
@@ -639,7 +640,18 @@ proto_tree_set_visible(proto_tree *tree, gboolean visible);
 extern void
 proto_tree_set_fake_protocols(proto_tree *tree, gboolean fake_protocols);
 
-/** Mark a field/protocol ID as "interesting".
+/** Indicate whether the tree is only being built for its primed fields
+ (default = FALSE).  Item text is then left unformatted, and skippable
+ protocols none of whose fields are primed are not dissected at all.
+ @param tree the tree to be set
+ @param fields_only TRUE if only primed fields are wanted */
+extern void
+proto_tree_set_fields_only(proto_tree *tree, gboolean fields_only);
+
+/** Mark a field/protocol ID as "interesting", so that the field_infos
+ of that field are kept where proto_get_finfo_ptr_array() can find them
+ without searching the tree.  The field is given a slot in a table the
+ first time it's primed.
  @param tree the tree to be set
  @param hfid the interesting field id
  @todo what *does* interesting mean? */
@@ -1688,6 +1700,22 @@ extern void proto_enable_all(void);
  @param proto_id protocol id (0-indexed) */
 extern void proto_set_cant_toggle(const int proto_id);
 
+/** Say that a protocol's dissector may be skipped when a tree is built only
+ for its primed fields, and none of them belong to the protocol.  Only do
+ this for dissectors that accept every packet they are handed, call no
+ other dissectors, add no fields of other protocols, and keep no state
+ (conversations, reassembly, tables) that the dissection of other packets
+ depends on.
+ @param proto_id protocol id (0-indexed) */
+extern void proto_set_skippable(const int proto_id);
+
+/** Can the dissector of a protocol be skipped when building a tree?
+ @param tree the tree being built
+ @param protocol the protocol
+ @return TRUE if the tree is fields-only, the protocol is skippable and
+ none of its fields are primed */
+extern gboolean proto_can_skip_protocol(proto_tree *tree, const protocol_t *protocol);
+
 /** Checks for existence any protocol or field within a tree.
  @param tree "Protocols" are assumed to be a child of the [empty] root node.
  @param id hfindex of protocol or field
@@ -745,7 +745,8 @@ xml_escape(const gchar *unescaped)
 /* Return the first occurrence of needle in haystack.
  * If not found, return NULL.
  * If either haystack or needle has 0 length, return NULL.
- * Algorithm copied from GNU's glibc 2.3.2 memcmp() */
+ * The candidate positions are found with memchr(), which the C library
+ * usually does many bytes at a time, rather than byte by byte. */
 const guint8 *
 epan_memmem(const guint8 *haystack, guint haystack_len,
 		const guint8 *needle, guint needle_len)
@@ -763,9 +764,11 @@ epan_memmem(const guint8 *haystack, guint haystack_len,
 	}
 
 	for (begin = haystack ; begin <= last_possible; ++begin) {
-		if (begin[0] == needle[0] &&
-			!memcmp(&begin[1], needle + 1,
-				needle_len - 1)) {
+		begin = memchr(begin, needle[0], last_possible - begin + 1);
+		if (begin == NULL) {
+			return NULL;
+		}
+		if (!memcmp(&begin[1], needle + 1, needle_len - 1)) {
 			return begin;
 		}
 	}
@@ -773,6 +776,74 @@ epan_memmem(const guint8 *haystack, guint haystack_len,
 	return NULL;
 }
 
+struct _epan_memmem_pattern_t {
+	guint8	*needle;
+	guint	needle_len;
+	/* How far the search can move on, by the last byte it looked at */
+	guint	skip[256];
+};
+
+epan_memmem_pattern_t *
+epan_memmem_pattern_new(const guint8 *needle, guint needle_len)
+{
+	epan_memmem_pattern_t *pattern;
+	guint i;
+
+	pattern = g_malloc(sizeof (epan_memmem_pattern_t));
+	pattern->needle = g_memdup(needle, needle_len);
+	pattern->needle_len = needle_len;
+
+	for (i = 0; i < 256; i++) {
+		pattern->skip[i] = needle_len;
+	}
+	for (i = 0; i + 1 < needle_len; i++) {
+		pattern->skip[needle[i]] = needle_len - 1 - i;
+	}
+
+	return pattern;
+}
+
+/* Boyer-Moore-Horspool: compare the last byte of the window first; on a
+ * mismatch, move the window so that byte lines up with its last
+ * occurrence in the needle.  Needles of one or two bytes gain nothing
+ * from that, so they are left to epan_memmem(). */
+const guint8 *
+epan_memmem_find(const epan_memmem_pattern_t *pattern,
+		const guint8 *haystack, guint haystack_len)
+{
+	const guint8 *needle = pattern->needle;
+	const guint needle_len = pattern->needle_len;
+	const guint8 *begin, *last_possible;
+	guint8 last;
+
+	if (needle_len < 3) {
+		return epan_memmem(haystack, haystack_len, needle, needle_len);
+	}
+
+	if (needle_len > haystack_len) {
+		return NULL;
+	}
+
+	last = needle[needle_len - 1];
+	last_possible = haystack + haystack_len - needle_len;
+	for (begin = haystack; begin <= last_possible;
+	    begin += pattern->skip[begin[needle_len - 1]]) {
+		if (begin[needle_len - 1] == last &&
+		    !memcmp(begin, needle, needle_len - 1)) {
+			return begin;
+		}
+	}
+
+	return NULL;
+}
+
+void
+epan_memmem_pattern_free(epan_memmem_pattern_t *pattern)
+{
+	g_free(pattern->needle);
+	g_free(pattern);
+}
+
 /*
  * Scan the search string to make sure it's valid hex.  Return the
  * number of bytes in nbytes.
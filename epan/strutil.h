@@ -180,7 +180,8 @@ gchar*     xml_escape(const gchar *unescaped);
 
 /**
  * Return the first occurrence of needle in haystack.
- * Algorithm copied from GNU's glibc 2.3.2 memcmp()
+ * The first byte of the needle is looked for with memchr(), which the C
+ * library usually does many bytes at a time.
  *
  * @param haystack The data to search
  * @param haystack_len The length of the search data
@@ -193,6 +194,35 @@ gchar*     xml_escape(const gchar *unescaped);
 const guint8 * epan_memmem(const guint8 *haystack, guint haystack_len,
 		const guint8 *needle, guint needle_len);
 
+/** A string of bytes prepared for searching for many times */
+typedef struct _epan_memmem_pattern_t epan_memmem_pattern_t;
+
+/**
+ * Prepare a string of bytes for searching with epan_memmem_find().
+ *
+ * @param needle The string to look for; it is copied
+ * @param needle_len The length of the search string
+ * @return The prepared pattern, to be freed with epan_memmem_pattern_free()
+ */
+epan_memmem_pattern_t * epan_memmem_pattern_new(const guint8 *needle,
+		guint needle_len);
+
+/**
+ * Return the first occurrence of a prepared pattern in haystack, as
+ * epan_memmem() would, using a Boyer-Moore-Horspool search.
+ *
+ * @param pattern The prepared pattern
+ * @param haystack The data to search
+ * @param haystack_len The length of the search data
+ * @return A pointer to the first occurrence of the pattern in "haystack",
+ *         or NULL if it isn't found or if the pattern is empty.
+ */
+const guint8 * epan_memmem_find(const epan_memmem_pattern_t *pattern,
+		const guint8 *haystack, guint haystack_len);
+
+/** Free a pattern made by epan_memmem_pattern_new() */
+void epan_memmem_pattern_free(epan_memmem_pattern_t *pattern);
+
 /** Surround a string or a macro, resolved to a string, with double quotes */
 #define _STRINGIFY(a)           # a
 #define STRINGIFY(a)            _STRINGIFY(a)
@@ -35,6 +35,13 @@
 
 gboolean failed = FALSE;
 
+/* Members in the composite of many members */
+#define MANY_MEMBERS	1000
+
+/* Copies spanning members after which a composite is flattened;
+ * COMPOSITE_FLATTEN_COPIES in tvbuff.c */
+#define FLATTEN_COPIES	16
+
 /* Tests a tvbuff against the expected pattern/length.
  * Returns TRUE if all tests succeeed, FALSE if any test fails */
 gboolean
@@ -248,6 +255,116 @@ test(tvbuff_t *tvb, gchar* name,
 	return TRUE;
 }
 
+/* Tests a composite of many small members, some of them empty: reads
+ * within members and across the joins while it is still in pieces, then
+ * that enough copies across joins flatten it, then reads of the flattened
+ * data. */
+gboolean
+test_many_members(void)
+{
+	tvbuff_t	*tvb;
+	tvbuff_t	*member;
+	guint8		*data, *ptr;
+	const guint8	*cptr;
+	guint8		buf[FLATTEN_COPIES * 4 + 9];
+	guint		length, offset, member_length, copy_length, i;
+	guint32		expected32;
+
+	data = g_malloc(MANY_MEMBERS * 7);
+	for (offset = 0; offset < MANY_MEMBERS * 7; offset++)
+		data[offset] = (guint8) (offset * 13);
+
+	/* Every 8th member is empty, the first one included, and so is
+	 * one more at the end */
+	tvb = tvb_new_composite();
+	offset = 0;
+	for (i = 0; i <= MANY_MEMBERS; i++) {
+		member_length = i < MANY_MEMBERS ? i % 8 : 0;
+		member = tvb_new_real_data(&data[offset], member_length, member_length);
+		tvb_composite_append(tvb, member);
+		offset += member_length;
+	}
+	length = offset;
+	tvb_composite_finalize(tvb);
+
+	if (tvb_length(tvb) != length) {
+		printf("01: Failed TVB=Many members Length of tvb=%u while expected length=%u\n",
+				tvb_length(tvb), length);
+		failed = TRUE;
+		return FALSE;
+	}
+
+	/* Each byte on its own, which is always within one member; this
+	 * must not flatten the composite */
+	for (offset = 0; offset < length; offset++) {
+		tvb_memcpy(tvb, buf, offset, 1);
+		if (buf[0] != data[offset]) {
+			printf("15: Failed TVB=Many members Offset=%u Length=1 Bad memcpy\n",
+					offset);
+			failed = TRUE;
+			return FALSE;
+		}
+	}
+
+	/* Copies spread over the composite, each longer than any member,
+	 * so that they span joins and empty members, up to one short of
+	 * the number that flattens it */
+	for (i = 0; i < FLATTEN_COPIES; i++) {
+		if (tvb->real_data != NULL) {
+			printf("16: Failed TVB=Many members Flattened after %u copies across members\n",
+					i);
+			failed = TRUE;
+			return FALSE;
+		}
+		offset = i * (length - sizeof buf) / (FLATTEN_COPIES - 1);
+		copy_length = 9 + i * 4;
+		tvb_memcpy(tvb, buf, offset, copy_length);
+		if (memcmp(buf, &data[offset], copy_length) != 0) {
+			printf("15: Failed TVB=Many members Offset=%u Length=%u Bad memcpy\n",
+					offset, copy_length);
+			failed = TRUE;
+			return FALSE;
+		}
+	}
+	if (tvb->real_data == NULL) {
+		printf("16: Failed TVB=Many members Not flattened after %u copies across members\n",
+				FLATTEN_COPIES);
+		failed = TRUE;
+		return FALSE;
+	}
+
+	/* Every 4 bytes of the flattened data */
+	for (offset = 0; offset + 4 <= length; offset++) {
+		expected32 = pntohl(&data[offset]);
+		if (tvb_get_ntohl(tvb, offset) != expected32) {
+			printf("13: Failed TVB=Many members Offset=%u Bad ntohl\n", offset);
+			failed = TRUE;
+			return FALSE;
+		}
+	}
+
+	ptr = tvb_memdup(tvb, 3, length - 6);
+	if (memcmp(ptr, &data[3], length - 6) != 0) {
+		printf("12: Failed TVB=Many members Offset=3 Length=%u Bad memdup\n",
+				length - 6);
+		failed = TRUE;
+		g_free(ptr);
+		return FALSE;
+	}
+	g_free(ptr);
+
+	cptr = tvb_get_ptr(tvb, 0, -1);
+	if (memcmp(cptr, data, length) != 0) {
+		printf("14: Failed TVB=Many members Bad data after flattening\n");
+		failed = TRUE;
+		return FALSE;
+	}
+
+	printf("Passed TVB=Many members\n");
+
+	return TRUE;
+}
+
 gboolean
 skip(tvbuff_t *tvb _U_, gchar* name,
 		guint8* expected_data _U_, guint expected_length _U_)
@@ -421,6 +538,9 @@ run_tests(void)
 	skip(tvb_comp[3], "Composite 3", comp[3], comp_length[3]);
 	skip(tvb_comp[4], "Composite 4", comp[4], comp_length[4]);
 	skip(tvb_comp[5], "Composite 5", comp[5], comp_length[5]);
+
+	/* Many members */
+	test_many_members();
 }
 
 int
@@ -59,6 +59,9 @@ ensure_contiguous_no_exception(tvbuff_t *tvb, const gint offset, const gint leng
 static const guint8*
 ensure_contiguous(tvbuff_t *tvb, const gint offset, const gint length);
 
+static void
+composite_flatten(tvbuff_t *tvb);
+
 #if GLIB_CHECK_VERSION(2,10,0)
 #else
 /* We dole out tvbuff's from this memchunk. */
@@ -119,8 +122,11 @@ tvb_init(tvbuff_t *tvb, const tvbuff_type type)
 		case TVBUFF_COMPOSITE:
 			composite = &tvb->tvbuffs.composite;
 			composite->tvbs			= NULL;
+			composite->members		= NULL;
+			composite->num_members		= 0;
 			composite->start_offsets	= NULL;
-			composite->end_offsets		= NULL;
+			composite->spanning_copies	= 0;
+			composite->spanning_bytes	= 0;
 			break;
 
 		default:
@@ -193,8 +199,8 @@ tvb_free(tvbuff_t* tvb)
 
 			g_slist_free(composite->tvbs);
 
+			g_free(composite->members);
 			g_free(composite->start_offsets);
-			g_free(composite->end_offsets);
 			if (tvb->real_data) {
 				/*
 				 * XXX - do this with a union?
@@ -610,22 +616,32 @@ tvb_composite_finalize(tvbuff_t* tvb)
 	composite = &tvb->tvbuffs.composite;
 	num_members = g_slist_length(composite->tvbs);
 
+	composite->members = g_new(tvbuff_t *, num_members);
+	composite->num_members = num_members;
 	composite->start_offsets = g_new(guint, num_members);
-	composite->end_offsets = g_new(guint, num_members);
 
 	for (slist = composite->tvbs; slist != NULL; slist = slist->next) {
 		DISSECTOR_ASSERT((guint) i < num_members);
 		member_tvb = slist->data;
+		composite->members[i] = member_tvb;
 		composite->start_offsets[i] = tvb->length;
 		tvb->length += member_tvb->length;
 		tvb->reported_length += member_tvb->reported_length;
-		composite->end_offsets[i] = tvb->length - 1;
 		i++;
 	}
 
 	tvb->initialized = TRUE;
 }
 
+void
+tvb_composite_flatten(tvbuff_t* tvb)
+{
+	DISSECTOR_ASSERT(tvb && tvb->initialized);
+	DISSECTOR_ASSERT(tvb->type == TVBUFF_COMPOSITE);
+
+	composite_flatten(tvb);
+}
+
 
 
 guint
@@ -835,31 +851,85 @@ tvb_offset_from_real_beginning(const tvbuff_t *tvb)
 	return offset_from_real_beginning(tvb, 0);
 }
 
+/* Find the member of a composite that the byte at abs_offset is in: the
+ * last one that starts at or before it.  Members with no data start where
+ * the next one does, so they are passed over, unless they are at the very
+ * end. */
+static guint
+composite_find_member(const tvb_comp_t *composite, const guint abs_offset)
+{
+	guint	low, high, mid;
+
+	DISSECTOR_ASSERT(composite->num_members > 0);
+
+	low = 0;
+	high = composite->num_members;
+	while (high - low > 1) {
+		mid = low + (high - low) / 2;
+		if (composite->start_offsets[mid] <= abs_offset)
+			low = mid;
+		else
+			high = mid;
+	}
+	return low;
+}
+
+/* Copy data that spans members, one member at a time */
+static void
+composite_copy(const tvb_comp_t *composite, guint8* target, guint abs_offset, guint abs_length)
+{
+	guint		i;
+	tvbuff_t	*member_tvb;
+	guint		member_offset, member_length;
+
+	i = composite_find_member(composite, abs_offset);
+	while (abs_length > 0) {
+		DISSECTOR_ASSERT(i < composite->num_members);
+		member_tvb = composite->members[i];
+		member_offset = abs_offset - composite->start_offsets[i];
+		member_length = member_tvb->length - member_offset;
+		if (member_length > abs_length)
+			member_length = abs_length;
+
+		tvb_memcpy(member_tvb, target, member_offset, member_length);
+		target		+= member_length;
+		abs_offset	+= member_length;
+		abs_length	-= member_length;
+		i++;
+	}
+}
+
+/* Copy all the data of a composite into one buffer, once; from then on
+ * it is accessed like the data of a real-data tvbuff. */
+static void
+composite_flatten(tvbuff_t *tvb)
+{
+	guint8	*buf;
+
+	if (tvb->real_data)
+		return;
+
+	buf = g_malloc(tvb->length);
+	composite_copy(&tvb->tvbuffs.composite, buf, 0, tvb->length);
+	tvb->real_data = buf;
+}
+
 static const guint8*
 composite_ensure_contiguous_no_exception(tvbuff_t *tvb, const guint abs_offset,
 		const guint abs_length)
 {
-	guint		i, num_members;
+	guint		i;
 	tvb_comp_t	*composite;
-	tvbuff_t	*member_tvb = NULL;
+	tvbuff_t	*member_tvb;
 	guint		member_offset, member_length;
-	GSList		*slist;
 
 	DISSECTOR_ASSERT(tvb->type == TVBUFF_COMPOSITE);
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
 	composite = &tvb->tvbuffs.composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = slist->data;
-			break;
-		}
-	}
-	DISSECTOR_ASSERT(member_tvb);
+	i = composite_find_member(composite, abs_offset);
+	member_tvb = composite->members[i];
 
 	if (check_offset_length_no_exception(member_tvb->length, member_tvb->reported_length, abs_offset - composite->start_offsets[i],
 				abs_length, &member_offset, &member_length, NULL)) {
@@ -871,7 +941,7 @@ composite_ensure_contiguous_no_exception(tvbuff_t *tvb, const guint abs_offset,
 		return ensure_contiguous_no_exception(member_tvb, member_offset, member_length, NULL);
 	}
 	else {
-		tvb->real_data = tvb_memdup(tvb, 0, -1);
+		composite_flatten(tvb);
 		return tvb->real_data + abs_offset;
 	}
 
@@ -982,31 +1052,25 @@ guint8_pbrk(const guint8* haystack, size_t haystacklen, const guint8 *needles, g
 
 /************** ACCESSORS **************/
 
+/* Once data spanning members has been copied this many times, or as many
+ * bytes of it as the composite has, flatten the composite */
+#define COMPOSITE_FLATTEN_COPIES	16
+
 static void*
-composite_memcpy(tvbuff_t *tvb, guint8* target, guint abs_offset, size_t abs_length)
+composite_memcpy(tvbuff_t *tvb, guint8* target, guint abs_offset, guint abs_length)
 {
-	guint		i, num_members;
+	guint		i;
 	tvb_comp_t	*composite;
-	tvbuff_t	*member_tvb = NULL;
+	tvbuff_t	*member_tvb;
 	guint		member_offset, member_length;
-	gboolean	retval;
-	GSList		*slist;
 
 	DISSECTOR_ASSERT(tvb->type == TVBUFF_COMPOSITE);
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
 	composite = &tvb->tvbuffs.composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = slist->data;
-			break;
-		}
-	}
-	DISSECTOR_ASSERT(member_tvb);
+	i = composite_find_member(composite, abs_offset);
+	member_tvb = composite->members[i];
 
 	if (check_offset_length_no_exception(member_tvb->length, member_tvb->reported_length, abs_offset - composite->start_offsets[i],
 				(gint) abs_length, &member_offset, &member_length, NULL)) {
@@ -1016,21 +1080,18 @@ composite_memcpy(tvbuff_t *tvb, guint8* target, guint abs_offset, size_t abs_len
 	}
 	else {
 		/* The requested data is non-contiguous inside
-		 * the member tvb. We have to memcpy() the part that's in the member tvb,
-		 * then iterate across the other member tvb's, copying their portions
-		 * until we have copied all data.
+		 * the member tvb. Copy the part that's in each
+		 * member it spans.
 		 */
-		retval = compute_offset_length(member_tvb->length, member_tvb->reported_length, abs_offset - composite->start_offsets[i], -1,
-				&member_offset, &member_length, NULL);
-		DISSECTOR_ASSERT(retval);
-
-		tvb_memcpy(member_tvb, target, member_offset, member_length);
-		abs_offset	+= member_length;
-		abs_length	-= member_length;
-
-		/* Recurse */
-		if (abs_length > 0) {
-			composite_memcpy(tvb, target + member_length, abs_offset, abs_length);
+		composite_copy(composite, target, abs_offset, abs_length);
+
+		/* If this keeps happening, it's cheaper to copy the lot
+		 * just once */
+		composite->spanning_copies++;
+		composite->spanning_bytes += abs_length;
+		if (composite->spanning_copies >= COMPOSITE_FLATTEN_COPIES ||
+		    composite->spanning_bytes >= tvb->length) {
+			composite_flatten(tvb);
 		}
 
 		return target;
@@ -1074,7 +1135,7 @@ tvb_memcpy(tvbuff_t *tvb, void* target, const gint offset, size_t length)
 					abs_length);
 
 		case TVBUFF_COMPOSITE:
-			return composite_memcpy(tvb, target, offset, length);
+			return composite_memcpy(tvb, target, abs_offset, abs_length);
 	}
 
 	DISSECTOR_ASSERT_NOT_REACHED();
@@ -72,11 +72,19 @@ typedef struct {
 typedef struct {
 	GSList		*tvbs;
 
-	/* Used for quick testing to see if this
-	 * is the tvbuff that a COMPOSITE is
-	 * interested in. */
+	/* The members in order, set up when the composite is
+	 * finalized, and where each one starts in it; the member
+	 * that has a given offset is found with a binary search
+	 * of the start offsets. */
+	struct tvbuff	**members;
+	guint		num_members;
 	guint		*start_offsets;
-	guint		*end_offsets;
+
+	/* Copies of data spanning more than one member, and the
+	 * bytes copied; once there have been enough, the data is
+	 * flattened into one buffer. */
+	guint		spanning_copies;
+	guint		spanning_bytes;
 
 } tvb_comp_t;
 
@@ -265,6 +273,14 @@ extern tvbuff_t* tvb_new_composite(void);
  * occur, data access can finally happen after this finalization. */
 extern void tvb_composite_finalize(tvbuff_t* tvb);
 
+/** Copy the data of a composite tvbuff into one buffer now, rather than
+ * when it is first needed, so that all accesses to it are as fast as to
+ * a real-data tvbuff.  Meant for composites of many members that are
+ * going to be read all over.  Flattening happens anyway the first time a
+ * pointer to data spanning members is asked for, and after data has been
+ * copied across members a number of times. */
+extern void tvb_composite_flatten(tvbuff_t* tvb);
+
 
 /* Get total length of buffer */
 extern guint tvb_length(const tvbuff_t*);
@@ -341,6 +341,10 @@ cf_open(capture_file *cf, const char *fname, gboolean is_tempfile, int *err)
   cf->ref_time_count = 0;
   cf->drops_known = FALSE;
   cf->drops     = 0;
+  cf->writer_stalls = 0;
+  cf->flow_truncated = 0;
+  cf->sampled_out = 0;
+  cf->rate_limited = 0;
   cf->snap      = wtap_snapshot_length(cf->wth);
   if (cf->snap == 0) {
     /* Snapshot length not known. */
@@ -1063,6 +1067,30 @@ void cf_set_drops(capture_file *cf, guint32 drops)
   cf->drops = drops;
 }
 
+/* XXX - use a macro instead? */
+void cf_set_writer_stalls(capture_file *cf, guint32 stalls)
+{
+  cf->writer_stalls = stalls;
+}
+
+/* XXX - use a macro instead? */
+void cf_set_flow_truncated(capture_file *cf, guint32 truncated)
+{
+  cf->flow_truncated = truncated;
+}
+
+/* XXX - use a macro instead? */
+void cf_set_sampled_out(capture_file *cf, guint32 sampled_out)
+{
+  cf->sampled_out = sampled_out;
+}
+
+/* XXX - use a macro instead? */
+void cf_set_rate_limited(capture_file *cf, guint32 rate_limited)
+{
+  cf->rate_limited = rate_limited;
+}
+
 /* XXX - use a macro instead? */
 gboolean cf_get_drops_known(capture_file *cf)
 {
@@ -1075,6 +1103,30 @@ guint32 cf_get_drops(capture_file *cf)
   return cf->drops;
 }
 
+/* XXX - use a macro instead? */
+guint32 cf_get_writer_stalls(capture_file *cf)
+{
+  return cf->writer_stalls;
+}
+
+/* XXX - use a macro instead? */
+guint32 cf_get_flow_truncated(capture_file *cf)
+{
+  return cf->flow_truncated;
+}
+
+/* XXX - use a macro instead? */
+guint32 cf_get_sampled_out(capture_file *cf)
+{
+  return cf->sampled_out;
+}
+
+/* XXX - use a macro instead? */
+guint32 cf_get_rate_limited(capture_file *cf)
+{
+  return cf->rate_limited;
+}
+
 void cf_set_rfcode(capture_file *cf, dfilter_t *rfcode)
 {
   cf->rfcode = rfcode;
@@ -273,6 +273,39 @@ void cf_set_drops_known(capture_file *cf, gboolean drops_known);
  */
 void cf_set_drops(capture_file *cf, guint32 drops);
 
+/**
+ * Set the number of times the capture had to wait for the capture file
+ * to be written.
+ *
+ * @param cf the capture file
+ * @param stalls the number of times the capture waited
+ */
+void cf_set_writer_stalls(capture_file *cf, guint32 stalls);
+
+/**
+ * Set the number of packets per-flow truncation cut short while capturing.
+ *
+ * @param cf the capture file
+ * @param truncated the number of packets cut short
+ */
+void cf_set_flow_truncated(capture_file *cf, guint32 truncated);
+
+/**
+ * Set the number of packets sampling left out while capturing.
+ *
+ * @param cf the capture file
+ * @param sampled_out the number of packets not sampled
+ */
+void cf_set_sampled_out(capture_file *cf, guint32 sampled_out);
+
+/**
+ * Set the number of packets the rate limit left out while capturing.
+ *
+ * @param cf the capture file
+ * @param rate_limited the number of packets over the rate limit
+ */
+void cf_set_rate_limited(capture_file *cf, guint32 rate_limited);
+
 /**
  * Get flag state, if the number of packet drops while capturing are known or not.
  *
@@ -289,6 +322,39 @@ gboolean cf_get_drops_known(capture_file *cf);
  */
 guint32 cf_get_drops(capture_file *cf);
 
+/**
+ * Get the number of times the capture had to wait for the capture file
+ * to be written.
+ *
+ * @param cf the capture file
+ * @return the number of times the capture waited
+ */
+guint32 cf_get_writer_stalls(capture_file *cf);
+
+/**
+ * Get the number of packets per-flow truncation cut short while capturing.
+ *
+ * @param cf the capture file
+ * @return the number of packets cut short
+ */
+guint32 cf_get_flow_truncated(capture_file *cf);
+
+/**
+ * Get the number of packets sampling left out while capturing.
+ *
+ * @param cf the capture file
+ * @return the number of packets not sampled
+ */
+guint32 cf_get_sampled_out(capture_file *cf);
+
+/**
+ * Get the number of packets the rate limit left out while capturing.
+ *
+ * @param cf the capture file
+ * @return the number of packets over the rate limit
+ */
+guint32 cf_get_rate_limited(capture_file *cf);
+
 /**
  * Set the read filter.
  * @todo this shouldn't be required, remove it somehow
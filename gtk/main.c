@@ -2724,7 +2724,8 @@ main(int argc, char *argv[])
 	cmdarg_err("Ring buffer requested, but an \"Update list of packets in real time\" capture is being done.");
 	global_capture_opts.multi_files_on = FALSE;
       }*/
-      if (!global_capture_opts.has_autostop_filesize && !global_capture_opts.has_file_duration) {
+      if (!global_capture_opts.has_autostop_filesize && !global_capture_opts.has_file_duration &&
+          !global_capture_opts.has_file_interval) {
 	cmdarg_err("Ring buffer requested, but no maximum capture file size or duration were specified.");
 /* XXX - this must be redesigned as the conditions changed */
 /*	global_capture_opts.multi_files_on = FALSE;*/
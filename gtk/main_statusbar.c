@@ -483,6 +483,18 @@ packets_bar_update(void)
             if(cfile.drops_known) {
                 g_string_append_printf(packets_str, " Dropped: %u", cfile.drops);
             }
+            if(cfile.writer_stalls > 0) {
+                g_string_append_printf(packets_str, " Disk stalls: %u", cfile.writer_stalls);
+            }
+            if(cfile.flow_truncated > 0) {
+                g_string_append_printf(packets_str, " Cut short: %u", cfile.flow_truncated);
+            }
+            if(cfile.sampled_out > 0) {
+                g_string_append_printf(packets_str, " Not sampled: %u", cfile.sampled_out);
+            }
+            if(cfile.rate_limited > 0) {
+                g_string_append_printf(packets_str, " Rate limited: %u", cfile.rate_limited);
+            }
             if(cfile.ignored_count > 0) {
                 g_string_append_printf(packets_str, " Ignored: %u", cfile.ignored_count);
             }
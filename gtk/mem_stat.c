@@ -0,0 +1,278 @@
+/* mem_stat.c
+ * Memory allocation statistics
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+/* This module shows how much ep_ and se_ memory each protocol's
+ * dissector allocated, and how much was allocated for each packet.
+ * It is only used by Wireshark and not TShark
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+
+#include <gtk/gtk.h>
+
+#include <epan/packet_info.h>
+#include <epan/epan.h>
+#include <epan/proto.h>
+#include <epan/emem.h>
+#include <epan/stat_cmd_args.h>
+#include <epan/tap.h>
+
+#include "../stat_menu.h"
+#include "../globals.h"
+#include "../simple_dialog.h"
+
+#include "gtk/gui_stat_menu.h"
+#include "gtk/gui_utils.h"
+#include "gtk/dlg_utils.h"
+#include "gtk/gui_stat_util.h"
+#include "gtk/main.h"
+
+typedef struct _memstat_t {
+	GtkWidget *win;
+	GtkTreeView *protos;
+	GtkTreeView *packets;
+} memstat_t;
+
+/* There is only one set of counts, so only one window */
+static memstat_t *memstat = NULL;
+
+/* what has been allocated for one protocol */
+typedef struct _memstat_proto_t {
+	int id;
+	emem_stats_t stats;
+} memstat_proto_t;
+
+static void
+memstat_reset(void *dummy _U_)
+{
+	emem_stats_reset();
+}
+
+static gboolean
+memstat_packet(void *dummy _U_, packet_info *pinfo _U_, epan_dissect_t *edt _U_, const void *dummy2 _U_)
+{
+	/* the counting is done by the allocator; just get it redrawn */
+	return TRUE;
+}
+
+static void
+memstat_collect(int id, const emem_stats_t *stats, void *user_data)
+{
+	GPtrArray *protos = user_data;
+	memstat_proto_t *mp;
+
+	mp = g_malloc(sizeof(memstat_proto_t));
+	mp->id = id;
+	mp->stats = *stats;
+	g_ptr_array_add(protos, mp);
+}
+
+/* most memory first */
+static gint
+memstat_compare(gconstpointer a, gconstpointer b)
+{
+	const memstat_proto_t *mpa = *(const memstat_proto_t * const *)a;
+	const memstat_proto_t *mpb = *(const memstat_proto_t * const *)b;
+	guint64 bytes_a = mpa->stats.ep_bytes + mpa->stats.se_bytes;
+	guint64 bytes_b = mpb->stats.ep_bytes + mpb->stats.se_bytes;
+
+	if (bytes_a > bytes_b)
+		return -1;
+	if (bytes_a < bytes_b)
+		return 1;
+	return 0;
+}
+
+static void
+memstat_draw(void *arg)
+{
+	memstat_t *ms = arg;
+	GPtrArray *protos;
+	memstat_proto_t *mp;
+	guint64 packets[EMEM_STATS_PACKET_BUCKETS];
+	GtkListStore *store;
+	GtkTreeIter iter;
+	char str[64];
+	guint i;
+
+	protos = g_ptr_array_new();
+	emem_stats_foreach(memstat_collect, protos);
+	g_ptr_array_sort(protos, memstat_compare);
+
+	store = GTK_LIST_STORE(gtk_tree_view_get_model(ms->protos));
+	gtk_list_store_clear(store);
+	for (i = 0; i < protos->len; i++) {
+		mp = g_ptr_array_index(protos, i);
+		gtk_list_store_append(store, &iter);
+		gtk_list_store_set(store, &iter,
+			0, mp->id == EMEM_STATS_NO_OWNER ? "(no dissector)" :
+			   proto_get_protocol_short_name(find_protocol_by_id(mp->id)),
+			1, mp->stats.ep_allocs,
+			2, mp->stats.ep_bytes,
+			3, mp->stats.se_allocs,
+			4, mp->stats.se_bytes,
+			5, mp->stats.packet_max,
+			-1);
+		g_free(mp);
+	}
+	g_ptr_array_free(protos, TRUE);
+
+	emem_stats_get_packets(packets);
+	store = GTK_LIST_STORE(gtk_tree_view_get_model(ms->packets));
+	gtk_list_store_clear(store);
+	for (i = 0; i < EMEM_STATS_PACKET_BUCKETS; i++) {
+		if (packets[i] == 0)
+			continue;
+		if (i == 0)
+			g_snprintf(str, sizeof(str), "0 - 1");
+		else if (i == EMEM_STATS_PACKET_BUCKETS - 1)
+			g_snprintf(str, sizeof(str), "%" G_GINT64_MODIFIER "u -",
+				((guint64)1 << (i - 1)) + 1);
+		else
+			g_snprintf(str, sizeof(str), "%" G_GINT64_MODIFIER "u - %" G_GINT64_MODIFIER "u",
+				((guint64)1 << (i - 1)) + 1, (guint64)1 << i);
+		gtk_list_store_append(store, &iter);
+		gtk_list_store_set(store, &iter,
+			0, str,
+			1, packets[i],
+			-1);
+	}
+}
+
+/* since the gtk2 implementation of tap is multithreaded we must protect
+ * remove_tap_listener() from modifying the list while draw_tap_listener()
+ * is running.  the other protected block is in main.c
+ *
+ * there should not be any other critical regions in gtk2
+ */
+static void
+win_destroy_cb(GtkWindow *win _U_, gpointer data)
+{
+	memstat_t *ms = data;
+
+	protect_thread_critical_region();
+	remove_tap_listener(ms);
+	unprotect_thread_critical_region();
+
+	emem_stats_enable(FALSE);
+
+	g_free(ms);
+	memstat = NULL;
+}
+
+static const stat_column proto_titles[]={
+	{G_TYPE_STRING, LEFT, "Protocol"},
+	{G_TYPE_UINT64, RIGHT, "ep_ allocations"},
+	{G_TYPE_UINT64, RIGHT, "ep_ bytes"},
+	{G_TYPE_UINT64, RIGHT, "se_ allocations"},
+	{G_TYPE_UINT64, RIGHT, "se_ bytes"},
+	{G_TYPE_UINT64, RIGHT, "Max bytes/packet"}
+};
+
+static const stat_column packet_titles[]={
+	{G_TYPE_STRING, RIGHT, "Bytes allocated per packet"},
+	{G_TYPE_UINT64, RIGHT, "Packets"}
+};
+
+/* When called, this function will start counting the memory that is
+ * allocated, and dissect all the packets again to count it for them.
+ */
+static void
+gtk_memstat_init(const char *optarg _U_, void* userdata _U_)
+{
+	memstat_t *ms;
+	GtkWidget *vbox;
+	GtkWidget *scrolled_window;
+	GString *error_string;
+	GtkWidget *bt_close;
+	GtkWidget *bbox;
+
+	if(memstat){
+		reactivate_window(memstat->win);
+		return;
+	}
+
+	ms=g_malloc(sizeof(memstat_t));
+
+	ms->win = dlg_window_new("Wireshark: Memory Usage");  /* transient_for top_level */
+	gtk_window_set_destroy_with_parent (GTK_WINDOW(ms->win), TRUE);
+	gtk_window_set_default_size(GTK_WINDOW(ms->win), 650, 500);
+
+	vbox=gtk_vbox_new(FALSE, 3);
+	init_main_stat_window(ms->win, vbox, "Memory Allocated by Dissectors", NULL);
+
+	scrolled_window = scrolled_window_new(NULL, NULL);
+	ms->protos = create_stat_table(scrolled_window, vbox, 6, proto_titles);
+
+	scrolled_window = scrolled_window_new(NULL, NULL);
+	ms->packets = create_stat_table(scrolled_window, vbox, 2, packet_titles);
+
+	error_string=register_tap_listener("frame", ms, NULL, 0, memstat_reset, memstat_packet, memstat_draw);
+	if(error_string){
+		simple_dialog(ESD_TYPE_ERROR, ESD_BTN_OK, "%s", error_string->str);
+		g_string_free(error_string, TRUE);
+		window_destroy(ms->win);
+		g_free(ms);
+		return;
+	}
+	memstat = ms;
+	emem_stats_enable(TRUE);
+
+	/* Button row. */
+	bbox = dlg_button_row_new(GTK_STOCK_CLOSE, NULL);
+	gtk_box_pack_end(GTK_BOX(vbox), bbox, FALSE, FALSE, 0);
+
+	bt_close = g_object_get_data(G_OBJECT(bbox), GTK_STOCK_CLOSE);
+	window_set_cancel_button(ms->win, bt_close, window_cancel_button_cb);
+
+	g_signal_connect(ms->win, "delete_event", G_CALLBACK(window_delete_event_cb), NULL);
+	g_signal_connect(ms->win, "destroy", G_CALLBACK(win_destroy_cb), ms);
+
+	gtk_widget_show_all(ms->win);
+	window_present(ms->win);
+
+	/* Redissect, rather than retap, so that what the dissectors keep
+	 * in se_ memory for the whole capture gets counted too */
+	cf_redissect_packets(&cfile);
+	gdk_window_raise(ms->win->window);
+}
+
+static void
+gtk_memstat_cb(GtkWidget *w _U_, gpointer d _U_)
+{
+	gtk_memstat_init("mem,stat",NULL);
+}
+
+void
+register_tap_listener_gtkmemstat(void)
+{
+	register_stat_cmd_arg("mem,stat", gtk_memstat_init,NULL);
+
+	register_stat_menu_item("Memory Usage", REGISTER_STAT_GROUP_GENERIC,
+	gtk_memstat_cb, NULL, NULL, NULL);
+}
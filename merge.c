@@ -28,6 +28,61 @@
 #include "wtap.h"
 #include "merge.h"
 
+/*
+ * Most packets read ahead from one input file, and the number of worker
+ * threads doing the reading if we can't find out how many processors
+ * there are.  All the files together get as many packets read ahead as
+ * MERGE_PREFETCH_RECORDS for each thread, plus the one packet from each
+ * file that's needed to see which file has the earliest packet; so
+ * merging hundreds of files doesn't take hundreds of times the memory.
+ */
+#define MERGE_PREFETCH_RECORDS	256
+#define MERGE_PREFETCH_THREADS	4
+
+/*
+ * Packet buffers up to this size are kept for reuse when a packet has
+ * been handed out; bigger ones are freed.
+ */
+#define MERGE_PREFETCH_KEEP_PD	16384
+
+typedef struct merge_prefetch_file_s {
+  int             index;      /* index into the input file array */
+  merge_record_t *first;      /* packets read ahead, oldest first */
+  merge_record_t *last;
+  guint           count;      /* number of packets read ahead */
+  gboolean        busy;       /* a worker is reading from the file */
+  gboolean        done;       /* got EOF or an error */
+  int             err;
+  gchar          *err_info;
+} merge_prefetch_file_t;
+
+struct merge_prefetch_s {
+  int                    in_file_count;
+  merge_in_file_t       *in_files;
+  merge_prefetch_file_t *files;
+  gboolean               do_append;
+  int                    current_file;  /* file of the packet handed out */
+  gboolean               stopping;
+  merge_record_t        *free_records;  /* for reuse */
+  guint                  buffered;      /* packets read ahead, or being read */
+  guint                  max_buffered;
+#ifdef USE_THREADS
+  GThreadPool           *pool;
+  GMutex                *mtx;
+  GCond                 *cond;
+#endif
+};
+
+#ifdef USE_THREADS
+#define PREFETCH_LOCK(p)	g_mutex_lock((p)->mtx)
+#define PREFETCH_UNLOCK(p)	g_mutex_unlock((p)->mtx)
+#define PREFETCH_SIGNAL(p)	g_cond_broadcast((p)->cond)
+#else
+#define PREFETCH_LOCK(p)
+#define PREFETCH_UNLOCK(p)
+#define PREFETCH_SIGNAL(p)
+#endif
+
 /*
  * Scan through the arguments and open the input files
  */
@@ -238,3 +293,312 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
   /* Return a pointer to the wtap structure for the file with that frame. */
   return in_files[i].wth;
 }
+
+/*
+ * Get a record to read a packet into, and count it as read ahead.
+ * Called with the lock held.
+ */
+static merge_record_t *
+merge_prefetch_get_record(merge_prefetch_t *prefetch)
+{
+  merge_record_t *rec = prefetch->free_records;
+
+  if (rec != NULL)
+    prefetch->free_records = rec->next;
+  else
+    rec = (merge_record_t *)g_malloc0(sizeof(merge_record_t));
+  rec->next = NULL;
+  prefetch->buffered++;
+  return rec;
+}
+
+/*
+ * Put a record back for reuse.  Called with the lock held.
+ */
+static void
+merge_prefetch_put_record(merge_prefetch_t *prefetch, merge_record_t *rec)
+{
+  if (rec->pd_size > MERGE_PREFETCH_KEEP_PD) {
+    g_free(rec->pd);
+    rec->pd = NULL;
+    rec->pd_size = 0;
+  }
+  rec->next = prefetch->free_records;
+  prefetch->free_records = rec;
+  prefetch->buffered--;
+}
+
+/*
+ * Read packets from one input file until it has as many read ahead as it
+ * may, or we get EOF or an error.  A file with nothing read ahead may
+ * always have one packet read, whatever the others have.  The packets are
+ * read without holding the lock; the record being filled isn't visible to
+ * the reader until it's put on the file's list.
+ */
+static void
+merge_prefetch_fill(merge_prefetch_t *prefetch, merge_prefetch_file_t *pf)
+{
+  wtap *wth = prefetch->in_files[pf->index].wth;
+  merge_record_t *rec;
+  struct wtap_pkthdr *phdr;
+  gboolean ok;
+  int err;
+  gchar *err_info;
+
+  for (;;) {
+    PREFETCH_LOCK(prefetch);
+    if (prefetch->stopping || pf->count == MERGE_PREFETCH_RECORDS ||
+        (pf->count != 0 && prefetch->buffered >= prefetch->max_buffered)) {
+      pf->busy = FALSE;
+      PREFETCH_UNLOCK(prefetch);
+      return;
+    }
+    rec = merge_prefetch_get_record(prefetch);
+    PREFETCH_UNLOCK(prefetch);
+
+    err_info = NULL;
+    ok = wtap_read(wth, &err, &err_info, &rec->data_offset);
+    if (ok) {
+      phdr = wtap_phdr(wth);
+      rec->phdr = *phdr;
+      rec->pseudo_header = *wtap_pseudoheader(wth);
+      if (phdr->caplen > rec->pd_size) {
+        rec->pd_size = phdr->caplen;
+        rec->pd = (guint8 *)g_realloc(rec->pd, rec->pd_size);
+      }
+      memcpy(rec->pd, wtap_buf_ptr(wth), phdr->caplen);
+      rec->in_file = pf->index;
+    }
+
+    PREFETCH_LOCK(prefetch);
+    if (ok) {
+      if (pf->last != NULL)
+        pf->last->next = rec;
+      else
+        pf->first = rec;
+      pf->last = rec;
+      /* Only a reader waiting on a file with nothing read ahead needs
+         waking up */
+      if (++pf->count == 1)
+        PREFETCH_SIGNAL(prefetch);
+    } else {
+      merge_prefetch_put_record(prefetch, rec);
+      pf->done     = TRUE;
+      pf->err      = err;
+      pf->err_info = err_info;
+      pf->busy     = FALSE;
+      PREFETCH_SIGNAL(prefetch);
+    }
+    PREFETCH_UNLOCK(prefetch);
+    if (!ok)
+      return;
+  }
+}
+
+#ifdef USE_THREADS
+static void
+merge_prefetch_worker(gpointer data, gpointer user_data)
+{
+  merge_prefetch_fill((merge_prefetch_t *)user_data,
+                      (merge_prefetch_file_t *)data);
+}
+
+/*
+ * Hand a file to the worker threads, if none of them has it already.
+ * Called with the lock held.
+ */
+static void
+merge_prefetch_schedule(merge_prefetch_t *prefetch, merge_prefetch_file_t *pf)
+{
+  if (!pf->busy && !pf->done && !prefetch->stopping) {
+    pf->busy = TRUE;
+    g_thread_pool_push(prefetch->pool, pf, NULL);
+  }
+}
+
+static gint
+merge_prefetch_threads(void)
+{
+#if defined(HAVE_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+  long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if (ncpus > 0)
+    return (gint)ncpus;
+#endif
+  return MERGE_PREFETCH_THREADS;
+}
+#endif /* USE_THREADS */
+
+/*
+ * Wait until there's a packet read ahead from a file, or it's at EOF.
+ * Called with the lock held.
+ */
+static void
+merge_prefetch_wait(merge_prefetch_t *prefetch, merge_prefetch_file_t *pf)
+{
+  while (pf->count == 0 && !pf->done) {
+#ifdef USE_THREADS
+    merge_prefetch_schedule(prefetch, pf);
+    g_cond_wait(prefetch->cond, prefetch->mtx);
+#else
+    merge_prefetch_fill(prefetch, pf);
+#endif
+  }
+}
+
+/*
+ * Start reading ahead from the input files.
+ */
+merge_prefetch_t *
+merge_prefetch_open(int in_file_count, merge_in_file_t in_files[],
+                    gboolean do_append)
+{
+  merge_prefetch_t *prefetch;
+  int i;
+#ifdef USE_THREADS
+  gint threads;
+#endif
+
+  prefetch = (merge_prefetch_t *)g_malloc0(sizeof(merge_prefetch_t));
+  prefetch->in_file_count = in_file_count;
+  prefetch->in_files      = in_files;
+  prefetch->do_append     = do_append;
+  prefetch->current_file  = -1;
+  prefetch->files = (merge_prefetch_file_t *)g_malloc0(in_file_count * sizeof(merge_prefetch_file_t));
+  for (i = 0; i < in_file_count; i++)
+    prefetch->files[i].index = i;
+
+#ifdef USE_THREADS
+  threads = merge_prefetch_threads();
+  prefetch->max_buffered = threads * MERGE_PREFETCH_RECORDS;
+  prefetch->mtx  = g_mutex_new();
+  prefetch->cond = g_cond_new();
+  prefetch->pool = g_thread_pool_new(merge_prefetch_worker, prefetch,
+                                     threads, FALSE, NULL);
+
+  /* Get the files going; when appending, the files are read one after
+     the other, so only the first one and the one after it */
+  PREFETCH_LOCK(prefetch);
+  for (i = 0; i < in_file_count; i++) {
+    if (do_append && i > 1)
+      break;
+    merge_prefetch_schedule(prefetch, &prefetch->files[i]);
+  }
+  PREFETCH_UNLOCK(prefetch);
+#else
+  prefetch->max_buffered = MERGE_PREFETCH_RECORDS;
+#endif
+
+  return prefetch;
+}
+
+/*
+ * Get the next packet, in chronological or file sequence order, from the
+ * packets read ahead.
+ */
+const merge_record_t *
+merge_prefetch_read_packet(merge_prefetch_t *prefetch, int *err,
+                           gchar **err_info)
+{
+  merge_prefetch_file_t *pf;
+  merge_record_t *rec, *earliest = NULL;
+  int i;
+  int ei = -1;
+
+  PREFETCH_LOCK(prefetch);
+
+  /* The packet we handed out last time can now be reused. */
+  if (prefetch->current_file != -1) {
+    pf = &prefetch->files[prefetch->current_file];
+    rec = pf->first;
+    pf->first = rec->next;
+    if (pf->first == NULL)
+      pf->last = NULL;
+    pf->count--;
+    merge_prefetch_put_record(prefetch, rec);
+#ifdef USE_THREADS
+    if (pf->count <= MERGE_PREFETCH_RECORDS / 2)
+      merge_prefetch_schedule(prefetch, pf);
+#endif
+    prefetch->current_file = -1;
+  }
+
+  for (i = 0; i < prefetch->in_file_count; i++) {
+    pf = &prefetch->files[i];
+    merge_prefetch_wait(prefetch, pf);
+    if (pf->count == 0) {
+      if (pf->err != 0) {
+        prefetch->in_files[i].state = GOT_ERROR;
+        *err      = pf->err;
+        *err_info = pf->err_info;
+        pf->err_info = NULL;
+        PREFETCH_UNLOCK(prefetch);
+        return NULL;
+      }
+      prefetch->in_files[i].state = AT_EOF;
+      continue;
+    }
+
+    rec = pf->first;
+    if (ei == -1 || is_earlier(&rec->phdr.ts, &earliest->phdr.ts)) {
+      earliest = rec;
+      ei = i;
+    }
+    if (prefetch->do_append)
+      break;  /* the first file not at EOF has the next packet */
+  }
+
+  if (ei == -1) {
+    /* All the streams are at EOF.  Return an EOF indication. */
+    PREFETCH_UNLOCK(prefetch);
+    *err = 0;
+    return NULL;
+  }
+
+#ifdef USE_THREADS
+  /* Get the next file going before this one runs out */
+  if (prefetch->do_append && ei + 1 < prefetch->in_file_count)
+    merge_prefetch_schedule(prefetch, &prefetch->files[ei + 1]);
+#endif
+
+  prefetch->current_file = ei;
+  prefetch->in_files[ei].data_offset = earliest->data_offset;
+  PREFETCH_UNLOCK(prefetch);
+  return earliest;
+}
+
+/*
+ * Stop reading ahead, waiting for the worker threads to finish the packet
+ * they're reading.
+ */
+void
+merge_prefetch_close(merge_prefetch_t *prefetch)
+{
+  merge_record_t *rec;
+  int i;
+
+  PREFETCH_LOCK(prefetch);
+  prefetch->stopping = TRUE;
+  PREFETCH_UNLOCK(prefetch);
+#ifdef USE_THREADS
+  g_thread_pool_free(prefetch->pool, TRUE, TRUE);
+  g_cond_free(prefetch->cond);
+  g_mutex_free(prefetch->mtx);
+#endif
+
+  for (i = 0; i < prefetch->in_file_count; i++) {
+    while ((rec = prefetch->files[i].first) != NULL) {
+      prefetch->files[i].first = rec->next;
+      g_free(rec->pd);
+      g_free(rec);
+    }
+    g_free(prefetch->files[i].err_info);
+  }
+  while ((rec = prefetch->free_records) != NULL) {
+    prefetch->free_records = rec->next;
+    g_free(rec->pd);
+    g_free(rec);
+  }
+  g_free(prefetch->files);
+  g_free(prefetch);
+}
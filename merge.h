@@ -117,6 +117,59 @@ extern wtap *
 merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
                          int *err, gchar **err_info);
 
+/**
+ * A packet read ahead from one of the input files.
+ */
+typedef struct merge_record_s {
+  struct wtap_pkthdr       phdr;
+  union wtap_pseudo_header pseudo_header;
+  guint8                  *pd;          /* packet data */
+  guint                    pd_size;     /* allocated size of pd */
+  gint64                   data_offset;
+  int                      in_file;     /* index into the input file array */
+  struct merge_record_s   *next;        /* used by the read-ahead */
+} merge_record_t;
+
+/**
+ * State of a set of input files being read ahead in parallel.
+ */
+typedef struct merge_prefetch_s merge_prefetch_t;
+
+/** Start reading ahead from a number of input files.  If Wireshark was
+ * built with thread support, the files are read on a pool of worker
+ * threads, otherwise they are read as the packets are asked for.
+ *
+ * @param in_file_count number of entries in in_files
+ * @param in_files input file array, as opened by merge_open_in_files()
+ * @param do_append TRUE to return the packets in file sequence order,
+ * FALSE to return them in chronological order
+ * @return the read-ahead state
+ */
+extern merge_prefetch_t *
+merge_prefetch_open(int in_file_count, merge_in_file_t in_files[],
+                    gboolean do_append);
+
+/** Get the next packet from a set of files being read ahead.  The record
+ * is valid until the next call.
+ *
+ * @param prefetch read-ahead state
+ * @param err wiretap error, if failed
+ * @param err_info wiretap error string, if failed
+ * @return the packet, or NULL on error or EOF; on error, the state of
+ * the input file on which it happened is GOT_ERROR
+ */
+extern const merge_record_t *
+merge_prefetch_read_packet(merge_prefetch_t *prefetch, int *err,
+                           gchar **err_info);
+
+/** Stop reading ahead and free the read-ahead state.  The input files
+ * themselves are left open.
+ *
+ * @param prefetch read-ahead state
+ */
+extern void
+merge_prefetch_close(merge_prefetch_t *prefetch);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
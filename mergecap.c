@@ -155,8 +155,10 @@ main(int argc, char *argv[])
   int          out_fd;
   merge_in_file_t   *in_files      = NULL;
   int          i;
-  wtap        *wth;
-  struct wtap_pkthdr *phdr, snap_phdr;
+  merge_prefetch_t *prefetch;
+  const merge_record_t *rec;
+  const struct wtap_pkthdr *phdr;
+  struct wtap_pkthdr snap_phdr;
   wtap_dumper *pdh;
   int          open_err, read_err, write_err, close_err;
   gchar       *err_info;
@@ -169,6 +171,12 @@ main(int argc, char *argv[])
   arg_list_utf_16to8(argc, argv);
 #endif /* _WIN32 */
 
+#ifdef USE_THREADS
+  /* The input files are read ahead on worker threads */
+  if (!g_thread_supported())
+    g_thread_init(NULL);
+#endif
+
   /* Process the options first */
   while ((opt = getopt(argc, argv, "hvas:T:F:w:")) != -1) {
 
@@ -339,15 +347,11 @@ main(int argc, char *argv[])
   }
 
   /* do the merge (or append) */
+  prefetch = merge_prefetch_open(in_file_count, in_files, do_append);
   count = 1;
   for (;;) {
-    if (do_append)
-      wth = merge_append_read_packet(in_file_count, in_files, &read_err,
-                                     &err_info);
-    else
-      wth = merge_read_packet(in_file_count, in_files, &read_err,
-                              &err_info);
-    if (wth == NULL) {
+    rec = merge_prefetch_read_packet(prefetch, &read_err, &err_info);
+    if (rec == NULL) {
       if (read_err != 0)
         got_read_error = TRUE;
       break;
@@ -358,20 +362,20 @@ main(int argc, char *argv[])
 
     /* We simply write it, perhaps after truncating it; we could do other
      * things, like modify it. */
-    phdr = wtap_phdr(wth);
+    phdr = &rec->phdr;
     if (snaplen != 0 && phdr->caplen > snaplen) {
       snap_phdr = *phdr;
       snap_phdr.caplen = snaplen;
       phdr = &snap_phdr;
     }
 
-    if (!wtap_dump(pdh, phdr, wtap_pseudoheader(wth),
-         wtap_buf_ptr(wth), &write_err)) {
+    if (!wtap_dump(pdh, phdr, &rec->pseudo_header, rec->pd, &write_err)) {
       got_write_error = TRUE;
       break;
     }
   }
 
+  merge_prefetch_close(prefetch);
   merge_close_in_files(in_file_count, in_files);
   if (!got_read_error && !got_write_error) {
     if (!wtap_dump_close(pdh, &write_err))
@@ -44,6 +44,10 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_FOPENCOOKIE
+#define _GNU_SOURCE /* Otherwise fopencookie won't be declared */
+#endif
+
 #ifdef HAVE_LIBPCAP
 
 #include <stdlib.h>
@@ -57,6 +61,14 @@
 
 #include "pcapio.h"
 
+#if defined(USE_THREADS) && defined(HAVE_FOPENCOOKIE)
+#define ASYNC_OUTPUT
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
 /* Magic numbers in "libpcap" files.
 
    "libpcap" file records are written in the byte order of the host that
@@ -158,7 +170,7 @@ struct option {
 	guint16 value_length;
 };
 #define OPT_ENDOFOPT 0
-#define OPT_COMMENT  1 /* currently not used */
+#define OPT_COMMENT  1
 #define SHB_HARDWARE 2 /* currently not used */
 #define SHB_OS       3 /* currently not used */
 #define SHB_USERAPPL 4
@@ -167,6 +179,7 @@ struct option {
 #define ISB_IFRECV   4
 #define ISB_IFDROP   5
 #define ISB_FILTERACCEPT 6
+#define ISB_USRDELIV 8
 
 #define ADD_PADDING(x) ((((x) + 3) >> 2) << 2)
 
@@ -188,12 +201,310 @@ struct option {
 	} while (0);                                                                       \
 }
 
+#ifdef ASYNC_OUTPUT
+/*
+ * Asynchronous output.
+ *
+ * The FILE * we hand out is a cookie stream; what's written to it is
+ * copied into large buffers, and full buffers are written out by a
+ * thread of its own, so that the capture loop doesn't wait for the disk.
+ * The capture loop only waits if every buffer is full or being written;
+ * we count those waits, as they mean the storage can't keep up.
+ *
+ * Flushing hands over the buffer being filled, so it's written soon;
+ * syncing also waits for everything to be written, so that whoever reads
+ * the file sees all of it.
+ */
+#define ASYNC_BUFFER_COUNT	4
+#define ASYNC_PREALLOC_SIZE	(64*1024*1024)	/* how far ahead to allocate disk space */
+
+typedef struct {
+	guint8		*data;
+	size_t		 len;
+	gboolean	 sync;		/* the writer acknowledges this one when done */
+} async_buf_t;
+
+typedef struct {
+	int		 fd;
+	size_t		 buf_size;
+	async_buf_t	 bufs[ASYNC_BUFFER_COUNT];
+	async_buf_t	*cur;		/* being filled by the capture loop */
+	async_buf_t	 stop;		/* tells the writer to finish */
+	GAsyncQueue	*full_q;	/* capture loop -> writer */
+	GAsyncQueue	*free_q;	/* writer -> capture loop */
+	GAsyncQueue	*sync_q;	/* writer -> capture loop, for flushes */
+	GThread		*writer;
+	volatile gint	 err;		/* set by the writer */
+	/* only used by the writer */
+	gint64		 offset;
+	gint64		 allocated;
+	gboolean	 prealloc;
+} async_output_t;
+
+static size_t async_buf_size = 0;	/* 0 means synchronous output */
+static GHashTable *async_outputs = NULL;	/* FILE * -> async_output_t * */
+/* streams may be opened and closed on a thread other than the capture loop */
+static GStaticMutex async_outputs_lock = G_STATIC_MUTEX_INIT;
+static guint32 async_stalls = 0;
+static guint64 async_stall_usec = 0;
+
+/* the writer thread */
+static void *
+async_writer(void *arg)
+{
+	async_output_t *ao = (async_output_t *)arg;
+	async_buf_t *buf;
+	size_t done;
+	ssize_t n;
+
+	for (;;) {
+		buf = (async_buf_t *)g_async_queue_pop(ao->full_q);
+		if (buf == &ao->stop)
+			break;
+
+		if (g_atomic_int_get(&ao->err) == 0) {
+#ifdef FALLOC_FL_KEEP_SIZE
+			/* Allocate ahead, so the file doesn't fragment and we
+			   don't find out the disk is full in the middle of a
+			   write; the file size isn't changed. */
+			if (ao->prealloc && ao->offset + (gint64)buf->len > ao->allocated) {
+				if (fallocate(ao->fd, FALLOC_FL_KEEP_SIZE, (off_t)ao->allocated,
+				    ASYNC_PREALLOC_SIZE) == 0)
+					ao->allocated += ASYNC_PREALLOC_SIZE;
+				else
+					ao->prealloc = FALSE;	/* not supported here */
+			}
+#endif
+			for (done = 0; done < buf->len; done += n) {
+				n = write(ao->fd, buf->data + done, buf->len - done);
+				if (n < 0) {
+					if (errno == EINTR) {
+						n = 0;
+						continue;
+					}
+					g_atomic_int_set(&ao->err, errno);
+					break;
+				}
+			}
+			ao->offset += (gint64)buf->len;
+		}
+
+		buf->len = 0;
+		if (buf->sync) {
+			buf->sync = FALSE;
+			g_async_queue_push(ao->sync_q, buf);
+		} else
+			g_async_queue_push(ao->free_q, buf);
+	}
+	return NULL;
+}
+
+/* hand the buffer being filled to the writer and get an empty one */
+static void
+async_hand_over(async_output_t *ao, gboolean sync)
+{
+	GTimeVal start, end;
+
+	ao->cur->sync = sync;
+	g_async_queue_push(ao->full_q, ao->cur);
+	if (sync) {
+		/* The writer writes buffers in order, so once it's done with
+		   this one, it's done with everything. */
+		ao->cur = (async_buf_t *)g_async_queue_pop(ao->sync_q);
+		return;
+	}
+
+	ao->cur = (async_buf_t *)g_async_queue_try_pop(ao->free_q);
+	if (ao->cur == NULL) {
+		g_get_current_time(&start);
+		ao->cur = (async_buf_t *)g_async_queue_pop(ao->free_q);
+		g_get_current_time(&end);
+		async_stalls++;
+		async_stall_usec += (guint64)((end.tv_sec - start.tv_sec) * G_USEC_PER_SEC +
+		    (end.tv_usec - start.tv_usec));
+	}
+}
+
+static ssize_t
+async_cookie_write(void *cookie, const char *data, size_t size)
+{
+	async_output_t *ao = (async_output_t *)cookie;
+	size_t left = size, n;
+	int err;
+
+	while (left != 0) {
+		err = g_atomic_int_get(&ao->err);
+		if (err != 0) {
+			errno = err;
+			return -1;
+		}
+		n = MIN(left, ao->buf_size - ao->cur->len);
+		memcpy(ao->cur->data + ao->cur->len, data, n);
+		ao->cur->len += n;
+		data += n;
+		left -= n;
+		if (ao->cur->len == ao->buf_size)
+			async_hand_over(ao, FALSE);
+	}
+	return (ssize_t)size;
+}
+
+/* have what's been written so far written out soon; returns 0 or an
+   errno value */
+static int
+async_flush(async_output_t *ao)
+{
+	if (ao->cur->len != 0)
+		async_hand_over(ao, FALSE);
+	return g_atomic_int_get(&ao->err);
+}
+
+/* write out everything; returns 0 or an errno value */
+static int
+async_sync(async_output_t *ao)
+{
+	async_hand_over(ao, TRUE);
+	return g_atomic_int_get(&ao->err);
+}
+
+static void
+async_output_free(async_output_t *ao)
+{
+	int i;
+
+	for (i = 0; i < ASYNC_BUFFER_COUNT; i++)
+		g_free(ao->bufs[i].data);
+	g_async_queue_unref(ao->full_q);
+	g_async_queue_unref(ao->free_q);
+	g_async_queue_unref(ao->sync_q);
+	g_free(ao);
+}
+
+static int
+async_cookie_close(void *cookie)
+{
+	async_output_t *ao = (async_output_t *)cookie;
+	int err;
+
+	err = async_sync(ao);
+	g_async_queue_push(ao->full_q, &ao->stop);
+	g_thread_join(ao->writer);
+
+	/* Give back the disk space we allocated past the end. */
+	if (ao->allocated > ao->offset && err == 0) {
+		if (ftruncate(ao->fd, (off_t)ao->offset) == -1)
+			err = errno;
+	}
+	if (close(ao->fd) == -1 && err == 0)
+		err = errno;
+	async_output_free(ao);
+
+	if (err != 0) {
+		errno = err;
+		return -1;
+	}
+	return 0;
+}
+
+static FILE *
+async_fdopen(int fd, int *err)
+{
+	static cookie_io_functions_t async_io_funcs = {
+		NULL, async_cookie_write, NULL, async_cookie_close
+	};
+	async_output_t *ao;
+	struct stat statb;
+	GError *error = NULL;
+	FILE *fp;
+	int i;
+
+	ao = g_malloc0(sizeof(async_output_t));
+	ao->fd = fd;
+	ao->buf_size = async_buf_size;
+	ao->full_q = g_async_queue_new();
+	ao->free_q = g_async_queue_new();
+	ao->sync_q = g_async_queue_new();
+	for (i = 0; i < ASYNC_BUFFER_COUNT; i++) {
+		ao->bufs[i].data = g_malloc(ao->buf_size);
+		if (i != 0)
+			g_async_queue_push(ao->free_q, &ao->bufs[i]);
+	}
+	ao->cur = &ao->bufs[0];
+	if (fstat(fd, &statb) == 0 && S_ISREG(statb.st_mode)) {
+		ao->offset = (gint64)lseek(fd, 0, SEEK_CUR);
+		ao->allocated = ao->offset;
+		ao->prealloc = TRUE;
+	}
+
+	ao->writer = g_thread_create(async_writer, ao, TRUE, &error);
+	if (ao->writer == NULL) {
+		/* Fall back to writing synchronously. */
+		g_error_free(error);
+		async_output_free(ao);
+		fp = fdopen(fd, "wb");
+		if (fp == NULL)
+			*err = errno;
+		return fp;
+	}
+
+	fp = fopencookie(ao, "wb", async_io_funcs);
+	if (fp == NULL) {
+		*err = errno;
+		g_async_queue_push(ao->full_q, &ao->stop);
+		g_thread_join(ao->writer);
+		async_output_free(ao);
+		return NULL;
+	}
+
+	/* We do our own buffering. */
+	setvbuf(fp, NULL, _IONBF, 0);
+	g_static_mutex_lock(&async_outputs_lock);
+	if (async_outputs == NULL)
+		async_outputs = g_hash_table_new(g_direct_hash, g_direct_equal);
+	g_hash_table_insert(async_outputs, fp, ao);
+	g_static_mutex_unlock(&async_outputs_lock);
+	return fp;
+}
+#endif /* ASYNC_OUTPUT */
+
+/* Write to files opened from now on with a thread of their own, through
+   buffers of the given size; 0 turns that off.  Returns FALSE if that
+   isn't supported here. */
+gboolean
+libpcap_set_async_output(size_t buffer_size)
+{
+#ifdef ASYNC_OUTPUT
+	async_buf_size = buffer_size;
+	return TRUE;
+#else
+	return buffer_size == 0;
+#endif
+}
+
+/* Get the number of times, and the total time, the capture had to wait
+   because asynchronous output couldn't keep up. */
+void
+libpcap_get_async_stalls(guint32 *stalls, guint64 *stall_usec)
+{
+#ifdef ASYNC_OUTPUT
+	*stalls = async_stalls;
+	*stall_usec = async_stall_usec;
+#else
+	*stalls = 0;
+	*stall_usec = 0;
+#endif
+}
+
 /* Returns a FILE * to write to on success, NULL on failure */
 FILE *
 libpcap_fdopen(int fd, int *err)
 {
 	FILE *fp;
 
+#ifdef ASYNC_OUTPUT
+	if (async_buf_size != 0)
+		return async_fdopen(fd, err);
+#endif
 	fp = fdopen(fd, "wb");
 	if (fp == NULL) {
 		*err = errno;
@@ -315,6 +626,7 @@ gboolean
 libpcap_write_interface_description_block(FILE *fp,
                                           char *name,
                                           char *filter,
+                                          char *comment,
                                           int link_type,
                                           int snap_len,
                                           long *bytes_written,
@@ -325,7 +637,13 @@ libpcap_write_interface_description_block(FILE *fp,
 	guint32 block_total_length;
 	const guint32 padding = 0;
 
+	if (comment == NULL)
+		comment = "";
 	block_total_length = sizeof(struct idb) + sizeof(guint32);
+	if ((strlen(comment) > 0) && (strlen(comment) < G_MAXUINT16)) {
+		block_total_length += sizeof(struct option) +
+		                      (guint16)(ADD_PADDING(strlen(comment) + 1));
+	}
 	if ((strlen(name) > 0) && (strlen(name) < G_MAXUINT16)) {
 		block_total_length += sizeof(struct option) +
 		                      (guint16)(ADD_PADDING(strlen(name) + 1));
@@ -334,7 +652,8 @@ libpcap_write_interface_description_block(FILE *fp,
 		block_total_length += sizeof(struct option) +
 		                      (guint16)(ADD_PADDING(strlen(filter) + 1));
 	}
-	if (((strlen(name) > 0) && (strlen(name) < G_MAXUINT16)) ||
+	if (((strlen(comment) > 0) && (strlen(comment) < G_MAXUINT16)) ||
+	    ((strlen(name) > 0) && (strlen(name) < G_MAXUINT16)) ||
 	    ((strlen(filter) > 0) && (strlen(filter) < G_MAXUINT16))) {
 		block_total_length += sizeof(struct option);
 	}
@@ -345,6 +664,16 @@ libpcap_write_interface_description_block(FILE *fp,
 	idb.reserved = 0;
 	idb.snap_len = snap_len;
 	WRITE_DATA(fp, &idb, sizeof(struct idb), *bytes_written, err);
+	/* write comment string if applicable */
+	if ((strlen(comment) > 0) && (strlen(comment) < G_MAXUINT16)) {
+		option.type = OPT_COMMENT;
+		option.value_length = (guint16)(strlen(comment) + 1);
+		WRITE_DATA(fp, &option, sizeof(struct option), *bytes_written, err);
+		WRITE_DATA(fp, comment, strlen(comment) + 1, *bytes_written, err);
+		if ((strlen(comment) + 1) % 4) {
+			WRITE_DATA(fp, &padding, 4 - (strlen(comment) + 1) % 4 , *bytes_written, err);
+		}
+	}
 	/* write interface name string if applicable */
 	if ((strlen(name) > 0) && (strlen(name) < G_MAXUINT16)) {
 		option.type = IDB_NAME;
@@ -366,7 +695,8 @@ libpcap_write_interface_description_block(FILE *fp,
 		}
 	}
 	/* write endofopt option if there were any options */
-	if (((strlen(name) > 0) && (strlen(name) < G_MAXUINT16)) ||
+	if (((strlen(comment) > 0) && (strlen(comment) < G_MAXUINT16)) ||
+	    ((strlen(name) > 0) && (strlen(name) < G_MAXUINT16)) ||
 	    ((strlen(filter) > 0) && (strlen(filter) < G_MAXUINT16))) {
 		option.type = OPT_ENDOFOPT;
 		option.value_length = 0;
@@ -417,6 +747,8 @@ gboolean
 libpcap_write_interface_statistics_block(FILE *fp,
                                          guint32 interface_id,
                                          pcap_t *pd,
+                                         guint64 filter_accept,
+                                         guint64 user_deliv,
                                          long *bytes_written,
                                          int *err)
 {
@@ -469,7 +801,9 @@ libpcap_write_interface_statistics_block(FILE *fp,
 	timestamp = (guint64)(now.tv_sec) * 1000000 +
 	            (guint64)(now.tv_usec);
 #endif
-	if (pcap_stats(pd, &stats) < 0) {
+	if (pd == NULL) {
+		stats_retrieved = FALSE;
+	} else if (pcap_stats(pd, &stats) < 0) {
 		stats_retrieved = FALSE;
 		g_warning("pcap_stats() failed.");
 	} else {
@@ -478,7 +812,13 @@ libpcap_write_interface_statistics_block(FILE *fp,
 	block_total_length = sizeof(struct isb) +
 	                     sizeof(guint32);
 	if (stats_retrieved) {
-		block_total_length += 3 * sizeof(struct option) + 2 * sizeof(guint64);
+		block_total_length += 2 * sizeof(struct option) + 2 * sizeof(guint64);
+	}
+	if (filter_accept != 0) {
+		block_total_length += 2 * sizeof(struct option) + 2 * sizeof(guint64);
+	}
+	if (stats_retrieved || filter_accept != 0) {
+		block_total_length += sizeof(struct option);
 	}
 	isb.block_type = INTERFACE_STATISTICS_BLOCK_TYPE;
 	isb.block_total_length = block_total_length;
@@ -499,6 +839,19 @@ libpcap_write_interface_statistics_block(FILE *fp,
 		counter = stats.ps_drop;
 		WRITE_DATA(fp, &option, sizeof(struct option), *bytes_written, err);
 		WRITE_DATA(fp, &counter, sizeof(guint64), *bytes_written, err);
+	}
+	if (filter_accept != 0) {
+		/* packets that passed the filter, and how many of them we kept */
+		option.type = ISB_FILTERACCEPT;
+		option.value_length = sizeof(guint64);
+		WRITE_DATA(fp, &option, sizeof(struct option), *bytes_written, err);
+		WRITE_DATA(fp, &filter_accept, sizeof(guint64), *bytes_written, err);
+		option.type = ISB_USRDELIV;
+		option.value_length = sizeof(guint64);
+		WRITE_DATA(fp, &option, sizeof(struct option), *bytes_written, err);
+		WRITE_DATA(fp, &user_deliv, sizeof(guint64), *bytes_written, err);
+	}
+	if (stats_retrieved || filter_accept != 0) {
 		/* last option */
 		option.type = OPT_ENDOFOPT;
 		option.value_length = 0;
@@ -509,20 +862,58 @@ libpcap_write_interface_statistics_block(FILE *fp,
 	return TRUE;
 }
 
-gboolean
-libpcap_dump_flush(FILE *pd, int *err)
+static gboolean
+libpcap_dump_flush_or_sync(FILE *pd, gboolean sync, int *err)
 {
+#ifdef ASYNC_OUTPUT
+	async_output_t *ao;
+#endif
+
 	if (fflush(pd) == EOF) {
 		if (err != NULL)
 			*err = errno;
 		return FALSE;
 	}
+#ifdef ASYNC_OUTPUT
+	ao = NULL;
+	g_static_mutex_lock(&async_outputs_lock);
+	if (async_outputs != NULL)
+		ao = (async_output_t *)g_hash_table_lookup(async_outputs, pd);
+	g_static_mutex_unlock(&async_outputs_lock);
+	if (ao != NULL) {
+		int async_err = sync ? async_sync(ao) : async_flush(ao);
+
+		if (async_err != 0) {
+			if (err != NULL)
+				*err = async_err;
+			return FALSE;
+		}
+	}
+#endif
 	return TRUE;
 }
 
+gboolean
+libpcap_dump_flush(FILE *pd, int *err)
+{
+	return libpcap_dump_flush_or_sync(pd, FALSE, err);
+}
+
+gboolean
+libpcap_dump_sync(FILE *pd, int *err)
+{
+	return libpcap_dump_flush_or_sync(pd, TRUE, err);
+}
+
 gboolean
 libpcap_dump_close(FILE *pd, int *err)
 {
+#ifdef ASYNC_OUTPUT
+	g_static_mutex_lock(&async_outputs_lock);
+	if (async_outputs != NULL)
+		g_hash_table_remove(async_outputs, pd);
+	g_static_mutex_unlock(&async_outputs_lock);
+#endif
 	if (fclose(pd) == EOF) {
 		if (err != NULL)
 			*err = errno;
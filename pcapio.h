@@ -25,6 +25,17 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
  */
 
+/* Write files opened from now on through buffers of the given size,
+   which a thread of its own writes out; 0 turns that off.
+   Returns FALSE if that isn't supported here. */
+extern gboolean
+libpcap_set_async_output(size_t buffer_size);
+
+/* Get the number of times, and the total time, the caller had to wait
+   because asynchronous output couldn't keep up with it. */
+extern void
+libpcap_get_async_stalls(guint32 *stalls, guint64 *stall_usec);
+
 /* Returns a FILE * to write to on success, NULL on failure */
 extern FILE *
 libpcap_fdopen(int fd, int *err);
@@ -51,6 +62,7 @@ extern gboolean
 libpcap_write_interface_description_block(FILE *fp,
                                           char *name,
                                           char *filter,
+                                          char *comment,
                                           int link_type,
                                           int snap_len,
                                           long *bytes_written,
@@ -60,6 +72,8 @@ extern gboolean
 libpcap_write_interface_statistics_block(FILE *fp,
                                          guint32 interface_id,
                                          pcap_t *pd,
+                                         guint64 filter_accept,
+                                         guint64 user_deliv,
                                          long *bytes_written,
                                          int *err);
 
@@ -71,8 +85,15 @@ libpcap_write_enhanced_packet_block(FILE *fp,
                                     long *bytes_written,
                                     int *err);
 
+/* Write out what's been written to a dump file so far.  With
+   asynchronous output, that's only started; see libpcap_dump_sync(). */
 extern gboolean
 libpcap_dump_flush(FILE *pd, int *err);
 
+/* Write out what's been written to a dump file so far, and wait until
+   it's all in the file, so that others reading it see all of it. */
+extern gboolean
+libpcap_dump_sync(FILE *pd, int *err);
+
 extern gboolean
 libpcap_dump_close(FILE *pd, int *err);
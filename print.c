@@ -84,6 +84,8 @@ struct _output_fields {
     GHashTable* field_indicies;
     emem_strbuf_t** field_values;
     gchar quote;
+    GPtrArray* field_dfilters;
+    gboolean field_dfilters_ok;
 };
 
 GHashTable *output_only_tables = NULL;
@@ -1306,6 +1308,8 @@ output_fields_t* output_fields_new(void)
     fields->field_indicies = NULL;
     fields->field_values = NULL;
     fields->quote='\0';
+    fields->field_dfilters = NULL; /*Do lazy initialisation */
+    fields->field_dfilters_ok = FALSE;
     return fields;
 }
 
@@ -1338,6 +1342,13 @@ void output_fields_free(output_fields_t* fields)
         }
         g_ptr_array_free(fields->fields, TRUE);
     }
+    if(NULL != fields->field_dfilters) {
+        gsize i;
+        for(i = 0; i < fields->field_dfilters->len; ++i) {
+            dfilter_free((dfilter_t *)g_ptr_array_index(fields->field_dfilters, i));
+        }
+        g_ptr_array_free(fields->field_dfilters, TRUE);
+    }
 
     g_free(fields);
 }
@@ -1359,6 +1370,59 @@ void output_fields_add(output_fields_t* fields, const gchar* field)
     g_ptr_array_add(fields->fields, field_copy);
 }
 
+/* Compile each field as a filter, so that a tree can be primed with it;
+ * this is only done once.  Returns FALSE if a field isn't known, or is a
+ * protocol, whose value is the text of its tree item. */
+static gboolean output_fields_compile(output_fields_t* fields)
+{
+    gsize i;
+
+    if(NULL != fields->field_dfilters) {
+        return fields->field_dfilters_ok;
+    }
+
+    fields->field_dfilters = g_ptr_array_new();
+    fields->field_dfilters_ok = TRUE;
+    for(i = 0; i < output_fields_num_fields(fields); ++i) {
+        gchar* field = (gchar *)g_ptr_array_index(fields->fields, i);
+        header_field_info* hfinfo = proto_registrar_get_byname(field);
+        dfilter_t* dfcode;
+
+        if(NULL == hfinfo || FT_PROTOCOL == hfinfo->type ||
+           !dfilter_compile(field, &dfcode) || NULL == dfcode) {
+            fields->field_dfilters_ok = FALSE;
+            break;
+        }
+        g_ptr_array_add(fields->field_dfilters, dfcode);
+    }
+
+    return fields->field_dfilters_ok;
+}
+
+gboolean output_fields_can_prime(output_fields_t* fields)
+{
+    g_assert(fields);
+
+    return output_fields_compile(fields);
+}
+
+void output_fields_prime_edt(output_fields_t* fields, epan_dissect_t *edt)
+{
+    gsize i;
+
+    g_assert(fields);
+    g_assert(edt);
+
+    if(!output_fields_compile(fields)) {
+        return;
+    }
+
+    for(i = 0; i < fields->field_dfilters->len; ++i) {
+        epan_dissect_prime_dfilter(edt,
+            (dfilter_t *)g_ptr_array_index(fields->field_dfilters, i));
+    }
+}
+
 gboolean output_fields_set_option(output_fields_t* info, gchar* option)
 {
     const gchar* option_name;
@@ -120,6 +120,12 @@ extern gsize output_fields_num_fields(output_fields_t* info);
 extern gboolean output_fields_set_option(output_fields_t* info, gchar* option);
 extern void output_fields_list_options(FILE *fh);
 
+/* Can the fields be had from an invisible tree primed with them, rather
+ * than a visible one?  (Not if any of them is a protocol.) */
+extern gboolean output_fields_can_prime(output_fields_t* info);
+/* Prime the tree of a dissection with the fields */
+extern void output_fields_prime_edt(output_fields_t* info, epan_dissect_t *edt);
+
 /*
  * Output only these protocols
  */
@@ -40,12 +40,22 @@
  * the files at switch and not the capture stop, and by closing them which
  * makes possible their move or deletion after a switch).
  *
+ * When built with threads, the next file is created ahead of time by a
+ * worker thread, under a hidden "spare" name, with its space allocated
+ * up front; a switch only has to rename it and swap streams.  The old
+ * file is closed, and the file it replaces in the ring deleted, by the
+ * worker as well, so none of that holds up the capture.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+#ifdef __linux__
+#define _GNU_SOURCE	/* for fallocate() */
+#endif
+
 #ifdef HAVE_LIBPCAP
 
 #ifdef HAVE_FCNTL_H
@@ -56,6 +66,10 @@
 #include <unistd.h>
 #endif
 
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
@@ -70,6 +84,27 @@
 #include <wsutil/file_util.h>
 
 
+#ifdef USE_THREADS
+#define RINGBUF_WORKER
+#endif
+
+#ifdef RINGBUF_WORKER
+/* Work for the worker thread */
+typedef enum {
+  RB_JOB_PREPARE,   /* create the spare file; the result goes to ready_q */
+  RB_JOB_CLOSE,     /* close a file we've switched away from */
+  RB_JOB_UNLINK,    /* delete a file that dropped out of the ring */
+  RB_JOB_QUIT
+} rb_job_type;
+
+typedef struct _rb_job {
+  rb_job_type   type;
+  FILE         *pdh;
+  int           fd;
+  gchar        *name;
+} rb_job;
+#endif
+
 /* Ringbuffer file structure */
 typedef struct _rb_file {
   gchar		*name;
@@ -87,28 +122,30 @@ typedef struct _ringbuf_data {
   int           fd;		     /* Current ringbuffer file descriptor */
   FILE         *pdh;
   gboolean      group_read_access;   /* TRUE if files need to be opened with group read access */
+  gint64        prealloc_size;       /* Space to allocate for each file up front, or 0 */
+
+#ifdef RINGBUF_WORKER
+  GThread      *worker;
+  GAsyncQueue  *job_q;               /* capture loop -> worker */
+  GAsyncQueue  *ready_q;             /* worker -> capture loop: the spare file */
+  gchar        *spare_name;          /* Name the spare file is created under */
+  gboolean      spare_pending;       /* TRUE if a spare has been asked for and not taken */
+  volatile gint close_err;           /* Error from closing a file on the worker */
+#endif
 } ringbuf_data;
 
 static ringbuf_data rb_data;
 
 
 /*
- * create the next filename and open a new binary file with that name
+ * create the next filename
  */
-static int ringbuf_open_file(rb_file *rfile, int *err)
+static gchar *ringbuf_make_name(void)
 {
   char    filenum[5+1];
   char    timestr[14+1];
   time_t  current_time;
 
-  if (rfile->name != NULL) {
-    if (rb_data.unlimited == FALSE) {
-      /* remove old file (if any, so ignore error) */
-      ws_unlink(rfile->name);
-    }
-    g_free(rfile->name);
-  }
-
 #ifdef _WIN32
   _tzset();
 #endif
@@ -116,12 +153,51 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
 
   g_snprintf(filenum, sizeof(filenum), "%05u", (rb_data.curr_file_num + 1) % RINGBUFFER_MAX_NUM_FILES);
   strftime(timestr, sizeof(timestr), "%Y%m%d%H%M%S", localtime(&current_time));
-  rfile->name = g_strconcat(rb_data.fprefix, "_", filenum, "_", timestr,
-			    rb_data.fsuffix, NULL);
+  return g_strconcat(rb_data.fprefix, "_", filenum, "_", timestr,
+		     rb_data.fsuffix, NULL);
+}
 
-  if (rfile->name == NULL) {
-    *err = ENOMEM;
-    return -1;
+/*
+ * give a file of the ring a new name; returns the name it replaces in the
+ * ring, if that file is to be removed
+ */
+static gchar *ringbuf_set_name(rb_file *rfile, gchar *name)
+{
+  gchar  *old_name = NULL;
+
+  if (rfile->name != NULL) {
+    if (rb_data.unlimited == FALSE) {
+      old_name = rfile->name;
+    } else {
+      g_free(rfile->name);
+    }
+  }
+  rfile->name = name;
+
+  return old_name;
+}
+
+/*
+ * create the next filename; returns the name it replaces in the ring, if
+ * that file is to be removed
+ */
+static gchar *ringbuf_next_name(rb_file *rfile)
+{
+  return ringbuf_set_name(rfile, ringbuf_make_name());
+}
+
+/*
+ * create the next filename and open a new binary file with that name
+ */
+static int ringbuf_open_file(rb_file *rfile, int *err)
+{
+  gchar  *old_name;
+
+  old_name = ringbuf_next_name(rfile);
+  if (old_name != NULL) {
+    /* remove old file (if any, so ignore error) */
+    ws_unlink(old_name);
+    g_free(old_name);
   }
 
   rb_data.fd = ws_open(rfile->name, O_RDWR|O_BINARY|O_TRUNC|O_CREAT, 
@@ -134,11 +210,234 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
   return rb_data.fd;
 }
 
+/*
+ * close a ringbuffer file, giving back any space allocated for it beyond
+ * what was written
+ */
+static gboolean ringbuf_close_file(FILE *pdh, int fd, int *err)
+{
+#if defined(RINGBUF_WORKER) && defined(FALLOC_FL_KEEP_SIZE)
+  struct stat statb;
+
+  if (rb_data.prealloc_size > 0 && libpcap_dump_sync(pdh, err) &&
+      fstat(fd, &statb) == 0 && ftruncate(fd, statb.st_size) == -1) {
+    /* The file is complete; only the space beyond its end is wasted */
+    g_warning("Couldn't free the space allocated beyond the end of a ring buffer file: %s",
+              g_strerror(errno));
+  }
+#endif
+  if (!libpcap_dump_close(pdh, err)) {
+    ws_close(fd);	/* XXX - the above should have closed this already */
+    return FALSE;
+  }
+  return TRUE;
+}
+
+#ifdef RINGBUF_WORKER
+/*
+ * create, allocate and open the spare file
+ */
+static void ringbuf_prepare_spare(rb_job *job)
+{
+  int err;
+
+  job->pdh = NULL;
+  job->fd = ws_open(rb_data.spare_name, O_RDWR|O_BINARY|O_TRUNC|O_CREAT,
+                    rb_data.group_read_access ? 0640 : 0600);
+  if (job->fd == -1)
+    return;
+
+#ifdef FALLOC_FL_KEEP_SIZE
+  /* Just a hint, so the file doesn't fragment; it isn't fatal if the file
+     system can't do it.  The file size isn't changed. */
+  if (rb_data.prealloc_size > 0)
+    fallocate(job->fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)rb_data.prealloc_size);
+#endif
+
+  job->pdh = libpcap_fdopen(job->fd, &err);
+  if (job->pdh == NULL) {
+    ws_close(job->fd);
+    ws_unlink(rb_data.spare_name);
+    job->fd = -1;
+  }
+}
+
+/*
+ * close a file we've switched away from on the worker
+ */
+static void ringbuf_close_old(rb_job *job)
+{
+  int err = 0;
+
+  if (!ringbuf_close_file(job->pdh, job->fd, &err)) {
+    g_atomic_int_set(&rb_data.close_err, err);
+  }
+}
+
+static gpointer ringbuf_worker(gpointer arg _U_)
+{
+  rb_job *job;
+
+  for (;;) {
+    job = (rb_job *)g_async_queue_pop(rb_data.job_q);
+    switch (job->type) {
+
+    case RB_JOB_PREPARE:
+      ringbuf_prepare_spare(job);
+      g_async_queue_push(rb_data.ready_q, job);
+      continue;	/* the capture loop frees it */
+
+    case RB_JOB_CLOSE:
+      ringbuf_close_old(job);
+      break;
+
+    case RB_JOB_UNLINK:
+      /* ignore error, as we always did */
+      ws_unlink(job->name);
+      g_free(job->name);
+      break;
+
+    case RB_JOB_QUIT:
+      g_free(job);
+      return NULL;
+    }
+    g_free(job);
+  }
+}
+
+static void ringbuf_queue_job(rb_job_type type, FILE *pdh, int fd, gchar *name)
+{
+  rb_job *job = (rb_job *)g_malloc(sizeof(rb_job));
+
+  job->type = type;
+  job->pdh = pdh;
+  job->fd = fd;
+  job->name = name;
+  g_async_queue_push(rb_data.job_q, job);
+}
+
+/*
+ * start the worker, and have it make the first spare file
+ */
+static void ringbuf_start_worker(void)
+{
+  GError *error = NULL;
+  gchar  *dir, *base;
+
+  dir = g_path_get_dirname(rb_data.fprefix);
+  base = g_path_get_basename(rb_data.fprefix);
+  rb_data.spare_name = g_strdup_printf("%s%s.%s_spare%s", dir, G_DIR_SEPARATOR_S,
+                                       base, rb_data.fsuffix ? rb_data.fsuffix : "");
+  g_free(dir);
+  g_free(base);
+
+  rb_data.job_q = g_async_queue_new();
+  rb_data.ready_q = g_async_queue_new();
+  rb_data.close_err = 0;
+  rb_data.worker = g_thread_create(ringbuf_worker, NULL, TRUE, &error);
+  if (rb_data.worker == NULL) {
+    /* Carry on without; we'll open each file as we switch to it. */
+    g_error_free(error);
+    return;
+  }
+  ringbuf_queue_job(RB_JOB_PREPARE, NULL, -1, NULL);
+  rb_data.spare_pending = TRUE;
+}
+
+/*
+ * finish any outstanding work, and get rid of the spare file
+ */
+static void ringbuf_stop_worker(void)
+{
+  rb_job *job;
+
+  if (rb_data.worker != NULL) {
+    ringbuf_queue_job(RB_JOB_QUIT, NULL, -1, NULL);
+    g_thread_join(rb_data.worker);
+    rb_data.worker = NULL;
+
+    while ((job = (rb_job *)g_async_queue_try_pop(rb_data.ready_q)) != NULL) {
+      if (job->pdh != NULL) {
+        libpcap_dump_close(job->pdh, NULL);
+        ws_unlink(rb_data.spare_name);
+      }
+      g_free(job);
+    }
+    rb_data.spare_pending = FALSE;
+  }
+  if (rb_data.job_q != NULL) {
+    g_async_queue_unref(rb_data.job_q);
+    rb_data.job_q = NULL;
+  }
+  if (rb_data.ready_q != NULL) {
+    g_async_queue_unref(rb_data.ready_q);
+    rb_data.ready_q = NULL;
+  }
+  if (rb_data.spare_name != NULL) {
+    g_free(rb_data.spare_name);
+    rb_data.spare_name = NULL;
+  }
+}
+
+/*
+ * switch to the spare file, if it's ready; the old file is handed to the
+ * worker to close
+ */
+static gboolean ringbuf_switch_to_spare(rb_file *next_rfile, int *err)
+{
+  rb_job *job;
+  gchar  *new_name, *old_name;
+
+  if (!rb_data.spare_pending)
+    return FALSE;
+  job = (rb_job *)g_async_queue_try_pop(rb_data.ready_q);
+  if (job == NULL)
+    return FALSE;	/* not ready yet; it'll be there next time */
+  rb_data.spare_pending = FALSE;
+  if (job->pdh == NULL) {
+    /* Couldn't create it; try again for the next switch. */
+    g_free(job);
+    ringbuf_queue_job(RB_JOB_PREPARE, NULL, -1, NULL);
+    rb_data.spare_pending = TRUE;
+    return FALSE;
+  }
+
+  /* the ring keeps the old file until the spare has taken its place */
+  new_name = ringbuf_make_name();
+  if (ws_rename(rb_data.spare_name, new_name) == -1) {
+    *err = errno;
+    libpcap_dump_close(job->pdh, NULL);
+    ws_unlink(rb_data.spare_name);
+    g_free(job);
+    g_free(new_name);
+    return FALSE;
+  }
+  old_name = ringbuf_set_name(next_rfile, new_name);
+  if (old_name != NULL) {
+    /* if it has the same name, the rename has replaced it already */
+    if (strcmp(old_name, next_rfile->name) != 0)
+      ringbuf_queue_job(RB_JOB_UNLINK, NULL, -1, old_name);
+    else
+      g_free(old_name);
+  }
+
+  ringbuf_queue_job(RB_JOB_CLOSE, rb_data.pdh, rb_data.fd, NULL);
+  rb_data.pdh = job->pdh;
+  rb_data.fd = job->fd;
+  g_free(job);
+
+  ringbuf_queue_job(RB_JOB_PREPARE, NULL, -1, NULL);
+  rb_data.spare_pending = TRUE;
+  return TRUE;
+}
+#endif /* RINGBUF_WORKER */
+
 /*
  * Initialize the ringbuffer data structures
  */
 int
-ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_access)
+ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_access,
+             gint64 prealloc_size)
 {
   unsigned int i;
   char        *pfx, *last_pathsep;
@@ -152,6 +451,14 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
   rb_data.fd = -1;
   rb_data.pdh = NULL;
   rb_data.group_read_access = group_read_access;
+  rb_data.prealloc_size = prealloc_size;
+#ifdef RINGBUF_WORKER
+  rb_data.worker = NULL;
+  rb_data.job_q = NULL;
+  rb_data.ready_q = NULL;
+  rb_data.spare_name = NULL;
+  rb_data.spare_pending = FALSE;
+#endif
 
   /* just to be sure ... */
   if (num_files <= RINGBUFFER_MAX_NUM_FILES) {
@@ -218,6 +525,11 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
     return -1;
   }
 
+#ifdef RINGBUF_WORKER
+  /* and have the next one made while we're writing to it */
+  ringbuf_start_worker();
+#endif
+
   return rb_data.fd;
 }
 
@@ -246,10 +558,25 @@ ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd, int *err)
   int     next_file_index;
   rb_file *next_rfile = NULL;
 
+#ifdef RINGBUF_WORKER
+  /* did closing an earlier file fail? */
+  *err = g_atomic_int_get(&rb_data.close_err);
+  if (*err != 0)
+    return FALSE;
+
+  next_file_index = (rb_data.curr_file_num + 1) % rb_data.num_files;
+  next_rfile = &rb_data.files[next_file_index];
+  if (ringbuf_switch_to_spare(next_rfile, err)) {
+    rb_data.curr_file_num++;
+    goto switched;
+  }
+  if (*err != 0)
+    return FALSE;
+#endif
+
   /* close current file */
 
-  if (!libpcap_dump_close(rb_data.pdh, err)) {
-    ws_close(rb_data.fd);	/* XXX - the above should have closed this already */
+  if (!ringbuf_close_file(rb_data.pdh, rb_data.fd, err)) {
     rb_data.pdh = NULL;	/* it's still closed, we just got an error while closing */
     rb_data.fd = -1;
     return FALSE;
@@ -272,6 +599,9 @@ ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd, int *err)
     return FALSE;
   }
 
+#ifdef RINGBUF_WORKER
+switched:
+#endif
   /* switch to the new file */
   *save_file = next_rfile->name;
   *save_file_fd = rb_data.fd;
@@ -290,8 +620,7 @@ ringbuf_libpcap_dump_close(gchar **save_file, int *err)
 
   /* close current file, if it's open */
   if (rb_data.pdh != NULL) {
-    if (!libpcap_dump_close(rb_data.pdh, err)) {
-      ws_close(rb_data.fd);
+    if (!ringbuf_close_file(rb_data.pdh, rb_data.fd, err)) {
       ret_val = FALSE;
     }
 
@@ -299,6 +628,15 @@ ringbuf_libpcap_dump_close(gchar **save_file, int *err)
     rb_data.fd  = -1;
   }
 
+#ifdef RINGBUF_WORKER
+  /* wait for the older files to be closed */
+  ringbuf_stop_worker();
+  if (ret_val && rb_data.close_err != 0) {
+    *err = rb_data.close_err;
+    ret_val = FALSE;
+  }
+#endif
+
   /* set the save file name to the current file */
   *save_file = rb_data.files[rb_data.curr_file_num % rb_data.num_files].name;
   return ret_val;
@@ -312,6 +650,10 @@ ringbuf_free(void)
 {
   unsigned int i;
 
+#ifdef RINGBUF_WORKER
+  ringbuf_stop_worker();
+#endif
+
   if (rb_data.files != NULL) {
     for (i=0; i < rb_data.num_files; i++) {
       if (rb_data.files[i].name != NULL) {
@@ -340,6 +682,10 @@ ringbuf_error_cleanup(void)
 {
   unsigned int i;
 
+#ifdef RINGBUF_WORKER
+  ringbuf_stop_worker();
+#endif
+
   /* try to close via wtap */
   if (rb_data.pdh != NULL) {
     if (libpcap_dump_close(rb_data.pdh, NULL)) {
@@ -56,12 +56,100 @@
 #define SP_PACKET_COUNT 'P'     /* count of packets captured since last message */
 #define SP_DROPS        'D'     /* count of packets dropped in capture */
 #define SP_SUCCESS      'S'     /* success indication, no extra data */
+#define SP_BATCH        'C'     /* batch of binary records, see below */
 /*
  * Win32 only: Indications sent out on the signal pipe (from parent to child)
  * (UNIX-like sends signals for this)
  */
 #define SP_QUIT         'Q'     /* "gracefully" capture quit message (SIGUSR1) */
 
+/*
+ * An SP_BATCH message carries, in one block, everything the capture
+ * child has to tell its parent about a running capture since the last
+ * batch, so that the parent is woken up and has to parse only once per
+ * batch.  The block starts with a 1-byte version (SP_BATCH_VERSION),
+ * followed by records, each of them a 1-byte record type, a 2-byte
+ * value length, and the value.  All integers are in network byte order.
+ * Records are processed in order; record types the parent doesn't know
+ * about are skipped.
+ */
+#define SP_BATCH_VERSION    1
+
+#define SP_REC_PACKETS      1   /* 4-byte count of packets written since the previous one */
+#define SP_REC_FILE         2   /* name of the new capture file, '\0'-terminated */
+#define SP_REC_IF_STATS     3   /* sync_pipe_if_stats_t, as 6 4-byte values */
+#define SP_REC_WRITER_STALLS 4  /* 4-byte count of times, and 8-byte microseconds, the
+                                   capture waited for the capture file to be written */
+#define SP_REC_FLOW_TRUNC   5   /* 8-byte counts of packets cut short by per-flow
+                                   truncation, and of the bytes cut off */
+#define SP_REC_SAMPLING     6   /* 8-byte counts of packets left out by sampling, and
+                                   by the rate limit; these aren't drops */
+
+#define SP_REC_HDR_LEN      3
+#define SP_REC_IF_STATS_LEN (6*4)
+#define SP_REC_WRITER_STALLS_LEN (4+8)
+#define SP_REC_FLOW_TRUNC_LEN (8+8)
+#define SP_REC_SAMPLING_LEN (8+8)
+
+/** Statistics for one capture interface, as of the time stamp. */
+typedef struct {
+    guint32 iface;              /**< index of the interface in the capture */
+    guint32 ts_sec;             /**< time the statistics were taken */
+    guint32 ts_usec;
+    guint32 received;           /**< packets received by the filter */
+    guint32 dropped;            /**< packets dropped for lack of buffer space */
+    guint32 if_dropped;         /**< packets dropped by the interface */
+} sync_pipe_if_stats_t;
+
+/** A batch being put together by the capture child. */
+typedef struct {
+    int      pipe_fd;
+    int      len;               /**< bytes of block data, version byte included */
+    int      packets_off;       /**< offset in buf of the last SP_REC_PACKETS value, or -1 */
+    guchar   buf[4+SP_MAX_MSG_LEN]; /**< message header, then block data */
+} sync_pipe_batch_t;
+
+/* start an (empty) batch for the given pipe */
+extern void
+sync_pipe_batch_init(sync_pipe_batch_t *batch, int pipe_fd);
+
+/* add packets written to the current file; coalesced with a previous
+   count unless a file switch came in between */
+extern void
+sync_pipe_batch_add_packets(sync_pipe_batch_t *batch, guint32 packets);
+
+/* add a switch to a new capture file */
+extern void
+sync_pipe_batch_add_file(sync_pipe_batch_t *batch, const char *filename);
+
+/* add interface statistics; replaces those for the same interface
+   already in the batch */
+extern void
+sync_pipe_batch_add_if_stats(sync_pipe_batch_t *batch,
+                             const sync_pipe_if_stats_t *stats);
+
+/* add how often, and for how long in all, the capture had to wait for
+   the capture file to be written; replaces a count already in the batch */
+extern void
+sync_pipe_batch_add_writer_stalls(sync_pipe_batch_t *batch, guint32 stalls,
+                                  guint64 stall_usec);
+
+/* add how many packets per-flow truncation cut short, and how many bytes
+   it cut off them; replaces the counts already in the batch */
+extern void
+sync_pipe_batch_add_flow_trunc(sync_pipe_batch_t *batch, guint64 truncated,
+                               guint64 bytes_cut);
+
+/* add how many packets sampling and the rate limit left out; replaces
+   the counts already in the batch */
+extern void
+sync_pipe_batch_add_sampling(sync_pipe_batch_t *batch, guint64 sampled_out,
+                             guint64 rate_limited);
+
+/* send the batch, if it isn't empty, and start a new one */
+extern void
+sync_pipe_batch_flush(sync_pipe_batch_t *batch);
+
 /* write a single message header to the recipient pipe */
 extern int
 pipe_write_header(int pipe_fd, char indicator, int length);
@@ -113,3 +113,196 @@ sync_pipe_errmsg_to_parent(int pipe_fd, const char *error_msg,
     pipe_write_block(pipe_fd, SP_ERROR_MSG, error_msg);
     pipe_write_block(pipe_fd, SP_ERROR_MSG, secondary_error_msg);
 }
+
+
+/****************************************************************************************************************/
+/* batched binary messages */
+
+#define SP_BATCH_DATA(batch)    (&(batch)->buf[4])
+
+static void
+sync_pipe_batch_put_u16(guchar *p, guint16 val)
+{
+    p[0] = (val >> 8) & 0xFF;
+    p[1] = (val >> 0) & 0xFF;
+}
+
+static void
+sync_pipe_batch_put_u32(guchar *p, guint32 val)
+{
+    p[0] = (val >> 24) & 0xFF;
+    p[1] = (val >> 16) & 0xFF;
+    p[2] = (val >> 8) & 0xFF;
+    p[3] = (val >> 0) & 0xFF;
+}
+
+static void
+sync_pipe_batch_put_u64(guchar *p, guint64 val)
+{
+    sync_pipe_batch_put_u32(&p[0], (guint32)(val >> 32));
+    sync_pipe_batch_put_u32(&p[4], (guint32)val);
+}
+
+static guint32
+sync_pipe_batch_get_u32(const guchar *p)
+{
+    return (guint32)p[0]<<24 | (guint32)p[1]<<16 | (guint32)p[2]<<8 | (guint32)p[3];
+}
+
+/* start a record of the given type and value length, flushing the
+   batch first if the record doesn't fit; returns the value's offset */
+static int
+sync_pipe_batch_add_rec(sync_pipe_batch_t *batch, guchar type, int len)
+{
+    guchar *p;
+    int off;
+
+    g_assert(1 + SP_REC_HDR_LEN + len <= SP_MAX_MSG_LEN);
+
+    if (batch->len + SP_REC_HDR_LEN + len > SP_MAX_MSG_LEN)
+        sync_pipe_batch_flush(batch);
+
+    p = SP_BATCH_DATA(batch) + batch->len;
+    p[0] = type;
+    sync_pipe_batch_put_u16(&p[1], (guint16)len);
+    off = batch->len + SP_REC_HDR_LEN;
+    batch->len = off + len;
+    return off;
+}
+
+void
+sync_pipe_batch_init(sync_pipe_batch_t *batch, int pipe_fd)
+{
+    batch->pipe_fd = pipe_fd;
+    SP_BATCH_DATA(batch)[0] = SP_BATCH_VERSION;
+    batch->len = 1;
+    batch->packets_off = -1;
+}
+
+void
+sync_pipe_batch_add_packets(sync_pipe_batch_t *batch, guint32 packets)
+{
+    guchar *data = SP_BATCH_DATA(batch);
+
+    if (batch->packets_off != -1) {
+        sync_pipe_batch_put_u32(&data[batch->packets_off],
+            sync_pipe_batch_get_u32(&data[batch->packets_off]) + packets);
+        return;
+    }
+    batch->packets_off = sync_pipe_batch_add_rec(batch, SP_REC_PACKETS, 4);
+    sync_pipe_batch_put_u32(&SP_BATCH_DATA(batch)[batch->packets_off], packets);
+}
+
+void
+sync_pipe_batch_add_file(sync_pipe_batch_t *batch, const char *filename)
+{
+    int len = (int) strlen(filename) + 1;   /* including the terminating '\0'! */
+    int off;
+
+    off = sync_pipe_batch_add_rec(batch, SP_REC_FILE, len);
+    memcpy(&SP_BATCH_DATA(batch)[off], filename, len);
+
+    /* packets from now on go to the new file */
+    batch->packets_off = -1;
+}
+
+void
+sync_pipe_batch_add_if_stats(sync_pipe_batch_t *batch,
+                             const sync_pipe_if_stats_t *stats)
+{
+    guchar *data = SP_BATCH_DATA(batch);
+    guchar *p;
+    int off, len;
+
+    /* only the latest statistics for an interface are of interest */
+    for (off = 1; off < batch->len; off += SP_REC_HDR_LEN + len) {
+        len = data[off+1]<<8 | data[off+2];
+        if (data[off] == SP_REC_IF_STATS &&
+            sync_pipe_batch_get_u32(&data[off+SP_REC_HDR_LEN]) == stats->iface)
+            break;
+    }
+    if (off < batch->len)
+        off += SP_REC_HDR_LEN;
+    else
+        off = sync_pipe_batch_add_rec(batch, SP_REC_IF_STATS, SP_REC_IF_STATS_LEN);
+
+    p = &SP_BATCH_DATA(batch)[off];
+    sync_pipe_batch_put_u32(&p[0], stats->iface);
+    sync_pipe_batch_put_u32(&p[4], stats->ts_sec);
+    sync_pipe_batch_put_u32(&p[8], stats->ts_usec);
+    sync_pipe_batch_put_u32(&p[12], stats->received);
+    sync_pipe_batch_put_u32(&p[16], stats->dropped);
+    sync_pipe_batch_put_u32(&p[20], stats->if_dropped);
+}
+
+/* get the record of the given type already in the batch, or start one;
+   for totals, of which only the latest is of interest.  Returns the
+   value's offset. */
+static int
+sync_pipe_batch_replace_rec(sync_pipe_batch_t *batch, guchar type, int len)
+{
+    guchar *data = SP_BATCH_DATA(batch);
+    int off, rec_len;
+
+    for (off = 1; off < batch->len; off += SP_REC_HDR_LEN + rec_len) {
+        rec_len = data[off+1]<<8 | data[off+2];
+        if (data[off] == type)
+            return off + SP_REC_HDR_LEN;
+    }
+    return sync_pipe_batch_add_rec(batch, type, len);
+}
+
+void
+sync_pipe_batch_add_writer_stalls(sync_pipe_batch_t *batch, guint32 stalls,
+                                  guint64 stall_usec)
+{
+    guchar *p;
+
+    p = &SP_BATCH_DATA(batch)[sync_pipe_batch_replace_rec(batch,
+        SP_REC_WRITER_STALLS, SP_REC_WRITER_STALLS_LEN)];
+    sync_pipe_batch_put_u32(&p[0], stalls);
+    sync_pipe_batch_put_u64(&p[4], stall_usec);
+}
+
+void
+sync_pipe_batch_add_flow_trunc(sync_pipe_batch_t *batch, guint64 truncated,
+                               guint64 bytes_cut)
+{
+    guchar *p;
+
+    p = &SP_BATCH_DATA(batch)[sync_pipe_batch_replace_rec(batch,
+        SP_REC_FLOW_TRUNC, SP_REC_FLOW_TRUNC_LEN)];
+    sync_pipe_batch_put_u64(&p[0], truncated);
+    sync_pipe_batch_put_u64(&p[8], bytes_cut);
+}
+
+void
+sync_pipe_batch_add_sampling(sync_pipe_batch_t *batch, guint64 sampled_out,
+                             guint64 rate_limited)
+{
+    guchar *p;
+
+    p = &SP_BATCH_DATA(batch)[sync_pipe_batch_replace_rec(batch,
+        SP_REC_SAMPLING, SP_REC_SAMPLING_LEN)];
+    sync_pipe_batch_put_u64(&p[0], sampled_out);
+    sync_pipe_batch_put_u64(&p[8], rate_limited);
+}
+
+void
+sync_pipe_batch_flush(sync_pipe_batch_t *batch)
+{
+    int ret;
+
+    if (batch->len > 1) {
+        /* header and data in one write, so the parent gets it in one read */
+        batch->buf[0] = SP_BATCH;
+        batch->buf[1] = (batch->len >> 16) & 0xFF;
+        batch->buf[2] = (batch->len >> 8) & 0xFF;
+        batch->buf[3] = (batch->len >> 0) & 0xFF;
+        ret = (int) write(batch->pipe_fd, batch->buf, 4 + batch->len);
+        if (ret == -1) {
+            /* nothing we can do about it here; the parent will notice */
+        }
+    }
+    sync_pipe_batch_init(batch, batch->pipe_fd);
+}
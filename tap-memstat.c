@@ -0,0 +1,175 @@
+/* tap-memstat.c
+ * Memory allocation statistics for tshark
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+/* This module reports how much ep_ and se_ memory each protocol's
+ * dissector allocated, and how much was allocated for each packet.
+ * It is only used by tshark and not wireshark
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <epan/packet_info.h>
+#include <epan/proto.h>
+#include <epan/emem.h>
+#include <epan/tap.h>
+#include <epan/stat_cmd_args.h>
+
+/* what has been allocated for one protocol */
+typedef struct _memstat_proto_t {
+	int id;
+	emem_stats_t stats;
+} memstat_proto_t;
+
+static gboolean already_enabled = FALSE;
+
+static int
+memstat_packet(void *dummy _U_, packet_info *pinfo _U_, epan_dissect_t *edt _U_, const void *dummy2 _U_)
+{
+	/* the counting is done by the allocator */
+	return 0;
+}
+
+static void
+memstat_collect(int id, const emem_stats_t *stats, void *user_data)
+{
+	GPtrArray *protos = user_data;
+	memstat_proto_t *mp;
+
+	mp = g_malloc(sizeof(memstat_proto_t));
+	mp->id = id;
+	mp->stats = *stats;
+	g_ptr_array_add(protos, mp);
+}
+
+/* most memory first */
+static gint
+memstat_compare(gconstpointer a, gconstpointer b)
+{
+	const memstat_proto_t *mpa = *(const memstat_proto_t * const *)a;
+	const memstat_proto_t *mpb = *(const memstat_proto_t * const *)b;
+	guint64 bytes_a = mpa->stats.ep_bytes + mpa->stats.se_bytes;
+	guint64 bytes_b = mpb->stats.ep_bytes + mpb->stats.se_bytes;
+
+	if (bytes_a > bytes_b)
+		return -1;
+	if (bytes_a < bytes_b)
+		return 1;
+	return 0;
+}
+
+static const char *
+memstat_proto_name(int id)
+{
+	if (id == EMEM_STATS_NO_OWNER)
+		return "(no dissector)";
+	return proto_get_protocol_short_name(find_protocol_by_id(id));
+}
+
+static void
+memstat_draw(void *dummy _U_)
+{
+	GPtrArray *protos;
+	memstat_proto_t *mp;
+	guint64 packets[EMEM_STATS_PACKET_BUCKETS];
+	guint64 num_packets;
+	guint i;
+
+	protos = g_ptr_array_new();
+	emem_stats_foreach(memstat_collect, protos);
+	g_ptr_array_sort(protos, memstat_compare);
+
+	printf("\n");
+	printf("===================================================================================\n");
+	printf("Memory Allocation Statistics:\n");
+	printf("%-18s %13s %15s %11s %15s %11s\n", "Protocol",
+		"ep_ allocs", "ep_ bytes", "se_ allocs", "se_ bytes", "Max/packet");
+	for (i = 0; i < protos->len; i++) {
+		mp = g_ptr_array_index(protos, i);
+		printf("%-18s %13" G_GINT64_MODIFIER "u %15" G_GINT64_MODIFIER "u %11" G_GINT64_MODIFIER "u %15" G_GINT64_MODIFIER "u %11" G_GINT64_MODIFIER "u\n",
+			memstat_proto_name(mp->id),
+			mp->stats.ep_allocs, mp->stats.ep_bytes,
+			mp->stats.se_allocs, mp->stats.se_bytes,
+			mp->stats.packet_max);
+		g_free(mp);
+	}
+	g_ptr_array_free(protos, TRUE);
+
+	num_packets = emem_stats_get_packets(packets);
+	printf("-----------------------------------------------------------------------------------\n");
+	printf("%26s %12s\n", "Bytes allocated per packet", "Packets");
+	for (i = 0; i < EMEM_STATS_PACKET_BUCKETS; i++) {
+		if (packets[i] == 0)
+			continue;
+		if (i == 0)
+			printf("%26s", "0 - 1");
+		else if (i == EMEM_STATS_PACKET_BUCKETS - 1)
+			printf("%12" G_GINT64_MODIFIER "u -            ", ((guint64)1 << (i - 1)) + 1);
+		else
+			printf("%12" G_GINT64_MODIFIER "u - %11" G_GINT64_MODIFIER "u", ((guint64)1 << (i - 1)) + 1, (guint64)1 << i);
+		printf(" %12" G_GINT64_MODIFIER "u\n", packets[i]);
+	}
+	printf("%26s %12" G_GINT64_MODIFIER "u\n", "Total", num_packets);
+	printf("===================================================================================\n");
+}
+
+static void
+memstat_init(const char *optarg, void* userdata _U_)
+{
+	GString *error_string;
+
+	if (strcmp(optarg, "mem,stat") != 0) {
+		fprintf(stderr, "tshark: invalid \"-z mem,stat\" argument\n");
+		exit(1);
+	}
+
+	if (already_enabled) {
+		return;
+	}
+	already_enabled = TRUE;
+
+	/* Any tap on every packet makes sure the packets are dissected */
+	error_string=register_tap_listener("frame", NULL, NULL, 0, NULL, memstat_packet, memstat_draw);
+	if(error_string){
+		fprintf(stderr,"tshark: Couldn't register mem,stat tap: %s\n",
+		    error_string->str);
+		g_string_free(error_string, TRUE);
+		exit(1);
+	}
+
+	emem_stats_enable(TRUE);
+}
+
+void
+register_tap_listener_memstat(void)
+{
+	register_stat_cmd_arg("mem,stat", memstat_init, NULL);
+}
@@ -0,0 +1,136 @@
+#!/bin/bash
+#
+# $Id$
+
+# Pipe-capture test for Dumpcap
+#
+# This script makes small libpcap and pcapng files, pipes each of them
+# into "dumpcap -i -", and checks with Capinfos that every packet made
+# it into the capture file.  A small file is read in along with the
+# header in one go, so this catches packets that are left in the pipe
+# read buffer at EOF.
+
+# Directory containing binaries.  Default current directory.
+BIN_DIR=.
+
+# Temporary file directory.
+TMP_DIR=/tmp
+
+while getopts ":b:d:" OPTCHAR ; do
+    case $OPTCHAR in
+        b) BIN_DIR=$OPTARG ;;
+        d) TMP_DIR=$OPTARG ;;
+    esac
+done
+shift $(($OPTIND - 1))
+
+DUMPCAP="$BIN_DIR/dumpcap"
+CAPINFOS="$BIN_DIR/capinfos"
+
+if [ "$BIN_DIR" = "." ]; then
+    export WIRESHARK_RUN_FROM_BUILD_DIRECTORY=1
+fi
+
+# Make sure we have valid binaries
+for BIN in $DUMPCAP $CAPINFOS ; do
+    if [ ! -x $BIN ]; then
+        echo "Couldn't find $BIN"
+        exit 1
+    fi
+done
+
+BASE_NAME=$TMP_DIR/dumpcap-pipe-test-$$
+IN_FILE=$BASE_NAME-in
+REC_FILE=$BASE_NAME-rec
+OUT_FILE=$BASE_NAME-out.pcap
+ERR_FILE=$BASE_NAME.err
+
+trap "rm -f $IN_FILE $REC_FILE $OUT_FILE $ERR_FILE" EXIT
+
+# Write a 32-bit or 16-bit value, little-endian
+le32() {
+    printf "\\x$(printf %02x $(($1 & 0xff)))\\x$(printf %02x $((($1 >> 8) & 0xff)))\\x$(printf %02x $((($1 >> 16) & 0xff)))\\x$(printf %02x $((($1 >> 24) & 0xff)))"
+}
+le16() {
+    printf "\\x$(printf %02x $(($1 & 0xff)))\\x$(printf %02x $((($1 >> 8) & 0xff)))"
+}
+
+# 60 bytes of Ethernet frame: broadcast, from 00:00:00:00:00:01,
+# type 0x88b5 (local experimental), padded with zeroes
+FRAME_LEN=60
+frame() {
+    printf '\xff\xff\xff\xff\xff\xff\x00\x00\x00\x00\x00\x01\x88\xb5'
+    head -c $(($FRAME_LEN - 14)) /dev/zero
+}
+
+# repeat <count>: write <count> copies of $REC_FILE, doubling it up
+# rather than running anything once per packet
+repeat() {
+    local n=$1
+
+    cp $REC_FILE $REC_FILE.2
+    while [ $n -gt 0 ]; do
+        if [ $(($n & 1)) -ne 0 ]; then
+            cat $REC_FILE.2
+        fi
+        cat $REC_FILE.2 $REC_FILE.2 > $REC_FILE.4
+        mv $REC_FILE.4 $REC_FILE.2
+        n=$(($n >> 1))
+    done
+    rm -f $REC_FILE.2
+}
+
+# make_pcap <packets>
+make_pcap() {
+    le32 0xa1b2c3d4; le16 2; le16 4; le32 0; le32 0; le32 65535; le32 1
+    {
+        le32 1300000000; le32 0; le32 $FRAME_LEN; le32 $FRAME_LEN
+        frame
+    } > $REC_FILE
+    repeat $1
+}
+
+# make_pcapng <packets>
+make_pcapng() {
+    # Section header block, with an unknown section length
+    le32 0x0a0d0d0a; le32 28; le32 0x1a2b3c4d; le16 1; le16 0
+    le32 0xffffffff; le32 0xffffffff; le32 28
+    # Interface description block
+    le32 1; le32 20; le16 1; le16 0; le32 65535; le32 20
+    {
+        # Enhanced packet block, microsecond time stamps
+        le32 6; le32 $((32 + $FRAME_LEN)); le32 0
+        le32 0; le32 1300000000
+        le32 $FRAME_LEN; le32 $FRAME_LEN
+        frame
+        le32 $((32 + $FRAME_LEN))
+    } > $REC_FILE
+    repeat $1
+}
+
+FAILED=0
+
+# run_test <format> <packets>
+run_test() {
+    local COUNT
+
+    make_$1 $2 > $IN_FILE
+    rm -f $OUT_FILE
+    "$DUMPCAP" -i - -w $OUT_FILE < $IN_FILE > /dev/null 2> $ERR_FILE
+    COUNT=`"$CAPINFOS" -c $OUT_FILE 2> /dev/null | sed -n 's/^Number of packets: *//p'`
+    if [ "$COUNT" = "$2" ]; then
+        echo "$1, $2 packets: OK"
+    else
+        echo "$1, $2 packets: FAILED, got ${COUNT:-no} packets"
+        cat $ERR_FILE
+        FAILED=1
+    fi
+}
+
+run_test pcap 3
+run_test pcapng 3
+# More than one read buffer's worth
+run_test pcap 20000
+run_test pcapng 20000
+
+exit $FAILED
@@ -93,6 +93,8 @@
 #include <wsutil/unicode-utils.h>
 #endif /* _WIN32 */
 #include "capture_sync.h"
+#include "capture_ring.h"
+#include <wiretap/pcap-encap.h>
 #endif /* HAVE_LIBPCAP */
 #include "log.h"
 #include <epan/funnel.h>
@@ -125,6 +127,7 @@ typedef enum {
 
 static output_action_e output_action;
 static gboolean do_dissection;  /* TRUE if we have to dissect each packet */
+static gboolean fields_only;    /* TRUE if only filter fields and -e fields are needed */
 static gboolean verbose;
 static gboolean print_hex;
 static gboolean line_buffered;
@@ -143,6 +146,22 @@ static gboolean print_packet_counts;
 
 static capture_options global_capture_opts;
 
+#ifdef HAVE_CAPTURE_RING
+/*
+ * Shared packet ring from dumpcap, if we're dissecting; packets are
+ * taken from it rather than read back from the capture file, for as
+ * long as it stays open.  "ring_file_records" counts the packets taken
+ * from it that are in the current capture file, so that we know how
+ * many to skip in the file if we have to carry on from there.
+ *
+ * If "ring_live" is TRUE, dumpcap isn't writing a capture file at all,
+ * and every packet comes from the ring.
+ */
+static capture_ring_t *capture_ring;
+static guint32 ring_file_records;
+static gboolean ring_live;
+#endif
+
 #ifdef SIGINFO
 static gboolean infodelay;      /* if TRUE, don't print capture info in SIGINFO handler */
 static gboolean infoprint;      /* if TRUE, print capture info after clearing infodelay */
@@ -161,6 +180,9 @@ static void report_counts_siginfo(int);
 #endif /* HAVE_LIBPCAP */
 
 static int load_cap_file(capture_file *, char *, int, gboolean, int, gint64);
+#ifdef HAVE_CAPTURE_RING
+static void cf_open_live(capture_file *cf);
+#endif
 static gboolean process_packet(capture_file *cf, gint64 offset,
     const struct wtap_pkthdr *whdr, union wtap_pseudo_header *pseudo_header,
     const guchar *pd, gboolean filtering_tap_listeners, guint tap_flags);
@@ -266,6 +288,8 @@ print_usage(gboolean print_ver)
   /*fprintf(output, "\n");*/
   fprintf(output, "Capture output:\n");
   fprintf(output, "  -b <ringbuffer opt.> ... duration:NUM - switch to next file after NUM secs\n");
+  fprintf(output, "                           interval:NUM - switch to next file every NUM secs,\n");
+  fprintf(output, "                                          on the clock\n");
   fprintf(output, "                           filesize:NUM - switch to next file after NUM KB\n");
   fprintf(output, "                              files:NUM - ringbuffer: replace after NUM files\n");
 #endif  /* HAVE_LIBPCAP */
@@ -1491,7 +1515,7 @@ main(int argc, char *argv[])
                    "a capture isn't being done.");
         return 1;
       }
-      if (global_capture_opts.has_file_duration) {
+      if (global_capture_opts.has_file_duration || global_capture_opts.has_file_interval) {
         cmdarg_err("Switching capture files after a time interval was specified, but "
                    "a capture isn't being done.");
         return 1;
@@ -1544,7 +1568,8 @@ main(int argc, char *argv[])
             return 1;
           }
           if (!global_capture_opts.has_autostop_filesize &&
-              !global_capture_opts.has_file_duration) {
+              !global_capture_opts.has_file_duration &&
+              !global_capture_opts.has_file_interval) {
             cmdarg_err("Multiple capture files requested, but "
               "no maximum capture file size or duration was specified.");
             return 1;
@@ -1673,6 +1698,15 @@ main(int argc, char *argv[])
         we're using any taps that need dissection. */
   do_dissection = print_packet_info || rfcode || tap_listeners_require_dissection();
 
+  /* If all we print is a list of fields, and no tap is looking at the
+     packets, the protocol tree only has to hold those fields and the
+     ones the read filter and any custom columns use; dissection can then
+     skip the text of the items, and the protocols that are of no use
+     for any of those fields. */
+  fields_only = print_packet_info && output_action == WRITE_FIELDS &&
+                output_fields_can_prime(output_fields) &&
+                !tap_listeners_require_dissection();
+
   if (cf_name) {
     /*
      * We're reading a capture file.
@@ -2035,6 +2069,25 @@ capture(void)
   global_capture_opts.iface_descr = get_interface_descriptive_name(global_capture_opts.iface);
   fprintf(stderr, "Capturing on %s\n", global_capture_opts.iface_descr);
 
+#ifdef HAVE_CAPTURE_RING
+  /* If we're dissecting, have dumpcap hand us the packets in memory;
+     if we can't, we just read them from the capture file. */
+  if (do_dissection) {
+    int ring_err;
+
+    capture_ring = capture_ring_create(CAPTURE_RING_DEFAULT_SIZE, &ring_err);
+    if (capture_ring != NULL) {
+      global_capture_opts.ring_fd = capture_ring_fd(capture_ring);
+      /* If the capture file would be no more than a relay between dumpcap
+         and us, ask dumpcap to do without it. */
+      if (global_capture_opts.save_file == NULL &&
+          !global_capture_opts.multi_files_on &&
+          !global_capture_opts.has_autostop_filesize)
+        capture_ring_want_live(capture_ring);
+    }
+  }
+#endif
+
   ret = sync_pipe_start(&global_capture_opts);
 
   if (!ret)
@@ -2136,6 +2189,39 @@ capture_input_cfilter_error_message(capture_options *capture_opts, char *error_m
 }
 
 
+#ifdef HAVE_CAPTURE_RING
+/*
+ * dumpcap has told us, with an empty file name, that it can hand us every
+ * packet through the ring without writing a capture file at all.  Take it
+ * up if we can dissect packets of the ring's link-layer type without
+ * Wiretap; otherwise, turn it down, and dumpcap goes on to tell us the
+ * name of the capture file after all.
+ */
+static void
+capture_ring_take_live(capture_options *capture_opts)
+{
+  int encap;
+
+  if (capture_ring == NULL)
+    return;
+
+  encap = wtap_pcap_encap_to_wtap_encap(capture_ring_linktype(capture_ring));
+  if (!wtap_pcap_can_fill_in_pseudo_header(encap)) {
+    capture_ring_set_live(capture_ring, FALSE);
+    return;
+  }
+  if (!capture_ring_set_live(capture_ring, TRUE)) {
+    /* dumpcap gave up waiting for us */
+    return;
+  }
+
+  ring_live = TRUE;
+  cf_open_live(capture_opts->cf);
+  capture_opts->state = CAPTURE_RUNNING;
+}
+#endif
+
+
 /* capture child tells us we have a new (or the first) capture file */
 gboolean
 capture_input_new_file(capture_options *capture_opts, gchar *new_file)
@@ -2150,6 +2236,14 @@ capture_input_new_file(capture_options *capture_opts, gchar *new_file)
 
   g_assert(capture_opts->state == CAPTURE_PREPARING || capture_opts->state == CAPTURE_RUNNING);
 
+#ifdef HAVE_CAPTURE_RING
+  /* an empty name means dumpcap could do without a capture file */
+  if (*new_file == '\0') {
+    capture_ring_take_live(capture_opts);
+    return TRUE;
+  }
+#endif
+
   /* free the old filename */
   if (capture_opts->save_file != NULL) {
 
@@ -2171,6 +2265,10 @@ capture_input_new_file(capture_options *capture_opts, gchar *new_file)
   /* save the new filename */
   capture_opts->save_file = g_strdup(new_file);
 
+#ifdef HAVE_CAPTURE_RING
+  ring_file_records = 0;
+#endif
+
   /* if we are in real-time mode, open the new file now */
   if(do_dissection) {
     /* Attempt to open the capture file and set up to read from it. */
@@ -2192,6 +2290,73 @@ capture_input_new_file(capture_options *capture_opts, gchar *new_file)
 }
 
 
+#ifdef HAVE_CAPTURE_RING
+/*
+ * Take a packet from the shared ring, and dissect it.  Returns FALSE,
+ * having closed the ring, if the ring is empty or if we can't dissect
+ * packets from it; the caller then has to read the packet from the
+ * capture file.
+ */
+static gboolean
+capture_ring_process_packet(capture_file *cf, gboolean filtering_tap_listeners,
+                            guint tap_flags, gboolean *passed)
+{
+  capture_ring_rec_t rec;
+  const guint8 *pd;
+  struct wtap_pkthdr whdr;
+  union wtap_pseudo_header pseudo_header;
+
+  pd = capture_ring_peek(capture_ring, &rec);
+  if (pd == NULL) {
+    capture_ring_close(capture_ring);
+    return FALSE;
+  }
+
+  whdr.ts.secs = rec.ts_sec;
+  whdr.ts.nsecs = rec.ts_usec * 1000;
+  whdr.caplen = rec.caplen;
+  whdr.len = rec.len;
+  whdr.pkt_encap = wtap_pcap_encap_to_wtap_encap(capture_ring_linktype(capture_ring));
+
+  /* Encapsulations with a pseudo-header in front of the packet data
+     have to be read through Wiretap. */
+  if (!wtap_pcap_fill_in_pseudo_header(whdr.pkt_encap, (guint8 *)pd,
+                                       rec.caplen, &pseudo_header)) {
+    capture_ring_close(capture_ring);
+    return FALSE;
+  }
+
+  *passed = process_packet(cf, rec.file_offset, &whdr, &pseudo_header, pd,
+                           filtering_tap_listeners, tap_flags);
+  capture_ring_release(capture_ring);
+  ring_file_records++;
+  return TRUE;
+}
+
+/*
+ * The ring has been closed; skip the packets we've already taken from
+ * it in the capture file, so we can carry on from there.
+ */
+static gboolean
+capture_ring_catch_up(capture_file *cf)
+{
+  int          err;
+  gchar        *err_info;
+  gint64       data_offset;
+
+  capture_ring_destroy(capture_ring);
+  capture_ring = NULL;
+
+  while (ring_file_records != 0) {
+    wtap_cleareof(cf->wth);
+    if (!wtap_read(cf->wth, &err, &err_info, &data_offset))
+      return FALSE;
+    ring_file_records--;
+  }
+  return TRUE;
+}
+#endif
+
 /* capture child tells us we have new packets to read */
 void
 capture_input_new_packets(capture_options *capture_opts, int to_read)
@@ -2220,7 +2385,40 @@ capture_input_new_packets(capture_options *capture_opts, int to_read)
   tap_flags = union_of_tap_listener_flags();
 
   if(do_dissection) {
+#ifdef HAVE_CAPTURE_RING
+    if (ring_live) {
+      /* The packets are in the ring, and nowhere else; dumpcap puts each
+         one there before counting it, so we shouldn't run out. */
+      while (to_read-- > 0) {
+        if (!capture_ring_process_packet(cf, filtering_tap_listeners,
+                                         tap_flags, &ret)) {
+          sync_pipe_stop(capture_opts);
+          break;
+        }
+        if (ret != FALSE)
+          packet_count++;
+      }
+      to_read = 0;
+    }
+#endif
     while (to_read-- && cf->wth) {
+#ifdef HAVE_CAPTURE_RING
+      if (capture_ring != NULL) {
+        if (capture_ring_process_packet(cf, filtering_tap_listeners,
+                                        tap_flags, &ret)) {
+          if (ret != FALSE)
+            packet_count++;
+          continue;
+        }
+        if (!capture_ring_catch_up(cf)) {
+          /* read from file failed, tell the capture child to stop */
+          sync_pipe_stop(capture_opts);
+          wtap_close(cf->wth);
+          cf->wth = NULL;
+          continue;
+        }
+      }
+#endif
       wtap_cleareof(cf->wth);
       ret = wtap_read(cf->wth, &err, &err_info, &data_offset);
       if(ret == FALSE) {
@@ -2318,6 +2516,40 @@ capture_input_drops(capture_options *capture_opts _U_, guint32 dropped)
 }
 
 
+/* capture child had to wait for the capture file to be written? */
+void
+capture_input_writer_stalls(capture_options *capture_opts _U_, guint32 stalls, guint64 stall_usec)
+{
+  if (stalls != 0) {
+    fprintf(stderr, "Capture held up %u time%s, for %" G_GINT64_MODIFIER "u ms, waiting for the disk\n",
+            stalls, plurality(stalls, "", "s"), stall_usec / 1000);
+  }
+}
+
+
+/* capture child cut packets short with per-flow truncation? */
+void
+capture_input_flow_truncation(capture_options *capture_opts _U_, guint64 truncated, guint64 bytes_cut)
+{
+  if (truncated != 0) {
+    fprintf(stderr, "Flow truncation: %" G_GINT64_MODIFIER "u packet%s cut short, %" G_GINT64_MODIFIER "u bytes not saved\n",
+            truncated, plurality(truncated, "", "s"), bytes_cut);
+  }
+}
+
+
+/* capture child left packets out by sampling or the rate limit?
+   (those aren't drops) */
+void
+capture_input_sampling(capture_options *capture_opts _U_, guint64 sampled_out, guint64 rate_limited)
+{
+  if (sampled_out != 0 || rate_limited != 0) {
+    fprintf(stderr, "Sampling: %" G_GINT64_MODIFIER "u packet%s not sampled, %" G_GINT64_MODIFIER "u over the rate limit\n",
+            sampled_out, plurality(sampled_out, "", "s"), rate_limited);
+  }
+}
+
+
 /*
  * Capture child closed its side of the pipe, report any error and
  * do the required cleanup.
@@ -2330,6 +2562,14 @@ capture_input_closed(capture_options *capture_opts, gchar *msg)
 
   report_counts();
 
+#ifdef HAVE_CAPTURE_RING
+  if (capture_ring != NULL) {
+    capture_ring_destroy(capture_ring);
+    capture_ring = NULL;
+  }
+  ring_live = FALSE;
+#endif
+
   if(capture_opts->cf != NULL && ((capture_file *) capture_opts->cf)->wth != NULL) {
     wtap_close(((capture_file *) capture_opts->cf)->wth);
     if(((capture_file *) capture_opts->cf)->user_saved == FALSE) {
@@ -2490,7 +2730,8 @@ process_packet_second_pass(capture_file *cf, frame_data *fdata,
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode ("verbose"
        is true). */
-    epan_dissect_init(&edt, create_proto_tree, print_packet_info && verbose);
+    epan_dissect_init(&edt, create_proto_tree,
+                      print_packet_info && verbose && !fields_only);
 
     /* If we're running a read filter, prime the epan_dissect_t with that
        filter. */
@@ -2499,6 +2740,12 @@ process_packet_second_pass(capture_file *cf, frame_data *fdata,
 
     col_custom_prime_edt(&edt, &cf->cinfo);
 
+    /* If only fields are being printed, prime it with them, too. */
+    if (fields_only) {
+      epan_dissect_fields_only(&edt, TRUE);
+      output_fields_prime_edt(output_fields, &edt);
+    }
+
     tap_queue_init(&edt);
 
     /* We only need the columns if either
@@ -2875,7 +3122,8 @@ process_packet(capture_file *cf, gint64 offset, const struct wtap_pkthdr *whdr,
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode ("verbose"
        is true). */
-    epan_dissect_init(&edt, create_proto_tree, print_packet_info && verbose);
+    epan_dissect_init(&edt, create_proto_tree,
+                      print_packet_info && verbose && !fields_only);
 
     /* If we're running a read filter, prime the epan_dissect_t with that
        filter. */
@@ -2884,6 +3132,12 @@ process_packet(capture_file *cf, gint64 offset, const struct wtap_pkthdr *whdr,
 
     col_custom_prime_edt(&edt, &cf->cinfo);
 
+    /* If only fields are being printed, prime it with them, too. */
+    if (fields_only) {
+      epan_dissect_fields_only(&edt, TRUE);
+      output_fields_prime_edt(output_fields, &edt);
+    }
+
     tap_queue_init(&edt);
 
     /* We only need the columns if either
@@ -3394,6 +3648,40 @@ fail:
   return CF_ERROR;
 }
 
+#ifdef HAVE_CAPTURE_RING
+/*
+ * Set up to dissect packets that come from dumpcap's ring, with no
+ * capture file behind them.
+ */
+static void
+cf_open_live(capture_file *cf)
+{
+  /* Cleanup all data structures used for dissection. */
+  cleanup_dissection();
+  /* Initialize all data structures used for dissection. */
+  init_dissection();
+
+  cf->wth = NULL;
+  cf->f_datalen = 0;
+  cf->filename = NULL;
+  cf->is_tempfile = FALSE;
+  cf->user_saved = TRUE;    /* there's nothing to delete */
+
+  cf->cd_t      = WTAP_FILE_PCAP;
+  cf->count     = 0;
+  cf->drops_known = FALSE;
+  cf->drops     = 0;
+  cf->snap      = WTAP_MAX_PACKET_SIZE;
+  cf->has_snap  = FALSE;
+  nstime_set_zero(&cf->elapsed_time);
+  nstime_set_unset(&first_ts);
+  nstime_set_unset(&prev_dis_ts);
+  nstime_set_unset(&prev_cap_ts);
+
+  cf->state = FILE_READ_IN_PROGRESS;
+}
+#endif
+
 static void
 show_capture_file_io_error(const char *fname, int err, gboolean is_close)
 {
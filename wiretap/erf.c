@@ -70,6 +70,9 @@ static gboolean erf_read(wtap *wth, int *err, gchar **err_info,
 static gboolean erf_seek_read(wtap *wth, gint64 seek_off,
 			      union wtap_pseudo_header *pseudo_header, guint8 *pd,
 			      int length, int *err, gchar **err_info);
+static gboolean erf_find_record(wtap *wth, gint64 offset, gint64 *rec_offset,
+				struct wtap_nstime *rec_ts, int *err,
+				gchar **err_info);
 
 extern int erf_open(wtap *wth, int *err, gchar **err_info)
 {
@@ -257,6 +260,7 @@ extern int erf_open(wtap *wth, int *err, gchar **err_info)
 
   wth->subtype_read = erf_read;
   wth->subtype_seek_read = erf_seek_read;
+  wth->subtype_find_record = erf_find_record;
   wth->tsprecision = WTAP_FILE_TSPREC_NSEC;
 
   return 1;
@@ -312,6 +316,96 @@ static gboolean erf_seek_read(wtap *wth, gint64 seek_off,
   return TRUE;
 }
 
+/*
+ * Amount of data erf_find_record() looks at, and number of consecutive
+ * plausible record headers it wants to see before deciding it's found
+ * the start of a record.
+ */
+#define ERF_SYNC_BUF_SIZE	(256*1024)
+#define ERF_SYNC_RECORDS	4
+
+/* Apply the same sanity checks erf_open() does to one record header */
+static gboolean erf_plausible_header(const erf_header_t *header)
+{
+  guint16 rlen = g_ntohs(header->rlen);
+
+  if (rlen < sizeof(*header) || rlen - sizeof(*header) > WTAP_MAX_PACKET_SIZE)
+    return FALSE;
+  if ((header->type & 0x7F) == ERF_TYPE_PAD)
+    return TRUE;
+  if ((header->type & 0x7F) == 0 || (header->type & 0x7F) > ERF_TYPE_INFINIBAND_LINK)
+    return FALSE;
+  return TRUE;
+}
+
+/*
+ * Find the first non-PAD record in the file that starts at or after
+ * "offset", by looking for a run of plausible, time-ordered record
+ * headers, each one pointing to the next.  Used to bisect files by
+ * time; returns FALSE, with *err set to 0, if we couldn't find one.
+ */
+static gboolean erf_find_record(wtap *wth, gint64 offset, gint64 *rec_offset,
+				struct wtap_nstime *rec_ts, int *err,
+				gchar **err_info)
+{
+  guint8 *buf;
+  int bytes_read;
+  gboolean at_eof;
+  erf_header_t header;
+  erf_timestamp_t ts, prevts;
+  guint p, q, n;
+
+  *err = 0;
+  if (file_seek(wth->fh, offset, SEEK_SET, err) == -1)
+    return FALSE;
+  buf = (guint8 *)g_malloc(ERF_SYNC_BUF_SIZE);
+  bytes_read = file_read(buf, ERF_SYNC_BUF_SIZE, wth->fh);
+  if (bytes_read < 0) {
+    *err = file_error(wth->fh, err_info);
+    g_free(buf);
+    return FALSE;
+  }
+  at_eof = (bytes_read < ERF_SYNC_BUF_SIZE);
+
+  for (p = 0; p + sizeof(header) <= (guint)bytes_read; p++) {
+    memcpy(&header, buf + p, sizeof(header));
+    if ((header.type & 0x7F) == ERF_TYPE_PAD || !erf_plausible_header(&header))
+      continue;
+
+    q = p;
+    n = 0;
+    prevts = 0;
+    while (n < ERF_SYNC_RECORDS && q + sizeof(header) <= (guint)bytes_read) {
+      memcpy(&header, buf + q, sizeof(header));
+      if (!erf_plausible_header(&header))
+	break;
+      /* PAD records may not have time stamps */
+      if ((header.type & 0x7F) != ERF_TYPE_PAD) {
+	ts = pletohll(&header.ts);
+	if (ts < prevts)
+	  break;
+	prevts = ts;
+      }
+      q += g_ntohs(header.rlen);
+      n++;
+    }
+
+    /* A shorter run that ends exactly at the end of the file will do. */
+    if (n == ERF_SYNC_RECORDS ||
+	(at_eof && n != 0 && q == (guint)bytes_read)) {
+      memcpy(&header, buf + p, sizeof(header));
+      ts = pletohll(&header.ts);
+      *rec_offset = offset + p;
+      rec_ts->secs = (long) (ts >> 32);
+      rec_ts->nsecs = (int) (((ts & 0xffffffff) * 1000 * 1000 * 1000) >> 32);
+      g_free(buf);
+      return TRUE;
+    }
+  }
+  g_free(buf);
+  return FALSE;
+}
+
 static int erf_read_header(FILE_T fh,
 			   struct wtap_pkthdr *phdr,
 			   union wtap_pseudo_header *pseudo_header,
@@ -1025,6 +1025,16 @@ file_tell_raw(FILE_T stream)
 	return stream->raw_pos;
 }
 
+/*
+ * Returns TRUE unless we know the data is being read straight from
+ * the file, in which case seeking to an arbitrary offset is cheap.
+ */
+gboolean
+file_iscompressed(FILE_T stream)
+{
+	return stream->compression != UNCOMPRESSED;
+}
+
 int
 file_fstat(FILE_T stream, ws_statb64 *statb, int *err)
 {
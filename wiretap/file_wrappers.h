@@ -32,6 +32,7 @@ extern gint64 file_tell(FILE_T stream);
 extern gint64 file_tell_raw(FILE_T stream);
 extern int file_fstat(FILE_T stream, ws_statb64 *statb, int *err);
 extern int file_error(FILE_T fh, gchar **err_info);
+extern gboolean file_iscompressed(FILE_T stream);
 
 extern FILE_T file_open(const char *path);
 extern FILE_T filed_open(int fildes);
@@ -74,6 +74,12 @@ static gboolean libpcap_seek_read(wtap *wth, gint64 seek_off,
 static int libpcap_read_header(wtap *wth, int *err, gchar **err_info,
     struct pcaprec_ss990915_hdr *hdr);
 static void adjust_header(wtap *wth, struct pcaprec_hdr *hdr);
+static int libpcap_record_header_size(wtap *wth);
+static gboolean libpcap_scan_headers(wtap *wth, wtap_header_scan_t *scan,
+    int *err, gchar **err_info);
+static gboolean libpcap_find_record(wtap *wth, gint64 offset,
+    gint64 *rec_offset, struct wtap_nstime *rec_ts, int *err,
+    gchar **err_info);
 static gboolean libpcap_read_rec_data(FILE_T fh, guint8 *pd, int length,
     int *err, gchar **err_info);
 static gboolean libpcap_dump(wtap_dumper *wdh, const struct wtap_pkthdr *phdr,
@@ -264,6 +270,8 @@ int libpcap_open(wtap *wth, int *err, gchar **err_info)
 	wth->priv = (void *)libpcap;
 	wth->subtype_read = libpcap_read;
 	wth->subtype_seek_read = libpcap_seek_read;
+	wth->subtype_find_record = libpcap_find_record;
+	wth->subtype_scan_headers = libpcap_scan_headers;
 	wth->file_encap = file_encap;
 	wth->snapshot_length = hdr.snaplen;
 
@@ -717,31 +725,7 @@ static int libpcap_read_header(wtap *wth, int *err, gchar **err_info,
 
 	/* Read record header. */
 	errno = WTAP_ERR_CANT_READ;
-	switch (wth->file_type) {
-
-	case WTAP_FILE_PCAP:
-	case WTAP_FILE_PCAP_AIX:
-	case WTAP_FILE_PCAP_NSEC:
-		bytes_to_read = sizeof (struct pcaprec_hdr);
-		break;
-
-	case WTAP_FILE_PCAP_SS990417:
-	case WTAP_FILE_PCAP_SS991029:
-		bytes_to_read = sizeof (struct pcaprec_modified_hdr);
-		break;
-
-	case WTAP_FILE_PCAP_SS990915:
-		bytes_to_read = sizeof (struct pcaprec_ss990915_hdr);
-		break;
-
-	case WTAP_FILE_PCAP_NOKIA:
-		bytes_to_read = sizeof (struct pcaprec_nokia_hdr);
-		break;
-
-	default:
-		g_assert_not_reached();
-		bytes_to_read = 0;
-	}
+	bytes_to_read = libpcap_record_header_size(wth);
 	bytes_read = file_read(hdr, bytes_to_read, wth->fh);
 	if (bytes_read != bytes_to_read) {
 		*err = file_error(wth->fh, err_info);
@@ -790,6 +774,33 @@ static int libpcap_read_header(wtap *wth, int *err, gchar **err_info,
 	return bytes_read;
 }
 
+/* Size of the per-record header in this flavor of libpcap file. */
+static int
+libpcap_record_header_size(wtap *wth)
+{
+	switch (wth->file_type) {
+
+	case WTAP_FILE_PCAP:
+	case WTAP_FILE_PCAP_AIX:
+	case WTAP_FILE_PCAP_NSEC:
+		return sizeof (struct pcaprec_hdr);
+
+	case WTAP_FILE_PCAP_SS990417:
+	case WTAP_FILE_PCAP_SS991029:
+		return sizeof (struct pcaprec_modified_hdr);
+
+	case WTAP_FILE_PCAP_SS990915:
+		return sizeof (struct pcaprec_ss990915_hdr);
+
+	case WTAP_FILE_PCAP_NOKIA:
+		return sizeof (struct pcaprec_nokia_hdr);
+
+	default:
+		g_assert_not_reached();
+		return 0;
+	}
+}
+
 static void
 adjust_header(wtap *wth, struct pcaprec_hdr *hdr)
 {
@@ -829,6 +840,210 @@ adjust_header(wtap *wth, struct pcaprec_hdr *hdr)
 	}
 }
 
+/*
+ * Amount of data libpcap_find_record() looks at, and number of
+ * consecutive plausible record headers it wants to see before deciding
+ * it's found the start of a record.
+ */
+#define LIBPCAP_SYNC_BUF_SIZE	(256*1024)
+#define LIBPCAP_SYNC_RECORDS	4
+
+/*
+ * Check whether "buf" looks like a standard record header in this file;
+ * if so, fill in "hdr" with the (byte-swapped, if necessary) header.
+ */
+static gboolean
+libpcap_plausible_header(wtap *wth, const guint8 *buf, struct pcaprec_hdr *hdr)
+{
+	memcpy(hdr, buf, sizeof (struct pcaprec_hdr));
+	adjust_header(wth, hdr);
+
+	if (hdr->incl_len > hdr->orig_len ||
+	    hdr->orig_len > WTAP_MAX_PACKET_SIZE)
+		return FALSE;
+	if (wth->snapshot_length != 0 &&
+	    hdr->incl_len > wth->snapshot_length)
+		return FALSE;
+	if (hdr->ts_usec >= (wth->tsprecision == WTAP_FILE_TSPREC_NSEC ?
+	    1000000000U : 1000000U))
+		return FALSE;
+	return TRUE;
+}
+
+/*
+ * Find the first record in the file that starts at or after "offset",
+ * by looking for a run of plausible, time-ordered record headers, each
+ * one pointing to the next.  Used to bisect time-ordered files; returns
+ * FALSE, with *err set to 0, if we couldn't find one.
+ */
+static gboolean
+libpcap_find_record(wtap *wth, gint64 offset, gint64 *rec_offset,
+    struct wtap_nstime *rec_ts, int *err, gchar **err_info)
+{
+	guint8 *buf;
+	int bytes_read;
+	gboolean at_eof;
+	struct pcaprec_hdr hdr;
+	guint32 prev_sec, prev_frac;
+	guint p, q, n;
+
+	*err = 0;
+
+	/* Only the standard record header is supported. */
+	if ((wth->file_type != WTAP_FILE_PCAP &&
+	     wth->file_type != WTAP_FILE_PCAP_NSEC) ||
+	    wth->file_encap == WTAP_ENCAP_ERF)
+		return FALSE;
+
+	if (file_seek(wth->fh, offset, SEEK_SET, err) == -1)
+		return FALSE;
+	buf = (guint8 *)g_malloc(LIBPCAP_SYNC_BUF_SIZE);
+	bytes_read = file_read(buf, LIBPCAP_SYNC_BUF_SIZE, wth->fh);
+	if (bytes_read < 0) {
+		*err = file_error(wth->fh, err_info);
+		g_free(buf);
+		return FALSE;
+	}
+	at_eof = (bytes_read < LIBPCAP_SYNC_BUF_SIZE);
+
+	for (p = 0; p + sizeof hdr <= (guint)bytes_read; p++) {
+		q = p;
+		n = 0;
+		prev_sec = 0;
+		prev_frac = 0;
+		while (n < LIBPCAP_SYNC_RECORDS &&
+		    q + sizeof hdr <= (guint)bytes_read &&
+		    libpcap_plausible_header(wth, buf + q, &hdr)) {
+			if (n != 0 && (hdr.ts_sec < prev_sec ||
+			    (hdr.ts_sec == prev_sec && hdr.ts_usec < prev_frac)))
+				break;
+			prev_sec = hdr.ts_sec;
+			prev_frac = hdr.ts_usec;
+			q += (guint)sizeof hdr + hdr.incl_len;
+			n++;
+		}
+
+		/* A shorter run that ends exactly at the end of the file will do. */
+		if (n == LIBPCAP_SYNC_RECORDS ||
+		    (at_eof && n != 0 && q == (guint)bytes_read)) {
+			libpcap_plausible_header(wth, buf + p, &hdr);
+			*rec_offset = offset + p;
+			rec_ts->secs = hdr.ts_sec;
+			if (wth->tsprecision == WTAP_FILE_TSPREC_NSEC)
+				rec_ts->nsecs = hdr.ts_usec;
+			else
+				rec_ts->nsecs = hdr.ts_usec * 1000;
+			g_free(buf);
+			return TRUE;
+		}
+	}
+	g_free(buf);
+	return FALSE;
+}
+
+/*
+ * Amount of the file libpcap_scan_headers() reads at a time.
+ */
+#define LIBPCAP_SCAN_BUF_SIZE	(1024*1024)
+
+/*
+ * Walk the record headers in a buffer full of the file, without copying
+ * or post-processing the packet data.  Records bigger than the buffer
+ * are skipped by seeking past them.
+ *
+ * Only done for uncompressed files whose records have no pseudo-header
+ * and no padding, so that the lengths and time stamps come straight
+ * from the record header; other files are read record by record.
+ */
+static gboolean
+libpcap_scan_headers(wtap *wth, wtap_header_scan_t *scan, int *err,
+    gchar **err_info)
+{
+	struct pcaprec_hdr hdr;
+	guint8 *buf;
+	gint64 base, pos, avail, file_size, rec_end;
+	int hdr_size;
+	guint n;
+
+	if (file_iscompressed(wth->fh) ||
+	    wth->file_type == WTAP_FILE_PCAP_AIX ||
+	    wth->file_type == WTAP_FILE_PCAP_NOKIA ||
+	    pcap_has_file_pseudo_header(wth->file_encap)) {
+		/* Read the records the ordinary way. */
+		wth->subtype_scan_headers = NULL;
+		return wtap_scan_headers(wth, scan, err, err_info);
+	}
+
+	*err = 0;
+	file_size = wtap_file_size(wth, err);
+	if (file_size == -1)
+		return FALSE;
+	hdr_size = libpcap_record_header_size(wth);
+
+	/* Use the frame buffer, which we're not filling in, as scratch space. */
+	buffer_assure_space(wth->frame_buffer, LIBPCAP_SCAN_BUF_SIZE);
+	buf = buffer_start_ptr(wth->frame_buffer);
+
+	base = wth->data_offset;	/* file offset of buf[0] */
+	pos = 0;
+	avail = 0;
+	for (n = 0; n < scan->max_records; n++) {
+		if (avail - pos < hdr_size) {
+			/* Refill the buffer, starting at the next record. */
+			base += pos;
+			pos = 0;
+			if (file_seek(wth->fh, base, SEEK_SET, err) == -1)
+				break;
+			avail = file_read(buf, LIBPCAP_SCAN_BUF_SIZE, wth->fh);
+			if (avail < 0) {
+				*err = file_error(wth->fh, err_info);
+				avail = 0;
+				break;
+			}
+			if (avail < hdr_size) {
+				/* EOF, or a partial record header */
+				if (avail != 0)
+					*err = WTAP_ERR_SHORT_READ;
+				break;
+			}
+		}
+
+		memcpy(&hdr, buf + pos, sizeof hdr);
+		adjust_header(wth, &hdr);
+		if (hdr.incl_len > WTAP_MAX_PACKET_SIZE ||
+		    hdr.orig_len > WTAP_MAX_PACKET_SIZE) {
+			*err = WTAP_ERR_BAD_RECORD;
+			*err_info = g_strdup_printf("pcap: File has %u-byte packet, bigger than maximum of %u",
+			    MAX(hdr.incl_len, hdr.orig_len), WTAP_MAX_PACKET_SIZE);
+			break;
+		}
+		rec_end = pos + hdr_size + hdr.incl_len;
+		if (base + rec_end > file_size) {
+			*err = WTAP_ERR_SHORT_READ;
+			break;
+		}
+
+		scan->offsets[n] = base + pos + hdr_size;
+		scan->caplens[n] = hdr.incl_len;
+		scan->lens[n] = hdr.orig_len;
+		scan->ts[n].secs = hdr.ts_sec;
+		if (wth->tsprecision == WTAP_FILE_TSPREC_NSEC)
+			scan->ts[n].nsecs = hdr.ts_usec;
+		else
+			scan->ts[n].nsecs = hdr.ts_usec * 1000;
+		scan->pkt_encaps[n] = wth->file_encap;
+		pos = rec_end;
+	}
+	scan->num_records = n;
+
+	/* Leave the file positioned after the last record scanned. */
+	wth->data_offset = base + pos;
+	if (pos != avail && *err == 0 &&
+	    file_seek(wth->fh, wth->data_offset, SEEK_SET, err) == -1)
+		return FALSE;
+	return *err == 0 && n == scan->max_records;
+}
+
 static gboolean
 libpcap_read_rec_data(FILE_T fh, guint8 *pd, int length, int *err,
     gchar **err_info)
@@ -1622,6 +1622,31 @@ pcap_process_pseudo_header(FILE_T fh, int file_type, int wtap_encap,
 	return phdr_len;
 }
 
+/*
+ * Does pcap_process_pseudo_header() read a pseudo-header from in front
+ * of the packet data of records with this encapsulation?  If so, the
+ * packet's length, captured length and data offset aren't the ones in
+ * the record header.
+ */
+gboolean
+pcap_has_file_pseudo_header(int wtap_encap)
+{
+	switch (wtap_encap) {
+
+	case WTAP_ENCAP_ATM_PDUS:
+	case WTAP_ENCAP_IRDA:
+	case WTAP_ENCAP_MTP2_WITH_PHDR:
+	case WTAP_ENCAP_LINUX_LAPD:
+	case WTAP_ENCAP_SITA:
+	case WTAP_ENCAP_BLUETOOTH_H4_WITH_PHDR:
+	case WTAP_ENCAP_PPP_WITH_PHDR:
+	case WTAP_ENCAP_ERF:
+	case WTAP_ENCAP_I2C:
+		return TRUE;
+	}
+	return FALSE;
+}
+
 void
 pcap_read_post_process(int file_type, int wtap_encap,
     union wtap_pseudo_header *pseudo_header,
@@ -1759,6 +1784,45 @@ pcap_get_phdr_size(int encap, const union wtap_pseudo_header *pseudo_header)
 	return hdrsize;
 }
 
+/*
+ * Can wtap_pcap_fill_in_pseudo_header() handle packets with the given
+ * encapsulation?  If not, they have to be read from a capture file.
+ */
+gboolean
+wtap_pcap_can_fill_in_pseudo_header(int wtap_encap)
+{
+	return wtap_encap != WTAP_ENCAP_UNKNOWN &&
+	    !pcap_has_file_pseudo_header(wtap_encap);
+}
+
+/*
+ * Fill in the pseudo-header for a packet whose raw data came from
+ * somewhere other than a capture file, such as a capture ring shared
+ * with dumpcap.
+ *
+ * That only works for encapsulations whose pseudo-header isn't stored
+ * in front of the packet data; for the others, return FALSE, and the
+ * caller should read the packet from the capture file instead.
+ */
+gboolean
+wtap_pcap_fill_in_pseudo_header(int wtap_encap, guint8 *pd, guint caplen,
+    union wtap_pseudo_header *pseudo_header)
+{
+	int err;
+	gchar *err_info;
+
+	if (!wtap_pcap_can_fill_in_pseudo_header(wtap_encap))
+		return FALSE;
+
+	memset(pseudo_header, 0, sizeof *pseudo_header);
+	if (pcap_process_pseudo_header(NULL, WTAP_FILE_PCAP, wtap_encap,
+	    caplen, FALSE, NULL, pseudo_header, &err, &err_info) != 0)
+		return FALSE;
+	pcap_read_post_process(WTAP_FILE_PCAP, wtap_encap, pseudo_header,
+	    pd, caplen, FALSE, -1);
+	return TRUE;
+}
+
 gboolean
 pcap_write_phdr(wtap_dumper *wdh, int encap, const union wtap_pseudo_header *pseudo_header,
     int *err)
@@ -34,6 +34,8 @@ extern int pcap_process_pseudo_header(FILE_T fh, int file_type, int wtap_encap,
     guint packet_size, gboolean check_packet_size, struct wtap_pkthdr *phdr,
     union wtap_pseudo_header *pseudo_header, int *err, gchar **err_info);
 
+extern gboolean pcap_has_file_pseudo_header(int wtap_encap);
+
 extern void pcap_read_post_process(int file_type, int wtap_encap,
     union wtap_pseudo_header *pseudo_header,
     guint8 *pd, guint packet_size, gboolean bytes_swapped, int fcs_len);
@@ -32,5 +32,8 @@
 
 extern int wtap_pcap_encap_to_wtap_encap(int encap);
 extern int wtap_wtap_encap_to_pcap_encap(int encap);
+extern gboolean wtap_pcap_can_fill_in_pseudo_header(int wtap_encap);
+extern gboolean wtap_pcap_fill_in_pseudo_header(int wtap_encap, guint8 *pd,
+    guint caplen, union wtap_pseudo_header *pseudo_header);
 
 #endif
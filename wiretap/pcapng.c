@@ -89,6 +89,9 @@ static gboolean
 pcapng_seek_read(wtap *wth, gint64 seek_off,
     union wtap_pseudo_header *pseudo_header, guint8 *pd, int length,
     int *err, gchar **err_info);
+static gboolean
+pcapng_index_seek(wtap *wth, const wtap_frame_index_entry_t *entry,
+    int *err, gchar **err_info);
 static void
 pcapng_close(wtap *wth);
 
@@ -166,6 +169,39 @@ typedef struct pcapng_interface_statistics_block_s {
 	/* ... Options ... */
 } pcapng_interface_statistics_block_t;
 
+/*
+ * pcapng: packet index block (local use; see BLOCK_TYPE_IDX)
+ *
+ * Written as the last block of the file; the trailing block total length
+ * lets a reader find it by looking at the end of the file.  It's followed
+ * by "num_interfaces" 64-bit file offsets of the IDBs, in interface ID
+ * order, and then "num_entries" index entries.  It only describes the
+ * section it's in, so a reader can only use it if that section is the
+ * first and only one in the file.
+ */
+typedef struct pcapng_index_block_s {
+	guint32 stride;		/* packets between index entries */
+	guint32 num_interfaces;
+	guint32 num_entries;
+	guint32 reserved;
+	guint64 block_offset;	/* file offset of this block, as a sanity check */
+	guint64 section_offset;	/* file offset of the SHB of this section */
+	/* ... IDB offsets ... */
+	/* ... Index entries ... */
+} pcapng_index_block_t;
+
+typedef struct pcapng_index_entry_s {
+	guint32 frame_num;	/* 1-origin packet number */
+	guint32 if_count;	/* IDBs written before this packet */
+	guint64 offset;		/* file offset of the packet's block */
+	guint64 prev_max_secs;	/* latest time stamp of any earlier packet */
+	guint32 prev_max_nsecs;
+	guint32 reserved;
+} pcapng_index_entry_t;
+
+/* Packets between entries in the index block we write */
+#define PCAPNG_INDEX_STRIDE	1024
+
 /* pcapng: common option header for every option type */
 typedef struct pcapng_option_header_s {
 	guint16 option_code;
@@ -182,6 +218,7 @@ typedef struct pcapng_option_header_s {
 #define BLOCK_TYPE_ISB 0x00000005 /* Interface Statistics Block */
 #define BLOCK_TYPE_EPB 0x00000006 /* Enhanced Packet Block */
 #define BLOCK_TYPE_SHB 0x0A0D0D0A /* Section Header Block */
+#define BLOCK_TYPE_IDX 0x80000100 /* Packet Index Block (local use, MSB set) */
 
 
 
@@ -314,6 +351,8 @@ typedef struct {
 	gint8 if_fcslen;
 	GArray *interface_data;
 	guint number_of_interfaces;
+	guint interfaces_passed;	/* IDBs before the sequential read position */
+	GArray *idb_offsets;		/* from the index block; NULL if none */
 	wtap_new_ipv4_callback_t add_new_ipv4;
 	wtap_new_ipv6_callback_t add_new_ipv6;
 } pcapng_t;
@@ -561,6 +600,7 @@ pcapng_read_section_header_block(FILE_T fh, gboolean first_block,
 	}
 	pn->interface_data = g_array_new(FALSE, FALSE, sizeof(interface_data_t));
 	pn->number_of_interfaces = 0;
+	pn->interfaces_passed = 0;
 
 	return block_read;
 }
@@ -760,10 +800,20 @@ pcapng_read_if_descr_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn,
 		}
 	}
 
+	/*
+	 * If the packet index moved us back in the file, we've already
+	 * seen this interface; don't add it a second time.
+	 */
+	if (pn->interfaces_passed < pn->number_of_interfaces) {
+		pn->interfaces_passed++;
+		return block_read;
+	}
+
 	int_data.wtap_encap = encap;
 	int_data.time_units_per_second = time_units_per_second;
 	g_array_append_val(pn->interface_data, int_data);
 	pn->number_of_interfaces++;
+	pn->interfaces_passed++;
 	return block_read;
 }
 
@@ -1406,6 +1456,10 @@ pcapng_read_block(FILE_T fh, gboolean first_block, pcapng_t *pn, wtapng_block_t
 		case(BLOCK_TYPE_ISB):
 			bytes_read = pcapng_read_interface_statistics_block(fh, &bh, pn, wblock, err, err_info);
 			break;
+		case(BLOCK_TYPE_IDX):
+			/* only of interest to pcapng_read_index() */
+			bytes_read = pcapng_read_unknown_block(fh, &bh, pn, wblock, err, err_info);
+			break;
 		default:
 			pcapng_debug2("pcapng_read_block: Unknown block_type: 0x%x (block ignored), block total length %d", bh.block_type, bh.block_total_length);
 			bytes_read = pcapng_read_unknown_block(fh, &bh, pn, wblock, err, err_info);
@@ -1442,6 +1496,142 @@ pcapng_read_block(FILE_T fh, gboolean first_block, pcapng_t *pn, wtapng_block_t
 }
 
 
+/*
+ * Look for a packet index block at the end of the file and, if there's
+ * a usable one, load it into wth->frame_index.  A missing or damaged
+ * index, or one for a later section, isn't an error; we just don't have
+ * one.  "section_length" is the length the first SHB gives its section.  Returns FALSE only if
+ * we can't get back to where the sequential reader was.
+ */
+static gboolean
+pcapng_read_index(wtap *wth, pcapng_t *pn, guint64 section_length,
+    int *err, gchar **err_info)
+{
+	gint64 file_size;
+	gint64 block_offset;
+	guint32 block_total_length;
+	pcapng_block_header_t bh;
+	pcapng_index_block_t ib;
+	pcapng_index_entry_t ie;
+	wtap_frame_index_entry_t entry;
+	guint64 idb_offset;
+	GArray *frame_index = NULL;
+	GArray *idb_offsets = NULL;
+	guint i;
+
+	/* Only worth it if we can seek around in the file cheaply. */
+	if (file_iscompressed(wth->fh))
+		return TRUE;
+	file_size = wtap_file_size(wth, NULL);
+	if (file_size < wth->data_offset + (gint64)(sizeof bh + sizeof ib + 4))
+		return TRUE;
+	/* If the first section's length is known, the file must end with it */
+	if (section_length != (guint64)-1 &&
+	    (guint64)wth->data_offset + section_length != (guint64)file_size)
+		return TRUE;
+
+	if (file_seek(wth->fh, file_size - 4, SEEK_SET, err) == -1)
+		goto seek_back;
+	if (file_read(&block_total_length, sizeof block_total_length, wth->fh) != sizeof block_total_length)
+		goto seek_back;
+	if (pn->byte_swapped)
+		block_total_length = BSWAP32(block_total_length);
+	if (block_total_length % 4 != 0 ||
+	    block_total_length < sizeof bh + sizeof ib + 4 ||
+	    block_total_length > file_size - wth->data_offset)
+		goto seek_back;
+
+	block_offset = file_size - block_total_length;
+	if (file_seek(wth->fh, block_offset, SEEK_SET, err) == -1)
+		goto seek_back;
+	if (file_read(&bh, sizeof bh, wth->fh) != sizeof bh ||
+	    file_read(&ib, sizeof ib, wth->fh) != sizeof ib)
+		goto seek_back;
+	if (pn->byte_swapped) {
+		bh.block_type         = BSWAP32(bh.block_type);
+		bh.block_total_length = BSWAP32(bh.block_total_length);
+		ib.stride             = BSWAP32(ib.stride);
+		ib.num_interfaces     = BSWAP32(ib.num_interfaces);
+		ib.num_entries        = BSWAP32(ib.num_entries);
+		ib.block_offset       = BSWAP64(ib.block_offset);
+		ib.section_offset     = BSWAP64(ib.section_offset);
+	}
+	/*
+	 * The index must be for the section that starts at the beginning
+	 * of the file, the one we've read the SHB of; the block being
+	 * where it says it is means there's no other section before it
+	 * that its writer didn't know about.
+	 */
+	if (bh.block_type != BLOCK_TYPE_IDX ||
+	    bh.block_total_length != block_total_length ||
+	    ib.block_offset != (guint64)block_offset ||
+	    ib.section_offset != 0 ||
+	    (guint64)block_total_length != sizeof bh + sizeof ib +
+	        (guint64)ib.num_interfaces * sizeof idb_offset +
+	        (guint64)ib.num_entries * sizeof ie + 4) {
+		pcapng_debug0("pcapng_read_index: no usable packet index block");
+		goto seek_back;
+	}
+
+	idb_offsets = g_array_sized_new(FALSE, FALSE, sizeof(gint64), ib.num_interfaces);
+	for (i = 0; i < ib.num_interfaces; i++) {
+		if (file_read(&idb_offset, sizeof idb_offset, wth->fh) != sizeof idb_offset)
+			goto seek_back;
+		if (pn->byte_swapped)
+			idb_offset = BSWAP64(idb_offset);
+		if (idb_offset >= (guint64)block_offset)
+			goto seek_back;
+		g_array_append_val(idb_offsets, idb_offset);
+	}
+
+	frame_index = g_array_sized_new(FALSE, FALSE, sizeof(wtap_frame_index_entry_t), ib.num_entries);
+	for (i = 0; i < ib.num_entries; i++) {
+		if (file_read(&ie, sizeof ie, wth->fh) != sizeof ie)
+			goto seek_back;
+		if (pn->byte_swapped) {
+			ie.frame_num      = BSWAP32(ie.frame_num);
+			ie.if_count       = BSWAP32(ie.if_count);
+			ie.offset         = BSWAP64(ie.offset);
+			ie.prev_max_secs  = BSWAP64(ie.prev_max_secs);
+			ie.prev_max_nsecs = BSWAP32(ie.prev_max_nsecs);
+		}
+		/* entries must be in packet order, and point into this section */
+		if (ie.if_count > ib.num_interfaces ||
+		    ie.offset >= (guint64)block_offset ||
+		    ie.offset < (guint64)wth->data_offset ||
+		    (i > 0 && ie.frame_num <= g_array_index(frame_index, wtap_frame_index_entry_t, i - 1).frame_num))
+			goto seek_back;
+		entry.frame_num         = ie.frame_num;
+		entry.aux               = ie.if_count;
+		entry.offset            = (gint64)ie.offset;
+		entry.prev_max_ts.secs  = (time_t)ie.prev_max_secs;
+		entry.prev_max_ts.nsecs = (int)ie.prev_max_nsecs;
+		g_array_append_val(frame_index, entry);
+	}
+
+	pcapng_debug2("pcapng_read_index: %u index entries, stride %u", ib.num_entries, ib.stride);
+	wth->frame_index = frame_index;
+	pn->idb_offsets = idb_offsets;
+	frame_index = NULL;
+	idb_offsets = NULL;
+
+seek_back:
+	if (frame_index != NULL)
+		g_array_free(frame_index, TRUE);
+	if (idb_offsets != NULL)
+		g_array_free(idb_offsets, TRUE);
+	*err = 0;
+	file_clearerr(wth->fh);
+	if (file_seek(wth->fh, wth->data_offset, SEEK_SET, err) == -1) {
+		if (*err == 0)
+			*err = WTAP_ERR_CANT_SEEK;
+		*err_info = NULL;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+
 /* classic wtap: open capture file */
 int
 pcapng_open(wtap *wth, int *err, gchar **err_info)
@@ -1458,6 +1648,8 @@ pcapng_open(wtap *wth, int *err, gchar **err_info)
 	pn.version_minor = -1;
 	pn.interface_data = NULL;
 	pn.number_of_interfaces = 0;
+	pn.interfaces_passed = 0;
+	pn.idb_offsets = NULL;
 
 	/* we don't expect any packet blocks yet */
 	wblock.frame_buffer = NULL;
@@ -1496,9 +1688,14 @@ pcapng_open(wtap *wth, int *err, gchar **err_info)
 	*pcapng = pn;
 	wth->subtype_read = pcapng_read;
 	wth->subtype_seek_read = pcapng_seek_read;
+	wth->subtype_index_seek = pcapng_index_seek;
 	wth->subtype_close = pcapng_close;
 	wth->file_type = WTAP_FILE_PCAPNG;
 
+	if (!pcapng_read_index(wth, pcapng, wblock.data.section.section_length,
+	    err, err_info))
+		return -1;
+
 	return 1;
 }
 
@@ -1631,6 +1828,50 @@ pcapng_seek_read(wtap *wth, gint64 seek_off,
 }
 
 
+/* jump the sequential reader to a packet index entry */
+static gboolean
+pcapng_index_seek(wtap *wth, const wtap_frame_index_entry_t *entry,
+    int *err, gchar **err_info)
+{
+	pcapng_t *pcapng = (pcapng_t *)wth->priv;
+	wtapng_block_t wblock;
+	gint64 idb_offset;
+
+	/*
+	 * Packets at the entry may refer to interfaces whose IDBs we
+	 * haven't got to yet; read those before jumping.
+	 */
+	wblock.frame_buffer  = NULL;
+	wblock.pseudo_header = NULL;
+	wblock.packet_header = NULL;
+	wblock.file_encap    = &wth->file_encap;
+	while (pcapng->number_of_interfaces < entry->aux) {
+		idb_offset = g_array_index(pcapng->idb_offsets, gint64, pcapng->number_of_interfaces);
+		if (file_seek(wth->fh, idb_offset, SEEK_SET, err) == -1)
+			return FALSE;
+		pcapng->interfaces_passed = pcapng->number_of_interfaces;
+		if (pcapng_read_block(wth->fh, FALSE, pcapng, &wblock, err, err_info) <= 0) {
+			if (*err == 0)
+				*err = WTAP_ERR_SHORT_READ;
+			return FALSE;
+		}
+		if (wblock.type != BLOCK_TYPE_IDB) {
+			*err = WTAP_ERR_BAD_RECORD;
+			*err_info = g_strdup_printf("pcapng: packet index points to block type 0x%x, not an IDB",
+			    wblock.type);
+			return FALSE;
+		}
+	}
+
+	if (file_seek(wth->fh, entry->offset, SEEK_SET, err) == -1)
+		return FALSE;
+	pcapng->interfaces_passed = entry->aux;
+	wth->data_offset = entry->offset;
+	pcapng_debug2("pcapng_index_seek: packet %u at offset %" G_GINT64_MODIFIER "u", entry->frame_num, entry->offset);
+	return TRUE;
+}
+
+
 /* classic wtap: close capture file */
 static void
 pcapng_close(wtap *wth)
@@ -1641,6 +1882,9 @@ pcapng_close(wtap *wth)
 	if (pcapng->interface_data != NULL) {
 		g_array_free(pcapng->interface_data, TRUE);
 	}
+	if (pcapng->idb_offsets != NULL) {
+		g_array_free(pcapng->idb_offsets, TRUE);
+	}
 }
 
 
@@ -1649,6 +1893,11 @@ typedef struct {
 	GArray *interface_data;
 	guint number_of_interfaces;
 	struct addrinfo *addrinfo_list_last;
+	GArray *idb_offsets;		/* file offset of each IDB we wrote */
+	GArray *index;			/* pcapng_index_entry_t */
+	gint64 section_offset;		/* file offset of our SHB */
+	guint32 packet_count;
+	struct wtap_nstime max_ts;	/* latest time stamp written so far */
 } pcapng_dump_t;
 
 static gboolean
@@ -1901,6 +2150,50 @@ pcapng_write_name_resolution_block(wtap_dumper *wdh, pcapng_dump_t *pcapng, int
 }
 
 
+static gboolean
+pcapng_write_index_block(wtap_dumper *wdh, pcapng_dump_t *pcapng, int *err)
+{
+	pcapng_block_header_t bh;
+	pcapng_index_block_t ib;
+
+	/* write block header */
+	bh.block_type = BLOCK_TYPE_IDX;
+	bh.block_total_length = (guint32)(sizeof(bh) + sizeof(ib) +
+	    pcapng->idb_offsets->len * sizeof(guint64) +
+	    pcapng->index->len * sizeof(pcapng_index_entry_t) + 4);
+
+	if (!wtap_dump_file_write(wdh, &bh, sizeof bh, err))
+		return FALSE;
+
+	/* write block fixed content */
+	ib.stride         = PCAPNG_INDEX_STRIDE;
+	ib.num_interfaces = pcapng->idb_offsets->len;
+	ib.num_entries    = pcapng->index->len;
+	ib.reserved       = 0;
+	ib.block_offset   = wdh->bytes_dumped;
+	ib.section_offset = pcapng->section_offset;
+
+	if (!wtap_dump_file_write(wdh, &ib, sizeof ib, err))
+		return FALSE;
+
+	/* write the IDB offsets and the index entries */
+	if (!wtap_dump_file_write(wdh, pcapng->idb_offsets->data,
+	    pcapng->idb_offsets->len * sizeof(guint64), err))
+		return FALSE;
+	if (!wtap_dump_file_write(wdh, pcapng->index->data,
+	    pcapng->index->len * sizeof(pcapng_index_entry_t), err))
+		return FALSE;
+
+	/* write block footer */
+	if (!wtap_dump_file_write(wdh, &bh.block_total_length,
+	    sizeof bh.block_total_length, err))
+		return FALSE;
+	wdh->bytes_dumped += bh.block_total_length;
+
+	return TRUE;
+}
+
+
 static gboolean
 pcapng_write_block(wtap_dumper *wdh, /*pcapng_t *pn, */wtapng_block_t *wblock, int *err)
 {
@@ -1945,6 +2238,8 @@ static gboolean pcapng_dump(wtap_dumper *wdh,
 {
 	wtapng_block_t wblock;
 	interface_data_t int_data;
+	pcapng_index_entry_t index_entry;
+	guint64 idb_offset;
 	guint32 interface_id;
 	guint64 ts;
 	pcapng_dump_t *pcapng = (pcapng_dump_t *)wdh->priv;
@@ -1990,9 +2285,11 @@ static gboolean pcapng_dump(wtap_dumper *wdh,
 		wblock.data.if_descr.if_os      = NULL;
 		wblock.data.if_descr.if_fcslen  = -1;
 
+		idb_offset = wdh->bytes_dumped;
 		if (!pcapng_write_block(wdh, &wblock, err)) {
 			return FALSE;
 		}
+		g_array_append_val(pcapng->idb_offsets, idb_offset);
 
 		interface_id = pcapng->number_of_interfaces;
 		int_data.wtap_encap = phdr->pkt_encap;
@@ -2011,6 +2308,17 @@ static gboolean pcapng_dump(wtap_dumper *wdh,
 		pcapng_write_name_resolution_block(wdh, pcapng, err);
 	}
 
+	/* Remember where every PCAPNG_INDEX_STRIDE'th packet goes */
+	if (pcapng->packet_count % PCAPNG_INDEX_STRIDE == 0) {
+		index_entry.frame_num      = pcapng->packet_count + 1;
+		index_entry.if_count       = pcapng->number_of_interfaces;
+		index_entry.offset         = wdh->bytes_dumped;
+		index_entry.prev_max_secs  = (guint64)pcapng->max_ts.secs;
+		index_entry.prev_max_nsecs = (guint32)pcapng->max_ts.nsecs;
+		index_entry.reserved       = 0;
+		g_array_append_val(pcapng->index, index_entry);
+	}
+
 	wblock.frame_buffer  = pd;
 	wblock.pseudo_header = pseudo_header;
 	wblock.packet_header = NULL;
@@ -2039,20 +2347,37 @@ static gboolean pcapng_dump(wtap_dumper *wdh,
 		return FALSE;
 	}
 
+	/* Keep the time stamp as a reader will see it, i.e. in microseconds */
+	pcapng->packet_count++;
+	if (phdr->ts.secs > pcapng->max_ts.secs ||
+	    (phdr->ts.secs == pcapng->max_ts.secs &&
+	     (phdr->ts.nsecs / 1000) * 1000 > pcapng->max_ts.nsecs)) {
+		pcapng->max_ts.secs  = phdr->ts.secs;
+		pcapng->max_ts.nsecs = (phdr->ts.nsecs / 1000) * 1000;
+	}
+
 	return TRUE;
 }
 
 
 /* Finish writing to a dump file.
    Returns TRUE on success, FALSE on failure. */
-static gboolean pcapng_dump_close(wtap_dumper *wdh, int *err _U_)
+static gboolean pcapng_dump_close(wtap_dumper *wdh, int *err)
 {
 	pcapng_dump_t *pcapng = (pcapng_dump_t *)wdh->priv;
+	gboolean ret = TRUE;
 
 	pcapng_debug0("pcapng_dump_close");
+
+	/* Small files can be walked quickly enough without an index */
+	if (pcapng->index->len > 1)
+		ret = pcapng_write_index_block(wdh, pcapng, err);
+
 	g_array_free(pcapng->interface_data, TRUE);
+	g_array_free(pcapng->idb_offsets, TRUE);
+	g_array_free(pcapng->index, TRUE);
 	pcapng->number_of_interfaces = 0;
-	return TRUE;
+	return ret;
 }
 
 
@@ -2076,6 +2401,8 @@ pcapng_dump_open(wtap_dumper *wdh, int *err)
 	pcapng = (pcapng_dump_t *)g_malloc0(sizeof(pcapng_dump_t));
 	wdh->priv = (void *)pcapng;
 	pcapng->interface_data = g_array_new(FALSE, FALSE, sizeof(interface_data_t));
+	pcapng->idb_offsets = g_array_new(FALSE, FALSE, sizeof(guint64));
+	pcapng->index = g_array_new(FALSE, FALSE, sizeof(pcapng_index_entry_t));
 
 	/* write the section header block */
 	wblock.type = BLOCK_TYPE_SHB;
@@ -2087,6 +2414,7 @@ pcapng_dump_open(wtap_dumper *wdh, int *err)
 	wblock.data.section.shb_os        = NULL;
 	wblock.data.section.shb_user_appl = NULL;
 
+	pcapng->section_offset = wdh->bytes_dumped;
 	if (!pcapng_write_block(wdh, &wblock, err)) {
 		return FALSE;
 	}
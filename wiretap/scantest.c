@@ -0,0 +1,208 @@
+/* Standalone program to test wtap_scan_headers() against wtap_read().
+ *
+ * scantest : scantest.o libwiretap.la
+ *
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wtap.h"
+
+/* Records in each test file; together they're bigger than the buffer
+ * the libpcap scanner reads the file into, so some records cross it */
+#define NUM_RECORDS	60
+
+/* Records scanned at a time */
+#define SCAN_RECORDS	7
+
+static const char *file_name = "scantest.pcap";
+
+gboolean failed = FALSE;
+
+static void
+put32(FILE *fp, guint32 v)
+{
+	fwrite(&v, sizeof v, 1, fp);
+}
+
+static void
+put16(FILE *fp, guint16 v)
+{
+	fwrite(&v, sizeof v, 1, fp);
+}
+
+/* Write a libpcap file, in host byte order, with the given link-layer
+ * header type.  Each packet starts with phdr_len bytes of pseudo-header
+ * that the pcap reader takes off. */
+static gboolean
+write_file(guint32 linktype, guint phdr_len)
+{
+	FILE *fp;
+	guint8 data[20000];
+	guint i, len;
+
+	fp = fopen(file_name, "wb");
+	if (fp == NULL) {
+		printf("Can't create %s\n", file_name);
+		return FALSE;
+	}
+	put32(fp, 0xa1b2c3d4);
+	put16(fp, 2);
+	put16(fp, 4);
+	put32(fp, 0);
+	put32(fp, 0);
+	put32(fp, 65535);
+	put32(fp, linktype);
+
+	for (i = 0; i < NUM_RECORDS; i++) {
+		len = phdr_len + 14 + (i * 4999) % (sizeof data - phdr_len - 14);
+		memset(data, 0, phdr_len);
+		memset(data + phdr_len, (int) i, len - phdr_len);
+		put32(fp, 1300000000 + i);
+		put32(fp, i * 1000);
+		put32(fp, len);
+		/* some records are cut short */
+		put32(fp, i % 3 == 0 ? len + 100 : len);
+		fwrite(data, len, 1, fp);
+	}
+
+	if (fclose(fp) != 0) {
+		printf("Can't write %s\n", file_name);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Scan the file, then read it, and check that the two agree */
+static gboolean
+test_scan(const char *name, guint32 linktype, guint phdr_len)
+{
+	wtap *wth;
+	wtap_header_scan_t *scan;
+	gint64 *offsets;
+	guint32 *caplens, *lens;
+	struct wtap_nstime *ts;
+	int *pkt_encaps;
+	guint n, i;
+	gboolean more;
+	gint64 data_offset;
+	struct wtap_pkthdr *phdr;
+	int err;
+	gchar *err_info;
+
+	if (!write_file(linktype, phdr_len)) {
+		failed = TRUE;
+		return FALSE;
+	}
+
+	offsets = g_new(gint64, NUM_RECORDS + SCAN_RECORDS);
+	caplens = g_new(guint32, NUM_RECORDS + SCAN_RECORDS);
+	lens = g_new(guint32, NUM_RECORDS + SCAN_RECORDS);
+	ts = g_new(struct wtap_nstime, NUM_RECORDS + SCAN_RECORDS);
+	pkt_encaps = g_new(int, NUM_RECORDS + SCAN_RECORDS);
+
+	wth = wtap_open_offline(file_name, &err, &err_info, FALSE);
+	if (wth == NULL) {
+		printf("01: Failed %s Can't open: %s\n", name, wtap_strerror(err));
+		failed = TRUE;
+		return FALSE;
+	}
+	scan = wtap_header_scan_new(SCAN_RECORDS);
+	n = 0;
+	do {
+		more = wtap_scan_headers(wth, scan, &err, &err_info);
+		for (i = 0; i < scan->num_records; i++, n++) {
+			offsets[n] = scan->offsets[i];
+			caplens[n] = scan->caplens[i];
+			lens[n] = scan->lens[i];
+			ts[n] = scan->ts[i];
+			pkt_encaps[n] = scan->pkt_encaps[i];
+		}
+	} while (more && n <= NUM_RECORDS);
+	wtap_header_scan_free(scan);
+	wtap_close(wth);
+	if (err != 0) {
+		printf("02: Failed %s Scan error: %s\n", name, wtap_strerror(err));
+		failed = TRUE;
+		return FALSE;
+	}
+	if (n != NUM_RECORDS) {
+		printf("03: Failed %s Scanned %u records, not %u\n", name, n, NUM_RECORDS);
+		failed = TRUE;
+		return FALSE;
+	}
+
+	wth = wtap_open_offline(file_name, &err, &err_info, FALSE);
+	if (wth == NULL) {
+		printf("01: Failed %s Can't open: %s\n", name, wtap_strerror(err));
+		failed = TRUE;
+		return FALSE;
+	}
+	for (n = 0; wtap_read(wth, &err, &err_info, &data_offset); n++) {
+		phdr = wtap_phdr(wth);
+		if (n >= NUM_RECORDS ||
+		    offsets[n] != data_offset ||
+		    caplens[n] != phdr->caplen ||
+		    lens[n] != phdr->len ||
+		    ts[n].secs != phdr->ts.secs ||
+		    ts[n].nsecs != phdr->ts.nsecs ||
+		    pkt_encaps[n] != phdr->pkt_encap) {
+			printf("04: Failed %s Record %u scanned differently from how it reads\n",
+			    name, n + 1);
+			failed = TRUE;
+			wtap_close(wth);
+			return FALSE;
+		}
+	}
+	wtap_close(wth);
+	if (err != 0 || n != NUM_RECORDS) {
+		printf("05: Failed %s Read %u records, not %u\n", name, n, NUM_RECORDS);
+		failed = TRUE;
+		return FALSE;
+	}
+
+	g_free(offsets);
+	g_free(caplens);
+	g_free(lens);
+	g_free(ts);
+	g_free(pkt_encaps);
+
+	printf("Passed %s\n", name);
+	return TRUE;
+}
+
+int
+main(void)
+{
+	/* No pseudo-header, so the records are scanned in place */
+	test_scan("Ethernet", 1, 0);
+	/* Pseudo-headers in front of the data, which the scan must not
+	 * count as packet data */
+	test_scan("Bluetooth H4 with pseudo-header", 201, 4);
+	test_scan("PPP with pseudo-header", 204, 1);
+
+	remove(file_name);
+	exit(failed?1:0);
+}
@@ -41,9 +41,30 @@
 
 int wtap_fstat(wtap *wth, ws_statb64 *statb, int *err);
 
+/*
+ * One entry of a frame index, mapping a record number to the file
+ * offset at which the sequential reader can pick up that record.
+ *
+ * "prev_max_ts" is the latest time stamp of any record *before* this
+ * one; it never decreases from one entry to the next, so it can be
+ * binary-searched even if the records themselves aren't in time order.
+ */
+typedef struct wtap_frame_index_entry_s {
+	guint32			frame_num;	/* 1-origin number of the record */
+	guint32			aux;		/* format-specific; pcap-ng interface count */
+	gint64			offset;		/* sequential file offset of the record */
+	struct wtap_nstime	prev_max_ts;
+} wtap_frame_index_entry_t;
+
 typedef gboolean (*subtype_read_func)(struct wtap*, int*, char**, gint64*);
 typedef gboolean (*subtype_seek_read_func)(struct wtap*, gint64, union wtap_pseudo_header*,
 					guint8*, int, int *, char **);
+typedef gboolean (*subtype_index_seek_func)(struct wtap*,
+					const wtap_frame_index_entry_t*, int *, char **);
+typedef gboolean (*subtype_find_record_func)(struct wtap*, gint64, gint64 *,
+					struct wtap_nstime *, int *, char **);
+typedef gboolean (*subtype_scan_headers_func)(struct wtap*,
+					wtap_header_scan_t *, int *, char **);
 struct wtap {
 	FILE_T			fh;
 	FILE_T			random_fh;    /* Secondary FILE_T for random access */
@@ -70,6 +91,17 @@ struct wtap {
 	wtap_new_ipv4_callback_t add_new_ipv4;
 	wtap_new_ipv6_callback_t add_new_ipv6;
 	GPtrArray *fast_seek;
+	GArray			*frame_index;	/* wtap_frame_index_entry_t, sorted by
+						   frame_num; NULL if the file has none */
+	subtype_index_seek_func	subtype_index_seek;	/* NULL: plain file_seek() */
+	subtype_find_record_func subtype_find_record;	/* find the first record at
+							   or after an offset, for
+							   bisecting by time */
+	wtap_read_window_t	window;		/* see wtap_set_read_window() */
+	gboolean		window_active;
+	gboolean		window_done;	/* read past the end of the window */
+	guint32			window_next_frame;	/* 0 if not known */
+	subtype_scan_headers_func subtype_scan_headers;	/* NULL: use subtype_read */
 };
 
 struct wtap_dumper;
@@ -675,6 +675,9 @@ wtap_close(wtap *wth)
 		g_ptr_array_foreach(wth->fast_seek, g_fast_seek_item_free, NULL);
 		g_ptr_array_free(wth->fast_seek, TRUE);
 	}
+
+	if (wth->frame_index != NULL)
+		g_array_free(wth->frame_index, TRUE);
 	g_free(wth);
 }
 
@@ -694,9 +697,43 @@ void wtap_set_cb_new_ipv6(wtap *wth, wtap_new_ipv6_callback_t add_new_ipv6) {
 		wth->add_new_ipv6 = add_new_ipv6;
 }
 
+static int
+wtap_nstime_cmp(const struct wtap_nstime *a, const struct wtap_nstime *b)
+{
+	if (a->secs != b->secs)
+		return (a->secs < b->secs) ? -1 : 1;
+	if (a->nsecs != b->nsecs)
+		return (a->nsecs < b->nsecs) ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Check whether the record just read is past the end of the read
+ * window, if there is one.
+ */
+static gboolean
+wtap_past_window(wtap *wth)
+{
+	if (wth->window_next_frame != 0) {
+		if (wth->window.last_frame != 0 &&
+		    wth->window_next_frame > wth->window.last_frame)
+			return TRUE;
+		wth->window_next_frame++;
+	}
+	if (wth->window.has_stop_time && wth->window.time_ordered &&
+	    wtap_nstime_cmp(&wth->phdr.ts, &wth->window.stop_time) >= 0)
+		return TRUE;
+	return FALSE;
+}
+
 gboolean
 wtap_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
 {
+	if (wth->window_done) {
+		*err = 0;
+		return FALSE;	/* already past the end of the read window */
+	}
+
 	/*
 	 * Set the packet encapsulation to the file's encapsulation
 	 * value; if that's not WTAP_ENCAP_PER_PACKET, it's the
@@ -737,9 +774,77 @@ wtap_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
 	 */
 	g_assert(wth->phdr.pkt_encap != WTAP_ENCAP_PER_PACKET);
 
+	if (wth->window_active && wtap_past_window(wth)) {
+		wth->window_done = TRUE;
+		*err = 0;
+		return FALSE;
+	}
+
 	return TRUE;	/* success */
 }
 
+wtap_header_scan_t *
+wtap_header_scan_new(guint max_records)
+{
+	wtap_header_scan_t *scan;
+
+	scan = g_new(wtap_header_scan_t, 1);
+	scan->max_records = max_records;
+	scan->num_records = 0;
+	scan->offsets = g_new(gint64, max_records);
+	scan->caplens = g_new(guint32, max_records);
+	scan->lens = g_new(guint32, max_records);
+	scan->ts = g_new(struct wtap_nstime, max_records);
+	scan->pkt_encaps = g_new(int, max_records);
+	return scan;
+}
+
+void
+wtap_header_scan_free(wtap_header_scan_t *scan)
+{
+	g_free(scan->offsets);
+	g_free(scan->caplens);
+	g_free(scan->lens);
+	g_free(scan->ts);
+	g_free(scan->pkt_encaps);
+	g_free(scan);
+}
+
+/*
+ * Read the headers of up to scan->max_records records, for callers that
+ * only want lengths and time stamps; formats that can find their record
+ * headers without reading the packet data do so.  Once a file has been
+ * scanned, wtap_buf_ptr() and wtap_pseudoheader() are meaningless, and
+ * scanning shouldn't be mixed with wtap_read().
+ *
+ * Returns TRUE if there may be more records, FALSE at EOF (with *err set
+ * to 0) or on an error; in all cases, scan->num_records records have
+ * been filled in.
+ */
+gboolean
+wtap_scan_headers(wtap *wth, wtap_header_scan_t *scan, int *err,
+	gchar **err_info)
+{
+	gint64 data_offset;
+	guint n;
+
+	*err = 0;
+	if (wth->subtype_scan_headers != NULL && !wth->window_active)
+		return wth->subtype_scan_headers(wth, scan, err, err_info);
+
+	for (n = 0; n < scan->max_records; n++) {
+		if (!wtap_read(wth, err, err_info, &data_offset))
+			break;
+		scan->offsets[n] = data_offset;
+		scan->caplens[n] = wth->phdr.caplen;
+		scan->lens[n] = wth->phdr.len;
+		scan->ts[n] = wth->phdr.ts;
+		scan->pkt_encaps[n] = wth->phdr.pkt_encap;
+	}
+	scan->num_records = n;
+	return n == scan->max_records;
+}
+
 /*
  * Return an approximation of the amount of data we've read sequentially
  * from the file so far.  (gint64, in case that's 64 bits.)
@@ -768,6 +873,250 @@ wtap_buf_ptr(wtap *wth)
 	return buffer_start_ptr(wth->frame_buffer);
 }
 
+/*
+ * Find the last frame index entry for a record numbered "frame_num"
+ * or lower; returns NULL if there isn't one.
+ */
+static const wtap_frame_index_entry_t *
+wtap_index_find_frame(wtap *wth, guint32 frame_num)
+{
+	wtap_frame_index_entry_t *entries;
+	guint lo, hi, mid;
+
+	if (wth->fh == NULL || wth->frame_index == NULL ||
+	    wth->frame_index->len == 0)
+		return NULL;
+
+	entries = (wtap_frame_index_entry_t *)wth->frame_index->data;
+	if (frame_num < entries[0].frame_num)
+		return NULL;
+
+	/* Find the last entry with entries[].frame_num <= frame_num. */
+	lo = 0;
+	hi = wth->frame_index->len;
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		if (entries[mid].frame_num <= frame_num)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return &entries[lo];
+}
+
+/*
+ * Find the last frame index entry such that every record before it has
+ * a time stamp earlier than "ts"; returns NULL if there's no index.
+ */
+static const wtap_frame_index_entry_t *
+wtap_index_find_time(wtap *wth, const struct wtap_nstime *ts)
+{
+	wtap_frame_index_entry_t *entries;
+	guint lo, hi, mid;
+
+	if (wth->fh == NULL || wth->frame_index == NULL ||
+	    wth->frame_index->len == 0)
+		return NULL;
+
+	entries = (wtap_frame_index_entry_t *)wth->frame_index->data;
+
+	/*
+	 * The first entry has nothing before it, so it always qualifies;
+	 * find the last entry whose prev_max_ts is before "ts".
+	 */
+	lo = 0;
+	hi = wth->frame_index->len;
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		if (wtap_nstime_cmp(&entries[mid].prev_max_ts, ts) < 0)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return &entries[lo];
+}
+
+/*
+ * Position the sequential side of the file at the given frame index
+ * entry, so that the next wtap_read() returns that record.
+ */
+static gboolean
+wtap_seek_to_index_entry(wtap *wth, const wtap_frame_index_entry_t *entry,
+	guint32 *found_frame, int *err, gchar **err_info)
+{
+	if (wth->subtype_index_seek != NULL) {
+		if (!wth->subtype_index_seek(wth, entry, err, err_info))
+			return FALSE;
+	} else {
+		if (file_seek(wth->fh, entry->offset, SEEK_SET, err) == -1)
+			return FALSE;
+		wth->data_offset = entry->offset;
+	}
+	wth->window_next_frame = entry->frame_num;
+	*found_frame = entry->frame_num;
+	return TRUE;
+}
+
+/*
+ * If the file has a frame index, position the sequential side of the
+ * file at the last indexed record numbered "frame_num" or lower, and
+ * return that record's number in "*found_frame"; the caller reads
+ * forward from there.
+ *
+ * Returns FALSE with *err set to 0 if there's no index entry to use,
+ * in which case the file position is unchanged.
+ */
+gboolean
+wtap_seek_to_frame(wtap *wth, guint32 frame_num, guint32 *found_frame,
+	int *err, gchar **err_info)
+{
+	const wtap_frame_index_entry_t *entry;
+
+	*err = 0;
+	entry = wtap_index_find_frame(wth, frame_num);
+	if (entry == NULL)
+		return FALSE;
+	return wtap_seek_to_index_entry(wth, entry, found_frame, err, err_info);
+}
+
+/*
+ * If the file has a frame index, position the sequential side of the
+ * file at the last indexed record such that every record before it
+ * has a time stamp earlier than "ts", and return that record's number
+ * in "*found_frame"; no record the caller skips can be at or after "ts".
+ *
+ * Returns FALSE with *err set to 0 if there's no index entry to use,
+ * in which case the file position is unchanged.
+ */
+gboolean
+wtap_seek_to_time(wtap *wth, const struct wtap_nstime *ts,
+	guint32 *found_frame, int *err, gchar **err_info)
+{
+	const wtap_frame_index_entry_t *entry;
+
+	*err = 0;
+	entry = wtap_index_find_time(wth, ts);
+	if (entry == NULL)
+		return FALSE;
+	return wtap_seek_to_index_entry(wth, entry, found_frame, err, err_info);
+}
+
+/*
+ * Don't bother bisecting less than this much of the file; reading it
+ * is about as cheap as the seeks it would take to skip it.
+ */
+#define WTAP_BISECT_MIN_SPAN	(256*1024)
+
+/*
+ * Binary-search an uncompressed file whose records are in time order
+ * for a point at or shortly before the first record at or after "ts",
+ * starting from the current sequential position, using the file type's
+ * record-finding routine.  Sets *moved if the sequential position was
+ * changed, in which case we no longer know the record number.
+ */
+static gboolean
+wtap_bisect_time(wtap *wth, const struct wtap_nstime *ts, gboolean *moved,
+	int *err, gchar **err_info)
+{
+	gint64 lo, hi, mid;
+	gint64 rec_offset;
+	struct wtap_nstime rec_ts;
+
+	*moved = FALSE;
+	if (wth->subtype_find_record == NULL || file_iscompressed(wth->fh))
+		return TRUE;	/* a scan would cost as much as reading it */
+	hi = wtap_file_size(wth, err);
+	if (hi == -1)
+		return FALSE;
+
+	/* "lo" is always the start of a record earlier than "ts" */
+	lo = wth->data_offset;
+	if (!wth->subtype_find_record(wth, lo, &rec_offset, &rec_ts, err,
+	    err_info) || wtap_nstime_cmp(&rec_ts, ts) >= 0) {
+		if (*err != 0)
+			return FALSE;
+		lo = wth->data_offset;
+		hi = lo;	/* nothing to skip */
+	}
+
+	while (hi - lo > WTAP_BISECT_MIN_SPAN) {
+		mid = lo + (hi - lo) / 2;
+		if (!wth->subtype_find_record(wth, mid, &rec_offset, &rec_ts,
+		    err, err_info)) {
+			if (*err != 0)
+				return FALSE;
+			hi = mid;	/* no recognizable record after mid */
+			continue;
+		}
+		if (rec_offset < hi && wtap_nstime_cmp(&rec_ts, ts) < 0)
+			lo = rec_offset;
+		else
+			hi = mid;
+	}
+
+	if (file_seek(wth->fh, lo, SEEK_SET, err) == -1)
+		return FALSE;
+	*moved = (lo != wth->data_offset);
+	wth->data_offset = lo;
+	return TRUE;
+}
+
+/*
+ * Restrict sequential reading to a window of records, given by record
+ * number and/or time stamp.  Call this before the first wtap_read().
+ *
+ * The sequential reader is moved to, or shortly before, the start of
+ * the window, using the file's frame index if it has one or, if the
+ * caller says the records are in time order, by binary-searching the
+ * file.  *first_frame is set to the number of the record the next
+ * wtap_read() will return, or to 0 if that isn't known.
+ *
+ * Records before the window that couldn't be skipped are still
+ * returned, so the caller should still check each record it gets.
+ * wtap_read() returns FALSE, with *err set to 0, once it reaches a
+ * record past "last_frame" or, for time-ordered files, a record at or
+ * after "stop_time".
+ */
+gboolean
+wtap_set_read_window(wtap *wth, const wtap_read_window_t *window,
+	guint32 *first_frame, int *err, gchar **err_info)
+{
+	const wtap_frame_index_entry_t *entry = NULL;
+	const wtap_frame_index_entry_t *time_entry;
+	guint32 found_frame;
+	gboolean moved;
+
+	*err = 0;
+	wth->window = *window;
+	wth->window_active = TRUE;
+	wth->window_done = FALSE;
+	wth->window_next_frame = 1;
+
+	/* Jump to whichever index entry gets us furthest into the file. */
+	if (window->first_frame > 1)
+		entry = wtap_index_find_frame(wth, window->first_frame);
+	if (window->has_start_time) {
+		time_entry = wtap_index_find_time(wth, &window->start_time);
+		if (entry == NULL ||
+		    (time_entry != NULL && time_entry->frame_num > entry->frame_num))
+			entry = time_entry;
+	}
+	if (entry != NULL) {
+		if (!wtap_seek_to_index_entry(wth, entry, &found_frame, err,
+		    err_info))
+			return FALSE;
+	} else if (window->has_start_time && window->time_ordered) {
+		if (!wtap_bisect_time(wth, &window->start_time, &moved, err,
+		    err_info))
+			return FALSE;
+		if (moved)
+			wth->window_next_frame = 0;
+	}
+
+	*first_frame = wth->window_next_frame;
+	return TRUE;
+}
+
 gboolean
 wtap_seek_read(wtap *wth, gint64 seek_off,
 	union wtap_pseudo_header *pseudo_header, guint8 *pd, int len,
@@ -903,6 +903,47 @@ gboolean wtap_seek_read (wtap *wth, gint64 seek_off,
 	union wtap_pseudo_header *pseudo_header, guint8 *pd, int len,
 	int *err, gchar **err_info);
 
+/* Jump the sequential reader close to (at or before) a given record or
+ * time stamp, using the file's frame index if it has one.  Returns FALSE
+ * with *err set to 0 if there's no index to use; *found_frame is set to
+ * the number of the record the next wtap_read() will return. */
+gboolean wtap_seek_to_frame(wtap *wth, guint32 frame_num,
+	guint32 *found_frame, int *err, gchar **err_info);
+gboolean wtap_seek_to_time(wtap *wth, const struct wtap_nstime *ts,
+	guint32 *found_frame, int *err, gchar **err_info);
+
+/* A window of records to read; see wtap_set_read_window() in wtap.c. */
+typedef struct wtap_read_window {
+	guint32		first_frame;	/* 1-origin; 0 or 1 means from the start */
+	guint32		last_frame;	/* 0 means no limit */
+	gboolean	has_start_time;
+	struct wtap_nstime start_time;
+	gboolean	has_stop_time;
+	struct wtap_nstime stop_time;	/* first time stamp *not* wanted */
+	gboolean	time_ordered;	/* caller vouches that the records are
+					   in time stamp order */
+} wtap_read_window_t;
+
+gboolean wtap_set_read_window(wtap *wth, const wtap_read_window_t *window,
+	guint32 *first_frame, int *err, gchar **err_info);
+
+/* Record headers, as arrays indexed by record; see wtap_scan_headers()
+   in wtap.c. */
+typedef struct wtap_header_scan {
+	guint		max_records;	/* size of the arrays */
+	guint		num_records;	/* number of records filled in */
+	gint64		*offsets;	/* offset of the record's data */
+	guint32		*caplens;
+	guint32		*lens;
+	struct wtap_nstime *ts;
+	int		*pkt_encaps;
+} wtap_header_scan_t;
+
+wtap_header_scan_t *wtap_header_scan_new(guint max_records);
+void wtap_header_scan_free(wtap_header_scan_t *scan);
+gboolean wtap_scan_headers(wtap *wth, wtap_header_scan_t *scan, int *err,
+	gchar **err_info);
+
 /*** get various information snippets about the current packet ***/
 struct wtap_pkthdr *wtap_phdr(wtap *wth);
 union wtap_pseudo_header *wtap_pseudoheader(wtap *wth);